@@ -7,6 +7,7 @@
 #include "common_logger.h"
 #include "common_utils.h"
 #include "common_utf8.h"
+#include "common_port_manager.h"
 
 #include "ws_client.h"
 #include "app_room_user.h"
@@ -37,14 +38,6 @@ static void *websocket_thread_func(void *ptr)
 	return 0;
 }
 
-static void *receive_thread_func(void *ptr)
-{
-	LiveMeetingRoom *room = (LiveMeetingRoom *)ptr;
-	room->receive_loop();
-
-	return 0;
-}
-
 ////////////////////////////////////////////////////////////
 
 LiveMeetingRoom::LiveMeetingRoom()
@@ -52,10 +45,21 @@ LiveMeetingRoom::LiveMeetingRoom()
 	m_initialized = false;
 	m_ws_thread_running = false;
 	m_websocket_client = NULL;
-	m_receive_thread_running = false;
+	m_receive_workers = NULL;
+	m_receive_worker_count = RTP_RECEIVE_DEFAULT_WORKERS;
+	m_audio_workers = NULL;
+	m_audio_fast_lane = false;
+	m_audio_realtime_priority = 0;
+	m_audio_socket_priority = -1;
+	m_bundle_mode = false;
+	m_audio_bundle = NULL;
 	m_rtp_audio_sender = NULL;
 	m_rtp_video_sender = NULL;
 	m_rtp_send_initialized = false;
+	m_video_fec_delta_percent = 0;
+	m_video_fec_key_percent = 0;
+	m_send_mtu = RTP_DEFAULT_MTU;
+	m_send_pmtu_discovery = false;
 
 	m_event_callback_func = NULL;
 	m_event_callback_arg = NULL;
@@ -96,15 +100,7 @@ void LiveMeetingRoom::free_context()
 #endif
 	}
 
-	if (m_receive_thread_running)
-	{
-		m_receive_thread_running = false;
-#ifdef _WIN32
-		m_receive_thread.join();
-#else
-		pthread_join(m_receive_thread, NULL);
-#endif
-	}
+	stop_receive();
 
 	if (m_websocket_client)
 	{
@@ -127,6 +123,9 @@ void LiveMeetingRoom::free_context()
 		m_rtp_video_sender = NULL;
 	}
 
+	//the senders were deleted, no packet is queued
+	m_pacer.stop();
+
 	std::map<std::string, RoomUser *>::iterator it = m_other_users_map.begin();
 	for (; it != m_other_users_map.end(); it++)
 	{
@@ -134,6 +133,35 @@ void LiveMeetingRoom::free_context()
 	}
 	m_other_users_map.clear();
 
+	//the receivers of the users unregister from the bundles when they are deleted
+	for (size_t i = 0; i < m_video_bundles.size(); i++)
+	{
+		PortManager::get_instance()->release_port(m_video_bundles[i]->get_port());
+		delete m_video_bundles[i];
+	}
+	m_video_bundles.clear();
+
+	if (m_audio_bundle)
+	{
+		PortManager::get_instance()->release_port(m_audio_bundle->get_port());
+		delete m_audio_bundle;
+		m_audio_bundle = NULL;
+	}
+
+	//the users unregister their sockets when they are deleted, so the
+	//worker reactors must be deleted after the users
+	if (m_receive_workers)
+	{
+		delete m_receive_workers;
+		m_receive_workers = NULL;
+	}
+
+	if (m_audio_workers)
+	{
+		delete m_audio_workers;
+		m_audio_workers = NULL;
+	}
+
 	m_rtp_send_initialized = false;
 	m_initialized = false;
 }
@@ -157,14 +185,28 @@ bool LiveMeetingRoom::is_signal_connected()
 
 void LiveMeetingRoom::stop_receive()
 {
-	if (m_receive_thread_running)
+	if (m_receive_workers)
 	{
-		m_receive_thread_running = false;
-#ifdef _WIN32
-		m_receive_thread.join();
-#else
-		pthread_join(m_receive_thread, NULL);
-#endif
+		m_receive_workers->stop();
+	}
+
+	if (m_audio_workers)
+	{
+		m_audio_workers->stop();
+	}
+}
+
+void LiveMeetingRoom::start_receive()
+{
+	//every user is pinned to one worker, the workers run their reactors in parallel
+	if (m_receive_workers && !m_receive_workers->start())
+	{
+		LOG_ERROR("Start receive workers error.");
+	}
+
+	if (m_audio_workers && !m_audio_workers->start())
+	{
+		LOG_ERROR("Start audio receive worker error.");
 	}
 }
 
@@ -206,41 +248,96 @@ void LiveMeetingRoom::websocket_pulse_loop()
 	}
 }
 
-void LiveMeetingRoom::receive_loop()
+void LiveMeetingRoom::set_receive_workers(int count)
 {
-	uint32_t count = 0;
-	while (m_receive_thread_running)
+	if (count < 1)
+	{
+		count = 1;
+	}
+	else if (count > RTP_RECEIVE_MAX_WORKERS)
 	{
+		count = RTP_RECEIVE_MAX_WORKERS;
+	}
+
+	m_receive_worker_count = count;
+}
+
+void LiveMeetingRoom::set_audio_fast_lane(bool enabled, int realtimePriority, int socketPriority)
+{
+	m_audio_fast_lane = enabled;
+	m_audio_realtime_priority = realtimePriority;
+	m_audio_socket_priority = socketPriority;
+}
+
+void LiveMeetingRoom::set_bundle_mode(bool enabled)
+{
+	m_bundle_mode = enabled;
+}
+
+bool LiveMeetingRoom::create_bundles()
+{
+	for (int i = 0; i < m_receive_workers->get_worker_count() + 1; i++)
+	{
+		//the last bundle is the audio bundle, it is on the audio worker if the fast lane is enabled
+		bool audio = i == m_receive_workers->get_worker_count();
+		if (audio && !m_audio_workers)
 		{
-#ifdef _WIN32
-			std::unique_lock<std::mutex> lock(m_receive_mutex);
-#else
-			pthread_mutex_lock(&m_receive_mutex);
-#endif
-			std::map<std::string, RoomUser *>::iterator it = m_other_users_map.begin();
-			for (; it != m_other_users_map.end(); it++)
-			{
-				RoomUser *usr = it->second;
-				usr->receive_audio();
-				usr->receive_video();
-				if (count % 2000 == 0)
-				{
-					usr->nat_pinhole();
-				}
-			}
-#ifdef _WIN32
-#else
-			pthread_mutex_unlock(&m_receive_mutex);
-#endif
-			count++;
+			break;
 		}
 
-		//sleep 4 milliseconds
-#ifdef _WIN32
-		std::this_thread::sleep_for(std::chrono::milliseconds(4));
-#else
-		usleep(1000 * 8);
-#endif
+		uint16_t port;
+		if (!PortManager::get_instance()->get_udp_port(port))
+		{
+			LOG_ERROR("No available ports for the bundle receiver");
+			return false;
+		}
+
+		RTPTransParamsV4 params;
+		params.bindIP = 0;
+		params.bindPort = port;
+		if (audio)
+		{
+			params.priority = m_audio_socket_priority;
+		}
+
+		RTPBundleReceiver *bundle = new (std::nothrow) RTPBundleReceiver();
+		if (!bundle)
+		{
+			PortManager::get_instance()->release_port(port);
+			return false;
+		}
+
+		if (!bundle->init(&params, audio ? m_audio_workers->get_reactor(0) : m_receive_workers->get_reactor(i)))
+		{
+			PortManager::get_instance()->release_port(port);
+			delete bundle;
+			return false;
+		}
+
+		if (audio)
+		{
+			m_audio_bundle = bundle;
+		}
+		else
+		{
+			m_video_bundles.push_back(bundle);
+		}
+	}
+
+	return true;
+}
+
+void LiveMeetingRoom::bind_user_receive(RoomUser *roomUser, const std::string &userUUID)
+{
+	int worker = m_receive_workers->select_worker(userUUID);
+	roomUser->set_receive_reactor(m_receive_workers->get_reactor(worker));
+	roomUser->set_audio_receive_reactor(m_audio_workers ? m_audio_workers->get_reactor(0) : NULL, m_audio_socket_priority);
+
+	//the bundles are registered to the reactors of the user, the streams are received on the same threads
+	if (m_bundle_mode && worker >= 0 && worker < (int)m_video_bundles.size())
+	{
+		RTPBundleReceiver *videoBundle = m_video_bundles[worker];
+		roomUser->set_bundle_receivers(videoBundle, m_audio_workers ? m_audio_bundle : videoBundle);
 	}
 }
 
@@ -262,6 +359,32 @@ bool LiveMeetingRoom::initialize(const std::string &websocket_ip, uint16_t webso
 	{
 		goto exitFlag;
 	}
+
+	m_receive_workers = new (std::nothrow) RTPReceiveWorkerPool();
+	if (!m_receive_workers || !m_receive_workers->init(m_receive_worker_count))
+	{
+		LOG_ERROR("create the receive workers error.");
+		goto exitFlag;
+	}
+
+	//the audio of all the users is received on one thread, it never waits behind the video
+	if (m_audio_fast_lane)
+	{
+		m_audio_workers = new (std::nothrow) RTPReceiveWorkerPool();
+		if (!m_audio_workers || !m_audio_workers->init(1))
+		{
+			LOG_ERROR("create the audio receive worker error.");
+			goto exitFlag;
+		}
+		m_audio_workers->set_realtime_priority(m_audio_realtime_priority);
+	}
+
+	if (m_bundle_mode && !create_bundles())
+	{
+		LOG_ERROR("create the bundle receivers error.");
+		goto exitFlag;
+	}
+
 	m_websocket_client->set_text_received_func(websocket_received, this);
 	m_websocket_client->set_ws_event_func(websocket_event, this);
 
@@ -291,6 +414,17 @@ bool LiveMeetingRoom::initialize(const std::string &websocket_ip, uint16_t webso
 		goto exitFlag;
 	}
 
+	//the keyframe bursts overflow the shallow router queues, the packets are sent unpaced if the pacer fails
+	if (m_pacer.start(RTP_PACER_DEFAULT_BITRATE))
+	{
+		m_rtp_audio_sender->set_pacer(&m_pacer);
+		m_rtp_video_sender->set_pacer(&m_pacer);
+	}
+	else
+	{
+		LOG_WARNING("the send pacer start failed");
+	}
+
 	m_initialized = true;
 	return true;
 
@@ -719,6 +853,26 @@ void LiveMeetingRoom::add_sender_destination(const std::string &majorVideoIP,
 			LOG_ERROR("rtp video session initialize failed");
 			return;
 		}
+		m_rtp_video_sender->set_fec_protection(m_video_fec_delta_percent, m_video_fec_key_percent);
+
+		m_rtp_audio_sender->set_mtu(m_send_mtu);
+		m_rtp_video_sender->set_mtu(m_send_mtu);
+		if (m_send_pmtu_discovery &&
+			(!m_rtp_audio_sender->set_pmtu_discovery(true) || !m_rtp_video_sender->set_pmtu_discovery(true)))
+		{
+			LOG_WARNING("rtp path mtu discovery enable failed");
+		}
+
+		//the receiver reports from the server arrive on the sender sockets
+		if (!m_rtp_audio_sender->start_rtcp(m_receive_workers->get_reactor(0)))
+		{
+			LOG_WARNING("rtp audio session rtcp start failed");
+		}
+
+		if (!m_rtp_video_sender->start_rtcp(m_receive_workers->get_reactor(0)))
+		{
+			LOG_WARNING("rtp video session rtcp start failed");
+		}
 
 		m_rtp_send_initialized = true;
 	}
@@ -727,6 +881,125 @@ void LiveMeetingRoom::add_sender_destination(const std::string &majorVideoIP,
 	m_rtp_video_sender->add_destination(majorVideoIP.c_str(), majorVideoPort_);
 }
 
+bool LiveMeetingRoom::get_video_send_stats(RTCPSendStats &stats)
+{
+	if (!m_rtp_send_initialized || !m_rtp_video_sender)
+	{
+		return false;
+	}
+
+	m_rtp_video_sender->get_rtcp_stats(stats);
+	return true;
+}
+
+bool LiveMeetingRoom::get_audio_send_stats(RTCPSendStats &stats)
+{
+	if (!m_rtp_send_initialized || !m_rtp_audio_sender)
+	{
+		return false;
+	}
+
+	m_rtp_audio_sender->get_rtcp_stats(stats);
+	return true;
+}
+
+void LiveMeetingRoom::set_video_fec_protection(int deltaPercent, int keyPercent)
+{
+	m_video_fec_delta_percent = deltaPercent;
+	m_video_fec_key_percent = keyPercent;
+
+	if (m_rtp_video_sender)
+	{
+		m_rtp_video_sender->set_fec_protection(deltaPercent, keyPercent);
+	}
+}
+
+void LiveMeetingRoom::set_send_mtu(int mtu, bool pmtuDiscovery)
+{
+	m_send_mtu = mtu;
+	m_send_pmtu_discovery = pmtuDiscovery;
+
+	if (m_rtp_send_initialized && m_rtp_audio_sender && m_rtp_video_sender)
+	{
+		m_rtp_audio_sender->set_mtu(mtu);
+		m_rtp_video_sender->set_mtu(mtu);
+		m_rtp_audio_sender->set_pmtu_discovery(pmtuDiscovery);
+		m_rtp_video_sender->set_pmtu_discovery(pmtuDiscovery);
+	}
+}
+
+bool LiveMeetingRoom::get_send_mtu_stats(RTPMtuStats &video, RTPMtuStats &audio)
+{
+	if (!m_rtp_send_initialized || !m_rtp_audio_sender || !m_rtp_video_sender)
+	{
+		return false;
+	}
+
+	m_rtp_video_sender->get_mtu_stats(video);
+	m_rtp_audio_sender->get_mtu_stats(audio);
+	return true;
+}
+
+void LiveMeetingRoom::set_pacing_bitrate(uint32_t bitrate)
+{
+	m_pacer.set_target_bitrate(bitrate);
+}
+
+bool LiveMeetingRoom::get_pacer_stats(RTPPacerStats &stats)
+{
+	if (!m_pacer.is_running())
+	{
+		return false;
+	}
+
+	m_pacer.get_stats(stats);
+	return true;
+}
+
+bool LiveMeetingRoom::get_user_receive_stats(const std::string &userUUID, RTCPReceiveStats &video, RTCPReceiveStats &audio)
+{
+	bool found = false;
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_receive_mutex);
+#else
+	pthread_mutex_lock(&m_receive_mutex);
+#endif
+	std::map<std::string, RoomUser *>::iterator it = m_other_users_map.find(userUUID);
+	if (it != m_other_users_map.end())
+	{
+		it->second->get_rtcp_stats(video, audio);
+		found = true;
+	}
+#ifdef _WIN32
+#else
+	pthread_mutex_unlock(&m_receive_mutex);
+#endif
+
+	return found;
+}
+
+bool LiveMeetingRoom::get_user_fec_stats(const std::string &userUUID, RTPFecStats &stats)
+{
+	bool found = false;
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_receive_mutex);
+#else
+	pthread_mutex_lock(&m_receive_mutex);
+#endif
+	std::map<std::string, RoomUser *>::iterator it = m_other_users_map.find(userUUID);
+	if (it != m_other_users_map.end())
+	{
+		it->second->get_fec_stats(stats);
+		found = true;
+	}
+#ifdef _WIN32
+#else
+	pthread_mutex_unlock(&m_receive_mutex);
+#endif
+
+	return found;
+}
+
 void LiveMeetingRoom::remove_sender()
 {
 	m_rtp_send_initialized = false;
@@ -868,21 +1141,7 @@ void LiveMeetingRoom::on_ws_conference_create(JsonObject &params)
 	add_sender_destination(m_video_push_ip, m_video_push_port, 0, 0, m_video_ssrc,
 						   m_audio_push_ip, m_audio_push_port, 0, 0, m_audio_ssrc);
 
-	//start the receive thread
-	if (!m_receive_thread_running)
-	{
-		m_receive_thread_running = true;
-#ifdef _WIN32
-		m_receive_thread = std::thread(std::bind(&LiveMeetingRoom::receive_loop, this));
-#else
-		int ret = pthread_create(&m_receive_thread, NULL, receive_thread_func, this);
-		if (ret != 0)
-		{
-			LOG_ERROR("Start receive thread error.");
-			m_receive_thread_running = false;
-		}
-#endif
-	}
+	start_receive();
 
 	m_is_signal_running = false;
 
@@ -936,21 +1195,7 @@ void LiveMeetingRoom::on_ws_conference_join(JsonObject &params)
 		add_sender_destination(m_video_push_ip, m_video_push_port, 0, 0, m_video_ssrc,
 							   m_audio_push_ip, m_audio_push_port, 0, 0, m_audio_ssrc);
 
-		//start the receive thread
-		if (!m_receive_thread_running)
-		{
-			m_receive_thread_running = true;
-#ifdef _WIN32
-			m_receive_thread = std::thread(std::bind(&LiveMeetingRoom::receive_loop, this));
-#else
-			int ret = pthread_create(&m_receive_thread, NULL, receive_thread_func, this);
-			if (ret != 0)
-			{
-				LOG_ERROR("Start receive thread error.");
-				m_receive_thread_running = false;
-			}
-#endif
-		}
+		start_receive();
 	}
 
 	m_is_signal_running = false;
@@ -996,6 +1241,7 @@ void LiveMeetingRoom::on_ws_conference_new_joined(JsonObject &params)
 		roomUser->set_audio_ssrc(audioSSRC);
 		roomUser->set_aac_receive_callback(m_aac_callback, m_aac_callback_arg);
 		roomUser->set_h264_receive_callback(m_h264_callback, m_h264_callback_arg);
+		bind_user_receive(roomUser, userUUID);
 		roomUser->set_pinhole_uuid(m_my_user_uuid);
 
 		m_other_users_map[userUUID] = roomUser;
@@ -1213,6 +1459,7 @@ void LiveMeetingRoom::on_ws_conference_online_users(JsonObject &params)
 				roomUser->set_audio_ssrc(audioSSRC);
 				roomUser->set_aac_receive_callback(m_aac_callback, m_aac_callback_arg);
 				roomUser->set_h264_receive_callback(m_h264_callback, m_h264_callback_arg);
+				bind_user_receive(roomUser, userUUID);
 				roomUser->set_pinhole_uuid(m_my_user_uuid);
 
 				m_other_users_map[userUUID] = roomUser;
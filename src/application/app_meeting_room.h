@@ -4,6 +4,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #ifdef _WIN32
 #include <mutex>
@@ -19,6 +20,7 @@
 #include "common_json.h"
 #include "rtp_session_audio.h"
 #include "rtp_session_video.h"
+#include "rtp_receive_worker_pool.h"
 #include "ws_client.h"
 #include "app_util.h"
 #include "app_room_user.h"
@@ -188,14 +190,88 @@ public:
 	void send_aac_data(const uint8_t *data, size_t length);
 
 	/**
-	 * @brief Set the h264 receive callback function
+	 * @brief get the rtcp statistics of the sent video stream.
+	 * the loss, the jitter and the round trip time are reported by the remote receiver
+	 * @param stats -- the statistics, output parameter
+	 * @return true - successful, false - the stream is not sending
+	 */
+	bool get_video_send_stats(RTCPSendStats &stats);
+
+	/**
+	 * @brief get the rtcp statistics of the sent audio stream.
+	 * the loss, the jitter and the round trip time are reported by the remote receiver
+	 * @param stats -- the statistics, output parameter
+	 * @return true - successful, false - the stream is not sending
+	 */
+	bool get_audio_send_stats(RTCPSendStats &stats);
+
+	/**
+	 * @brief set the XOR parity protection of the sent video stream, it is kept
+	 * when the video stream is created again. the protection is disabled by default.
+	 * @param deltaPercent -- the parity packets percent of the delta frames, 0 disables the protection
+	 * @param keyPercent -- the parity packets percent of the keyframes, 0 disables the protection
+	 */
+	void set_video_fec_protection(int deltaPercent, int keyPercent);
+
+	/**
+	 * @brief set the mtu of the sent streams, it is kept when the streams are created again
+	 * @param mtu -- the mtu, RTP_DEFAULT_MTU by default
+	 * @param pmtuDiscovery -- whether the path mtu is discovered, the smaller one is used
+	 */
+	void set_send_mtu(int mtu, bool pmtuDiscovery);
+
+	/**
+	 * @brief get the mtu statistics of the sent streams
+	 * @param video -- the video statistics, output parameter
+	 * @param audio -- the audio statistics, output parameter
+	 * @return true - successful, false - the streams are not sending
+	 */
+	bool get_send_mtu_stats(RTPMtuStats &video, RTPMtuStats &audio);
+
+	/**
+	 * @brief set the target bitrate of the send pacer. the video frames are spread
+	 * over the frame interval at a multiple of the bitrate, the audio is not paced.
+	 * @param bitrate -- the target bitrate in bits per second
+	 */
+	void set_pacing_bitrate(uint32_t bitrate);
+
+	/**
+	 * @brief get the statistics of the send pacer
+	 * @param stats -- the statistics, output parameter
+	 * @return true - successful, false - the pacer is not running
+	 */
+	bool get_pacer_stats(RTPPacerStats &stats);
+
+	/**
+	 * @brief get the rtcp statistics of the streams received from the user
+	 * @param userUUID -- the user uuid
+	 * @param video -- the video statistics, output parameter
+	 * @param audio -- the audio statistics, output parameter
+	 * @return true - successful, false - the user is not found
+	 */
+	bool get_user_receive_stats(const std::string &userUUID, RTCPReceiveStats &video, RTCPReceiveStats &audio);
+
+	/**
+	 * @brief get the FEC statistics of the video stream received from the user
+	 * @param userUUID -- the user uuid
+	 * @param stats -- the statistics, output parameter
+	 * @return true - successful, false - the user is not found
+	 */
+	bool get_user_fec_stats(const std::string &userUUID, RTPFecStats &stats);
+
+	/**
+	 * @brief Set the h264 receive callback function.
+	 * the callback is invoked on a receive worker thread. it runs concurrently with the
+	 * AAC callback when the audio fast lane is enabled, see set_audio_fast_lane()
 	 * @param func -- the H.264 data receive function
 	 * @param arg -- the user argument
 	 */
 	void set_h264_receive_callback(OnH264ReceiveCallback func, void* arg);
 
 	/**
-	 * @brief Set the aac receive callback function
+	 * @brief Set the aac receive callback function.
+	 * the callback is invoked on a receive worker thread, or on the audio thread when the
+	 * audio fast lane is enabled, then it runs concurrently with the H.264 callback
 	 * @param func -- the AAC data receive function
 	 * @param arg -- the user argument
 	 */
@@ -303,19 +379,61 @@ public:
 	void websocket_pulse_loop();
 
 	/**
-	 * @brief the receive loop, the user shound not invoke this function
-	 * 
+	 * @brief set the receive workers count, it takes effect when the room is initialized.
+	 * every remote user is pinned to one worker by its uuid, the users on different
+	 * workers are received in parallel, so the receive callbacks may be invoked on
+	 * several threads at the same time when the count is greater than 1.
+	 * @param count -- the workers count, RTP_RECEIVE_DEFAULT_WORKERS by default
 	 */
-	void receive_loop();
+	void set_receive_workers(int count);
+
+	/**
+	 * @brief set the audio fast lane, it takes effect when the room is initialized.
+	 * the audio of all the users is received on a dedicated thread, so the AAC callback
+	 * is not delayed by the video reassembly and the H.264 callback, and it is invoked
+	 * on that thread. the AAC and the H.264 callbacks may then run at the same time,
+	 * the application has to synchronize the data they share. the fast lane is disabled by default.
+	 * @param enabled -- whether the audio is received on the dedicated thread
+	 * @param realtimePriority -- the SCHED_FIFO priority of the thread, 1 to 99, 0 is the normal priority
+	 * @param socketPriority -- the SO_PRIORITY of the audio sockets, 0 to 6, -1 keeps the default
+	 */
+	void set_audio_fast_lane(bool enabled, int realtimePriority, int socketPriority);
+
+	/**
+	 * @brief set the bundle mode, it takes effect when the room is initialized.
+	 * every receive worker has one socket which receives the streams of all its users,
+	 * the audio fast lane has one socket for the audio, and the datagrams are
+	 * demultiplexed by the ssrc. the sockets count does not grow with the users.
+	 * @param enabled -- whether the streams are received on the bundle sockets
+	 */
+	void set_bundle_mode(bool enabled);
 
 private:
 	void free_context();
 
+	/**
+	 * @brief create the bundle receivers on the receive workers
+	 * @return true - successful, false - fail
+	 */
+	bool create_bundles();
+
+	/**
+	 * @brief set the reactors and the bundles which the user receives on
+	 * @param roomUser -- the user
+	 * @param userUUID -- the user uuid, the user is pinned to a worker by it
+	 */
+	void bind_user_receive(RoomUser *roomUser, const std::string &userUUID);
+
 	/**
 	*@brief stop receiving rtp
 	*/
 	void stop_receive();
 
+	/**
+	*@brief start receiving rtp
+	*/
+	void start_receive();
+
 	/**
 	* @brief add the audio/video server destination
 	* @param majorVideoIP -- the major video ip address of destination
@@ -431,17 +549,29 @@ private:
 	//the users map
 	//key: the user uuid, value: other RoomUsers in the meeting room
 	std::map<std::string, RoomUser *> m_other_users_map;
-	//whether the receiving thread running
-	bool m_receive_thread_running;
+	//the receive workers, the receive sockets of every user are registered to the reactor of one worker
+	RTPReceiveWorkerPool *m_receive_workers;
+	//the receive workers count
+	int m_receive_worker_count;
+	//the audio receive worker, the audio sockets of all the users are registered to its reactor
+	RTPReceiveWorkerPool *m_audio_workers;
+	//whether the audio is received on the audio receive worker
+	bool m_audio_fast_lane;
+	//the SCHED_FIFO priority of the audio receive worker, 0 is the normal priority
+	int m_audio_realtime_priority;
+	//the SO_PRIORITY of the audio sockets, -1 keeps the default
+	int m_audio_socket_priority;
+	//whether the streams are received on the bundle sockets
+	bool m_bundle_mode;
+	//the bundle of every receive worker, the index is the worker index
+	std::vector<RTPBundleReceiver *> m_video_bundles;
+	//the bundle of the audio receive worker
+	RTPBundleReceiver *m_audio_bundle;
 #ifdef _WIN32
-	//the user receive thread
-	std::thread m_receive_thread;
-	//the mutex for receive
+	//the mutex for the users map
 	std::mutex m_receive_mutex;
 #else
-	//the user receive thread
-	pthread_t m_receive_thread;
-	//the mutex for receive
+	//the mutex for the users map
 	pthread_mutex_t m_receive_mutex;
 #endif
 
@@ -451,6 +581,14 @@ private:
 	RTPSessionVideo *m_rtp_video_sender;
 	//whether the rtp send session initialized
 	bool m_rtp_send_initialized;
+	//the send pacer of the audio and video rtp sessions
+	RTPPacer m_pacer;
+	//the parity packets percent of the sent video delta frames and keyframes
+	int m_video_fec_delta_percent;
+	int m_video_fec_key_percent;
+	//the mtu of the sent streams and whether the path mtu is discovered
+	int m_send_mtu;
+	bool m_send_pmtu_discovery;
 
 	//the conference room id which the server generates
 	std::string m_my_room_id;
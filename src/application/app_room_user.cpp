@@ -7,7 +7,18 @@
 #include "common_json.h"
 #include "codec_utils.h"
 
-static const int RTP_H264_RECV_BUFFER_SIZE = 1024 * 1024;
+//the max packets which are handled in one socket readable callback,
+//so a busy stream can not starve the other streams on the same reactor
+static const int RTP_MAX_DRAIN_PACKETS = 64;
+
+//the playout timer interval in milliseconds
+static const int RTP_PLAYOUT_TIMER_INTERVAL_MS = 5;
+
+//the NAT pinhole interval in milliseconds
+static const int NAT_PINHOLE_INTERVAL_MS = 16000;
+
+//the receive buffer size of the video sockets, a keyframe arrives as a burst of packets
+static const uint32_t RTP_VIDEO_RECV_BUFFER_SIZE = 1024 * 1024;
 
 RoomUser::RoomUser()
 {
@@ -17,11 +28,20 @@ RoomUser::RoomUser()
 	m_bind_audio_port = 0;
 	m_major_receiver = NULL;
 	m_audio_receiver = NULL;
+	m_receive_reactor = NULL;
+	m_audio_reactor = NULL;
+	m_audio_socket_priority = -1;
+	m_playout_timer_id = -1;
+	m_report_timer_id = -1;
+	m_pinhole_timer_id = -1;
+	m_audio_playout_timer_id = -1;
+	m_audio_report_timer_id = -1;
+	m_video_bundle = NULL;
+	m_audio_bundle = NULL;
 
 	m_h264_frame_assembler = NULL;
 
-	m_h264_rtp_buffer = NULL;
-	m_h264_rtp_buffer_used_len = 0;
+	m_reference_lost = true;
 
 	m_h264_callback = NULL;
 	m_h264_callback_arg = NULL;
@@ -32,6 +52,49 @@ RoomUser::RoomUser()
 
 RoomUser::~RoomUser()
 {
+	if (m_receive_reactor)
+	{
+		if (m_playout_timer_id != -1)
+		{
+			m_receive_reactor->remove_timer(m_playout_timer_id);
+		}
+
+		if (m_report_timer_id != -1)
+		{
+			m_receive_reactor->remove_timer(m_report_timer_id);
+		}
+
+		if (m_pinhole_timer_id != -1)
+		{
+			m_receive_reactor->remove_timer(m_pinhole_timer_id);
+		}
+
+		//the bundle socket is not the user's, the receiver unregisters from the bundle when it is deleted
+		if (m_major_receiver && !m_video_bundle)
+		{
+			m_receive_reactor->remove_socket(m_major_receiver->get_socket());
+		}
+	}
+
+	RTPReceiveReactor *audioReactor = get_audio_reactor();
+	if (audioReactor)
+	{
+		if (m_audio_playout_timer_id != -1)
+		{
+			audioReactor->remove_timer(m_audio_playout_timer_id);
+		}
+
+		if (m_audio_report_timer_id != -1)
+		{
+			audioReactor->remove_timer(m_audio_report_timer_id);
+		}
+
+		if (m_audio_receiver && !m_audio_bundle)
+		{
+			audioReactor->remove_socket(m_audio_receiver->get_socket());
+		}
+	}
+
 	if (m_major_receiver)
 	{
 		delete m_major_receiver;
@@ -49,11 +112,6 @@ RoomUser::~RoomUser()
 		delete m_h264_frame_assembler;
 		m_h264_frame_assembler = NULL;
 	}
-
-	if (m_h264_rtp_buffer)
-	{
-		delete[] m_h264_rtp_buffer;
-	}
 }
 
 bool RoomUser::initialize(const char *pinholeIP,
@@ -83,7 +141,7 @@ bool RoomUser::initialize_video(const char *pinholeIP,
 		return true;
 	}
 
-	uint16_t majorPort = get_available_port();
+	uint16_t majorPort = m_video_bundle ? m_video_bundle->get_port() : get_available_port();
 	if (majorPort == 0)
 	{
 		LOG_ERROR("No available ports for rtp receiver");
@@ -102,7 +160,20 @@ bool RoomUser::initialize_video(const char *pinholeIP,
 
 	rtpVideoParams.bindIP = 0;
 	rtpVideoParams.bindPort = this->m_bind_major_port;
-	ret = m_major_receiver->init(true, &rtpVideoParams, pinholeIP, pinholePort);
+	rtpVideoParams.recvBufferSize = RTP_VIDEO_RECV_BUFFER_SIZE;
+	//a lost packet of a keyframe freezes the video until the next keyframe
+	m_major_receiver->set_nack_enabled(true);
+	//the parity packets recover the losses without a round trip, the decoder
+	//is only allocated when the sender turns out to send them
+	m_major_receiver->set_fec_enabled(true);
+	if (m_video_bundle)
+	{
+		ret = m_major_receiver->init_bundle(m_video_bundle, pinholeIP, pinholePort, m_video_ssrc, on_video_readable, this);
+	}
+	else
+	{
+		ret = m_major_receiver->init(true, &rtpVideoParams, pinholeIP, pinholePort);
+	}
 	if (!ret)
 	{
 		LOG_ERROR("init RTPSessionReceiver error.");
@@ -122,19 +193,32 @@ bool RoomUser::initialize_video(const char *pinholeIP,
 		goto exitFlag;
 	}
 
-	m_h264_rtp_buffer = new uint8_t[RTP_H264_RECV_BUFFER_SIZE];
-	m_h264_rtp_buffer_used_len = 0;
-	if (!m_h264_rtp_buffer)
+	m_h264_frame_assembler->set_frame_callback(on_h264_frame, this);
+	m_reference_lost = true;
+
+	if (!register_playout_timer() || !register_report_timer() || !register_pinhole_timer())
 	{
-		LOG_ERROR("Create H.264 RTP receive buffer error.");
+		LOG_ERROR("register timers to the receive reactor error.");
 		goto exitFlag;
 	}
 
+	if (!m_video_bundle && m_receive_reactor &&
+		!m_receive_reactor->add_socket(m_major_receiver->get_socket(), on_video_readable, this))
+	{
+		LOG_ERROR("register video socket to the receive reactor error.");
+		goto exitFlag;
+	}
+
+	//the pinhole is opened at once, the timer keeps it open
+	m_major_receiver->nat_pinhole(m_pinhole_msg);
 	m_video_initialize = true;
 	return true;
 
 exitFlag:
 
+	//the timers use the receiver, they are removed before it is deleted
+	remove_video_timers();
+
 	if (m_major_receiver)
 	{
 		delete m_major_receiver;
@@ -147,12 +231,6 @@ exitFlag:
 		m_h264_frame_assembler = NULL;
 	}
 
-	if (m_h264_rtp_buffer)
-	{
-		delete[] m_h264_rtp_buffer;
-		m_h264_rtp_buffer = NULL;
-	}
-
 	return false;
 }
 
@@ -165,7 +243,7 @@ bool RoomUser::initialize_audio(const char *pinholeIP,
 		return true;
 	}
 
-	uint16_t audioPort = get_available_port();
+	uint16_t audioPort = m_audio_bundle ? m_audio_bundle->get_port() : get_available_port();
 	if (audioPort == 0)
 	{
 		LOG_ERROR("No available ports for rtp receiver");
@@ -184,18 +262,42 @@ bool RoomUser::initialize_audio(const char *pinholeIP,
 
 	rtpAudioParams.bindIP = 0;
 	rtpAudioParams.bindPort = this->m_bind_audio_port;
-	ret = m_audio_receiver->init(true, &rtpAudioParams, pinholeIP, pinholePort);
+	rtpAudioParams.priority = m_audio_socket_priority;
+	if (m_audio_bundle)
+	{
+		ret = m_audio_receiver->init_bundle(m_audio_bundle, pinholeIP, pinholePort, m_audio_ssrc, on_audio_readable, this);
+	}
+	else
+	{
+		ret = m_audio_receiver->init(true, &rtpAudioParams, pinholeIP, pinholePort);
+	}
 	if (!ret)
 	{
 		LOG_ERROR("init RTPSessionReceiver error.");
 		goto exitFlag;
 	}
 
+	if (!register_audio_timers() || !register_pinhole_timer())
+	{
+		LOG_ERROR("register timers to the receive reactor error.");
+		goto exitFlag;
+	}
+
+	if (!m_audio_bundle && get_audio_reactor() &&
+		!get_audio_reactor()->add_socket(m_audio_receiver->get_socket(), on_audio_readable, this))
+	{
+		LOG_ERROR("register audio socket to the receive reactor error.");
+		goto exitFlag;
+	}
+
+	m_audio_receiver->nat_pinhole(m_pinhole_msg);
 	m_audio_initialize = true;
 	return true;
 
 exitFlag:
 
+	remove_audio_timers();
+
 	if (m_audio_receiver)
 	{
 		delete m_audio_receiver;
@@ -213,6 +315,116 @@ uint16_t RoomUser::get_available_port()
 	return ret ? port : 0;
 }
 
+bool RoomUser::register_playout_timer()
+{
+	if (!m_receive_reactor || m_playout_timer_id != -1)
+	{
+		return true;
+	}
+
+	m_playout_timer_id = m_receive_reactor->add_timer(RTP_PLAYOUT_TIMER_INTERVAL_MS, on_playout_timer, this);
+	return m_playout_timer_id != -1;
+}
+
+bool RoomUser::register_report_timer()
+{
+	if (!m_receive_reactor || m_report_timer_id != -1)
+	{
+		return true;
+	}
+
+	m_report_timer_id = m_receive_reactor->add_timer(RTCP_REPORT_INTERVAL_MS, on_report_timer, this);
+	return m_report_timer_id != -1;
+}
+
+bool RoomUser::register_audio_timers()
+{
+	RTPReceiveReactor *reactor = get_audio_reactor();
+	if (!reactor)
+	{
+		return true;
+	}
+
+	if (m_audio_playout_timer_id == -1)
+	{
+		m_audio_playout_timer_id = reactor->add_timer(RTP_PLAYOUT_TIMER_INTERVAL_MS, on_audio_playout_timer, this);
+	}
+
+	if (m_audio_report_timer_id == -1)
+	{
+		m_audio_report_timer_id = reactor->add_timer(RTCP_REPORT_INTERVAL_MS, on_audio_report_timer, this);
+	}
+
+	return m_audio_playout_timer_id != -1 && m_audio_report_timer_id != -1;
+}
+
+RTPReceiveReactor *RoomUser::get_audio_reactor() const
+{
+	return m_audio_reactor ? m_audio_reactor : m_receive_reactor;
+}
+
+bool RoomUser::register_pinhole_timer()
+{
+	if (!m_receive_reactor || m_pinhole_timer_id != -1)
+	{
+		return true;
+	}
+
+	m_pinhole_timer_id = m_receive_reactor->add_timer(NAT_PINHOLE_INTERVAL_MS, on_pinhole_timer, this);
+	return m_pinhole_timer_id != -1;
+}
+
+void RoomUser::remove_video_timers()
+{
+	if (!m_receive_reactor)
+	{
+		return;
+	}
+
+	if (m_playout_timer_id != -1)
+	{
+		m_receive_reactor->remove_timer(m_playout_timer_id);
+		m_playout_timer_id = -1;
+	}
+
+	if (m_report_timer_id != -1)
+	{
+		m_receive_reactor->remove_timer(m_report_timer_id);
+		m_report_timer_id = -1;
+	}
+
+	if (m_pinhole_timer_id != -1 && !m_audio_initialize)
+	{
+		m_receive_reactor->remove_timer(m_pinhole_timer_id);
+		m_pinhole_timer_id = -1;
+	}
+}
+
+void RoomUser::remove_audio_timers()
+{
+	RTPReceiveReactor *reactor = get_audio_reactor();
+	if (reactor)
+	{
+		if (m_audio_playout_timer_id != -1)
+		{
+			reactor->remove_timer(m_audio_playout_timer_id);
+			m_audio_playout_timer_id = -1;
+		}
+
+		if (m_audio_report_timer_id != -1)
+		{
+			reactor->remove_timer(m_audio_report_timer_id);
+			m_audio_report_timer_id = -1;
+		}
+	}
+
+	if (m_receive_reactor && m_pinhole_timer_id != -1 && !m_video_initialize)
+	{
+		m_receive_reactor->remove_timer(m_pinhole_timer_id);
+		m_pinhole_timer_id = -1;
+	}
+}
+
 void RoomUser::set_h264_receive_callback(OnH264ReceiveCallback func, void* arg)
 {
 	m_h264_callback = func;
@@ -225,56 +437,217 @@ void RoomUser::set_aac_receive_callback(OnAACReceiveCallback func, void* arg)
 	m_aac_callback_arg = arg;
 }
 
-void RoomUser::receive_video()
+void RoomUser::set_receive_reactor(RTPReceiveReactor *reactor)
 {
-	if(!m_major_receiver)
+	m_receive_reactor = reactor;
+}
+
+void RoomUser::set_audio_receive_reactor(RTPReceiveReactor *reactor, int socketPriority)
+{
+	m_audio_reactor = reactor;
+	m_audio_socket_priority = socketPriority;
+}
+
+void RoomUser::set_bundle_receivers(RTPBundleReceiver *video, RTPBundleReceiver *audio)
+{
+	m_video_bundle = video;
+	m_audio_bundle = audio;
+}
+
+void RoomUser::on_video_readable(void *arg)
+{
+	RoomUser *usr = (RoomUser *)arg;
+	usr->receive_video();
+}
+
+void RoomUser::on_audio_readable(void *arg)
+{
+	RoomUser *usr = (RoomUser *)arg;
+	usr->receive_audio();
+}
+
+void RoomUser::on_playout_timer(void *arg)
+{
+	RoomUser *usr = (RoomUser *)arg;
+	if (usr->m_video_initialize)
 	{
-		return;
+		usr->m_major_receiver->send_nack();
 	}
+	usr->playout_video();
+}
 
-	RTPPacket *rtp = m_major_receiver->receive_rtp_packet(5, 0);
-	if (rtp)
+void RoomUser::on_report_timer(void *arg)
+{
+	RoomUser *usr = (RoomUser *)arg;
+	if (usr->m_video_initialize)
 	{
-		if (m_h264_frame_assembler->push_packet(rtp))
-		{
-			uint8_t *data = m_h264_frame_assembler->get_frame_data();
-			size_t len = m_h264_frame_assembler->get_frame_length();
+		usr->m_major_receiver->send_receiver_report();
+	}
+}
 
-			if (m_h264_rtp_buffer_used_len + len >= RTP_H264_RECV_BUFFER_SIZE)
-			{
-				m_h264_rtp_buffer_used_len = 0;
-			}
+void RoomUser::on_audio_playout_timer(void *arg)
+{
+	RoomUser *usr = (RoomUser *)arg;
+	usr->playout_audio();
+}
 
-			memcpy(m_h264_rtp_buffer + m_h264_rtp_buffer_used_len, data, len);
-			m_h264_rtp_buffer_used_len += len;
+void RoomUser::on_audio_report_timer(void *arg)
+{
+	RoomUser *usr = (RoomUser *)arg;
+	if (usr->m_audio_initialize)
+	{
+		usr->m_audio_receiver->send_receiver_report();
+	}
+}
+
+void RoomUser::on_pinhole_timer(void *arg)
+{
+	RoomUser *usr = (RoomUser *)arg;
+	usr->nat_pinhole();
+}
+
+void RoomUser::get_rtcp_stats(RTCPReceiveStats &video, RTCPReceiveStats &audio)
+{
+	memset(&video, 0, sizeof(video));
+	memset(&audio, 0, sizeof(audio));
+
+	if (m_video_initialize)
+	{
+		m_major_receiver->get_rtcp_stats(video);
+	}
+
+	if (m_audio_initialize)
+	{
+		m_audio_receiver->get_rtcp_stats(audio);
+	}
+}
+
+void RoomUser::get_fec_stats(RTPFecStats &stats)
+{
+	memset(&stats, 0, sizeof(stats));
+
+	if (m_video_initialize)
+	{
+		m_major_receiver->get_fec_stats(stats);
+	}
+}
 
-			if (rtp->has_marker())
+void RoomUser::get_socket_stats(RTPSocketStats &video, RTPSocketStats &audio)
+{
+	memset(&video, 0, sizeof(video));
+	memset(&audio, 0, sizeof(audio));
+
+	if (m_video_initialize)
+	{
+		m_major_receiver->get_socket_stats(video);
+	}
+
+	if (m_audio_initialize)
+	{
+		m_audio_receiver->get_socket_stats(audio);
+	}
+}
+
+void RoomUser::on_h264_frame(const RTPH264Frame &frame, void *arg)
+{
+	RoomUser *usr = (RoomUser *)arg;
+	uint32_t flags = frame.keyframe ? H264_FRAME_FLAG_KEYFRAME : 0;
+
+	//a keyframe does not reference the frames before it
+	if (frame.keyframe)
+	{
+		usr->m_reference_lost = false;
+	}
+
+	//a gap in the frame_num means a reference picture was lost in a frame which looked complete
+	if (frame.complete)
+	{
+		H264AccessUnitInfo info;
+		usr->m_au_index.parse(frame.data, frame.length);
+		if (usr->m_h264_parser.parse_access_unit(usr->m_au_index, info) && info.frameNumGap)
+		{
+			if (!usr->m_reference_lost)
 			{
-				//the callback
-				if (m_h264_callback)
-				{
-					uint32_t ts = rtp->get_timestamp();
-					uint32_t ssrc = rtp->get_ssrc();
-					m_h264_callback(m_user_uuid, m_h264_rtp_buffer, m_h264_rtp_buffer_used_len, ssrc, ts, m_h264_callback_arg);
-				}
-
-				m_h264_rtp_buffer_used_len = 0;
+				LOG_WARNING("the h264 frame %u has a frame_num gap", frame.timestamp);
 			}
+			usr->m_reference_lost = true;
+		}
+	}
+
+	if (usr->m_reference_lost)
+	{
+		flags |= H264_FRAME_FLAG_REFERENCE_LOST;
+	}
+
+	//the frames after an incomplete frame reference the lost data until the next keyframe
+	if (!frame.complete)
+	{
+		if (!usr->m_reference_lost)
+		{
+			LOG_WARNING("the h264 frame %u is incomplete", frame.timestamp);
 		}
+		flags |= H264_FRAME_FLAG_INCOMPLETE;
+		usr->m_reference_lost = true;
+	}
 
+	//all the nalus of an incomplete frame may have been dropped
+	if (usr->m_h264_callback && frame.length > 0)
+	{
+		usr->m_h264_callback(usr->m_user_uuid, frame.data, (int)frame.length, frame.ssrc, frame.timestamp, flags, usr->m_h264_callback_arg);
+	}
+}
+
+bool RoomUser::receive_video()
+{
+	if (!m_video_initialize)
+	{
+		return false;
+	}
+
+	int count = m_major_receiver->receive_rtp_packets(RTP_MAX_DRAIN_PACKETS);
+	playout_video();
+
+	return count > 0;
+}
+
+bool RoomUser::receive_audio()
+{
+	if (!m_audio_initialize)
+	{
+		return false;
+	}
+
+	int count = m_audio_receiver->receive_rtp_packets(RTP_MAX_DRAIN_PACKETS);
+	playout_audio();
+
+	return count > 0;
+}
+
+void RoomUser::playout_video()
+{
+	if (!m_video_initialize)
+	{
+		return;
+	}
+
+	RTPPacket *rtp;
+	while ((rtp = m_major_receiver->playout_rtp_packet()) != NULL)
+	{
+		//the assembled frames are delivered by on_h264_frame()
+		m_h264_frame_assembler->push_packet(rtp);
 		m_major_receiver->end_receive_rtp_packet(rtp);
 	}
 }
 
-void RoomUser::receive_audio()
+void RoomUser::playout_audio()
 {
-	if(!m_audio_receiver)
+	if (!m_audio_initialize)
 	{
 		return;
 	}
 
-	RTPPacket *rtp = m_audio_receiver->receive_rtp_packet(5, 0);
-	if (rtp)
+	RTPPacket *rtp;
+	while ((rtp = m_audio_receiver->playout_rtp_packet()) != NULL)
 	{
 		if (m_aac_callback)
 		{
@@ -382,12 +755,13 @@ RoomUser *RoomUser::create_user()
 
 void RoomUser::nat_pinhole()
 {
-	if (m_major_receiver)
+	//the timer is registered before the streams are ready, it skips a stream which is being initialized
+	if (m_video_initialize)
 	{
 		m_major_receiver->nat_pinhole(m_pinhole_msg);
 	}
 
-	if (m_audio_receiver)
+	if (m_audio_initialize)
 	{
 		m_audio_receiver->nat_pinhole(m_pinhole_msg);
 	}
@@ -2,14 +2,27 @@
 #define _H_APP_ROOM_USER_H_
 
 #include <string>
+#include <atomic>
 #include <stdint.h>
 
 #include "rtp_session_receiver.h"
+#include "rtp_receive_reactor.h"
+#include "rtp_bundle_receiver.h"
 #include "rtp_h264_frame_assembler.h"
 #include "codec_utils.h"
+#include "codec_h264_parser.h"
 
-//the H.264 data receive callback function
-typedef void (*OnH264ReceiveCallback)(std::string &uuid, uint8_t *data, int length, uint32_t ssrc, uint32_t timestamp, void* userArg);
+//the flags of a received H.264 frame
+//the frame is an IDR access unit
+const uint32_t H264_FRAME_FLAG_KEYFRAME = 0x01;
+//packets of the frame were lost, the NACK and the FEC could not repair them
+const uint32_t H264_FRAME_FLAG_INCOMPLETE = 0x02;
+//a frame was lost or incomplete since the last keyframe, the decoder has to conceal the frame
+const uint32_t H264_FRAME_FLAG_REFERENCE_LOST = 0x04;
+
+//the H.264 data receive callback function, every assembled frame is delivered with its H264_FRAME_FLAG_* flags,
+//the application decides whether to decode, conceal or drop it
+typedef void (*OnH264ReceiveCallback)(std::string &uuid, uint8_t *data, int length, uint32_t ssrc, uint32_t timestamp, uint32_t flags, void* userArg);
 
 //the AAC data receive callback function
 typedef void (*OnAACReceiveCallback)(std::string &uuid, uint8_t *data, int length, uint32_t ssrc, uint32_t timestamp, void* userArg);
@@ -75,15 +88,124 @@ public:
 	void set_aac_receive_callback(OnAACReceiveCallback func, void* arg);
 
 	/**
-	 * @brief receive video
+	 * @brief Set the receive reactor. the receive sockets and the timers of the user are
+	 * registered to the reactor when the streams are initialized, so all the
+	 * callbacks of the user run on the thread of the reactor.
+	 * NOTE: the function must be called before initialize()
+	 * @param reactor -- the receive reactor
 	 */
-	void receive_video();
+	void set_receive_reactor(RTPReceiveReactor *reactor);
 
 	/**
-	 * @brief receive audio
-	 * 
+	 * @brief Set the audio receive reactor. the audio socket and the audio timers are
+	 * registered to it instead of the receive reactor, so the audio is not delayed by
+	 * the video reassembly and the H.264 callback.
+	 * NOTE: the function must be called before initialize()
+	 * @param reactor -- the audio receive reactor, NULL shares the receive reactor
+	 * @param socketPriority -- the SO_PRIORITY of the audio socket, -1 keeps the default
+	 */
+	void set_audio_receive_reactor(RTPReceiveReactor *reactor, int socketPriority);
+
+	/**
+	 * @brief Set the bundle receivers. the streams are received on the bundle sockets
+	 * instead of their own sockets, the ports of the user are the bundle ports.
+	 * the bundles must be registered to the reactors of the user.
+	 * NOTE: the function must be called before initialize()
+	 * @param video -- the video bundle, NULL receives the video on its own socket
+	 * @param audio -- the audio bundle, NULL receives the audio on its own socket
+	 */
+	void set_bundle_receivers(RTPBundleReceiver *video, RTPBundleReceiver *audio);
+
+	/**
+	 * @brief receive the video rtp packets to the jitter buffer, and play out the due packets
+	 * @return true - rtp packets were received, false - no rtp packet available
+	 */
+	bool receive_video();
+
+	/**
+	 * @brief receive the audio rtp packets to the jitter buffer, and play out the due packets
+	 * @return true - rtp packets were received, false - no rtp packet available
+	 */
+	bool receive_audio();
+
+	/**
+	 * @brief play out the due video rtp packets to the H.264 frame assembler
+	 */
+	void playout_video();
+
+	/**
+	 * @brief play out the due audio rtp packets to the AAC callback
+	 */
+	void playout_audio();
+
+	/**
+	 * @brief the video socket readable callback, it drains the video socket
+	 * @param arg -- the RoomUser pointer
+	 */
+	static void on_video_readable(void *arg);
+
+	/**
+	 * @brief the audio socket readable callback, it drains the audio socket
+	 * @param arg -- the RoomUser pointer
+	 */
+	static void on_audio_readable(void *arg);
+
+	/**
+	 * @brief the playout timer callback, it plays out the due video packets when the stream goes quiet
+	 * @param arg -- the RoomUser pointer
+	 */
+	static void on_playout_timer(void *arg);
+
+	/**
+	 * @brief the rtcp report timer callback, it sends the receiver report of the video stream
+	 * @param arg -- the RoomUser pointer
+	 */
+	static void on_report_timer(void *arg);
+
+	/**
+	 * @brief the audio playout timer callback, it plays out the due audio packets when the stream goes quiet
+	 * @param arg -- the RoomUser pointer
+	 */
+	static void on_audio_playout_timer(void *arg);
+
+	/**
+	 * @brief the audio rtcp report timer callback, it sends the receiver report of the audio stream
+	 * @param arg -- the RoomUser pointer
+	 */
+	static void on_audio_report_timer(void *arg);
+
+	/**
+	 * @brief the NAT pinhole timer callback, it keeps the pinholes of the streams open
+	 * @param arg -- the RoomUser pointer
+	 */
+	static void on_pinhole_timer(void *arg);
+
+	/**
+	 * @brief get the rtcp statistics of the received streams
+	 * @param video -- the video statistics, output parameter
+	 * @param audio -- the audio statistics, output parameter
+	 */
+	void get_rtcp_stats(RTCPReceiveStats &video, RTCPReceiveStats &audio);
+
+	/**
+	 * @brief get the FEC statistics of the received video stream
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_fec_stats(RTPFecStats &stats);
+
+	/**
+	 * @brief get the receive socket statistics of the video and the audio streams
+	 * @param video -- the video socket statistics, output parameter
+	 * @param audio -- the audio socket statistics, output parameter
 	 */
-	void receive_audio();
+	void get_socket_stats(RTPSocketStats &video, RTPSocketStats &audio);
+
+	/**
+	 * @brief the H.264 frame callback of the frame assembler
+	 * @param frame -- the assembled frame
+	 * @param arg -- the RoomUser pointer
+	 */
+	static void on_h264_frame(const RTPH264Frame &frame, void *arg);
 
 	RoomUser *set_user_id(const std::string &userID);
 	RoomUser *set_user_name(const std::string &userName);
@@ -125,9 +247,52 @@ private:
 	*/
 	static uint16_t get_available_port();
 
+	/**
+	 * @brief register the video playout timer to the receive reactor
+	 * @return true - successful, false - fail
+	 */
+	bool register_playout_timer();
+
+	/**
+	 * @brief register the video rtcp report timer to the receive reactor
+	 * @return true - successful, false - fail
+	 */
+	bool register_report_timer();
+
+	/**
+	 * @brief register the audio playout and rtcp report timers to the audio reactor
+	 * @return true - successful, false - fail
+	 */
+	bool register_audio_timers();
+
+	/**
+	 * @brief get the reactor which the audio socket is registered to
+	 * @return the audio reactor, or the receive reactor if there is no audio reactor
+	 */
+	RTPReceiveReactor *get_audio_reactor() const;
+
+	/**
+	 * @brief register the NAT pinhole timer to the receive reactor
+	 * @return true - successful, false - fail
+	 */
+	bool register_pinhole_timer();
+
+	/**
+	 * @brief remove the video timers which a failed initialize_video() registered,
+	 * the pinhole timer is kept if the audio uses it
+	 */
+	void remove_video_timers();
+
+	/**
+	 * @brief remove the audio timers which a failed initialize_audio() registered,
+	 * the pinhole timer is kept if the video uses it
+	 */
+	void remove_audio_timers();
+
 private:
-	bool m_video_initialize;
-	bool m_audio_initialize;
+	//the timers read the flags on the reactor threads, they are set after the streams are ready
+	std::atomic<bool> m_video_initialize;
+	std::atomic<bool> m_audio_initialize;
 
 	//the major video rtp bind port
 	uint16_t m_bind_major_port;
@@ -139,13 +304,38 @@ private:
 	//the audio receiver
 	RTPSessionReceiver *m_audio_receiver;
 
+	//the receive reactor which the receive sockets are registered to
+	RTPReceiveReactor *m_receive_reactor;
+	//the playout timer id in the receive reactor
+	int m_playout_timer_id;
+	//the rtcp report timer id in the receive reactor
+	int m_report_timer_id;
+	//the NAT pinhole timer id in the receive reactor
+	int m_pinhole_timer_id;
+
+	//the audio receive reactor, NULL if the audio shares the receive reactor
+	RTPReceiveReactor *m_audio_reactor;
+	//the SO_PRIORITY of the audio socket, -1 keeps the default
+	int m_audio_socket_priority;
+	//the audio playout timer id in the audio reactor
+	int m_audio_playout_timer_id;
+	//the audio rtcp report timer id in the audio reactor
+	int m_audio_report_timer_id;
+
+	//the bundle which receives the video, NULL if the video has its own socket
+	RTPBundleReceiver *m_video_bundle;
+	//the bundle which receives the audio, NULL if the audio has its own socket
+	RTPBundleReceiver *m_audio_bundle;
+
 	//the h264 rtp frame assembler
 	RTPH264FrameAssembler *m_h264_frame_assembler;
 
-	//the H.264 rtp receive buffer
-	uint8_t *m_h264_rtp_buffer;
-	//the H.264 rtp buffer used length
-	size_t m_h264_rtp_buffer_used_len;
+	//whether a frame was lost or incomplete since the last keyframe
+	bool m_reference_lost;
+	//the nalus of the frame being checked
+	AccessUnitIndex m_au_index;
+	//the parameter sets and the frame_num of the video stream
+	H264StreamParser m_h264_parser;
 
 	OnH264ReceiveCallback m_h264_callback;
 	void* m_h264_callback_arg;
@@ -0,0 +1,531 @@
+#include "codec_h264_parser.h"
+
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//count the leading zeros of a non zero value
+static inline int count_leading_zeros64(uint64_t x)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, x);
+	return 63 - (int)index;
+#else
+	return __builtin_clzll(x);
+#endif
+}
+
+H264BitReader::H264BitReader(const uint8_t *data, size_t size)
+	: m_pos(data), m_end(data + size), m_zero_count(0), m_cache(0), m_cache_bits(0), m_error(false)
+{
+	refill();
+}
+
+void H264BitReader::refill()
+{
+	while (m_cache_bits <= 56 && m_pos < m_end)
+	{
+		uint8_t byte = *m_pos++;
+
+		//the 0x03 after two zero bytes is an emulation prevention byte
+		if (byte == 0x03 && m_zero_count >= 2)
+		{
+			m_zero_count = 0;
+			continue;
+		}
+		m_zero_count = (byte == 0) ? m_zero_count + 1 : 0;
+
+		m_cache |= (uint64_t)byte << (56 - m_cache_bits);
+		m_cache_bits += 8;
+	}
+}
+
+uint32_t H264BitReader::read_bits(int count)
+{
+	if (count <= 0)
+	{
+		return 0;
+	}
+
+	if (m_cache_bits < count)
+	{
+		refill();
+		if (m_cache_bits < count)
+		{
+			m_error = true;
+			m_cache = 0;
+			m_cache_bits = 0;
+			return 0;
+		}
+	}
+
+	uint32_t value = (uint32_t)(m_cache >> (64 - count));
+	m_cache <<= count;
+	m_cache_bits -= count;
+
+	return value;
+}
+
+void H264BitReader::skip_bits(int count)
+{
+	while (count > 32)
+	{
+		read_bits(32);
+		count -= 32;
+	}
+	read_bits(count);
+}
+
+uint32_t H264BitReader::read_ue()
+{
+	if (m_cache_bits < 32)
+	{
+		refill();
+	}
+
+	//the bits after the valid bits are 0
+	if (m_cache == 0)
+	{
+		m_error = true;
+		m_cache_bits = 0;
+		return 0;
+	}
+
+	int zeros = count_leading_zeros64(m_cache);
+	if (zeros > 31)
+	{
+		m_error = true;
+		return 0;
+	}
+
+	m_cache <<= zeros;
+	m_cache_bits -= zeros;
+
+	return read_bits(zeros + 1) - 1;
+}
+
+int32_t H264BitReader::read_se()
+{
+	uint32_t value = read_ue();
+	if (value & 1)
+	{
+		return (int32_t)((value >> 1) + 1);
+	}
+
+	return -(int32_t)(value >> 1);
+}
+
+//skip the scaling list of the sps, ITU-T H.264 7.3.2.1.1.1
+static void skip_scaling_list(H264BitReader &reader, int size)
+{
+	int lastScale = 8;
+	int nextScale = 8;
+	for (int i = 0; i < size && !reader.has_error(); i++)
+	{
+		if (nextScale != 0)
+		{
+			int delta = reader.read_se();
+			nextScale = (lastScale + delta + 256) % 256;
+		}
+		lastScale = (nextScale == 0) ? lastScale : nextScale;
+	}
+}
+
+//parse the timing of the vui parameters, the fields after it are not read
+static void parse_vui_timing(H264BitReader &reader, H264SPS &sps)
+{
+	//aspect_ratio_info_present_flag
+	if (reader.read_bit())
+	{
+		uint32_t aspectRatioIdc = reader.read_bits(8);
+		if (aspectRatioIdc == 255)
+		{
+			//sar_width, sar_height
+			reader.skip_bits(32);
+		}
+	}
+
+	//overscan_info_present_flag
+	if (reader.read_bit())
+	{
+		reader.skip_bits(1);
+	}
+
+	//video_signal_type_present_flag
+	if (reader.read_bit())
+	{
+		//video_format, video_full_range_flag
+		reader.skip_bits(4);
+		//colour_description_present_flag
+		if (reader.read_bit())
+		{
+			reader.skip_bits(24);
+		}
+	}
+
+	//chroma_loc_info_present_flag
+	if (reader.read_bit())
+	{
+		reader.read_ue();
+		reader.read_ue();
+	}
+
+	sps.timingInfoPresent = reader.read_bit() != 0;
+	if (sps.timingInfoPresent)
+	{
+		sps.numUnitsInTick = reader.read_bits(32);
+		sps.timeScale = reader.read_bits(32);
+		sps.fixedFrameRate = reader.read_bit() != 0;
+	}
+}
+
+bool h264_parse_sps(const uint8_t *nal, size_t size, H264SPS &sps)
+{
+	memset(&sps, 0, sizeof(sps));
+	if (size < 4 || (nal[0] & 0x1F) != 7)
+	{
+		return false;
+	}
+
+	H264BitReader reader(nal + 1, size - 1);
+	sps.profileIdc = (uint8_t)reader.read_bits(8);
+	sps.constraintFlags = (uint8_t)(reader.read_bits(8) >> 2);
+	sps.levelIdc = (uint8_t)reader.read_bits(8);
+	sps.spsId = reader.read_ue();
+	if (sps.spsId >= (uint32_t)H264_MAX_SPS_COUNT)
+	{
+		return false;
+	}
+
+	sps.chromaFormatIdc = 1;
+	sps.bitDepthLuma = 8;
+	sps.bitDepthChroma = 8;
+	switch (sps.profileIdc)
+	{
+	case 100:
+	case 110:
+	case 122:
+	case 244:
+	case 44:
+	case 83:
+	case 86:
+	case 118:
+	case 128:
+	case 138:
+	case 139:
+	case 134:
+	case 135:
+	{
+		sps.chromaFormatIdc = reader.read_ue();
+		if (sps.chromaFormatIdc > 3)
+		{
+			return false;
+		}
+		if (sps.chromaFormatIdc == 3)
+		{
+			sps.separateColourPlane = reader.read_bit() != 0;
+		}
+		sps.bitDepthLuma = reader.read_ue() + 8;
+		sps.bitDepthChroma = reader.read_ue() + 8;
+		//qpprime_y_zero_transform_bypass_flag
+		reader.skip_bits(1);
+
+		//seq_scaling_matrix_present_flag
+		if (reader.read_bit())
+		{
+			int lists = (sps.chromaFormatIdc != 3) ? 8 : 12;
+			for (int i = 0; i < lists; i++)
+			{
+				if (reader.read_bit())
+				{
+					skip_scaling_list(reader, i < 6 ? 16 : 64);
+				}
+			}
+		}
+	}
+	break;
+	default:
+		break;
+	}
+
+	sps.log2MaxFrameNum = reader.read_ue() + 4;
+	if (sps.log2MaxFrameNum > 16)
+	{
+		return false;
+	}
+
+	sps.picOrderCntType = reader.read_ue();
+	if (sps.picOrderCntType == 0)
+	{
+		sps.log2MaxPocLsb = reader.read_ue() + 4;
+		if (sps.log2MaxPocLsb > 16)
+		{
+			return false;
+		}
+	}
+	else if (sps.picOrderCntType == 1)
+	{
+		sps.deltaPicOrderAlwaysZero = reader.read_bit() != 0;
+		//offset_for_non_ref_pic, offset_for_top_to_bottom_field
+		reader.read_se();
+		reader.read_se();
+		uint32_t cycle = reader.read_ue();
+		if (cycle > 255)
+		{
+			return false;
+		}
+		for (uint32_t i = 0; i < cycle; i++)
+		{
+			reader.read_se();
+		}
+	}
+	else if (sps.picOrderCntType != 2)
+	{
+		return false;
+	}
+
+	sps.numRefFrames = reader.read_ue();
+	sps.gapsInFrameNumAllowed = reader.read_bit() != 0;
+	uint32_t widthInMbs = reader.read_ue() + 1;
+	uint32_t heightInMapUnits = reader.read_ue() + 1;
+	sps.frameMbsOnly = reader.read_bit() != 0;
+	if (!sps.frameMbsOnly)
+	{
+		//mb_adaptive_frame_field_flag
+		reader.skip_bits(1);
+	}
+	//direct_8x8_inference_flag
+	reader.skip_bits(1);
+
+	int frameHeightFactor = sps.frameMbsOnly ? 1 : 2;
+	sps.width = (int)(widthInMbs * 16);
+	sps.height = (int)(heightInMapUnits * 16) * frameHeightFactor;
+
+	//frame_cropping_flag
+	if (reader.read_bit())
+	{
+		uint32_t left = reader.read_ue();
+		uint32_t right = reader.read_ue();
+		uint32_t top = reader.read_ue();
+		uint32_t bottom = reader.read_ue();
+
+		//the crop units of ChromaArrayType, ITU-T H.264 Table 6-1
+		uint32_t chromaArrayType = sps.separateColourPlane ? 0 : sps.chromaFormatIdc;
+		int cropUnitX = (chromaArrayType == 1 || chromaArrayType == 2) ? 2 : 1;
+		int cropUnitY = ((chromaArrayType == 1) ? 2 : 1) * frameHeightFactor;
+		sps.width -= (int)(left + right) * cropUnitX;
+		sps.height -= (int)(top + bottom) * cropUnitY;
+	}
+
+	//vui_parameters_present_flag
+	if (reader.read_bit())
+	{
+		parse_vui_timing(reader, sps);
+	}
+
+	if (reader.has_error() || sps.width <= 0 || sps.height <= 0)
+	{
+		return false;
+	}
+
+	if (sps.timingInfoPresent && sps.numUnitsInTick > 0)
+	{
+		sps.fps = (int)(sps.timeScale / (2 * (uint64_t)sps.numUnitsInTick));
+	}
+
+	sps.valid = true;
+	return true;
+}
+
+H264StreamParser::H264StreamParser()
+{
+	memset(m_sps, 0, sizeof(m_sps));
+	memset(m_pps, 0, sizeof(m_pps));
+	m_prev_ref_frame_num = -1;
+}
+
+bool H264StreamParser::parse_sps(const uint8_t *nal, size_t size, H264SPS *sps)
+{
+	H264SPS parsed;
+	if (!h264_parse_sps(nal, size, parsed))
+	{
+		return false;
+	}
+
+	m_sps[parsed.spsId] = parsed;
+	if (sps)
+	{
+		*sps = parsed;
+	}
+
+	return true;
+}
+
+bool H264StreamParser::parse_pps(const uint8_t *nal, size_t size)
+{
+	if (size < 2 || (nal[0] & 0x1F) != 8)
+	{
+		return false;
+	}
+
+	H264BitReader reader(nal + 1, size - 1);
+	H264PPS pps;
+	memset(&pps, 0, sizeof(pps));
+	pps.ppsId = reader.read_ue();
+	pps.spsId = reader.read_ue();
+	pps.entropyCodingMode = reader.read_bit() != 0;
+	pps.bottomFieldPicOrderInFramePresent = reader.read_bit() != 0;
+	pps.numSliceGroups = reader.read_ue() + 1;
+
+	if (reader.has_error() || pps.ppsId >= (uint32_t)H264_MAX_PPS_COUNT ||
+		pps.spsId >= (uint32_t)H264_MAX_SPS_COUNT || !m_sps[pps.spsId].valid)
+	{
+		return false;
+	}
+
+	pps.valid = true;
+	m_pps[pps.ppsId] = pps;
+	return true;
+}
+
+bool H264StreamParser::parse_slice_header(const uint8_t *nal, size_t size, H264SliceHeader &header) const
+{
+	memset(&header, 0, sizeof(header));
+	if (size < 2)
+	{
+		return false;
+	}
+
+	//the coded slice, the data partition A and the IDR slice have the slice header
+	header.nalType = nal[0] & 0x1F;
+	header.nalRefIdc = (nal[0] >> 5) & 0x03;
+	if (header.nalType != 1 && header.nalType != 2 && header.nalType != 5)
+	{
+		return false;
+	}
+
+	H264BitReader reader(nal + 1, size - 1);
+	header.firstMbInSlice = reader.read_ue();
+	uint32_t sliceType = reader.read_ue();
+	if (sliceType > 9)
+	{
+		return false;
+	}
+	header.sliceType = sliceType % 5;
+
+	header.ppsId = reader.read_ue();
+	if (header.ppsId >= (uint32_t)H264_MAX_PPS_COUNT || !m_pps[header.ppsId].valid)
+	{
+		return false;
+	}
+	const H264PPS &pps = m_pps[header.ppsId];
+	const H264SPS &sps = m_sps[pps.spsId];
+	if (!sps.valid)
+	{
+		return false;
+	}
+
+	if (sps.separateColourPlane)
+	{
+		//colour_plane_id
+		reader.skip_bits(2);
+	}
+
+	header.frameNum = reader.read_bits((int)sps.log2MaxFrameNum);
+	if (!sps.frameMbsOnly)
+	{
+		header.fieldPic = reader.read_bit() != 0;
+		if (header.fieldPic)
+		{
+			header.bottomField = reader.read_bit() != 0;
+		}
+	}
+
+	if (header.nalType == 5)
+	{
+		header.idrPicId = reader.read_ue();
+	}
+
+	if (sps.picOrderCntType == 0)
+	{
+		header.picOrderCntLsb = reader.read_bits((int)sps.log2MaxPocLsb);
+	}
+
+	return !reader.has_error();
+}
+
+bool H264StreamParser::parse_access_unit(const AccessUnitIndex &index, H264AccessUnitInfo &info)
+{
+	memset(&info, 0, sizeof(info));
+
+	for (int i = 0; i < index.get_count(); i++)
+	{
+		const AVCNaluIndex &nalu = index.get_nalu(i);
+		switch (nalu.type)
+		{
+		case 7:
+			parse_sps(nalu.data, nalu.size, NULL);
+			break;
+		case 8:
+			parse_pps(nalu.data, nalu.size);
+			break;
+		case 1:
+		case 2:
+		case 5:
+			if (nalu.type == 5)
+			{
+				info.keyframe = true;
+			}
+			if (!info.hasSlice)
+			{
+				info.hasSlice = parse_slice_header(nalu.data, nalu.size, info.slice);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (!info.hasSlice)
+	{
+		return false;
+	}
+
+	//the pictures after a reference picture have its frame_num or its frame_num + 1,
+	//the second field of a reference field pair has the same frame_num
+	const H264SPS &sps = m_sps[m_pps[info.slice.ppsId].spsId];
+	if (info.slice.nalType != 5 && m_prev_ref_frame_num >= 0 && !sps.gapsInFrameNumAllowed)
+	{
+		uint32_t maxFrameNum = 1u << sps.log2MaxFrameNum;
+		uint32_t prev = (uint32_t)m_prev_ref_frame_num;
+		if (info.slice.frameNum != prev && info.slice.frameNum != (prev + 1) % maxFrameNum)
+		{
+			info.frameNumGap = true;
+		}
+	}
+
+	if (info.slice.nalRefIdc != 0)
+	{
+		m_prev_ref_frame_num = info.slice.frameNum;
+	}
+
+	return true;
+}
+
+void H264StreamParser::reset_frame_num()
+{
+	m_prev_ref_frame_num = -1;
+}
+
+const H264SPS *H264StreamParser::get_sps(uint32_t spsId) const
+{
+	if (spsId >= (uint32_t)H264_MAX_SPS_COUNT || !m_sps[spsId].valid)
+	{
+		return NULL;
+	}
+
+	return &m_sps[spsId];
+}
@@ -0,0 +1,232 @@
+#ifndef _H_CODEC_H264_PARSER_H_
+#define _H_CODEC_H264_PARSER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "codec_utils.h"
+
+//the max sps and pps ids, ITU-T H.264 7.4.2.1.1 and 7.4.2.2
+const int H264_MAX_SPS_COUNT = 32;
+const int H264_MAX_PPS_COUNT = 256;
+
+/**
+* the bit reader of an H.264 nalu. the emulation prevention bytes are skipped
+* when the cache is refilled, so the nalu is not copied or modified.
+* the reads past the end return 0 and set the error flag.
+*/
+class H264BitReader
+{
+public:
+	/**
+	* @param data -- the nalu payload, it may contain the emulation prevention bytes
+	* @param size -- the payload length
+	*/
+	H264BitReader(const uint8_t *data, size_t size);
+
+	/**
+	* @brief read the bits
+	* @param count -- the bits count, 0 to 32
+	* @return the bits value
+	*/
+	uint32_t read_bits(int count);
+
+	uint32_t read_bit() { return read_bits(1); }
+
+	void skip_bits(int count);
+
+	/**
+	* @brief read the ue(v) Exp-Golomb code, the leading zeros are counted by CLZ
+	* @return the code value
+	*/
+	uint32_t read_ue();
+
+	//read the se(v) Exp-Golomb code
+	int32_t read_se();
+
+	//whether a read was past the end or an Exp-Golomb code was invalid
+	bool has_error() const { return m_error; }
+
+private:
+	//fill the cache with whole bytes, up to 56 bits
+	void refill();
+
+private:
+	const uint8_t *m_pos;
+	const uint8_t *m_end;
+	//the zero bytes before m_pos
+	int m_zero_count;
+
+	//the cached bits, msb first
+	uint64_t m_cache;
+	//the valid bits in the cache
+	int m_cache_bits;
+
+	bool m_error;
+};
+
+/**
+* the H.264 sequence parameter set, ITU-T H.264 7.3.2.1.1
+*/
+struct H264SPS
+{
+	bool valid;
+
+	uint8_t profileIdc;
+	//constraint_set0_flag to constraint_set5_flag, msb first
+	uint8_t constraintFlags;
+	uint8_t levelIdc;
+	uint32_t spsId;
+
+	uint32_t chromaFormatIdc;
+	bool separateColourPlane;
+	uint32_t bitDepthLuma;
+	uint32_t bitDepthChroma;
+
+	//the frame_num bits, log2_max_frame_num_minus4 + 4
+	uint32_t log2MaxFrameNum;
+	uint32_t picOrderCntType;
+	//the pic_order_cnt_lsb bits, log2_max_pic_order_cnt_lsb_minus4 + 4
+	uint32_t log2MaxPocLsb;
+	bool deltaPicOrderAlwaysZero;
+
+	uint32_t numRefFrames;
+	bool gapsInFrameNumAllowed;
+	bool frameMbsOnly;
+
+	//the cropped picture size
+	int width;
+	int height;
+
+	//the VUI timing
+	bool timingInfoPresent;
+	uint32_t numUnitsInTick;
+	uint32_t timeScale;
+	bool fixedFrameRate;
+	//time_scale / (2 * num_units_in_tick), 0 if there is no timing
+	int fps;
+};
+
+/**
+* @brief parse an SPS nalu
+* @param nal -- the nalu, from the nalu header byte
+* @param size -- the nalu length
+* @param sps -- the sps, output parameter
+* @return true - successful, false - the nalu is malformed
+*/
+bool h264_parse_sps(const uint8_t *nal, size_t size, H264SPS &sps);
+
+/**
+* the H.264 picture parameter set, the fields which the slice header parsing needs
+*/
+struct H264PPS
+{
+	bool valid;
+
+	uint32_t ppsId;
+	uint32_t spsId;
+	bool entropyCodingMode;
+	bool bottomFieldPicOrderInFramePresent;
+	uint32_t numSliceGroups;
+};
+
+/**
+* the H.264 slice header up to the picture order count, ITU-T H.264 7.3.3
+*/
+struct H264SliceHeader
+{
+	uint8_t nalType;
+	uint8_t nalRefIdc;
+	uint32_t firstMbInSlice;
+	//the slice_type % 5, 0 P, 1 B, 2 I, 3 SP, 4 SI
+	uint32_t sliceType;
+	uint32_t ppsId;
+	uint32_t frameNum;
+	bool fieldPic;
+	bool bottomField;
+	uint32_t idrPicId;
+	uint32_t picOrderCntLsb;
+};
+
+/**
+* the access unit information from its nalus
+*/
+struct H264AccessUnitInfo
+{
+	//whether the access unit has an IDR slice
+	bool keyframe;
+	//whether the access unit has a slice whose header was parsed
+	bool hasSlice;
+	//the header of the first slice
+	H264SliceHeader slice;
+	//whether the frame_num is not continuous with the previous reference picture,
+	//a reference picture was lost
+	bool frameNumGap;
+};
+
+/**
+* the H.264 stream parser. the parameter sets are kept in fixed tables, the
+* parsing never allocates memory. the frame_num of the pictures is tracked so
+* the lost reference pictures are detected without a decoder.
+*/
+class H264StreamParser
+{
+public:
+	H264StreamParser();
+
+	/**
+	* @brief parse an SPS nalu and keep it
+	* @param nal -- the nalu, from the nalu header byte
+	* @param size -- the nalu length
+	* @param sps -- the sps, output parameter, it may be NULL
+	* @return true - successful, false - the nalu is malformed
+	*/
+	bool parse_sps(const uint8_t *nal, size_t size, H264SPS *sps);
+
+	/**
+	* @brief parse a PPS nalu and keep it
+	* @param nal -- the nalu, from the nalu header byte
+	* @param size -- the nalu length
+	* @return true - successful, false - the nalu is malformed or its sps is unknown
+	*/
+	bool parse_pps(const uint8_t *nal, size_t size);
+
+	/**
+	* @brief parse the slice header, the parameter sets must be parsed before
+	* @param nal -- the nalu, from the nalu header byte
+	* @param size -- the nalu length
+	* @param header -- the slice header, output parameter
+	* @return true - successful, false - the nalu is malformed or its pps is unknown
+	*/
+	bool parse_slice_header(const uint8_t *nal, size_t size, H264SliceHeader &header) const;
+
+	/**
+	* @brief parse the parameter sets and the first slice header of an access unit,
+	* and check its frame_num against the previous reference picture
+	* @param index -- the nalus of the access unit
+	* @param info -- the access unit information, output parameter
+	* @return true - a slice header was parsed, false - no slice or the parameter sets are unknown
+	*/
+	bool parse_access_unit(const AccessUnitIndex &index, H264AccessUnitInfo &info);
+
+	/**
+	* @brief forget the previous reference picture, the next picture is not checked
+	*/
+	void reset_frame_num();
+
+	/**
+	* @brief get the sps
+	* @param spsId -- the sps id
+	* @return the sps, NULL if it is not parsed
+	*/
+	const H264SPS *get_sps(uint32_t spsId) const;
+
+private:
+	H264SPS m_sps[H264_MAX_SPS_COUNT];
+	H264PPS m_pps[H264_MAX_PPS_COUNT];
+
+	//the frame_num of the previous reference picture, -1 if unknown
+	int64_t m_prev_ref_frame_num;
+};
+
+#endif
@@ -1,9 +1,36 @@
 #include "codec_utils.h"
+#include "codec_h264_parser.h"
 
 #include <iostream>
 #include <math.h>
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CODEC_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//the avx2 scanner is compiled with the target attribute and selected at runtime
+#if defined(CODEC_HAVE_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CODEC_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+//count the trailing zeros of a non zero value
+static inline int count_trailing_zeros32(uint32_t x)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, x);
+	return (int)index;
+#else
+	return __builtin_ctz(x);
+#endif
+}
 
 /**
 * @brief find start code
@@ -68,9 +95,101 @@ static const uint8_t *AVCFindStartCodeInternal(const uint8_t *start, const uint8
 	return end + 3;
 }
 
+#ifdef CODEC_HAVE_SSE2
+/**
+* @brief find start code, 16 positions are compared at once
+* @param start -- the start position
+* @param end -- the end position
+*
+* @return the same position as AVCFindStartCodeInternal
+*/
+static const uint8_t *AVCFindStartCodeSSE2(const uint8_t *start, const uint8_t *end)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi8(1);
+
+	//the last compared position is start + 15, it must be before end - 3
+	while (end - start >= 19)
+	{
+		__m128i b0 = _mm_loadu_si128((const __m128i *)start);
+		__m128i b1 = _mm_loadu_si128((const __m128i *)(start + 1));
+		__m128i b2 = _mm_loadu_si128((const __m128i *)(start + 2));
+
+		__m128i hit = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+									_mm_cmpeq_epi8(b2, one));
+		int mask = _mm_movemask_epi8(hit);
+		if (mask)
+		{
+			return start + count_trailing_zeros32(mask);
+		}
+
+		start += 16;
+	}
+
+	return AVCFindStartCodeInternal(start, end);
+}
+#endif
+
+#ifdef CODEC_HAVE_AVX2
+/**
+* @brief find start code, 32 positions are compared at once
+* @param start -- the start position
+* @param end -- the end position
+*
+* @return the same position as AVCFindStartCodeInternal
+*/
+__attribute__((target("avx2")))
+static const uint8_t *AVCFindStartCodeAVX2(const uint8_t *start, const uint8_t *end)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi8(1);
+
+	//the last compared position is start + 31, it must be before end - 3
+	while (end - start >= 35)
+	{
+		__m256i b0 = _mm256_loadu_si256((const __m256i *)start);
+		__m256i b1 = _mm256_loadu_si256((const __m256i *)(start + 1));
+		__m256i b2 = _mm256_loadu_si256((const __m256i *)(start + 2));
+
+		__m256i hit = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(b0, zero), _mm256_cmpeq_epi8(b1, zero)),
+									   _mm256_cmpeq_epi8(b2, one));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit);
+		if (mask)
+		{
+			return start + count_trailing_zeros32(mask);
+		}
+
+		start += 32;
+	}
+
+	return AVCFindStartCodeSSE2(start, end);
+}
+#endif
+
+typedef const uint8_t *(*AVCFindStartCodeFunc)(const uint8_t *start, const uint8_t *end);
+
+//select the start code scanner of the cpu
+static AVCFindStartCodeFunc select_find_start_code()
+{
+#ifdef CODEC_HAVE_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return AVCFindStartCodeAVX2;
+	}
+#endif
+#ifdef CODEC_HAVE_SSE2
+	return AVCFindStartCodeSSE2;
+#else
+	return AVCFindStartCodeInternal;
+#endif
+}
+
+static const AVCFindStartCodeFunc s_find_start_code = select_find_start_code();
+
 const uint8_t* avc_find_start_code(const uint8_t *start, const uint8_t *end)
 {
-	const uint8_t *pos = AVCFindStartCodeInternal(start, end);
+	const uint8_t *pos = s_find_start_code(start, end);
 	if (start < pos && pos < end && !pos[-1])
 	{
 		pos--;
@@ -79,15 +198,56 @@ const uint8_t* avc_find_start_code(const uint8_t *start, const uint8_t *end)
 	return pos;
 }
 
-bool avc_find_key_frame(const uint8_t *data, size_t size)
+//read the first_mb_in_slice of a slice nalu, -1 if the nalu is not a slice.
+//it is less than 2^16 - 1, so its ue(v) code has no emulation prevention byte
+static int32_t avc_read_first_mb(const uint8_t *nal, size_t size)
 {
-	const uint8_t *nalStart;
-	const uint8_t *nalEnd;
+	uint8_t type = nal[0] & 0x1F;
+	if (type < 1 || type > 5)
+	{
+		return -1;
+	}
+
+	size_t bits = (size - 1) * 8;
+	size_t pos = 0;
+	int zeros = 0;
+	while (pos < bits && !(nal[1 + pos / 8] & (0x80 >> (pos % 8))))
+	{
+		zeros++;
+		pos++;
+	}
+	if (zeros > 16 || pos + 1 + zeros > bits)
+	{
+		return -1;
+	}
+	pos++;
+
+	uint32_t value = 0;
+	for (int i = 0; i < zeros; i++, pos++)
+	{
+		value = (value << 1) | ((nal[1 + pos / 8] >> (7 - pos % 8)) & 1);
+	}
+
+	return (int32_t)((1u << zeros) - 1 + value);
+}
+
+//fill the nalu index from the nalu between the start codes
+static void avc_fill_nalu_index(AVCNaluIndex &nalu, const uint8_t *nalStart, const uint8_t *nalEnd)
+{
+	nalu.data = nalStart;
+	nalu.size = nalEnd - nalStart;
+	nalu.type = nalStart[0] & 0x1F;
+	nalu.nalRefIdc = (nalStart[0] >> 5) & 0x03;
+	nalu.firstMbInSlice = avc_read_first_mb(nalStart, nalu.size);
+}
+
+int avc_index_nalus(const uint8_t *data, size_t size, AVCNaluIndex *nalus, int maxNalus)
+{
+	int count = 0;
 	const uint8_t *end = data + size;
-	int type;
+	const uint8_t *nalStart = avc_find_start_code(data, end);
 
-	nalStart = avc_find_start_code(data, end);
-	while (true)
+	while (count < maxNalus)
 	{
 		while (nalStart < end && !*(nalStart++))
 			;
@@ -97,28 +257,26 @@ bool avc_find_key_frame(const uint8_t *data, size_t size)
 			break;
 		}
 
-		type = nalStart[0] & 0x1F;
+		const uint8_t *nalEnd = avc_find_start_code(nalStart, end);
+		avc_fill_nalu_index(nalus[count++], nalStart, nalEnd);
 
-		if (type == 5 || type == 1)
-		{
-			return (type == 5);
-		}
-
-		nalEnd = avc_find_start_code(nalStart, end);
 		nalStart = nalEnd;
 	}
 
-	return false;
+	return count;
 }
 
-bool avc_find_sps_pps_idr(const uint8_t* data, size_t size)
+AccessUnitIndex::AccessUnitIndex()
 {
-	const uint8_t *nalStart;
-	const uint8_t *nalEnd;
-	const uint8_t *end = data + size;
-	int type;
+	m_nalus.reserve(64);
+}
 
-	nalStart = avc_find_start_code(data, end);
+int AccessUnitIndex::parse(const uint8_t *data, size_t size)
+{
+	m_nalus.clear();
+
+	const uint8_t *end = data + size;
+	const uint8_t *nalStart = avc_find_start_code(data, end);
 	while (true)
 	{
 		while (nalStart < end && !*(nalStart++))
@@ -129,77 +287,87 @@ bool avc_find_sps_pps_idr(const uint8_t* data, size_t size)
 			break;
 		}
 
-		type = nalStart[0] & 0x1F;
+		const uint8_t *nalEnd = avc_find_start_code(nalStart, end);
+		m_nalus.push_back(AVCNaluIndex());
+		avc_fill_nalu_index(m_nalus.back(), nalStart, nalEnd);
 
-		if (type == 5 || type == 7 || type == 8)
+		nalStart = nalEnd;
+	}
+
+	return (int)m_nalus.size();
+}
+
+bool AccessUnitIndex::is_key_frame() const
+{
+	for (size_t i = 0; i < m_nalus.size(); i++)
+	{
+		if (m_nalus[i].type == 5 || m_nalus[i].type == 1)
 		{
-			return true;
+			return m_nalus[i].type == 5;
 		}
-
-		nalEnd = avc_find_start_code(nalStart, end);
-		nalStart = nalEnd;
 	}
 
 	return false;
 }
 
-int count_avc_key_frames(const uint8_t *data, size_t size)
+bool AccessUnitIndex::has_idr() const
 {
-	int count = 0;
-	const uint8_t *nalStart;
-	const uint8_t *nalEnd;
-	const uint8_t *end = data + size;
-	int type;
+	return count_key_frames() > 0;
+}
 
-	nalStart = avc_find_start_code(data, end);
-	while (true)
+bool AccessUnitIndex::has_sps_pps_idr() const
+{
+	for (size_t i = 0; i < m_nalus.size(); i++)
 	{
-		while (nalStart < end && !*(nalStart++))
-			;
-
-		if (nalStart == end)
+		uint8_t type = m_nalus[i].type;
+		if (type == 5 || type == 7 || type == 8)
 		{
-			break;
+			return true;
 		}
+	}
 
-		type = nalStart[0] & 0x1F;
+	return false;
+}
 
-		if (type == 5)
+int AccessUnitIndex::count_key_frames() const
+{
+	int count = 0;
+	for (size_t i = 0; i < m_nalus.size(); i++)
+	{
+		if (m_nalus[i].type == 5)
 		{
 			count++;
 		}
-
-		nalEnd = avc_find_start_code(nalStart, end);
-		nalStart = nalEnd;
 	}
 
 	return count;
 }
 
-int count_frames(const uint8_t *data, size_t size)
+bool avc_find_key_frame(const uint8_t *data, size_t size)
 {
-	int count = 0;
-	const uint8_t *nalStart;
-	const uint8_t *nalEnd;
-	const uint8_t *end = data + size;
-
-	nalStart = avc_find_start_code(data, end);
-	while (true)
-	{
-		while (nalStart < end && !*(nalStart++))
-			;
+	AccessUnitIndex index;
+	index.parse(data, size);
+	return index.is_key_frame();
+}
 
-		if (nalStart == end)
-		{
-			break;
-		}
+bool avc_find_sps_pps_idr(const uint8_t* data, size_t size)
+{
+	AccessUnitIndex index;
+	index.parse(data, size);
+	return index.has_sps_pps_idr();
+}
 
-		count++;
-		nalEnd = avc_find_start_code(nalStart, end);
-		nalStart = nalEnd;
-	}
+int count_avc_key_frames(const uint8_t *data, size_t size)
+{
+	AccessUnitIndex index;
+	index.parse(data, size);
+	return index.count_key_frames();
+}
 
-	return count;
+int count_frames(const uint8_t *data, size_t size)
+{
+	AccessUnitIndex index;
+	return index.parse(data, size);
 }
 
 bool parse_adts_header(const uint8_t* data, size_t data_len, struct ADTSHeader* header)
@@ -261,224 +429,23 @@ int count_aac_frames(const uint8_t* data, size_t size)
 }
 
 
-static uint32_t Ue(const uint8_t *pBuff, size_t nLen, uint32_t &nStartBit)
-{
-	uint32_t nZeroNum = 0;
-	while (nStartBit < nLen * 8)
-	{
-		if (pBuff[nStartBit / 8] & (0x80 >> (nStartBit % 8)))
-		{
-			break;
-		}
-		nZeroNum++;
-		nStartBit++;
-	}
-	nStartBit++;
-
-	uint64_t dwRet = 0;
-	for (uint32_t i = 0; i < nZeroNum; i++)
-	{
-		dwRet <<= 1;
-		if (pBuff[nStartBit / 8] & (0x80 >> (nStartBit % 8)))
-		{
-			dwRet += 1;
-		}
-		nStartBit++;
-	}
-
-	return (1 << nZeroNum) - 1 + dwRet;
-}
-
-static int32_t Se(uint8_t *pBuff, size_t nLen, uint32_t &nStartBit)
+bool h264_decode_sps(uint8_t *data, size_t size, int* width, int *height, int*fps)
 {
-	int32_t UeVal = Ue(pBuff, nLen, nStartBit);
-	double k = UeVal;
-	int32_t nValue = (int32_t)ceil(k / 2);
-	if (UeVal % 2 == 0)
+	//the emulation prevention bytes are skipped by the bit reader, the sps is not modified
+	H264SPS sps;
+	if (!h264_parse_sps(data, size, sps))
 	{
-		nValue = -nValue;
+		return false;
 	}
-	return nValue;
-}
 
-uint64_t u(uint32_t BitCount, uint8_t * buf, uint32_t &nStartBit)
-{
-	uint64_t dwRet = 0;
-	for (uint32_t i = 0; i < BitCount; i++)
+	*width = sps.width;
+	*height = sps.height;
+	if (sps.timingInfoPresent && sps.numUnitsInTick > 0)
 	{
-		dwRet <<= 1;
-		if (buf[nStartBit / 8] & (0x80 >> (nStartBit % 8)))
-		{
-			dwRet += 1;
-		}
-		nStartBit++;
+		*fps = sps.fps;
 	}
-	return dwRet;
-}
 
-void de_emulation_prevention(uint8_t* buf, size_t* buf_size)
-{
-	int32_t i = 0, j = 0;
-	uint8_t* tmp_ptr = NULL;
-	size_t tmp_buf_size = 0;
-	int32_t val = 0;
-
-	tmp_ptr = buf;
-	tmp_buf_size = *buf_size;
-	for (i = 0; i < (tmp_buf_size - 2); i++)
-	{
-		//check for 0x000003
-		val = (tmp_ptr[i] ^ 0x00) + (tmp_ptr[i + 1] ^ 0x00) + (tmp_ptr[i + 2] ^ 0x03);
-		if (val == 0)
-		{
-			//kick out 0x03
-			for (j = i + 2; j < tmp_buf_size - 1; j++)
-			{
-				tmp_ptr[j] = tmp_ptr[j + 1];
-			}
-
-			//and so we should devrease bufsize
-			(*buf_size)--;
-		}
-	}
-
-	return;
-}
-
-bool h264_decode_sps(uint8_t *data, size_t size, int* width, int *height, int*fps)
-{
-	uint32_t StartBit = 0;
-	de_emulation_prevention(data, &size);
-
-	int forbidden_zero_bit = u(1, data, StartBit);
-	int nal_ref_idc = u(2, data, StartBit);
-	int nal_unit_type = u(5, data, StartBit);
-	if (nal_unit_type == 7)
-	{
-		int profile_idc = u(8, data, StartBit);
-		int constraint_set0_flag = u(1, data, StartBit);//(buf[1] & 0x80)>>7;
-		int constraint_set1_flag = u(1, data, StartBit);//(buf[1] & 0x40)>>6;
-		int constraint_set2_flag = u(1, data, StartBit);//(buf[1] & 0x20)>>5;
-		int constraint_set3_flag = u(1, data, StartBit);//(buf[1] & 0x10)>>4;
-		int reserved_zero_4bits = u(4, data, StartBit);
-		int level_idc = u(8, data, StartBit);
-
-		int seq_parameter_set_id = Ue(data, size, StartBit);
-
-		if (profile_idc == 100 || profile_idc == 110 ||
-			profile_idc == 122 || profile_idc == 144)
-		{
-			int chroma_format_idc = Ue(data, size, StartBit);
-			if (chroma_format_idc == 3)
-				int residual_colour_transform_flag = u(1, data, StartBit);
-			int bit_depth_luma_minus8 = Ue(data, size, StartBit);
-			int bit_depth_chroma_minus8 = Ue(data, size, StartBit);
-			int qpprime_y_zero_transform_bypass_flag = u(1, data, StartBit);
-			int seq_scaling_matrix_present_flag = u(1, data, StartBit);
-
-			int seq_scaling_list_present_flag[8];
-			if (seq_scaling_matrix_present_flag)
-			{
-				for (int i = 0; i < 8; i++)
-				{
-					seq_scaling_list_present_flag[i] = u(1, data, StartBit);
-				}
-			}
-		}
-		int log2_max_frame_num_minus4 = Ue(data, size, StartBit);
-		int pic_order_cnt_type = Ue(data, size, StartBit);
-		if (pic_order_cnt_type == 0)
-		{
-			int log2_max_pic_order_cnt_lsb_minus4 = Ue(data, size, StartBit);
-		}
-		else if (pic_order_cnt_type == 1)
-		{
-			int delta_pic_order_always_zero_flag = u(1, data, StartBit);
-			int offset_for_non_ref_pic = Se(data, size, StartBit);
-			int offset_for_top_to_bottom_field = Se(data, size, StartBit);
-			int num_ref_frames_in_pic_order_cnt_cycle = Ue(data, size, StartBit);
-
-			int *offset_for_ref_frame = new int[num_ref_frames_in_pic_order_cnt_cycle];
-			for (int i = 0; i < num_ref_frames_in_pic_order_cnt_cycle; i++)
-			{
-				offset_for_ref_frame[i] = Se(data, size, StartBit);
-			}
-			delete[] offset_for_ref_frame;
-		}
-		int num_ref_frames = Ue(data, size, StartBit);
-		int gaps_in_frame_num_value_allowed_flag = u(1, data, StartBit);
-		int pic_width_in_mbs_minus1 = Ue(data, size, StartBit);
-		int pic_height_in_map_units_minus1 = Ue(data, size, StartBit);
-
-		*width = (pic_width_in_mbs_minus1 + 1) * 16;
-		*height = (pic_height_in_map_units_minus1 + 1) * 16;
-
-		int frame_mbs_only_flag = u(1, data, StartBit);
-		if (!frame_mbs_only_flag)
-		{
-			int mb_adaptive_frame_field_flag = u(1, data, StartBit);
-		}
-
-		int direct_8x8_inference_flag = u(1, data, StartBit);
-		int frame_cropping_flag = u(1, data, StartBit);
-		if (frame_cropping_flag)
-		{
-			int frame_crop_left_offset = Ue(data, size, StartBit);
-			int frame_crop_right_offset = Ue(data, size, StartBit);
-			int frame_crop_top_offset = Ue(data, size, StartBit);
-			int frame_crop_bottom_offset = Ue(data, size, StartBit);
-		}
-		int vui_parameter_present_flag = u(1, data, StartBit);
-		if (vui_parameter_present_flag)
-		{
-			int aspect_ratio_info_present_flag = u(1, data, StartBit);
-			if (aspect_ratio_info_present_flag)
-			{
-				int aspect_ratio_idc = u(8, data, StartBit);
-				if (aspect_ratio_idc == 255)
-				{
-					int sar_width = u(16, data, StartBit);
-					int sar_height = u(16, data, StartBit);
-				}
-			}
-			int overscan_info_present_flag = u(1, data, StartBit);
-			if (overscan_info_present_flag)
-			{
-				int overscan_appropriate_flagu = u(1, data, StartBit);
-			}
-			int video_signal_type_present_flag = u(1, data, StartBit);
-			if (video_signal_type_present_flag)
-			{
-				int video_format = u(3, data, StartBit);
-				int video_full_range_flag = u(1, data, StartBit);
-				int colour_description_present_flag = u(1, data, StartBit);
-				if (colour_description_present_flag)
-				{
-					int colour_primaries = u(8, data, StartBit);
-					int transfer_characteristics = u(8, data, StartBit);
-					int matrix_coefficients = u(8, data, StartBit);
-				}
-			}
-			int chroma_loc_info_present_flag = u(1, data, StartBit);
-			if (chroma_loc_info_present_flag)
-			{
-				int chroma_sample_loc_type_top_field = Ue(data, size, StartBit);
-				int chroma_sample_loc_type_bottom_field = Ue(data, size, StartBit);
-			}
-			int timing_info_present_flag = u(1, data, StartBit);
-			if (timing_info_present_flag)
-			{
-				int num_units_in_tick = u(32, data, StartBit);
-				int time_scale = u(32, data, StartBit);
-				*fps = time_scale / (2 * num_units_in_tick);
-			}
-		}
-		return true;
-	}
-	else
-	{
-		return false;
-	}
+	return true;
 }
 
 const uint8_t* aac_find_frame(const uint8_t *data, size_t size)
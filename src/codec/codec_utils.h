@@ -17,6 +17,7 @@ extern "C"
 #include <stdint.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <vector>
 
 /** 
  RFC-6184 -- RTP Payload Format for H.264 Video
@@ -60,6 +61,70 @@ extern "C"
 * @return  the position of start code, if the start code non found, then return @param end
 */
 const uint8_t* avc_find_start_code(const uint8_t *start, const uint8_t *end);
+
+//the nalu in an H.264 annex B buffer
+struct AVCNaluIndex
+{
+	//the nalu header position, after the start code
+	const uint8_t *data;
+	//the nalu length, up to the next start code
+	size_t size;
+	//the nalu type
+	uint8_t type;
+	//the nal_ref_idc
+	uint8_t nalRefIdc;
+	//the first_mb_in_slice of the slices, -1 for the other nalus
+	int32_t firstMbInSlice;
+};
+
+/**
+* @brief index the nalus of the buffer in one pass
+* @param data -- the annex B data pointer
+* @param size -- the data length
+* @param nalus -- the nalus, output parameter
+* @param maxNalus -- the max nalus count
+* @return the nalus count
+*/
+int avc_index_nalus(const uint8_t *data, size_t size, AVCNaluIndex *nalus, int maxNalus);
+
+/**
+* the nalus of an H.264 access unit. the buffer is scanned once by parse(),
+* the helpers and the packetizer read the nalus from the index.
+* NOTE: the nalus point to the parsed buffer
+*/
+class AccessUnitIndex
+{
+public:
+	AccessUnitIndex();
+
+	/**
+	* @brief index the nalus of the buffer, the previous nalus are cleared
+	* @param data -- the annex B data pointer
+	* @param size -- the data length
+	* @return the nalus count
+	*/
+	int parse(const uint8_t *data, size_t size);
+
+	int get_count() const { return (int)m_nalus.size(); }
+	const AVCNaluIndex &get_nalu(int index) const { return m_nalus[index]; }
+
+	//whether the first slice is an IDR slice, the same as avc_find_key_frame
+	bool is_key_frame() const;
+
+	//whether there is an IDR slice, the same as is_key_frame() for a single access unit
+	bool has_idr() const;
+
+	//whether there is an SPS, a PPS or an IDR slice
+	bool has_sps_pps_idr() const;
+
+	//the IDR nalus count
+	int count_key_frames() const;
+
+private:
+	std::vector<AVCNaluIndex> m_nalus;
+};
+
+
 bool avc_find_key_frame(const uint8_t *data, size_t size);
 int count_avc_key_frames(const uint8_t *data, size_t size);
 int count_frames(const uint8_t *data, size_t size);
@@ -8,23 +8,327 @@
 #endif
 
 #include <sstream>
+#include <vector>
 #include <new>
 #include <time.h>
 #include <stdarg.h>
 #include <sys/types.h>
 #include <string.h>
 
-LogTask::LogTask(const char *filename, int linenumber, const char *msgType, const char *strMessage, int msgsize)
-	: m_file_name(filename), m_line_number(linenumber), m_msg_type(msgType), m_message(strMessage, msgsize)
+//the record kinds in the log ring
+static const uint32_t LOG_RECORD_PADDING = 0;
+static const uint32_t LOG_RECORD_MESSAGE = 1;
+
+/**
+ * the log record header in the ring, it is followed by the arguments and the string arguments
+ */
+struct LogRecordHeader
+{
+	//the record size, a multiple of 8
+	uint32_t size;
+	//the record kind
+	uint32_t kind;
+	const char *fileName;
+	const char *format;
+	const char *msgType;
+	int64_t time;
+	int64_t tid;
+	int32_t line;
+	int32_t argc;
+};
+
+LogRing::LogRing()
+	: m_in_use(true), m_head(0), m_tail(0)
+{
+	m_buffer = new uint8_t[LOG_RING_SIZE];
+}
+
+LogRing::~LogRing()
+{
+	delete[] m_buffer;
+}
+
+uint8_t *LogRing::reserve(uint32_t size)
+{
+	uint32_t tail = m_tail.load(std::memory_order_relaxed);
+	uint32_t head = m_head.load(std::memory_order_acquire);
+	uint32_t offset = tail & (LOG_RING_SIZE - 1);
+	uint32_t contiguous = LOG_RING_SIZE - offset;
+
+	//the record does not wrap, the end of the buffer is skipped by a padding record
+	uint32_t needed = size <= contiguous ? size : contiguous + size;
+	if (LOG_RING_SIZE - (tail - head) < needed)
+	{
+		return NULL;
+	}
+
+	if (size > contiguous)
+	{
+		uint32_t *padding = (uint32_t *)(m_buffer + offset);
+		padding[0] = contiguous;
+		padding[1] = LOG_RECORD_PADDING;
+		m_tail.store(tail + contiguous, std::memory_order_release);
+		offset = 0;
+	}
+
+	return m_buffer + offset;
+}
+
+void LogRing::commit(uint32_t size)
+{
+	m_tail.store(m_tail.load(std::memory_order_relaxed) + size, std::memory_order_release);
+}
+
+const uint8_t *LogRing::peek(uint32_t &size)
+{
+	for (;;)
+	{
+		uint32_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire))
+		{
+			return NULL;
+		}
+
+		const uint8_t *record = m_buffer + (head & (LOG_RING_SIZE - 1));
+		const uint32_t *prefix = (const uint32_t *)record;
+		if (prefix[1] == LOG_RECORD_PADDING)
+		{
+			m_head.store(head + prefix[0], std::memory_order_release);
+			continue;
+		}
+
+		size = prefix[0];
+		return record;
+	}
+}
+
+void LogRing::consume(uint32_t size)
+{
+	m_head.store(m_head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+}
+
+/**
+ * the ring of the thread, it is released to the pool when the thread exits
+ */
+struct LogRingHolder
+{
+	LogRing *ring;
+
+	LogRingHolder() : ring(NULL) {}
+	~LogRingHolder()
+	{
+		if (ring)
+		{
+			ring->m_in_use = false;
+		}
+	}
+};
+
+static thread_local LogRingHolder s_ring_holder;
+static thread_local long s_thread_id = 0;
+
+//the rings are kept until the process exits, the threads and the logger may end in any order
+static std::vector<LogRing *> s_ring_pool;
+#ifdef _WIN32
+static std::mutex s_ring_pool_mutex;
+#else
+static pthread_mutex_t s_ring_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static long get_thread_id()
 {
+	if (s_thread_id == 0)
+	{
+#ifdef _WIN32
+		s_thread_id = (long)GetCurrentThreadId();
+#else
+		s_thread_id = (long)syscall(__NR_gettid);
+#endif
+	}
+
+	return s_thread_id;
+}
+
+//format one conversion with the star arguments
+template <typename T>
+static int format_conversion(char *out, int outSize, const char *spec, const int *stars, int starCount, T value)
+{
+	switch (starCount)
+	{
+	case 0:
+		return snprintf(out, outSize, spec, value);
+	case 1:
+		return snprintf(out, outSize, spec, stars[0], value);
+	default:
+		return snprintf(out, outSize, spec, stars[0], stars[1], value);
+	}
 }
 
-LogTask::~LogTask()
+//get the integer argument truncated to its promoted size, the signed conversions sign-extend it like printf
+static long long get_integer_arg(const LogArg *arg, bool isSigned)
 {
+	uint32_t size = arg->size < sizeof(int) ? (uint32_t)sizeof(int) : arg->size;
+	if (size >= sizeof(uint64_t))
+	{
+		return (long long)arg->value.u;
+	}
+
+	int bits = size * 8;
+	uint64_t value = arg->value.u & (((uint64_t)1 << bits) - 1);
+	if (isSigned && (value >> (bits - 1)))
+	{
+		value |= ~(uint64_t)0 << bits;
+	}
+	return (long long)value;
+}
+
+//format the message with the raw arguments, the argument which does not match its conversion is printed as (bad)
+static int format_log_message(char *out, int outSize, const char *fmt, const LogArg *args, int argc)
+{
+	int pos = 0;
+	int next = 0;
+	char spec[32];
+
+	while (*fmt && pos < outSize - 1)
+	{
+		if (*fmt != '%')
+		{
+			out[pos++] = *fmt++;
+			continue;
+		}
+
+		if (fmt[1] == '%')
+		{
+			out[pos++] = '%';
+			fmt += 2;
+			continue;
+		}
+
+		//copy the flags, the width and the precision, the length modifiers are replaced
+		int specLen = 0;
+		int stars[2];
+		int starCount = 0;
+		spec[specLen++] = *fmt++;
+		while (*fmt && strchr("-+ #0", *fmt) && specLen < 8)
+		{
+			spec[specLen++] = *fmt++;
+		}
+		for (int part = 0; part < 2; part++)
+		{
+			if (part == 1)
+			{
+				if (*fmt != '.')
+				{
+					break;
+				}
+				spec[specLen++] = *fmt++;
+			}
+
+			if (*fmt == '*')
+			{
+				spec[specLen++] = *fmt++;
+				stars[starCount++] = (next < argc && args[next].type <= LOG_ARG_UINT) ? (int)args[next].value.i : 0;
+				next++;
+			}
+			else
+			{
+				while (*fmt >= '0' && *fmt <= '9' && specLen < 24)
+				{
+					spec[specLen++] = *fmt++;
+				}
+			}
+		}
+		while (*fmt && strchr("hlLqjzt", *fmt))
+		{
+			fmt++;
+		}
+
+		char conv = *fmt;
+		if (!conv)
+		{
+			break;
+		}
+		fmt++;
+
+		const LogArg *arg = next < argc ? &args[next] : NULL;
+		next++;
+
+		int n = -1;
+		int remain = outSize - pos;
+		switch (conv)
+		{
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			if (arg && arg->type <= LOG_ARG_UINT)
+			{
+				spec[specLen++] = 'l';
+				spec[specLen++] = 'l';
+				spec[specLen++] = conv;
+				spec[specLen] = 0;
+				n = format_conversion(out + pos, remain, spec, stars, starCount, get_integer_arg(arg, conv == 'd' || conv == 'i'));
+			}
+			break;
+		case 'c':
+			if (arg && arg->type <= LOG_ARG_UINT)
+			{
+				spec[specLen++] = conv;
+				spec[specLen] = 0;
+				n = format_conversion(out + pos, remain, spec, stars, starCount, (int)arg->value.i);
+			}
+			break;
+		case 'f':
+		case 'F':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			if (arg && arg->type == LOG_ARG_DOUBLE)
+			{
+				spec[specLen++] = conv;
+				spec[specLen] = 0;
+				n = format_conversion(out + pos, remain, spec, stars, starCount, arg->value.d);
+			}
+			break;
+		case 's':
+			if (arg && arg->type == LOG_ARG_STRING)
+			{
+				spec[specLen++] = conv;
+				spec[specLen] = 0;
+				n = format_conversion(out + pos, remain, spec, stars, starCount, arg->value.s ? arg->value.s : "(null)");
+			}
+			break;
+		case 'p':
+			if (arg && (arg->type == LOG_ARG_POINTER || arg->type == LOG_ARG_STRING))
+			{
+				spec[specLen++] = conv;
+				spec[specLen] = 0;
+				n = format_conversion(out + pos, remain, spec, stars, starCount, arg->value.p);
+			}
+			break;
+		default:
+			//%n and the unknown conversions are not supported
+			continue;
+		}
+
+		if (n < 0)
+		{
+			n = snprintf(out + pos, remain, "(bad)");
+		}
+		pos += n < remain ? n : remain - 1;
+	}
+
+	out[pos] = 0;
+	return pos;
 }
 
 AppLogger::AppLogger(const std::string &strPrefixName)
-	: SimpleMessageQueue(1024 * 20),
+	: RingMessageQueue(1024 * 16),
 	m_initialized(false),
 	m_is_daily(true),
 	m_max_size(4096),
@@ -33,8 +337,15 @@ AppLogger::AppLogger(const std::string &strPrefixName)
 	m_seq(0),
 	m_file(NULL),
 	m_printed_size(0L),
-	m_log_type(ASYNC)
+	m_log_type(ASYNC),
+	m_dropped(0),
+	m_cached_time(0),
+	m_cached_file(NULL),
+	m_cached_file_name(NULL)
 {
+	memset(&m_cached_tm, 0, sizeof(m_cached_tm));
+	memset(m_cached_now, 0, sizeof(m_cached_now));
+
 	if (strPrefixName.length() > 128)
 	{
 		m_prefix_name = strPrefixName.substr(0, 128);
@@ -103,16 +414,12 @@ void AppLogger::set_log_type(LogType type)
 
 void AppLogger::handle_msg(const MessageItem &msg)
 {
-	std::auto_ptr<LogTask> task(static_cast<LogTask *>(msg.get_data()));
-
 	switch (msg.get_id())
 	{
 	case MSG_LOG_WRITE_TASK:
 	{
-		write_log(task->m_file_name.c_str(),
-			task->m_line_number,
-			task->m_msg_type.c_str(),
-			task->m_message.c_str());
+		//the records queued by a failed put are written with the next message of the thread
+		drain_ring(static_cast<LogRing *>(msg.get_data()));
 	}
 	break;
 	default:
@@ -120,30 +427,190 @@ void AppLogger::handle_msg(const MessageItem &msg)
 	}
 }
 
-void AppLogger::write_log(const char *filename, int linenumber, const char *msgtype, const char *strMessage)
+void AppLogger::drain_ring(LogRing *ring)
 {
-	time_t now = time(NULL);
+	char szLog[4096];
+	LogArg args[LOG_MAX_ARGS];
+	uint32_t size = 0;
+
+	const uint8_t *record;
+	while ((record = ring->peek(size)) != NULL)
+	{
+		const LogRecordHeader *header = (const LogRecordHeader *)record;
+		memcpy(args, record + sizeof(LogRecordHeader), header->argc * sizeof(LogArg));
+		for (int i = 0; i < header->argc; i++)
+		{
+			if (args[i].type == LOG_ARG_STRING && args[i].value.s)
+			{
+				//the string is copied after the arguments, the value is its offset
+				args[i].value.s = (const char *)record + args[i].value.u;
+			}
+		}
+
+		format_log_message(szLog, 4000, header->format, args, header->argc);
+		write_log((time_t)header->time, (long)header->tid, header->fileName, header->line, header->msgType, szLog);
+
+		ring->consume(size);
+	}
+}
+
+LogRing *AppLogger::get_thread_ring()
+{
+	if (s_ring_holder.ring)
+	{
+		return s_ring_holder.ring;
+	}
+
+	LogRing *ring = NULL;
 #ifdef _WIN32
-	struct tm* tmnow = localtime(&now);
+	std::lock_guard<std::mutex> lg(s_ring_pool_mutex);
 #else
-	struct tm *tmnow;
-	struct tm tmtmp;
-	tmnow = localtime_r(&now, &tmtmp);
+	pthread_mutex_lock(&s_ring_pool_mutex);
 #endif
-	if (NULL == tmnow)
+	//the ring of an exited thread is reused, its records are still written in order
+	for (size_t i = 0; i < s_ring_pool.size(); i++)
 	{
-		return;
+		if (!s_ring_pool[i]->m_in_use.exchange(true))
+		{
+			ring = s_ring_pool[i];
+			break;
+		}
 	}
+	if (!ring)
+	{
+		ring = new (std::nothrow) LogRing();
+		if (ring)
+		{
+			s_ring_pool.push_back(ring);
+		}
+	}
+#ifdef _WIN32
+#else
+	pthread_mutex_unlock(&s_ring_pool_mutex);
+#endif
+
+	s_ring_holder.ring = ring;
+	return ring;
+}
 
-	const char *pFileName = filename;
+void AppLogger::log_message(const char *filename, int linenumber, const char *msgType, const char *szFormat, const LogArg *args, int argc)
+{
+	if (m_log_type == SYNC)
+	{
+		char szLog[4096];
+		format_log_message(szLog, 4000, szFormat, args, argc);
 #ifdef _WIN32
-	pFileName = strrchr(filename, '\\');
-	if (NULL != pFileName)
+		std::lock_guard<std::mutex> lg(m_log_mutex);
+		write_log(time(NULL), get_thread_id(), filename, linenumber, msgType, szLog);
+#else
+		pthread_mutex_lock(&m_log_mutex);
+		write_log(time(NULL), get_thread_id(), filename, linenumber, msgType, szLog);
+		pthread_mutex_unlock(&m_log_mutex);
+#endif
+		return;
+	}
+
+	if (argc > LOG_MAX_ARGS)
 	{
-		++pFileName;
+		m_dropped++;
+		return;
 	}
-	else
+
+	uint32_t lengths[LOG_MAX_ARGS];
+	uint32_t size = sizeof(LogRecordHeader) + argc * sizeof(LogArg);
+	for (int i = 0; i < argc; i++)
+	{
+		if (args[i].type == LOG_ARG_STRING && args[i].value.s)
+		{
+			lengths[i] = (uint32_t)strnlen(args[i].value.s, LOG_MAX_STRING_ARG);
+			size += lengths[i] + 1;
+		}
+	}
+	size = (size + 7) & ~7u;
+
+	LogRing *ring = get_thread_ring();
+	uint8_t *record = (ring && size <= (uint32_t)LOG_MAX_RECORD_SIZE) ? ring->reserve(size) : NULL;
+	if (!record)
+	{
+		m_dropped++;
+		return;
+	}
+
+	LogRecordHeader *header = (LogRecordHeader *)record;
+	header->size = size;
+	header->kind = LOG_RECORD_MESSAGE;
+	header->fileName = filename;
+	header->format = szFormat;
+	header->msgType = msgType;
+	header->time = (int64_t)time(NULL);
+	header->tid = get_thread_id();
+	header->line = linenumber;
+	header->argc = argc;
+
+	LogArg *recordArgs = (LogArg *)(record + sizeof(LogRecordHeader));
+	uint32_t offset = sizeof(LogRecordHeader) + argc * sizeof(LogArg);
+	for (int i = 0; i < argc; i++)
+	{
+		recordArgs[i] = args[i];
+		if (args[i].type == LOG_ARG_STRING && args[i].value.s)
+		{
+			memcpy(record + offset, args[i].value.s, lengths[i]);
+			record[offset + lengths[i]] = 0;
+			recordArgs[i].value.u = offset;
+			offset += lengths[i] + 1;
+		}
+	}
+
+	ring->commit(size);
+	put(MessageItem(MSG_LOG_WRITE_TASK, 0, 0, ring));
+}
+
+void AppLogger::write_log(time_t now, long tid, const char *filename, int linenumber, const char *msgtype, const char *strMessage)
+{
+	//the time string is formatted once per second
+	if (now != m_cached_time || m_cached_now[0] == 0)
 	{
+#ifdef _WIN32
+		struct tm *tmtmp = localtime(&now);
+		if (NULL == tmtmp)
+		{
+			return;
+		}
+		m_cached_tm = *tmtmp;
+#else
+		if (NULL == localtime_r(&now, &m_cached_tm))
+		{
+			return;
+		}
+#endif
+		strftime(m_cached_now, sizeof(m_cached_now), "[%y-%m-%d %H:%M:%S]", &m_cached_tm);
+		m_cached_time = now;
+	}
+	struct tm *tmnow = &m_cached_tm;
+	const char *szNow = m_cached_now;
+
+	if (filename != m_cached_file)
+	{
+		const char *pFileName = filename;
+#ifdef _WIN32
+		pFileName = strrchr(filename, '\\');
+		if (NULL != pFileName)
+		{
+			++pFileName;
+		}
+		else
+		{
+			pFileName = strrchr(filename, '/');
+			if (NULL == pFileName)
+			{
+				pFileName = filename;
+			}
+			else
+			{
+				++pFileName;
+			}
+		}
+#else
 		pFileName = strrchr(filename, '/');
 		if (NULL == pFileName)
 		{
@@ -153,22 +620,13 @@ void AppLogger::write_log(const char *filename, int linenumber, const char *msgt
 		{
 			++pFileName;
 		}
-	}
-#else
-	pFileName = strrchr(filename, '/');
-	if (NULL == pFileName)
-	{
-		pFileName = filename;
-	}
-	else
-	{
-		++pFileName;
-	}
 #endif
+		m_cached_file = filename;
+		m_cached_file_name = pFileName;
+	}
+	const char *pFileName = m_cached_file_name;
 
-	char szNow[64] = { 0 };
 	char szFileName[256] = { 0 };
-	strftime(szNow, sizeof(szNow), "[%y-%m-%d %H:%M:%S]", tmnow);
 
 	if ((m_is_daily && m_day != tmnow->tm_mday) ||
 		m_printed_size > (long)(m_max_size * 1024) ||
@@ -234,11 +692,7 @@ void AppLogger::write_log(const char *filename, int linenumber, const char *msgt
 
 	if (NULL != m_file)
 	{
-#ifdef _WIN32
-		int size = fprintf(m_file, "%s%s[%ld] %s(%d):\t\t%s\r\n", szNow, msgtype, GetCurrentThreadId(), pFileName, linenumber, strMessage);
-#else
-		int size = fprintf(m_file, "%s%s[%ld] %s(%d):\t\t%s\r\n", szNow, msgtype, syscall(__NR_gettid), pFileName, linenumber, strMessage);
-#endif
+		int size = fprintf(m_file, "%s%s[%ld] %s(%d):\t\t%s\r\n", szNow, msgtype, tid, pFileName, linenumber, strMessage);
 		fflush(m_file);
 		if (size > 0)
 		{
@@ -246,189 +700,3 @@ void AppLogger::write_log(const char *filename, int linenumber, const char *msgt
 		}
 	}
 }
-
-void AppLogger::info(const char *filename, int line, const char *szFormat, ...)
-{
-	char szLog[4096];
-
-	va_list a_list;
-	memset(szLog, 0, sizeof(szLog));
-	va_start(a_list, szFormat);
-	int nLog = vsnprintf(szLog, 4000, szFormat, a_list);
-	va_end(a_list);
-
-	if (nLog > 0)
-	{
-		if (m_log_type == SYNC)
-		{
-#ifdef _WIN32
-			std::lock_guard<std::mutex> lg(m_log_mutex);
-			write_log(filename, line, "[I]", szLog);
-#else
-			pthread_mutex_lock(&m_log_mutex);
-			write_log(filename, line, "[I]", szLog);
-			pthread_mutex_unlock(&m_log_mutex);
-#endif
-		}
-		else
-		{
-			MessageItem msg(MSG_LOG_WRITE_TASK, 0, 0, new (std::nothrow) LogTask(filename, line, "[I]", szLog, nLog));
-			put(msg);
-		}
-	}
-}
-
-void AppLogger::debug(const char *filename, int line, const char *szFormat, ...)
-{
-	char szLog[4096];
-
-	va_list a_list;
-	memset(szLog, 0, sizeof(szLog));
-	va_start(a_list, szFormat);
-	int nLog = vsnprintf(szLog, 4000, szFormat, a_list);
-	va_end(a_list);
-
-	if (nLog > 0)
-	{
-		if (m_log_type == SYNC)
-		{
-#ifdef _WIN32
-			std::lock_guard<std::mutex> lg(m_log_mutex);
-			write_log(filename, line, "[D]", szLog);
-#else
-			pthread_mutex_lock(&m_log_mutex);
-			write_log(filename, line, "[D]", szLog);
-			pthread_mutex_unlock(&m_log_mutex);
-#endif
-		}
-		else
-		{
-			MessageItem msg(MSG_LOG_WRITE_TASK, 0, 0, new (std::nothrow) LogTask(filename, line, "[D]", szLog, nLog));
-			put(msg);
-		}
-	}
-}
-
-void AppLogger::warning(const char *filename, int line, const char *szFormat, ...)
-{
-	char szLog[4096];
-
-	va_list a_list;
-	memset(szLog, 0, sizeof(szLog));
-	va_start(a_list, szFormat);
-	int nLog = vsnprintf(szLog, 4000, szFormat, a_list);
-	va_end(a_list);
-
-	if (nLog > 0)
-	{
-		if (m_log_type == SYNC)
-		{
-#ifdef _WIN32
-			std::lock_guard<std::mutex> lg(m_log_mutex);
-			write_log(filename, line, "[W]", szLog);
-#else
-			pthread_mutex_lock(&m_log_mutex);
-			write_log(filename, line, "[W]", szLog);
-			pthread_mutex_unlock(&m_log_mutex);
-#endif
-		}
-		else
-		{
-			MessageItem msg(MSG_LOG_WRITE_TASK, 0, 0, new (std::nothrow) LogTask(filename, line, "[W]", szLog, nLog));
-			put(msg);
-		}
-	}
-}
-
-void AppLogger::error(const char *filename, int line, const char *szFormat, ...)
-{
-	char szLog[4096];
-
-	va_list a_list;
-	memset(szLog, 0, sizeof(szLog));
-	va_start(a_list, szFormat);
-	int nLog = vsnprintf(szLog, 4000, szFormat, a_list);
-	va_end(a_list);
-
-	if (nLog > 0)
-	{
-		if (m_log_type == SYNC)
-		{
-#ifdef _WIN32
-			std::lock_guard<std::mutex> lg(m_log_mutex);
-			write_log(filename, line, "[E]", szLog);
-#else
-			pthread_mutex_lock(&m_log_mutex);
-			write_log(filename, line, "[E]", szLog);
-			pthread_mutex_unlock(&m_log_mutex);
-#endif
-		}
-		else
-		{
-			MessageItem msg(MSG_LOG_WRITE_TASK, 0, 0, new (std::nothrow) LogTask(filename, line, "[E]", szLog, nLog));
-			put(msg);
-		}
-	}
-}
-
-void AppLogger::trace(const char *filename, int line, const char *szFormat, ...)
-{
-	char szLog[4096];
-
-	va_list a_list;
-	memset(szLog, 0, sizeof(szLog));
-	va_start(a_list, szFormat);
-	int nLog = vsnprintf(szLog, 4000, szFormat, a_list);
-	va_end(a_list);
-
-	if (nLog > 0)
-	{
-		if (m_log_type == SYNC)
-		{
-#ifdef _WIN32
-			std::lock_guard<std::mutex> lg(m_log_mutex);
-			write_log(filename, line, "[T]", szLog);
-#else
-			pthread_mutex_lock(&m_log_mutex);
-			write_log(filename, line, "[T]", szLog);
-			pthread_mutex_unlock(&m_log_mutex);
-#endif
-		}
-		else
-		{
-			MessageItem msg(MSG_LOG_WRITE_TASK, 0, 0, new (std::nothrow) LogTask(filename, line, "[T]", szLog, nLog));
-			put(msg);
-		}
-	}
-}
-
-void AppLogger::verbose(const char *filename, int line, const char *szFormat, ...)
-{
-	char szLog[4096];
-
-	va_list a_list;
-	memset(szLog, 0, sizeof(szLog));
-	va_start(a_list, szFormat);
-	int nLog = vsnprintf(szLog, 4000, szFormat, a_list);
-	va_end(a_list);
-
-	if (nLog > 0)
-	{
-		if (m_log_type == SYNC)
-		{
-#ifdef _WIN32
-			std::lock_guard<std::mutex> lg(m_log_mutex);
-			write_log(filename, line, "[V]", szLog);
-#else
-			pthread_mutex_lock(&m_log_mutex);
-			write_log(filename, line, "[V]", szLog);
-			pthread_mutex_unlock(&m_log_mutex);
-#endif
-		}
-		else
-		{
-			MessageItem msg(MSG_LOG_WRITE_TASK, 0, 0, new (std::nothrow) LogTask(filename, line, "[V]", szLog, nLog));
-			put(msg);
-		}
-	}
-}
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include <memory>
 
 #include <stdio.h>
+#include <stdint.h>
+#include <time.h>
 
 #ifdef _WIN32
 #include <mutex>
@@ -23,62 +25,209 @@
 #define LOG_LEVEL_TRACE    0x00000010	 /* trace   */
 #define LOG_LEVEL_VERBOSE  0x00000020    /* verbose */
 
+#define LOG_MODULE_COMMON       0x00000001    /* common, main */
+#define LOG_MODULE_RTP          0x00000002    /* rtp         */
+#define LOG_MODULE_CODEC        0x00000004    /* codec       */
+#define LOG_MODULE_WEBSOCKET    0x00000008    /* websocket   */
+#define LOG_MODULE_APPLICATION  0x00000010    /* application */
+#define LOG_MODULE_ALL          0xFFFFFFFF
+
+//the max compiled log level, the lower levels are compiled out with their arguments.
+//it is set by the LOG_COMPILE_LEVEL cmake option
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_VERBOSE
+#endif
+
+//the module of the source file, it is defined by the CMakeLists.txt of the module
+#ifndef LOG_MODULE
+#define LOG_MODULE LOG_MODULE_COMMON
+#endif
+
 class AppLogger;
 extern AppLogger *g_pLogger;
 
 extern int g_log_level;
 
+//the runtime mask of the logged modules
+extern uint32_t g_log_module_mask;
+
+//whether the level of the module is logged, it is checked before the arguments are evaluated
+#define LOG_ENABLED(level)                                        \
+	((level) <= LOG_COMPILE_LEVEL && (g_log_level >= (level)) && \
+	 (g_log_module_mask & LOG_MODULE) && g_pLogger)
+
 #define LOG_INFO(x, ...)                                             \
 	do                                                               \
 	{                                                                \
-		if (g_pLogger && (g_log_level >= LOG_LEVEL_INFO))            \
+		if (LOG_ENABLED(LOG_LEVEL_INFO))                             \
 			g_pLogger->info(__FILE__, __LINE__, (x), ##__VA_ARGS__); \
 	} while (0)
 #define LOG_WARNING(x, ...)                                             \
 	do                                                                  \
 	{                                                                   \
-		if (g_pLogger && (g_log_level >= LOG_LEVEL_WARNING))            \
+		if (LOG_ENABLED(LOG_LEVEL_WARNING))                             \
 			g_pLogger->warning(__FILE__, __LINE__, (x), ##__VA_ARGS__); \
 	} while (0)
 #define LOG_ERROR(x, ...)                                             \
 	do                                                                \
 	{                                                                 \
-		if (g_pLogger && (g_log_level >= LOG_LEVEL_ERROR))            \
+		if (LOG_ENABLED(LOG_LEVEL_ERROR))                             \
 			g_pLogger->error(__FILE__, __LINE__, (x), ##__VA_ARGS__); \
 	} while (0)
 #define LOG_DEBUG(x, ...)                                             \
 	do                                                                \
 	{                                                                 \
-		if (g_pLogger && (g_log_level >= LOG_LEVEL_DEBUG))            \
+		if (LOG_ENABLED(LOG_LEVEL_DEBUG))                             \
 			g_pLogger->debug(__FILE__, __LINE__, (x), ##__VA_ARGS__); \
 	} while (0)
 #define LOG_TRACE(x, ...)                                             \
 	do                                                                \
 	{                                                                 \
-		if (g_pLogger && (g_log_level >= LOG_LEVEL_TRACE))            \
+		if (LOG_ENABLED(LOG_LEVEL_TRACE))                             \
 			g_pLogger->trace(__FILE__, __LINE__, (x), ##__VA_ARGS__); \
 	} while (0)
 #define LOG_VERBOSE(x, ...)                                             \
 	do                                                                  \
 	{                                                                   \
-		if (g_pLogger && (g_log_level >= LOG_LEVEL_VERBOSE))            \
+		if (LOG_ENABLED(LOG_LEVEL_VERBOSE))                             \
 			g_pLogger->verbose(__FILE__, __LINE__, (x), ##__VA_ARGS__); \
 	} while (0)
 
 
 const int  MSG_LOG_WRITE_TASK = 1001;
 
-class LogTask
+//the per-thread log ring size in bytes, it must be a power of 2
+const int LOG_RING_SIZE = 256 * 1024;
+
+//the max record size in the log ring
+const int LOG_MAX_RECORD_SIZE = 4096;
+
+//the max string argument length copied into the log ring
+const int LOG_MAX_STRING_ARG = 1024;
+
+//the max arguments of a log call
+const int LOG_MAX_ARGS = 32;
+
+//the log argument types
+enum LogArgType
 {
-public:
-	LogTask(const char *filename, int linenumber, const char *msgType, const char *strMessage, int msgSize);
-	virtual ~LogTask();
+	LOG_ARG_INT,
+	LOG_ARG_UINT,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_STRING,
+	LOG_ARG_POINTER
+};
+
+/**
+ * a raw log argument, the arguments are formatted on the logger thread
+ */
+struct LogArg
+{
+	int type;
+	//the size of the argument type, the integers are truncated to it when they are formatted
+	uint32_t size;
+	union
+	{
+		int64_t i;
+		uint64_t u;
+		double d;
+		const char *s;
+		const void *p;
+	} value;
+};
 
+inline LogArg make_log_arg_int(int64_t v, uint32_t size) { LogArg arg; arg.type = LOG_ARG_INT; arg.size = size; arg.value.i = v; return arg; }
+inline LogArg make_log_arg_uint(uint64_t v, uint32_t size) { LogArg arg; arg.type = LOG_ARG_UINT; arg.size = size; arg.value.u = v; return arg; }
+
+inline LogArg make_log_arg(bool v) { return make_log_arg_int(v, sizeof(v)); }
+inline LogArg make_log_arg(char v) { return make_log_arg_int(v, sizeof(v)); }
+inline LogArg make_log_arg(signed char v) { return make_log_arg_int(v, sizeof(v)); }
+inline LogArg make_log_arg(short v) { return make_log_arg_int(v, sizeof(v)); }
+inline LogArg make_log_arg(int v) { return make_log_arg_int(v, sizeof(v)); }
+inline LogArg make_log_arg(long v) { return make_log_arg_int(v, sizeof(v)); }
+inline LogArg make_log_arg(long long v) { return make_log_arg_int(v, sizeof(v)); }
+inline LogArg make_log_arg(unsigned char v) { return make_log_arg_uint(v, sizeof(v)); }
+inline LogArg make_log_arg(unsigned short v) { return make_log_arg_uint(v, sizeof(v)); }
+inline LogArg make_log_arg(unsigned int v) { return make_log_arg_uint(v, sizeof(v)); }
+inline LogArg make_log_arg(unsigned long v) { return make_log_arg_uint(v, sizeof(v)); }
+inline LogArg make_log_arg(unsigned long long v) { return make_log_arg_uint(v, sizeof(v)); }
+
+inline LogArg make_log_arg(double v)
+{
+	LogArg arg;
+	arg.type = LOG_ARG_DOUBLE;
+	arg.size = sizeof(v);
+	arg.value.d = v;
+	return arg;
+}
+
+inline LogArg make_log_arg(const char *v)
+{
+	LogArg arg;
+	arg.type = LOG_ARG_STRING;
+	arg.size = sizeof(v);
+	arg.value.s = v;
+	return arg;
+}
+
+template <typename T>
+inline LogArg make_log_arg(const T *v)
+{
+	LogArg arg;
+	arg.type = LOG_ARG_POINTER;
+	arg.size = sizeof(v);
+	arg.value.p = v;
+	return arg;
+}
+
+/**
+ * the single producer single consumer log record ring of a thread. the thread
+ * which logs is the producer, the logger thread is the consumer.
+ */
+class LogRing
+{
 public:
-	std::string m_file_name;
-	int m_line_number;
-	std::string m_msg_type;
-	std::string m_message;
+	LogRing();
+	~LogRing();
+
+	/**
+	 * @brief reserve a contiguous record in the ring
+	 * @param size -- the record size, it is a multiple of 8
+	 * @return the record buffer, NULL if the ring is full
+	 */
+	uint8_t *reserve(uint32_t size);
+
+	/**
+	 * @brief publish the reserved record
+	 * @param size -- the record size
+	 */
+	void commit(uint32_t size);
+
+	/**
+	 * @brief get the first record
+	 * @param size -- the record size, output parameter
+	 * @return the record buffer, NULL if the ring is empty
+	 */
+	const uint8_t *peek(uint32_t &size);
+
+	/**
+	 * @brief release the first record
+	 * @param size -- the record size
+	 */
+	void consume(uint32_t size);
+
+	//whether the ring is used by a living thread
+	std::atomic<bool> m_in_use;
+
+private:
+	uint8_t *m_buffer;
+	//the paddings keep the positions on their own cache lines, the ring is not over-aligned
+	char m_pad0[CACHE_LINE_SIZE];
+	//the consumer position
+	std::atomic<uint32_t> m_head;
+	char m_pad1[CACHE_LINE_SIZE - sizeof(std::atomic<uint32_t>)];
+	//the producer position
+	std::atomic<uint32_t> m_tail;
 };
 
 //log type: synchronize asynchronize
@@ -88,7 +237,7 @@ enum LogType
 	ASYNC
 };
 
-class AppLogger : public SimpleMessageQueue
+class AppLogger : public RingMessageQueue
 {
 public:
 
@@ -108,28 +257,82 @@ public:
 	bool initialize(const std::string &strLogDirectory, bool bDaily, int nMaxSize, int nMaxFile);
 	bool uninitialize();
 
-	void info(const char *filename, int line, const char *szFormat, ...);
-	void debug(const char *filename, int line, const char *szFormat, ...);
-	void warning(const char *filename, int line, const char *szFormat, ...);
-	void error(const char *filename, int line, const char *szFormat, ...);
-	void trace(const char *filename, int line, const char *szFormat, ...);
-	void verbose(const char *filename, int line, const char *szFormat, ...);
+	//the log functions. in the async mode, only the format pointer and the raw
+	//arguments are copied into the ring of the calling thread, they are formatted
+	//on the logger thread. so the format must be a string literal.
+	template <typename... Args>
+	void info(const char *filename, int line, const char *szFormat, const Args &... args)
+	{
+		LogArg argv[] = {make_log_arg(0), make_log_arg(args)...};
+		log_message(filename, line, "[I]", szFormat, argv + 1, (int)sizeof...(Args));
+	}
+	template <typename... Args>
+	void debug(const char *filename, int line, const char *szFormat, const Args &... args)
+	{
+		LogArg argv[] = {make_log_arg(0), make_log_arg(args)...};
+		log_message(filename, line, "[D]", szFormat, argv + 1, (int)sizeof...(Args));
+	}
+	template <typename... Args>
+	void warning(const char *filename, int line, const char *szFormat, const Args &... args)
+	{
+		LogArg argv[] = {make_log_arg(0), make_log_arg(args)...};
+		log_message(filename, line, "[W]", szFormat, argv + 1, (int)sizeof...(Args));
+	}
+	template <typename... Args>
+	void error(const char *filename, int line, const char *szFormat, const Args &... args)
+	{
+		LogArg argv[] = {make_log_arg(0), make_log_arg(args)...};
+		log_message(filename, line, "[E]", szFormat, argv + 1, (int)sizeof...(Args));
+	}
+	template <typename... Args>
+	void trace(const char *filename, int line, const char *szFormat, const Args &... args)
+	{
+		LogArg argv[] = {make_log_arg(0), make_log_arg(args)...};
+		log_message(filename, line, "[T]", szFormat, argv + 1, (int)sizeof...(Args));
+	}
+	template <typename... Args>
+	void verbose(const char *filename, int line, const char *szFormat, const Args &... args)
+	{
+		LogArg argv[] = {make_log_arg(0), make_log_arg(args)...};
+		log_message(filename, line, "[V]", szFormat, argv + 1, (int)sizeof...(Args));
+	}
+
+	//the log records dropped because the ring of the thread was full
+	uint64_t get_dropped_count() const { return m_dropped; }
 
 protected:
 	virtual void handle_msg(const MessageItem &msg);
-	virtual void destroy_msg(const MessageItem &msg)
+	virtual void destroy_msg(const MessageItem & /*msg*/)
 	{
-		std::auto_ptr<LogTask> task(static_cast<LogTask *>(msg.get_data()));
+		//the message data is the log ring, the records stay in it
 	}
 
 private:
+	//log a message
+	//@param:
+	//      filename -- source file name
+	//      linenumber -- code line number
+	//      msgType -- msg type [E],[W],[I],[D],[V], are error, warning, info, debug, verbose
+	//      szFormat -- the format string
+	//      args -- the raw arguments
+	//      argc -- the arguments count
+	void log_message(const char *filename, int linenumber, const char *msgType, const char *szFormat, const LogArg *args, int argc);
+
+	//get the log ring of the calling thread
+	LogRing *get_thread_ring();
+
+	//format and write the records in the ring
+	void drain_ring(LogRing *ring);
+
 	//write log
 	//@param:
+	//      now -- the log time
+	//      tid -- the thread id
 	//      filename -- source file name
-	//       linenumber -- code line number
-	//       msgType -- msg type [E],[W],[I],[D],[V], are error, warning, info, debug, verbose
-	//       strMessage -- string to write to log
-	void write_log(const char *filename, int linenumber, const char *msgType, const char *strMessage);
+	//      linenumber -- code line number
+	//      msgType -- msg type [E],[W],[I],[D],[V], are error, warning, info, debug, verbose
+	//      strMessage -- string to write to log
+	void write_log(time_t now, long tid, const char *filename, int linenumber, const char *msgType, const char *strMessage);
 
 private:
 	bool m_initialized;
@@ -165,6 +368,18 @@ private:
 	//log type
 	LogType m_log_type;
 
+	//the dropped log records
+	std::atomic<uint64_t> m_dropped;
+
+	//the cached log time and its formatted string
+	time_t m_cached_time;
+	struct tm m_cached_tm;
+	char m_cached_now[64];
+
+	//the cached source file path and its file name
+	const char *m_cached_file;
+	const char *m_cached_file_name;
+
 #ifdef _WIN32
 	std::mutex m_log_mutex;
 #else
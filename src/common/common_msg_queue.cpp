@@ -1,7 +1,13 @@
 #include "common_msg_queue.h"
 
+#include <new>
 #ifdef _WIN32
 #include <functional>
+#else
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #endif
 
 MessageItem::MessageItem(int msg_id, int first_param, int second_param, void *data)
@@ -253,4 +259,247 @@ void SimpleMessageQueue::clear_msg_queue()
 	}
 	pthread_mutex_unlock(&m_mutex);
 #endif
-}
\ No newline at end of file
+}
+
+/*****************************************************************/
+/*****************************************************************/
+
+static void* ring_run_func(void* ptr)
+{
+	RingMessageQueue* queue = (RingMessageQueue*)ptr;
+	queue->run();
+	return 0;
+}
+
+RingMessageQueue::RingMessageQueue(int max_count)
+	: m_initialized(false), m_is_running(false), m_cells(NULL), m_mask(0),
+	m_enqueue_pos(0), m_dequeue_pos(0), m_wake_seq(0), m_sleeping(false)
+{
+	uint32_t size = 2;
+	while ((int)size < max_count && size < 0x40000000)
+	{
+		size <<= 1;
+	}
+
+	m_cells = new (std::nothrow) Cell[size];
+	if (m_cells)
+	{
+		m_mask = size - 1;
+		for (uint32_t i = 0; i < size; i++)
+		{
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+}
+
+RingMessageQueue::~RingMessageQueue()
+{
+	if (m_cells)
+	{
+		delete[] m_cells;
+		m_cells = NULL;
+	}
+}
+
+void RingMessageQueue::start()
+{
+	if (!m_cells)
+	{
+		return;
+	}
+
+	m_is_running = true;
+
+#ifdef _WIN32
+	m_running_thread = std::thread(std::bind(&RingMessageQueue::run, this));
+	m_initialized = true;
+#else
+	int ret = pthread_create(&m_running_thread, NULL, ring_run_func, this);
+	if(ret == 0)
+	{
+		m_initialized = true;
+	}else
+	{
+		m_is_running = false;
+		m_initialized = false;
+	}
+#endif
+}
+
+void RingMessageQueue::stop()
+{
+	if (m_is_running)
+	{
+		m_is_running = false;
+
+		//the consumer thread is draining the queue, the exit msg is queued when a slot is free
+		while (!put(MessageItem(EXIT_MSG_ID, 0, 0, NULL)))
+		{
+#ifdef _WIN32
+			std::this_thread::yield();
+#else
+			sched_yield();
+#endif
+		}
+
+		if (m_initialized)
+		{
+#ifdef _WIN32
+			m_running_thread.join();
+#else
+			pthread_join(m_running_thread, NULL);
+#endif
+			m_initialized = false;
+		}
+	}
+}
+
+void RingMessageQueue::run()
+{
+	while (m_is_running)
+	{
+		MessageItem msg;
+		//get the message item
+		get(msg);
+		if (msg.get_id() != EXIT_MSG_ID)
+		{
+			handle_msg(msg);
+		}
+	}
+
+	clear_msg_queue();
+}
+
+bool RingMessageQueue::readable() const
+{
+	const Cell &cell = m_cells[m_dequeue_pos & m_mask];
+	return cell.sequence.load(std::memory_order_acquire) == m_dequeue_pos + 1;
+}
+
+bool RingMessageQueue::try_pop(MessageItem &msg)
+{
+	Cell &cell = m_cells[m_dequeue_pos & m_mask];
+	if (cell.sequence.load(std::memory_order_acquire) != m_dequeue_pos + 1)
+	{
+		return false;
+	}
+
+	msg = cell.item;
+	//the slot is free for the enqueue position one lap later
+	cell.sequence.store(m_dequeue_pos + m_mask + 1, std::memory_order_release);
+	m_dequeue_pos++;
+
+	return true;
+}
+
+int RingMessageQueue::get(MessageItem &msg)
+{
+	while (!try_pop(msg))
+	{
+		//the wake sequence is read before the ring is checked again, a put after the check changes it
+		int seq = m_wake_seq.load(std::memory_order_acquire);
+		m_sleeping.store(true, std::memory_order_seq_cst);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (!readable())
+		{
+#ifdef _WIN32
+			std::unique_lock<std::mutex> lock(this->m_mutex);
+			this->m_condi.wait(lock, [this, seq] {
+				return m_wake_seq.load(std::memory_order_acquire) != seq;
+			});
+#else
+			syscall(SYS_futex, reinterpret_cast<int *>(&m_wake_seq), FUTEX_WAIT_PRIVATE, seq, NULL, NULL, 0);
+#endif
+		}
+
+		m_sleeping.store(false, std::memory_order_relaxed);
+	}
+
+	return (int)(m_enqueue_pos.load(std::memory_order_relaxed) - m_dequeue_pos);
+}
+
+void RingMessageQueue::wake_consumer()
+{
+	//pairs with the fence in get(), either the consumer sees the message or the producer sees it sleeping
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!m_sleeping.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	{
+		std::unique_lock<std::mutex> lock(this->m_mutex);
+		m_wake_seq.fetch_add(1, std::memory_order_release);
+	}
+	this->m_condi.notify_one();
+#else
+	m_wake_seq.fetch_add(1, std::memory_order_release);
+	syscall(SYS_futex, reinterpret_cast<int *>(&m_wake_seq), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+}
+
+bool RingMessageQueue::put(const MessageItem &msg)
+{
+	if (!m_is_running && msg.get_id() != EXIT_MSG_ID)
+	{
+		destroy_msg(msg);
+		return false;
+	}
+
+	if (!m_cells)
+	{
+		return false;
+	}
+
+	uint32_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+	Cell *cell;
+	for (;;)
+	{
+		cell = &m_cells[pos & m_mask];
+		uint32_t seq = cell->sequence.load(std::memory_order_acquire);
+		int32_t diff = (int32_t)(seq - pos);
+		if (diff == 0)
+		{
+			//the slot is free, claim it
+			if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (diff < 0)
+		{
+			//the slot is still used one lap earlier, the queue is full
+			if (msg.get_id() != EXIT_MSG_ID)
+			{
+				destroy_msg(msg);
+			}
+			return false;
+		}
+		else
+		{
+			//another producer claimed the slot
+			pos = m_enqueue_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->item = msg;
+	cell->sequence.store(pos + 1, std::memory_order_release);
+
+	wake_consumer();
+	return true;
+}
+
+void RingMessageQueue::clear_msg_queue()
+{
+	//clear the remaining data
+	MessageItem item;
+	while (try_pop(item))
+	{
+		if (item.get_id() != EXIT_MSG_ID)
+		{
+			destroy_msg(item);
+		}
+	}
+}
@@ -2,12 +2,13 @@
 #define __H_COMMON_MSG_QUEUE_H__
 
 #include <deque>
+#include <atomic>
+#include <stdint.h>
 
 #ifdef _WIN32
 #include <thread>
 #include <mutex>
 #include <condition_variable>
-#include <atomic>
 #else
 #include <pthread.h>
 #endif
@@ -15,6 +16,9 @@
 //the exit msg id
 const int EXIT_MSG_ID = 0xFFFFFFFF;
 
+//the cache line size, the positions written by different threads are padded to it
+const int CACHE_LINE_SIZE = 64;
+
 /**
  * the message item in SimpleMessageQueue
  */
@@ -118,4 +122,97 @@ private:
 	std::deque<MessageItem> m_msg_queue;
 };
 
-#endif
\ No newline at end of file
+/**
+ * A bounded lock-free multi-producer single-consumer message queue.
+ * put() claims a ring slot with a CAS and never takes a lock, so the producers
+ * do not contend with the consumer thread. the consumer thread sleeps on a futex
+ * only when the ring is empty, the producers wake it only when it sleeps.
+ */
+class RingMessageQueue
+{
+public:
+	//constructor
+	//@param maxCount -- the maximux capacity of the queue, it is rounded up to a power of 2
+	RingMessageQueue(int maxCount = 2048);
+	virtual ~RingMessageQueue();
+
+	//add message item msg to the queue. it can be called by multiple threads.
+	//if the queue if full, the queue will ignore the item
+	//@param: msg -- message item
+	//@return true--success, false--fail
+	bool put(const MessageItem &msg);
+
+	virtual void run();
+
+protected:
+	//start the message queue loop
+	void start();
+
+	//stop the message queue loop
+	void stop();
+
+	//get the first item in the queue.
+	//if the queue is empty, this function will blocked.
+	//and will return the message item when the queue is not empty.
+	//@param: msg -- message item
+	//@param: the remaining Message item count in the queue
+	int get(MessageItem &msg);
+
+	//message process function
+	virtual void handle_msg(const MessageItem &msg) = 0;
+	virtual void destroy_msg(const MessageItem &msg) = 0;
+	virtual void clear_msg_queue();
+
+private:
+	struct Cell
+	{
+		//the slot sequence, it is the enqueue position when the slot is free,
+		//the enqueue position + 1 when the slot holds a message
+		std::atomic<uint32_t> sequence;
+		MessageItem item;
+	};
+
+	//pop the first item without blocking
+	//@return true--popped, false--the queue is empty
+	bool try_pop(MessageItem &msg);
+
+	//whether the first slot holds a message, it is called by the consumer thread
+	bool readable() const;
+
+	//wake the consumer thread if it sleeps
+	void wake_consumer();
+
+private:
+	bool m_initialized;
+	//is the message queue running?
+	std::atomic<bool> m_is_running;
+
+	//the ring, the size is a power of 2
+	Cell *m_cells;
+	uint32_t m_mask;
+
+	//the paddings keep the positions on their own cache lines. they are not alignas,
+	//an over-aligned queue needs the aligned operator new of C++17
+	char m_pad0[CACHE_LINE_SIZE];
+	//the enqueue position, shared by the producers
+	std::atomic<uint32_t> m_enqueue_pos;
+	char m_pad1[CACHE_LINE_SIZE - sizeof(std::atomic<uint32_t>)];
+	//the dequeue position, it is only used by the consumer thread
+	uint32_t m_dequeue_pos;
+	char m_pad2[CACHE_LINE_SIZE - sizeof(uint32_t)];
+
+	//the futex word, it is increased when the sleeping consumer is woken
+	std::atomic<int> m_wake_seq;
+	//whether the consumer thread sleeps or is going to sleep
+	std::atomic<bool> m_sleeping;
+
+#ifdef _WIN32
+	std::thread m_running_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_condi;
+#else
+	pthread_t m_running_thread;
+#endif
+};
+
+#endif
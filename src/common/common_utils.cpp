@@ -12,6 +12,9 @@
 #include <io.h>
 #include <direct.h>
 #include <windows.h>
+#include <chrono>
+#else
+#include <time.h>
 #endif
 
 bool check_path_exists(const std::string &path)
@@ -253,4 +256,42 @@ long string_to_long(const std::string& str)
 double string_to_double(const std::string& str)
 {
 	return atof(str.c_str());
-}
\ No newline at end of file
+}
+
+uint64_t get_monotonic_time_us()
+{
+#ifdef _WIN32
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)(ts.tv_nsec / 1000);
+#endif
+}
+
+uint64_t get_monotonic_time_ms()
+{
+	return get_monotonic_time_us() / 1000;
+}
+
+void get_ntp_time(uint32_t &msw, uint32_t &lsw)
+{
+	//the seconds from 1900-01-01 to 1970-01-01
+	const uint64_t NTP_UNIX_OFFSET = 2208988800ULL;
+
+#ifdef _WIN32
+	uint64_t us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	uint64_t sec = us / 1000000;
+	uint64_t usec = us % 1000000;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	uint64_t sec = (uint64_t)ts.tv_sec;
+	uint64_t usec = (uint64_t)(ts.tv_nsec / 1000);
+#endif
+
+	msw = (uint32_t)(sec + NTP_UNIX_OFFSET);
+	lsw = (uint32_t)((usec << 32) / 1000000);
+}
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <stdint.h>
 
 /**
 * @brief check if the path exists
@@ -96,4 +97,23 @@ int string_to_int(const std::string& str);
 long string_to_long(const std::string& str);
 double string_to_double(const std::string& str);
 
+/**
+* @brief get the monotonic clock time. the time is not affected by the system time changes
+* @return the monotonic time in microseconds
+*/
+uint64_t get_monotonic_time_us();
+
+/**
+* @brief get the monotonic clock time. the time is not affected by the system time changes
+* @return the monotonic time in milliseconds
+*/
+uint64_t get_monotonic_time_ms();
+
+/**
+* @brief get the wall clock time in the NTP format
+* @param msw -- the seconds since 1900-01-01, output parameter
+* @param lsw -- the fraction of the second in 1/2^32 seconds, output parameter
+*/
+void get_ntp_time(uint32_t &msw, uint32_t &lsw);
+
 #endif
\ No newline at end of file
@@ -28,6 +28,8 @@
 AppLogger *g_pLogger = NULL;
 //日志等级
 int g_log_level = LOG_LEVEL_VERBOSE;
+//日志模块
+uint32_t g_log_module_mask = LOG_MODULE_ALL;
 
 //视频会议对象
 LiveMeetingRoom *g_room = NULL;
@@ -50,9 +52,10 @@ bool g_in_room;
 //length -- 数据长度
 //ssrc -- H.264视频流的ssrc
 //timestamp -- 时间戳
+//flags -- 帧标志, H264_FRAME_FLAG_KEYFRAME/INCOMPLETE/REFERENCE_LOST 的组合
 //userArg -- 用户传入的自定义参数
 void h264_receive_callback(std::string &uuid, uint8_t *data, int length,
-						   uint32_t ssrc, uint32_t timestamp, void *userArg)
+						   uint32_t ssrc, uint32_t timestamp, uint32_t flags, void *userArg)
 {
 }
 
@@ -0,0 +1,185 @@
+#include "rtcp_nack_generator.h"
+
+#include <string.h>
+
+RTCPNackGenerator::RTCPNackGenerator()
+{
+	m_started = false;
+	m_highest_sequence = 0;
+	m_count = 0;
+	m_rtt_us = 0;
+	memset(m_entries, 0, sizeof(m_entries));
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+RTCPNackGenerator::~RTCPNackGenerator()
+{
+}
+
+void RTCPNackGenerator::clear()
+{
+	if (m_count == 0)
+	{
+		return;
+	}
+
+	for (int i = 0; i < RTCP_NACK_LIST_SIZE; i++)
+	{
+		m_entries[i].active = false;
+	}
+	m_count = 0;
+}
+
+bool RTCPNackGenerator::on_packet(uint16_t sequence, uint64_t nowUs)
+{
+	if (!m_started)
+	{
+		m_started = true;
+		m_highest_sequence = sequence;
+		return false;
+	}
+
+	int16_t distance = (int16_t)(sequence - m_highest_sequence);
+	if (distance > 0)
+	{
+		if (distance > RTCP_NACK_LIST_SIZE)
+		{
+			//the gap is too large to recover, the receiver waits for the next keyframe
+			m_stats.abandoned += m_count;
+			clear();
+		}
+		else
+		{
+			for (uint16_t missing = m_highest_sequence + 1; missing != sequence; missing++)
+			{
+				NackEntry &entry = m_entries[missing & (RTCP_NACK_LIST_SIZE - 1)];
+				if (entry.active)
+				{
+					//the ring wrapped onto a packet which was never recovered
+					m_stats.abandoned++;
+					m_count--;
+				}
+
+				entry.active = true;
+				entry.sequence = missing;
+				entry.detectTime = nowUs;
+				entry.requestTime = 0;
+				entry.retries = 0;
+				m_count++;
+				m_stats.missing++;
+			}
+		}
+
+		m_highest_sequence = sequence;
+		return false;
+	}
+
+	if (distance < -RTCP_NACK_LIST_SIZE)
+	{
+		//the sequence jumps back, the stream was restarted
+		clear();
+		m_highest_sequence = sequence;
+		return false;
+	}
+
+	NackEntry &entry = m_entries[sequence & (RTCP_NACK_LIST_SIZE - 1)];
+	if (!entry.active || entry.sequence != sequence)
+	{
+		//duplicated, or reordered before the gap was requested
+		return false;
+	}
+
+	entry.active = false;
+	m_count--;
+
+	if (entry.retries == 0)
+	{
+		return false;
+	}
+
+	m_stats.recovered++;
+
+	//the round trip time is only sampled from the packets which were requested once,
+	//the retransmission of the later requests is ambiguous
+	if (entry.retries == 1)
+	{
+		double sample = (double)(nowUs - entry.requestTime);
+		m_rtt_us = m_rtt_us == 0 ? sample : m_rtt_us + (sample - m_rtt_us) / 8;
+		m_stats.rttMs = m_rtt_us / 1000;
+	}
+
+	return true;
+}
+
+void RTCPNackGenerator::on_recovered(uint16_t sequence, uint64_t nowUs)
+{
+	//the packet beyond the highest sequence updates the gaps like a received packet
+	if (!m_started || (int16_t)(sequence - m_highest_sequence) > 0)
+	{
+		on_packet(sequence, nowUs);
+		return;
+	}
+
+	NackEntry &entry = m_entries[sequence & (RTCP_NACK_LIST_SIZE - 1)];
+	if (entry.active && entry.sequence == sequence)
+	{
+		entry.active = false;
+		m_count--;
+	}
+}
+
+int RTCPNackGenerator::get_nack_list(uint64_t nowUs, uint16_t *sequences, int maxCount)
+{
+	if (m_count == 0)
+	{
+		return 0;
+	}
+
+	//a missing packet is requested again when the retransmission of the previous request is overdue
+	uint64_t interval = (uint64_t)(m_rtt_us > 0 ? m_rtt_us * 5 / 4 : RTCP_NACK_DEFAULT_RTT_MS * 1000);
+	if (interval < (uint64_t)RTCP_NACK_MIN_INTERVAL_MS * 1000)
+	{
+		interval = (uint64_t)RTCP_NACK_MIN_INTERVAL_MS * 1000;
+	}
+
+	int count = 0;
+	for (int i = RTCP_NACK_LIST_SIZE - 1; i > 0 && count < maxCount; i--)
+	{
+		uint16_t sequence = (uint16_t)(m_highest_sequence - i);
+		NackEntry &entry = m_entries[sequence & (RTCP_NACK_LIST_SIZE - 1)];
+		if (!entry.active || entry.sequence != sequence)
+		{
+			continue;
+		}
+
+		if (nowUs - entry.detectTime >= (uint64_t)RTCP_NACK_MAX_AGE_MS * 1000 || entry.retries >= RTCP_NACK_MAX_RETRIES)
+		{
+			entry.active = false;
+			m_count--;
+			m_stats.abandoned++;
+			continue;
+		}
+
+		if (entry.requestTime != 0 && nowUs - entry.requestTime < interval)
+		{
+			continue;
+		}
+
+		entry.requestTime = nowUs;
+		entry.retries++;
+		sequences[count++] = sequence;
+		m_stats.requests++;
+	}
+
+	return count;
+}
+
+int RTCPNackGenerator::get_rtt_ms() const
+{
+	return (int)(m_rtt_us / 1000);
+}
+
+void RTCPNackGenerator::get_stats(RTCPNackStats &stats) const
+{
+	stats = m_stats;
+}
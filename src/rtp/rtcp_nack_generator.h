@@ -0,0 +1,126 @@
+#ifndef _H_RTCP_NACK_GENERATOR_H_
+#define _H_RTCP_NACK_GENERATOR_H_
+
+#include <stdint.h>
+
+//the missing sequences ring size, it must be a power of 2. it is the max sequence
+//gap which is requested, the larger gaps are left to the keyframe recovery
+const int RTCP_NACK_LIST_SIZE = 512;
+
+//the max NACK requests of a missing packet
+const int RTCP_NACK_MAX_RETRIES = 10;
+
+//the missing packet is given up after the time in milliseconds, it is too late to play out
+const int RTCP_NACK_MAX_AGE_MS = 500;
+
+//the min interval of the NACK requests of a missing packet in milliseconds
+const int RTCP_NACK_MIN_INTERVAL_MS = 5;
+
+//the round trip time in milliseconds before it is measured
+const int RTCP_NACK_DEFAULT_RTT_MS = 50;
+
+/**
+ * the NACK generator statistics
+ */
+struct RTCPNackStats
+{
+	//the missing sequences detected
+	uint64_t missing;
+	//the NACK requests of the sequences
+	uint64_t requests;
+	//the missing packets which were received after they were requested
+	uint64_t recovered;
+	//the missing packets which were given up
+	uint64_t abandoned;
+	//the round trip time in milliseconds, measured from the NACK to the retransmission
+	double rttMs;
+};
+
+/**
+ * the generic NACK generator of a received stream. the sequence gaps are recorded
+ * as the missing packets, they are requested again after a round trip time until
+ * they arrive, they are too old or the retries are exhausted.
+ * NOTE: the generator is not thread safe.
+ */
+class RTCPNackGenerator
+{
+public:
+	RTCPNackGenerator();
+	virtual ~RTCPNackGenerator();
+
+	/**
+	 * @brief update the missing packets by the received rtp packet
+	 *
+	 * @param sequence -- the packet sequence
+	 * @param nowUs -- the arrival time, the monotonic time in microseconds
+	 *
+	 * @return true - the packet was requested by a NACK, it is a retransmission
+	 */
+	bool on_packet(uint16_t sequence, uint64_t nowUs);
+
+	/**
+	 * @brief remove the missing packet which was recovered locally, e.g. by FEC.
+	 * the round trip time is not sampled from it.
+	 *
+	 * @param sequence -- the packet sequence
+	 * @param nowUs -- the recovery time, the monotonic time in microseconds
+	 */
+	void on_recovered(uint16_t sequence, uint64_t nowUs);
+
+	/**
+	 * @brief get the missing sequences which should be requested now, in the sequence order
+	 *
+	 * @param nowUs -- the monotonic time in microseconds
+	 * @param sequences -- the sequences, output parameter
+	 * @param maxCount -- the max sequences count
+	 *
+	 * @return the sequences count
+	 */
+	int get_nack_list(uint64_t nowUs, uint16_t *sequences, int maxCount);
+
+	/**
+	 * @brief get the round trip time in milliseconds
+	 */
+	int get_rtt_ms() const;
+
+	/**
+	 * @brief get the statistics
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_stats(RTCPNackStats &stats) const;
+
+private:
+	struct NackEntry
+	{
+		//whether the sequence is missing
+		bool active;
+		uint16_t sequence;
+		//the time when the gap was detected
+		uint64_t detectTime;
+		//the time of the last request, 0 if it was not requested
+		uint64_t requestTime;
+		//the requests count
+		int retries;
+	};
+
+	//clear all the missing packets
+	void clear();
+
+private:
+	//whether the first packet was received
+	bool m_started;
+	//the highest sequence received
+	uint16_t m_highest_sequence;
+
+	//the missing packets, indexed by the sequence
+	NackEntry m_entries[RTCP_NACK_LIST_SIZE];
+	//the missing packets count
+	int m_count;
+
+	//the smoothed round trip time in microseconds, 0 if it is not measured
+	double m_rtt_us;
+
+	RTCPNackStats m_stats;
+};
+
+#endif
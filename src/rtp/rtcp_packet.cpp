@@ -0,0 +1,326 @@
+#include "rtcp_packet.h"
+
+#include <string.h>
+#include <random>
+
+namespace
+{
+	void write_uint16(uint8_t *p, uint16_t v)
+	{
+		p[0] = (uint8_t)(v >> 8);
+		p[1] = (uint8_t)v;
+	}
+
+	void write_uint32(uint8_t *p, uint32_t v)
+	{
+		p[0] = (uint8_t)(v >> 24);
+		p[1] = (uint8_t)(v >> 16);
+		p[2] = (uint8_t)(v >> 8);
+		p[3] = (uint8_t)v;
+	}
+
+	uint16_t read_uint16(const uint8_t *p)
+	{
+		return (uint16_t)((p[0] << 8) | p[1]);
+	}
+
+	uint32_t read_uint32(const uint8_t *p)
+	{
+		return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+	}
+
+	//write the common header, the length is in bytes including the header
+	void write_header(uint8_t *p, uint8_t count, uint8_t type, int length)
+	{
+		p[0] = (uint8_t)(0x80 | (count & 0x1F));
+		p[1] = type;
+		write_uint16(p + 2, (uint16_t)(length / 4 - 1));
+	}
+
+	void write_report_block(uint8_t *p, const RTCPReportBlock &block)
+	{
+		int32_t lost = block.cumulativeLost;
+
+		//the cumulative lost is clamped to 24 bits signed
+		if (lost > 0x7FFFFF)
+		{
+			lost = 0x7FFFFF;
+		}
+		else if (lost < -0x800000)
+		{
+			lost = -0x800000;
+		}
+
+		write_uint32(p, block.ssrc);
+		write_uint32(p + 4, ((uint32_t)block.fractionLost << 24) | ((uint32_t)lost & 0xFFFFFF));
+		write_uint32(p + 8, block.extendedHighestSequence);
+		write_uint32(p + 12, block.jitter);
+		write_uint32(p + 16, block.lastSR);
+		write_uint32(p + 20, block.delaySinceLastSR);
+	}
+
+	void read_report_block(const uint8_t *p, RTCPReportBlock &block)
+	{
+		uint32_t lost = read_uint32(p + 4);
+
+		block.ssrc = read_uint32(p);
+		block.fractionLost = (uint8_t)(lost >> 24);
+		//sign extend the 24 bits cumulative lost
+		block.cumulativeLost = (int32_t)((lost & 0xFFFFFF) << 8) >> 8;
+		block.extendedHighestSequence = read_uint32(p + 8);
+		block.jitter = read_uint32(p + 12);
+		block.lastSR = read_uint32(p + 16);
+		block.delaySinceLastSR = read_uint32(p + 20);
+	}
+}
+
+bool rtcp_is_rtcp_packet(const uint8_t *data, size_t len)
+{
+	if (len < (size_t)RTCP_HEADER_SIZE || (data[0] >> 6) != 2)
+	{
+		return false;
+	}
+
+	//the rtcp packet types are in [192, 223], the rtp payload types 64-95 with the marker bit collide with them
+	return data[1] >= 192 && data[1] <= 223;
+}
+
+int rtcp_build_sender_report(uint8_t *buffer, int bufferLen, uint32_t ssrc, const RTCPSenderInfo &info,
+							 const RTCPReportBlock *blocks, int count)
+{
+	if (count < 0 || count > RTCP_MAX_REPORT_BLOCKS)
+	{
+		return 0;
+	}
+
+	int length = RTCP_HEADER_SIZE + 4 + RTCP_SENDER_INFO_SIZE + count * RTCP_REPORT_BLOCK_SIZE;
+	if (length > bufferLen)
+	{
+		return 0;
+	}
+
+	write_header(buffer, (uint8_t)count, RTCP_PT_SR, length);
+	write_uint32(buffer + 4, ssrc);
+	write_uint32(buffer + 8, info.ntpMsw);
+	write_uint32(buffer + 12, info.ntpLsw);
+	write_uint32(buffer + 16, info.rtpTimestamp);
+	write_uint32(buffer + 20, info.packetCount);
+	write_uint32(buffer + 24, info.octetCount);
+
+	for (int i = 0; i < count; i++)
+	{
+		write_report_block(buffer + 28 + i * RTCP_REPORT_BLOCK_SIZE, blocks[i]);
+	}
+
+	return length;
+}
+
+int rtcp_build_receiver_report(uint8_t *buffer, int bufferLen, uint32_t ssrc,
+							   const RTCPReportBlock *blocks, int count)
+{
+	if (count < 0 || count > RTCP_MAX_REPORT_BLOCKS)
+	{
+		return 0;
+	}
+
+	int length = RTCP_HEADER_SIZE + 4 + count * RTCP_REPORT_BLOCK_SIZE;
+	if (length > bufferLen)
+	{
+		return 0;
+	}
+
+	write_header(buffer, (uint8_t)count, RTCP_PT_RR, length);
+	write_uint32(buffer + 4, ssrc);
+
+	for (int i = 0; i < count; i++)
+	{
+		write_report_block(buffer + 8 + i * RTCP_REPORT_BLOCK_SIZE, blocks[i]);
+	}
+
+	return length;
+}
+
+int rtcp_build_generic_nack(uint8_t *buffer, int bufferLen, uint32_t ssrc, uint32_t mediaSsrc,
+							const uint16_t *sequences, int count)
+{
+	int length = RTCP_HEADER_SIZE + 8;
+	int i = 0;
+
+	while (i < count)
+	{
+		//the PID is the first lost sequence, the BLP bit i marks the loss of PID + i + 1
+		uint16_t pid = sequences[i++];
+		uint16_t blp = 0;
+		while (i < count)
+		{
+			uint16_t distance = (uint16_t)(sequences[i] - pid);
+			if (distance == 0)
+			{
+				i++;
+				continue;
+			}
+
+			if (distance > 16)
+			{
+				break;
+			}
+
+			blp |= (uint16_t)(1 << (distance - 1));
+			i++;
+		}
+
+		if (length + 4 > bufferLen)
+		{
+			return 0;
+		}
+
+		write_uint16(buffer + length, pid);
+		write_uint16(buffer + length + 2, blp);
+		length += 4;
+	}
+
+	if (length == RTCP_HEADER_SIZE + 8)
+	{
+		return 0;
+	}
+
+	write_header(buffer, RTCP_FMT_GENERIC_NACK, RTCP_PT_RTPFB, length);
+	write_uint32(buffer + 4, ssrc);
+	write_uint32(buffer + 8, mediaSsrc);
+
+	return length;
+}
+
+uint32_t rtcp_random_ssrc()
+{
+	std::random_device rd;
+	std::mt19937 gen(rd());
+
+	uint32_t ssrc = 0;
+	while (ssrc == 0)
+	{
+		ssrc = (uint32_t)gen();
+	}
+	return ssrc;
+}
+
+RTCPCompoundReader::RTCPCompoundReader(const uint8_t *data, size_t len)
+	: m_data(data), m_len(len), m_packet(NULL), m_packet_len(0)
+{
+}
+
+bool RTCPCompoundReader::next()
+{
+	const uint8_t *p = m_packet ? m_packet + m_packet_len : m_data;
+	size_t remain = m_len - (size_t)(p - m_data);
+
+	if (remain < (size_t)RTCP_HEADER_SIZE || (p[0] >> 6) != 2)
+	{
+		return false;
+	}
+
+	size_t length = ((size_t)read_uint16(p + 2) + 1) * 4;
+	if (length > remain)
+	{
+		return false;
+	}
+
+	m_packet = p;
+	m_packet_len = length;
+	return true;
+}
+
+uint8_t RTCPCompoundReader::get_type() const
+{
+	return m_packet[1];
+}
+
+uint8_t RTCPCompoundReader::get_count() const
+{
+	return m_packet[0] & 0x1F;
+}
+
+const uint8_t *RTCPCompoundReader::get_packet() const
+{
+	return m_packet;
+}
+
+size_t RTCPCompoundReader::get_length() const
+{
+	return m_packet_len;
+}
+
+bool RTCPCompoundReader::parse_report(RTCPReport &report) const
+{
+	uint8_t type = get_type();
+	int count = get_count();
+	size_t offset = RTCP_HEADER_SIZE + 4;
+
+	if (type != RTCP_PT_SR && type != RTCP_PT_RR)
+	{
+		return false;
+	}
+
+	if (type == RTCP_PT_SR)
+	{
+		offset += RTCP_SENDER_INFO_SIZE;
+	}
+
+	if (m_packet_len < offset + (size_t)count * RTCP_REPORT_BLOCK_SIZE)
+	{
+		return false;
+	}
+
+	memset(&report, 0, sizeof(report));
+	report.type = type;
+	report.ssrc = read_uint32(m_packet + 4);
+	if (type == RTCP_PT_SR)
+	{
+		report.senderInfo.ntpMsw = read_uint32(m_packet + 8);
+		report.senderInfo.ntpLsw = read_uint32(m_packet + 12);
+		report.senderInfo.rtpTimestamp = read_uint32(m_packet + 16);
+		report.senderInfo.packetCount = read_uint32(m_packet + 20);
+		report.senderInfo.octetCount = read_uint32(m_packet + 24);
+	}
+
+	report.blockCount = count;
+	for (int i = 0; i < count; i++)
+	{
+		read_report_block(m_packet + offset + i * RTCP_REPORT_BLOCK_SIZE, report.blocks[i]);
+	}
+
+	return true;
+}
+
+int RTCPCompoundReader::parse_generic_nack(uint32_t &mediaSsrc, uint16_t *sequences, int maxCount) const
+{
+	if (get_type() != RTCP_PT_RTPFB || get_count() != RTCP_FMT_GENERIC_NACK ||
+		m_packet_len < (size_t)RTCP_HEADER_SIZE + 8)
+	{
+		return -1;
+	}
+
+	mediaSsrc = read_uint32(m_packet + 8);
+
+	int count = 0;
+	for (size_t offset = RTCP_HEADER_SIZE + 8; offset + 4 <= m_packet_len; offset += 4)
+	{
+		uint16_t pid = read_uint16(m_packet + offset);
+		uint16_t blp = read_uint16(m_packet + offset + 2);
+
+		if (count < maxCount)
+		{
+			sequences[count++] = pid;
+		}
+
+		for (int bit = 0; bit < 16 && count < maxCount; bit++)
+		{
+			if (blp & (1 << bit))
+			{
+				sequences[count++] = (uint16_t)(pid + bit + 1);
+			}
+		}
+	}
+
+	return count;
+}
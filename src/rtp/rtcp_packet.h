@@ -0,0 +1,235 @@
+#ifndef _H_RTCP_PACKET_H_
+#define _H_RTCP_PACKET_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* rtcp common header
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ |V=2|P|    RC   |   PT=SR=200   |             length            |
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+*/
+
+/* report block
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ +=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ |                 SSRC_1 (SSRC of first source)                 |
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ | fraction lost |       cumulative number of packets lost       |
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ |           extended highest sequence number received           |
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ |                      interarrival jitter                      |
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ |                         last SR (LSR)                         |
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ |                   delay since last SR (DLSR)                  |
+ +=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*/
+
+//the rtcp packet types
+const uint8_t RTCP_PT_SR = 200;
+const uint8_t RTCP_PT_RR = 201;
+//the transport layer feedback, RFC 4585
+const uint8_t RTCP_PT_RTPFB = 205;
+
+//the generic NACK feedback message type of RTCP_PT_RTPFB
+const uint8_t RTCP_FMT_GENERIC_NACK = 1;
+
+//the rtcp common header size
+const int RTCP_HEADER_SIZE = 4;
+
+//the report block size
+const int RTCP_REPORT_BLOCK_SIZE = 24;
+
+//the sender info size in the sender report
+const int RTCP_SENDER_INFO_SIZE = 20;
+
+//the max report blocks count in a report
+const int RTCP_MAX_REPORT_BLOCKS = 31;
+
+//the max sequences count in a generic NACK
+const int RTCP_NACK_MAX_SEQUENCES = 256;
+
+//the rtcp packet buffer size
+const int RTCP_PACKET_BUFFER_SIZE = 1500;
+
+/**
+ * the sender info of the sender report
+ */
+struct RTCPSenderInfo
+{
+	//the NTP timestamp
+	uint32_t ntpMsw;
+	uint32_t ntpLsw;
+	//the rtp timestamp of the same time as the NTP timestamp
+	uint32_t rtpTimestamp;
+	//the sent packets count
+	uint32_t packetCount;
+	//the sent payload octets count
+	uint32_t octetCount;
+};
+
+/**
+ * the report block
+ */
+struct RTCPReportBlock
+{
+	//the source which the block reports
+	uint32_t ssrc;
+	//the fraction lost since the previous report, in 1/256
+	uint8_t fractionLost;
+	//the cumulative lost packets count, 24 bits signed
+	int32_t cumulativeLost;
+	//the extended highest sequence received
+	uint32_t extendedHighestSequence;
+	//the interarrival jitter in timestamp units
+	uint32_t jitter;
+	//the middle 32 bits of the NTP timestamp of the last sender report
+	uint32_t lastSR;
+	//the delay since the last sender report in 1/65536 seconds
+	uint32_t delaySinceLastSR;
+};
+
+/**
+ * the sender report or the receiver report
+ */
+struct RTCPReport
+{
+	//RTCP_PT_SR or RTCP_PT_RR
+	uint8_t type;
+	//the ssrc of the report sender
+	uint32_t ssrc;
+	//the sender info, valid for the sender report
+	RTCPSenderInfo senderInfo;
+	//the report blocks count
+	int blockCount;
+	//the report blocks
+	RTCPReportBlock blocks[RTCP_MAX_REPORT_BLOCKS];
+};
+
+/**
+ * @brief check if the datagram is a rtcp packet, the rtp and rtcp packets are
+ * multiplexed on one port as RFC 5761
+ *
+ * @param data -- the datagram
+ * @param len -- the datagram length
+ * @return true - it is a rtcp packet
+ */
+bool rtcp_is_rtcp_packet(const uint8_t *data, size_t len);
+
+/**
+ * @brief build the sender report
+ *
+ * @param buffer -- the buffer
+ * @param bufferLen -- the buffer length
+ * @param ssrc -- the sender ssrc
+ * @param info -- the sender info
+ * @param blocks -- the report blocks, it can be NULL if count is 0
+ * @param count -- the report blocks count
+ * @return the report length, 0 if the buffer is too small
+ */
+int rtcp_build_sender_report(uint8_t *buffer, int bufferLen, uint32_t ssrc, const RTCPSenderInfo &info,
+							 const RTCPReportBlock *blocks, int count);
+
+/**
+ * @brief build the receiver report
+ *
+ * @param buffer -- the buffer
+ * @param bufferLen -- the buffer length
+ * @param ssrc -- the reporter ssrc
+ * @param blocks -- the report blocks
+ * @param count -- the report blocks count
+ * @return the report length, 0 if the buffer is too small
+ */
+int rtcp_build_receiver_report(uint8_t *buffer, int bufferLen, uint32_t ssrc,
+							   const RTCPReportBlock *blocks, int count);
+
+/**
+ * @brief build the generic NACK, RFC 4585 6.2.1. the sequences are packed into
+ * the PID and BLP pairs, they must be in the ascending order.
+ *
+ * @param buffer -- the buffer
+ * @param bufferLen -- the buffer length
+ * @param ssrc -- the feedback sender ssrc
+ * @param mediaSsrc -- the media source ssrc
+ * @param sequences -- the lost sequences
+ * @param count -- the lost sequences count
+ * @return the NACK length, 0 if the buffer is too small
+ */
+int rtcp_build_generic_nack(uint8_t *buffer, int bufferLen, uint32_t ssrc, uint32_t mediaSsrc,
+							const uint16_t *sequences, int count);
+
+/**
+ * @brief generate a random ssrc for the rtcp reporter which does not send rtp packets
+ * @return the ssrc
+ */
+uint32_t rtcp_random_ssrc();
+
+/**
+ * the compound rtcp packet reader. it iterates the rtcp packets in the compound packet.
+ */
+class RTCPCompoundReader
+{
+public:
+	/**
+	 * @param data -- the compound packet
+	 * @param len -- the compound packet length
+	 */
+	RTCPCompoundReader(const uint8_t *data, size_t len);
+
+	/**
+	 * @brief move to the next rtcp packet
+	 * @return true - the next packet is valid; false - no more packet or the packet is malformed
+	 */
+	bool next();
+
+	/**
+	 * @brief get the current packet type
+	 */
+	uint8_t get_type() const;
+
+	/**
+	 * @brief get the count field of the current packet, it is the report count or the feedback type
+	 */
+	uint8_t get_count() const;
+
+	/**
+	 * @brief get the current packet, including the common header
+	 */
+	const uint8_t *get_packet() const;
+
+	/**
+	 * @brief get the current packet length, including the common header
+	 */
+	size_t get_length() const;
+
+	/**
+	 * @brief parse the current packet as the sender report or the receiver report
+	 * @param report -- the report, output parameter
+	 * @return true - successful
+	 */
+	bool parse_report(RTCPReport &report) const;
+
+	/**
+	 * @brief parse the current packet as the generic NACK
+	 * @param mediaSsrc -- the media source ssrc, output parameter
+	 * @param sequences -- the lost sequences, output parameter
+	 * @param maxCount -- the max sequences count
+	 * @return the lost sequences count, -1 if it is not a generic NACK
+	 */
+	int parse_generic_nack(uint32_t &mediaSsrc, uint16_t *sequences, int maxCount) const;
+
+private:
+	const uint8_t *m_data;
+	size_t m_len;
+
+	//the current packet
+	const uint8_t *m_packet;
+	size_t m_packet_len;
+};
+
+#endif
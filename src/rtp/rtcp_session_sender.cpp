@@ -0,0 +1,230 @@
+#include "rtcp_session_sender.h"
+
+#include "common_logger.h"
+#include "common_utils.h"
+
+//the rtcp receive batch capacity, the receiver reports are rare
+static const int RTCP_BATCH_CAPACITY = 8;
+
+RTCPSessionSender::RTCPSessionSender()
+{
+	m_reactor = NULL;
+	m_transmitter = NULL;
+	m_socket_registered = false;
+	m_timer_id = -1;
+	m_ssrc = 0;
+	m_history = NULL;
+	m_retransmit_tokens = RTP_RETRANSMIT_BURST_BYTES;
+	m_retransmit_refill_time = 0;
+}
+
+RTCPSessionSender::~RTCPSessionSender()
+{
+	stop();
+}
+
+bool RTCPSessionSender::start(RTPReceiveReactor *reactor, RTPTransmitterV4 *transmitter, uint32_t ssrc, uint32_t clockRate)
+{
+	if (m_reactor)
+	{
+		return true;
+	}
+
+	if (!reactor || !transmitter)
+	{
+		return false;
+	}
+
+	if (!m_recv_batch.init(RTCP_BATCH_CAPACITY, RTCP_PACKET_BUFFER_SIZE))
+	{
+		return false;
+	}
+
+	m_reactor = reactor;
+	m_transmitter = transmitter;
+	m_ssrc = ssrc;
+	m_statistics.init(ssrc, clockRate);
+
+	m_socket_registered = m_reactor->add_socket(m_transmitter->get_socket(), on_rtcp_readable, this);
+	if (!m_socket_registered)
+	{
+		LOG_ERROR("register the rtcp socket to the reactor error.");
+		goto exitFlag;
+	}
+
+	m_timer_id = m_reactor->add_timer(RTCP_REPORT_INTERVAL_MS, on_report_timer, this);
+	if (m_timer_id == -1)
+	{
+		LOG_ERROR("register the rtcp report timer to the reactor error.");
+		goto exitFlag;
+	}
+
+	return true;
+
+exitFlag:
+	stop();
+	return false;
+}
+
+void RTCPSessionSender::set_packet_history(RTPPacketHistory *history)
+{
+	m_history = history;
+}
+
+void RTCPSessionSender::stop()
+{
+	if (!m_reactor)
+	{
+		return;
+	}
+
+	if (m_timer_id != -1)
+	{
+		m_reactor->remove_timer(m_timer_id);
+		m_timer_id = -1;
+	}
+
+	if (m_socket_registered)
+	{
+		m_reactor->remove_socket(m_transmitter->get_socket());
+		m_socket_registered = false;
+	}
+
+	m_reactor = NULL;
+	m_transmitter = NULL;
+}
+
+void RTCPSessionSender::on_rtp_sent(uint32_t packets, uint32_t octets, uint32_t headerOctets)
+{
+	m_statistics.on_rtp_sent(packets, octets, headerOctets);
+}
+
+bool RTCPSessionSender::send_sender_report()
+{
+	if (!m_transmitter)
+	{
+		return false;
+	}
+
+	RTCPSenderInfo info;
+	m_statistics.build_sender_info(info, (uint32_t)get_monotonic_time_ms(), get_monotonic_time_us());
+
+	int len = rtcp_build_sender_report(m_report_buffer, sizeof(m_report_buffer), m_ssrc, info, NULL, 0);
+	if (len <= 0)
+	{
+		return false;
+	}
+
+	return m_transmitter->send_data(m_report_buffer, len);
+}
+
+void RTCPSessionSender::receive_reports()
+{
+	if (!m_transmitter)
+	{
+		return;
+	}
+
+	//the reactor is level-triggered, the datagrams left in the socket wake it up again
+	RTCPReport report;
+	if (m_transmitter->receive_batch(m_recv_batch, 0) > 0)
+	{
+		uint64_t now = get_monotonic_time_us();
+		for (int i = 0; i < m_recv_batch.get_count(); i++)
+		{
+			const uint8_t *data = m_recv_batch.get_data(i);
+			int len = m_recv_batch.get_length(i);
+			if (!rtcp_is_rtcp_packet(data, len))
+			{
+				continue;
+			}
+
+			RTCPCompoundReader reader(data, len);
+			while (reader.next())
+			{
+				if (reader.get_type() == RTCP_PT_RTPFB)
+				{
+					uint32_t mediaSsrc;
+					int count = reader.parse_generic_nack(mediaSsrc, m_nack_sequences, RTCP_NACK_MAX_SEQUENCES);
+					if (count > 0 && mediaSsrc == m_ssrc)
+					{
+						retransmit(m_nack_sequences, count, now);
+					}
+				}
+				else if (reader.parse_report(report))
+				{
+					m_statistics.on_receiver_report(report, now);
+				}
+			}
+		}
+	}
+}
+
+void RTCPSessionSender::retransmit(const uint16_t *sequences, int count, uint64_t nowUs)
+{
+	uint32_t retransmitted = 0;
+	uint32_t suppressed = 0;
+	uint32_t rateLimited = 0;
+
+	if (!m_history)
+	{
+		m_statistics.on_nack(count, 0, count, 0);
+		return;
+	}
+
+	//refill the token bucket
+	if (m_retransmit_refill_time != 0)
+	{
+		m_retransmit_tokens += (double)(nowUs - m_retransmit_refill_time) * RTP_RETRANSMIT_MAX_BYTES_PER_SECOND / 1000000;
+		if (m_retransmit_tokens > RTP_RETRANSMIT_BURST_BYTES)
+		{
+			m_retransmit_tokens = RTP_RETRANSMIT_BURST_BYTES;
+		}
+	}
+	m_retransmit_refill_time = nowUs;
+
+	//the same packet is not retransmitted again until the previous retransmission could arrive
+	double rtt = m_statistics.get_rtt_ms();
+	uint64_t minInterval = (uint64_t)(rtt > 0 ? rtt * 1000 : RTP_RETRANSMIT_DEFAULT_INTERVAL_MS * 1000);
+
+	for (int i = 0; i < count; i++)
+	{
+		if (m_retransmit_tokens <= 0)
+		{
+			rateLimited += count - i;
+			break;
+		}
+
+		int len = m_history->get_for_retransmit(sequences[i], nowUs, minInterval, m_retransmit_buffer);
+		if (len <= 0)
+		{
+			suppressed++;
+			continue;
+		}
+
+		if (m_transmitter->send_data(m_retransmit_buffer, len))
+		{
+			retransmitted++;
+			m_retransmit_tokens -= len;
+		}
+	}
+
+	m_statistics.on_nack(count, retransmitted, suppressed, rateLimited);
+}
+
+void RTCPSessionSender::get_stats(RTCPSendStats &stats)
+{
+	m_statistics.get_stats(stats);
+}
+
+void RTCPSessionSender::on_rtcp_readable(void *arg)
+{
+	RTCPSessionSender *session = (RTCPSessionSender *)arg;
+	session->receive_reports();
+}
+
+void RTCPSessionSender::on_report_timer(void *arg)
+{
+	RTCPSessionSender *session = (RTCPSessionSender *)arg;
+	session->send_sender_report();
+}
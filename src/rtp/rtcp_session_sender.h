@@ -0,0 +1,143 @@
+#ifndef _H_RTCP_SESSION_SENDER_H_
+#define _H_RTCP_SESSION_SENDER_H_
+
+#include <stdint.h>
+#include "rtcp_packet.h"
+#include "rtcp_statistics.h"
+#include "rtp_packet_batch.h"
+#include "rtp_packet_history.h"
+#include "rtp_receive_reactor.h"
+#include "rtp_transmitter_v4.h"
+
+//the retransmission rate limit in bytes per second
+const int RTP_RETRANSMIT_MAX_BYTES_PER_SECOND = 512 * 1024;
+
+//the retransmission burst size in bytes
+const int RTP_RETRANSMIT_BURST_BYTES = 64 * 1024;
+
+//the min interval of the retransmissions of a packet in milliseconds before the round trip time is measured
+const int RTP_RETRANSMIT_DEFAULT_INTERVAL_MS = 10;
+
+/**
+ * the rtcp part of a sending rtp session. the sender report is sent to the rtp
+ * destinations periodically by the reactor timer, the receiver reports and the
+ * NACKs which arrive on the rtp socket are read by the reactor. the packets
+ * requested by the NACKs are retransmitted from the packet history.
+ */
+class RTCPSessionSender
+{
+public:
+	RTCPSessionSender();
+	virtual ~RTCPSessionSender();
+
+	/**
+	 * @brief start the rtcp reports
+	 *
+	 * @param reactor -- the reactor which the rtp socket and the report timer are registered to
+	 * @param transmitter -- the rtp transmitter, the reports are sent and received by it
+	 * @param ssrc -- the rtp ssrc
+	 * @param clockRate -- the rtp timestamp clock rate
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool start(RTPReceiveReactor *reactor, RTPTransmitterV4 *transmitter, uint32_t ssrc, uint32_t clockRate);
+
+	/**
+	 * @brief set the sent packets history, the NACKs are ignored if it is not set.
+	 * NOTE: the function must be called before start()
+	 *
+	 * @param history -- the packet history
+	 */
+	void set_packet_history(RTPPacketHistory *history);
+
+	/**
+	 * @brief stop the rtcp reports. when the function returns, the reactor
+	 * callbacks are not running and will never be invoked again.
+	 */
+	void stop();
+
+	/**
+	 * @brief update the statistics by the sent rtp packets of a frame
+	 *
+	 * @param packets -- the sent packets count
+	 * @param octets -- the sent payload octets count
+	 * @param headerOctets -- the ip, udp and rtp header octets of the packets
+	 */
+	void on_rtp_sent(uint32_t packets, uint32_t octets, uint32_t headerOctets);
+
+	/**
+	 * @brief send the sender report to the rtp destinations
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool send_sender_report();
+
+	/**
+	 * @brief read the rtcp packets from the rtp socket
+	 */
+	void receive_reports();
+
+	/**
+	 * @brief get the statistics
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_stats(RTCPSendStats &stats);
+
+	/**
+	 * @brief the rtp socket readable callback
+	 * @param arg -- the RTCPSessionSender pointer
+	 */
+	static void on_rtcp_readable(void *arg);
+
+	/**
+	 * @brief the report timer callback
+	 * @param arg -- the RTCPSessionSender pointer
+	 */
+	static void on_report_timer(void *arg);
+
+private:
+	/**
+	 * @brief retransmit the packets requested by the NACK
+	 *
+	 * @param sequences -- the requested sequences
+	 * @param count -- the requested sequences count
+	 * @param nowUs -- the monotonic time in microseconds
+	 */
+	void retransmit(const uint16_t *sequences, int count, uint64_t nowUs);
+
+private:
+	//the reactor which the socket and the timer are registered to
+	RTPReceiveReactor *m_reactor;
+	//the rtp transmitter
+	RTPTransmitterV4 *m_transmitter;
+	//whether the rtp socket was registered to the reactor
+	bool m_socket_registered;
+	//the report timer id
+	int m_timer_id;
+
+	//the rtp ssrc
+	uint32_t m_ssrc;
+
+	//the statistics
+	RTCPSenderStatistics m_statistics;
+
+	//the receive batch of the rtcp packets
+	RTPPacketBatch m_recv_batch;
+	//the report buffer
+	uint8_t m_report_buffer[RTCP_PACKET_BUFFER_SIZE];
+
+	//the sent packets history
+	RTPPacketHistory *m_history;
+	//the retransmission buffer
+	uint8_t m_retransmit_buffer[RTP_HISTORY_SLOT_SIZE];
+	//the NACK sequences buffer
+	uint16_t m_nack_sequences[RTCP_NACK_MAX_SEQUENCES];
+	//the retransmission token bucket in bytes
+	double m_retransmit_tokens;
+	//the last refill time of the token bucket
+	uint64_t m_retransmit_refill_time;
+};
+
+#endif
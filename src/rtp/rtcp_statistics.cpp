@@ -0,0 +1,417 @@
+#include "rtcp_statistics.h"
+
+#include <string.h>
+#include "common_utils.h"
+
+namespace
+{
+	//the RFC 3550 Appendix A.1 constants
+	const uint32_t RTP_SEQ_MOD = 1 << 16;
+	const uint32_t MAX_DROPOUT = 3000;
+	const uint32_t MAX_MISORDER = 100;
+	const uint32_t MIN_SEQUENTIAL = 2;
+
+	//get the middle 32 bits of the NTP timestamp
+	uint32_t ntp_mid32(uint32_t msw, uint32_t lsw)
+	{
+		return (msw << 16) | (lsw >> 16);
+	}
+}
+
+RTCPReceiverStatistics::RTCPReceiverStatistics()
+{
+	m_clock_rate = 1000;
+	m_has_source = false;
+	m_ssrc = 0;
+
+	m_max_seq = 0;
+	m_cycles = 0;
+	m_base_seq = 0;
+	m_bad_seq = RTP_SEQ_MOD + 1;
+	m_probation = MIN_SEQUENTIAL;
+	m_received = 0;
+	m_expected_prior = 0;
+	m_received_prior = 0;
+	m_fraction_lost = 0;
+
+	m_has_transit = false;
+	m_last_timestamp = 0;
+	m_last_arrival = 0;
+	m_jitter_us = 0;
+
+	m_last_sr = 0;
+	m_last_sr_arrival = 0;
+
+	m_packets_received = 0;
+	m_sender_reports = 0;
+	m_receiver_reports = 0;
+
+#ifdef _WIN32
+#else
+	pthread_mutex_init(&m_mutex, NULL);
+#endif
+}
+
+RTCPReceiverStatistics::~RTCPReceiverStatistics()
+{
+#ifdef _WIN32
+#else
+	pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+void RTCPReceiverStatistics::lock()
+{
+#ifdef _WIN32
+	m_mutex.lock();
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+}
+
+void RTCPReceiverStatistics::unlock()
+{
+#ifdef _WIN32
+	m_mutex.unlock();
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+void RTCPReceiverStatistics::init(uint32_t clockRate)
+{
+	m_clock_rate = clockRate > 0 ? clockRate : 1000;
+}
+
+void RTCPReceiverStatistics::init_sequence(uint16_t sequence)
+{
+	m_base_seq = sequence;
+	m_max_seq = sequence;
+	m_bad_seq = RTP_SEQ_MOD + 1;
+	m_cycles = 0;
+	m_received = 0;
+	m_received_prior = 0;
+	m_expected_prior = 0;
+}
+
+bool RTCPReceiverStatistics::update_sequence(uint16_t sequence)
+{
+	uint16_t udelta = sequence - m_max_seq;
+
+	//the source is not valid until MIN_SEQUENTIAL packets with sequential sequence numbers have been received
+	if (m_probation)
+	{
+		if (sequence == (uint16_t)(m_max_seq + 1))
+		{
+			m_probation--;
+			m_max_seq = sequence;
+			if (m_probation == 0)
+			{
+				init_sequence(sequence);
+				m_received++;
+				return true;
+			}
+		}
+		else
+		{
+			m_probation = MIN_SEQUENTIAL - 1;
+			m_max_seq = sequence;
+		}
+		return false;
+	}
+	else if (udelta < MAX_DROPOUT)
+	{
+		//in order, with permissible gap
+		if (sequence < m_max_seq)
+		{
+			//the sequence wrapped
+			m_cycles += RTP_SEQ_MOD;
+		}
+		m_max_seq = sequence;
+	}
+	else if (udelta <= RTP_SEQ_MOD - MAX_MISORDER)
+	{
+		//the sequence made a very large jump
+		if (sequence == m_bad_seq)
+		{
+			//two sequential packets, assume that the other side restarted without telling us
+			init_sequence(sequence);
+		}
+		else
+		{
+			m_bad_seq = (sequence + 1) & (RTP_SEQ_MOD - 1);
+			return false;
+		}
+	}
+	else
+	{
+		//duplicate or reordered packet
+	}
+
+	m_received++;
+	return true;
+}
+
+void RTCPReceiverStatistics::on_rtp_packet(uint32_t ssrc, uint16_t sequence, uint32_t timestamp, uint64_t arrivalUs)
+{
+	lock();
+
+	if (!m_has_source || ssrc != m_ssrc)
+	{
+		//a new source, the sequence is tracked from the beginning
+		m_has_source = true;
+		m_ssrc = ssrc;
+		init_sequence(sequence);
+		m_max_seq = sequence - 1;
+		m_probation = MIN_SEQUENTIAL;
+		m_fraction_lost = 0;
+		m_has_transit = false;
+		m_jitter_us = 0;
+	}
+
+	m_packets_received++;
+	update_sequence(sequence);
+
+	//the difference of the relative transit times, D(i,j) = (Rj - Ri) - (Sj - Si)
+	if (m_has_transit)
+	{
+		double media = (double)(int32_t)(timestamp - m_last_timestamp) * 1000000.0 / m_clock_rate;
+		double d = (double)(int64_t)(arrivalUs - m_last_arrival) - media;
+		if (d < 0)
+		{
+			d = -d;
+		}
+		m_jitter_us += (d - m_jitter_us) / 16.0;
+	}
+	m_has_transit = true;
+	m_last_timestamp = timestamp;
+	m_last_arrival = arrivalUs;
+
+	unlock();
+}
+
+void RTCPReceiverStatistics::on_sender_report(const RTCPReport &report, uint64_t arrivalUs)
+{
+	lock();
+
+	m_last_sr = ntp_mid32(report.senderInfo.ntpMsw, report.senderInfo.ntpLsw);
+	m_last_sr_arrival = arrivalUs;
+	m_sender_reports++;
+
+	unlock();
+}
+
+bool RTCPReceiverStatistics::build_report_block(RTCPReportBlock &block, uint64_t nowUs)
+{
+	lock();
+
+	if (!m_has_source)
+	{
+		unlock();
+		return false;
+	}
+
+	uint32_t extendedMax = m_cycles + m_max_seq;
+	uint32_t expected = extendedMax - m_base_seq + 1;
+	int64_t lost = (int64_t)expected - m_received;
+
+	uint32_t expectedInterval = expected - m_expected_prior;
+	m_expected_prior = expected;
+	uint32_t receivedInterval = m_received - m_received_prior;
+	m_received_prior = m_received;
+	int64_t lostInterval = (int64_t)expectedInterval - receivedInterval;
+	if (expectedInterval == 0 || lostInterval <= 0)
+	{
+		m_fraction_lost = 0;
+	}
+	else
+	{
+		m_fraction_lost = (uint8_t)((lostInterval << 8) / expectedInterval);
+	}
+
+	memset(&block, 0, sizeof(block));
+	block.ssrc = m_ssrc;
+	block.fractionLost = m_fraction_lost;
+	block.cumulativeLost = (int32_t)lost;
+	block.extendedHighestSequence = extendedMax;
+	block.jitter = (uint32_t)(m_jitter_us * m_clock_rate / 1000000.0);
+	if (m_last_sr_arrival != 0)
+	{
+		block.lastSR = m_last_sr;
+		block.delaySinceLastSR = (uint32_t)((nowUs - m_last_sr_arrival) * 65536 / 1000000);
+	}
+
+	m_receiver_reports++;
+
+	unlock();
+	return true;
+}
+
+void RTCPReceiverStatistics::get_stats(RTCPReceiveStats &stats)
+{
+	lock();
+
+	uint32_t extendedMax = m_cycles + m_max_seq;
+
+	memset(&stats, 0, sizeof(stats));
+	stats.ssrc = m_ssrc;
+	stats.packetsReceived = m_packets_received;
+	if (m_has_source && !m_probation)
+	{
+		stats.extendedHighestSequence = extendedMax;
+		stats.cumulativeLost = (int32_t)((int64_t)(extendedMax - m_base_seq + 1) - m_received);
+	}
+	stats.fractionLost = m_fraction_lost;
+	stats.jitter = (uint32_t)(m_jitter_us * m_clock_rate / 1000000.0);
+	stats.jitterMs = m_jitter_us / 1000.0;
+	stats.senderReports = m_sender_reports;
+	stats.receiverReports = m_receiver_reports;
+
+	unlock();
+}
+
+////////////////////////////////////////////////////////////
+
+RTCPSenderStatistics::RTCPSenderStatistics()
+{
+	m_clock_rate = 1000;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_stats.rttMs = -1;
+	memset(m_sr_ntp, 0, sizeof(m_sr_ntp));
+	memset(m_sr_time, 0, sizeof(m_sr_time));
+	m_sr_pos = 0;
+
+#ifdef _WIN32
+#else
+	pthread_mutex_init(&m_mutex, NULL);
+#endif
+}
+
+RTCPSenderStatistics::~RTCPSenderStatistics()
+{
+#ifdef _WIN32
+#else
+	pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+void RTCPSenderStatistics::lock()
+{
+#ifdef _WIN32
+	m_mutex.lock();
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+}
+
+void RTCPSenderStatistics::unlock()
+{
+#ifdef _WIN32
+	m_mutex.unlock();
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+void RTCPSenderStatistics::init(uint32_t ssrc, uint32_t clockRate)
+{
+	lock();
+	m_stats.ssrc = ssrc;
+	m_clock_rate = clockRate > 0 ? clockRate : 1000;
+	unlock();
+}
+
+void RTCPSenderStatistics::on_rtp_sent(uint32_t packets, uint32_t octets, uint32_t headerOctets)
+{
+	lock();
+	m_stats.packetsSent += packets;
+	m_stats.octetsSent += octets;
+	m_stats.framesSent++;
+	m_stats.headerOctetsSent += headerOctets;
+	unlock();
+}
+
+void RTCPSenderStatistics::build_sender_info(RTCPSenderInfo &info, uint32_t rtpTimestamp, uint64_t nowUs)
+{
+	lock();
+
+	get_ntp_time(info.ntpMsw, info.ntpLsw);
+	info.rtpTimestamp = rtpTimestamp;
+	//the counts wrap as RFC 3550
+	info.packetCount = (uint32_t)m_stats.packetsSent;
+	info.octetCount = (uint32_t)m_stats.octetsSent;
+
+	m_sr_ntp[m_sr_pos] = ntp_mid32(info.ntpMsw, info.ntpLsw);
+	m_sr_time[m_sr_pos] = nowUs;
+	m_sr_pos = (m_sr_pos + 1) % RTCP_SR_HISTORY_SIZE;
+	m_stats.senderReports++;
+
+	unlock();
+}
+
+void RTCPSenderStatistics::on_receiver_report(const RTCPReport &report, uint64_t arrivalUs)
+{
+	lock();
+
+	for (int i = 0; i < report.blockCount; i++)
+	{
+		const RTCPReportBlock &block = report.blocks[i];
+		if (block.ssrc != m_stats.ssrc)
+		{
+			continue;
+		}
+
+		m_stats.receiverReports++;
+		m_stats.fractionLost = block.fractionLost;
+		m_stats.cumulativeLost = block.cumulativeLost;
+		m_stats.extendedHighestSequence = block.extendedHighestSequence;
+		m_stats.jitter = block.jitter;
+		m_stats.jitterMs = (double)block.jitter * 1000.0 / m_clock_rate;
+
+		//the receiver has not received a sender report yet
+		if (block.lastSR == 0)
+		{
+			continue;
+		}
+
+		//RTT = A - LSR - DLSR, the sent time of LSR is measured by the monotonic clock
+		for (int j = 0; j < RTCP_SR_HISTORY_SIZE; j++)
+		{
+			if (m_sr_time[j] != 0 && m_sr_ntp[j] == block.lastSR)
+			{
+				double rttUs = (double)(int64_t)(arrivalUs - m_sr_time[j]) -
+							   (double)block.delaySinceLastSR * 1000000.0 / 65536.0;
+				m_stats.rttMs = rttUs > 0 ? rttUs / 1000.0 : 0;
+				break;
+			}
+		}
+	}
+
+	unlock();
+}
+
+void RTCPSenderStatistics::on_nack(uint32_t requested, uint32_t retransmitted, uint32_t suppressed, uint32_t rateLimited)
+{
+	lock();
+	m_stats.nackRequests += requested;
+	m_stats.retransmitted += retransmitted;
+	m_stats.retransmitSuppressed += suppressed;
+	m_stats.retransmitRateLimited += rateLimited;
+	unlock();
+}
+
+double RTCPSenderStatistics::get_rtt_ms()
+{
+	lock();
+	double rtt = m_stats.rttMs;
+	unlock();
+
+	return rtt;
+}
+
+void RTCPSenderStatistics::get_stats(RTCPSendStats &stats)
+{
+	lock();
+	stats = m_stats;
+	unlock();
+}
@@ -0,0 +1,276 @@
+#ifndef _H_RTCP_STATISTICS_H_
+#define _H_RTCP_STATISTICS_H_
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <mutex>
+#else
+#include <pthread.h>
+#endif
+
+#include "rtcp_packet.h"
+
+//the rtcp report interval in milliseconds
+const int RTCP_REPORT_INTERVAL_MS = 5000;
+
+//the rtp timestamp clock rate of the sessions, the timestamps are the monotonic time in milliseconds
+const uint32_t RTCP_DEFAULT_CLOCK_RATE = 1000;
+
+//the sent sender reports which are kept for the round trip time calculation
+const int RTCP_SR_HISTORY_SIZE = 8;
+
+/**
+ * the statistics of a received rtp stream
+ */
+struct RTCPReceiveStats
+{
+	//the remote stream ssrc
+	uint32_t ssrc;
+	//the received packets count
+	uint64_t packetsReceived;
+	//the extended highest sequence received
+	uint32_t extendedHighestSequence;
+	//the cumulative lost packets count, it is negative if duplicates were received
+	int32_t cumulativeLost;
+	//the fraction lost in the last report interval, in 1/256
+	uint8_t fractionLost;
+	//the interarrival jitter in timestamp units
+	uint32_t jitter;
+	//the interarrival jitter in milliseconds
+	double jitterMs;
+	//the sender reports received
+	uint64_t senderReports;
+	//the receiver reports sent
+	uint64_t receiverReports;
+};
+
+/**
+ * the statistics of a sent rtp stream, the loss and the jitter are reported by the remote receiver
+ */
+struct RTCPSendStats
+{
+	//the stream ssrc
+	uint32_t ssrc;
+	//the sent packets count
+	uint64_t packetsSent;
+	//the sent payload octets count
+	uint64_t octetsSent;
+	//the sent frames count, packetsSent / framesSent is the packets per frame
+	uint64_t framesSent;
+	//the ip, udp and rtp header octets of the sent packets, the header overhead is
+	//headerOctetsSent / (headerOctetsSent + octetsSent)
+	uint64_t headerOctetsSent;
+	//the sender reports sent
+	uint64_t senderReports;
+	//the receiver reports received
+	uint64_t receiverReports;
+	//the fraction lost of the last receiver report, in 1/256
+	uint8_t fractionLost;
+	//the cumulative lost packets count of the last receiver report
+	int32_t cumulativeLost;
+	//the extended highest sequence of the last receiver report
+	uint32_t extendedHighestSequence;
+	//the interarrival jitter of the last receiver report in timestamp units
+	uint32_t jitter;
+	//the interarrival jitter of the last receiver report in milliseconds
+	double jitterMs;
+	//the round trip time in milliseconds, -1 if it is unknown
+	double rttMs;
+	//the sequences requested by the received NACKs
+	uint64_t nackRequests;
+	//the retransmitted packets
+	uint64_t retransmitted;
+	//the requests which were not served, the packet is not in the history or it was retransmitted within the round trip time
+	uint64_t retransmitSuppressed;
+	//the requests which were not served because of the retransmission rate limit
+	uint64_t retransmitRateLimited;
+};
+
+/**
+ * the statistics of a received rtp stream. the sequence and the loss are tracked as
+ * RFC 3550 Appendix A.1 and A.3, the jitter is estimated as RFC 3550 Appendix A.8.
+ * the functions are thread safe.
+ */
+class RTCPReceiverStatistics
+{
+public:
+	RTCPReceiverStatistics();
+	virtual ~RTCPReceiverStatistics();
+
+	/**
+	 * @brief initialize the statistics
+	 * @param clockRate -- the rtp timestamp clock rate
+	 */
+	void init(uint32_t clockRate);
+
+	/**
+	 * @brief update the statistics by the received rtp packet
+	 *
+	 * @param ssrc -- the packet ssrc
+	 * @param sequence -- the packet sequence
+	 * @param timestamp -- the packet rtp timestamp
+	 * @param arrivalUs -- the packet arrival time, the monotonic time in microseconds
+	 */
+	void on_rtp_packet(uint32_t ssrc, uint16_t sequence, uint32_t timestamp, uint64_t arrivalUs);
+
+	/**
+	 * @brief update the last sender report by the received sender report
+	 *
+	 * @param report -- the sender report
+	 * @param arrivalUs -- the report arrival time, the monotonic time in microseconds
+	 */
+	void on_sender_report(const RTCPReport &report, uint64_t arrivalUs);
+
+	/**
+	 * @brief build the report block of the received stream, the loss interval is restarted
+	 *
+	 * @param block -- the report block, output parameter
+	 * @param nowUs -- the monotonic time in microseconds
+	 * @return true - successful; false - no rtp packet was received
+	 */
+	bool build_report_block(RTCPReportBlock &block, uint64_t nowUs);
+
+	/**
+	 * @brief get the statistics
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_stats(RTCPReceiveStats &stats);
+
+private:
+	//restart the sequence tracking from the sequence
+	void init_sequence(uint16_t sequence);
+
+	//update the sequence tracking, return false if the packet is not valid
+	bool update_sequence(uint16_t sequence);
+
+	void lock();
+	void unlock();
+
+private:
+	uint32_t m_clock_rate;
+
+	//whether a packet was received
+	bool m_has_source;
+	uint32_t m_ssrc;
+
+	//the sequence tracking state of RFC 3550 Appendix A.1
+	uint16_t m_max_seq;
+	uint32_t m_cycles;
+	uint32_t m_base_seq;
+	uint32_t m_bad_seq;
+	uint32_t m_probation;
+	uint32_t m_received;
+	uint32_t m_expected_prior;
+	uint32_t m_received_prior;
+	uint8_t m_fraction_lost;
+
+	//the jitter estimation state
+	bool m_has_transit;
+	uint32_t m_last_timestamp;
+	uint64_t m_last_arrival;
+	//the jitter in microseconds
+	double m_jitter_us;
+
+	//the middle 32 bits of the NTP timestamp of the last sender report
+	uint32_t m_last_sr;
+	//the arrival time of the last sender report
+	uint64_t m_last_sr_arrival;
+
+	uint64_t m_packets_received;
+	uint64_t m_sender_reports;
+	uint64_t m_receiver_reports;
+
+#ifdef _WIN32
+	std::mutex m_mutex;
+#else
+	pthread_mutex_t m_mutex;
+#endif
+};
+
+/**
+ * the statistics of a sent rtp stream. the round trip time is calculated from
+ * the LSR and the DLSR of the received receiver report. the functions are thread safe.
+ */
+class RTCPSenderStatistics
+{
+public:
+	RTCPSenderStatistics();
+	virtual ~RTCPSenderStatistics();
+
+	/**
+	 * @brief initialize the statistics
+	 * @param ssrc -- the stream ssrc
+	 * @param clockRate -- the rtp timestamp clock rate
+	 */
+	void init(uint32_t ssrc, uint32_t clockRate);
+
+	/**
+	 * @brief update the statistics by the sent rtp packets of a frame
+	 *
+	 * @param packets -- the sent packets count
+	 * @param octets -- the sent payload octets count
+	 * @param headerOctets -- the ip, udp and rtp header octets of the packets
+	 */
+	void on_rtp_sent(uint32_t packets, uint32_t octets, uint32_t headerOctets);
+
+	/**
+	 * @brief build the sender info of the sender report, the report is recorded for the round trip time
+	 *
+	 * @param info -- the sender info, output parameter
+	 * @param rtpTimestamp -- the rtp timestamp of the current time
+	 * @param nowUs -- the monotonic time in microseconds
+	 */
+	void build_sender_info(RTCPSenderInfo &info, uint32_t rtpTimestamp, uint64_t nowUs);
+
+	/**
+	 * @brief update the remote statistics by the received receiver report
+	 *
+	 * @param report -- the receiver report or the sender report
+	 * @param arrivalUs -- the report arrival time, the monotonic time in microseconds
+	 */
+	void on_receiver_report(const RTCPReport &report, uint64_t arrivalUs);
+
+	/**
+	 * @brief update the retransmission statistics by the handled NACK
+	 *
+	 * @param requested -- the requested sequences count
+	 * @param retransmitted -- the retransmitted packets count
+	 * @param suppressed -- the suppressed requests count
+	 * @param rateLimited -- the rate limited requests count
+	 */
+	void on_nack(uint32_t requested, uint32_t retransmitted, uint32_t suppressed, uint32_t rateLimited);
+
+	/**
+	 * @brief get the round trip time in milliseconds, -1 if it is unknown
+	 */
+	double get_rtt_ms();
+
+	/**
+	 * @brief get the statistics
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_stats(RTCPSendStats &stats);
+
+private:
+	void lock();
+	void unlock();
+
+private:
+	uint32_t m_clock_rate;
+
+	RTCPSendStats m_stats;
+
+	//the sent sender reports, the middle 32 bits of the NTP timestamp and the monotonic send time
+	uint32_t m_sr_ntp[RTCP_SR_HISTORY_SIZE];
+	uint64_t m_sr_time[RTCP_SR_HISTORY_SIZE];
+	int m_sr_pos;
+
+#ifdef _WIN32
+	std::mutex m_mutex;
+#else
+	pthread_mutex_t m_mutex;
+#endif
+};
+
+#endif
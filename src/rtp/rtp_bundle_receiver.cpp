@@ -0,0 +1,271 @@
+#include "rtp_bundle_receiver.h"
+
+#include <new>
+
+#include "common_logger.h"
+#include "common_utils.h"
+#include "rtcp_packet.h"
+#include "rtp_session_receiver.h"
+
+RTPBundleReceiver::RTPBundleReceiver()
+{
+	m_initialize = false;
+	m_port = 0;
+	m_reactor = NULL;
+	m_datagrams = 0;
+	m_unknown_datagrams = 0;
+
+#ifdef _WIN32
+#else
+	pthread_mutex_init(&m_mutex, NULL);
+#endif
+}
+
+RTPBundleReceiver::~RTPBundleReceiver()
+{
+	//the reactor does not invoke the callback any more when remove_socket() returns
+	if (m_initialize && m_reactor)
+	{
+		m_reactor->remove_socket(m_transmitter.get_socket());
+	}
+
+	if (m_streams.get_count() > 0)
+	{
+		LOG_WARNING("the bundle receiver is destroyed with %d streams", m_streams.get_count());
+	}
+
+#ifdef _WIN32
+#else
+	pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+bool RTPBundleReceiver::init(RTPTransParamsV4 *params, RTPReceiveReactor *reactor)
+{
+	if (m_initialize)
+	{
+		return true;
+	}
+
+	//the streams share the socket receive buffer, a burst of one stream must not drop the others
+	RTPTransParamsV4 bundleParams = *params;
+	if (bundleParams.recvBufferSize < RTP_BUNDLE_RECV_BUFFER_SIZE)
+	{
+		bundleParams.recvBufferSize = RTP_BUNDLE_RECV_BUFFER_SIZE;
+	}
+
+	if (!m_transmitter.init(&bundleParams))
+	{
+		LOG_ERROR("init the bundle transmitter error, port:%d", bundleParams.bindPort);
+		return false;
+	}
+
+	if (!m_batch.init(RTP_BATCH_DEFAULT_CAPACITY, RTP_RECV_BUFFER_SIZE))
+	{
+		return false;
+	}
+
+	if (!m_streams.init(RTP_SSRC_TABLE_MIN_CAPACITY))
+	{
+		return false;
+	}
+
+	m_port = bundleParams.bindPort;
+	m_reactor = reactor;
+	m_initialize = true;
+
+	if (m_reactor && !m_reactor->add_socket(m_transmitter.get_socket(), on_readable, this))
+	{
+		LOG_ERROR("register the bundle socket to the receive reactor error.");
+		m_reactor = NULL;
+		m_initialize = false;
+		return false;
+	}
+
+	LOG_INFO("the bundle receiver is listening on port:%d", m_port);
+	return true;
+}
+
+bool RTPBundleReceiver::add_stream(uint32_t ssrc, RTPSessionReceiver *receiver, OnSocketReadableCallback func, void *arg)
+{
+	if (!m_initialize || !receiver)
+	{
+		return false;
+	}
+
+	Stream *stream = new (std::nothrow) Stream();
+	if (!stream)
+	{
+		LOG_ERROR("create the bundle stream error.");
+		return false;
+	}
+	stream->receiver = receiver;
+	stream->func = func;
+	stream->arg = arg;
+	stream->pending = false;
+
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+
+	bool ret = false;
+	if (m_streams.find(ssrc))
+	{
+		//the ssrc is the only demultiplexing key, the streams of a bundle must not collide
+		LOG_ERROR("the ssrc %u is already in the bundle on port:%d", ssrc, m_port);
+	}
+	else
+	{
+		ret = m_streams.insert(ssrc, stream);
+	}
+
+#ifdef _WIN32
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+
+	if (!ret)
+	{
+		delete stream;
+	}
+	return ret;
+}
+
+void RTPBundleReceiver::remove_stream(uint32_t ssrc)
+{
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+
+	//the mutex is held while a batch is demultiplexed, the stream is not in use here
+	Stream *stream = (Stream *)m_streams.find(ssrc);
+	if (stream)
+	{
+		m_streams.remove(ssrc);
+		delete stream;
+	}
+
+#ifdef _WIN32
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+void RTPBundleReceiver::get_stats(RTPBundleStats &stats)
+{
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+
+	stats.streams = m_streams.get_count();
+	stats.datagrams = m_datagrams;
+	stats.unknownDatagrams = m_unknown_datagrams;
+
+#ifdef _WIN32
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+bool RTPBundleReceiver::get_demux_ssrc(const uint8_t *data, int len, uint32_t &ssrc)
+{
+	if (len < RTCP_HEADER_SIZE + 4 || (data[0] >> 6) != 2)
+	{
+		return false;
+	}
+
+	//the rtcp packets of the sender are keyed by the sender ssrc, it is the media ssrc
+	if (rtcp_is_rtcp_packet(data, len))
+	{
+		ssrc = ((uint32_t)data[4] << 24) | ((uint32_t)data[5] << 16) | ((uint32_t)data[6] << 8) | data[7];
+		return true;
+	}
+
+	//the rtp and the parity packets carry the media ssrc
+	if (len < 12)
+	{
+		return false;
+	}
+	ssrc = ((uint32_t)data[8] << 24) | ((uint32_t)data[9] << 16) | ((uint32_t)data[10] << 8) | data[11];
+	return true;
+}
+
+int RTPBundleReceiver::receive(int maxPackets)
+{
+	if (!m_initialize)
+	{
+		return 0;
+	}
+
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+
+	int count = 0;
+	while (count < maxPackets)
+	{
+		int received = m_transmitter.receive_batch(m_batch, 0);
+		if (received <= 0)
+		{
+			break;
+		}
+
+		uint64_t now = get_monotonic_time_us();
+		for (int i = 0; i < received; i++)
+		{
+			const uint8_t *data = m_batch.get_data(i);
+			int len = m_batch.get_length(i);
+
+			uint32_t ssrc;
+			Stream *stream = get_demux_ssrc(data, len, ssrc) ? (Stream *)m_streams.find(ssrc) : NULL;
+			if (!stream)
+			{
+				m_unknown_datagrams++;
+				continue;
+			}
+
+			stream->receiver->push_datagram(data, len, now);
+			if (!stream->pending)
+			{
+				stream->pending = true;
+				m_pending_streams.push_back(stream);
+			}
+		}
+
+		m_datagrams += received;
+		count += received;
+	}
+
+	//the streams play out once per batch, not once per datagram
+	for (int i = 0; i < (int)m_pending_streams.size(); i++)
+	{
+		Stream *stream = m_pending_streams[i];
+		stream->pending = false;
+		if (stream->func)
+		{
+			stream->func(stream->arg);
+		}
+	}
+	m_pending_streams.clear();
+
+#ifdef _WIN32
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+
+	return count;
+}
+
+void RTPBundleReceiver::on_readable(void *arg)
+{
+	RTPBundleReceiver *bundle = (RTPBundleReceiver *)arg;
+	bundle->receive(RTP_BUNDLE_MAX_DRAIN_PACKETS);
+}
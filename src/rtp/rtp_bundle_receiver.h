@@ -0,0 +1,177 @@
+#ifndef _H_RTP_BUNDLE_RECEIVER_H_
+#define _H_RTP_BUNDLE_RECEIVER_H_
+
+#include <vector>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <mutex>
+#else
+#include <pthread.h>
+#endif
+
+#include "rtp_transmitter_v4.h"
+#include "rtp_packet_batch.h"
+#include "rtp_receive_reactor.h"
+#include "rtp_ssrc_table.h"
+
+class RTPSessionReceiver;
+
+//the socket receive buffer size of the bundle, all the streams share it
+const uint32_t RTP_BUNDLE_RECV_BUFFER_SIZE = 1024 * 1024 * 4;
+
+//the max datagrams which are demultiplexed in one socket readable callback
+const int RTP_BUNDLE_MAX_DRAIN_PACKETS = 256;
+
+/**
+ * the statistics of a bundle receiver
+ */
+struct RTPBundleStats
+{
+	//the streams count
+	int streams;
+	//the received datagrams count
+	uint64_t datagrams;
+	//the datagrams whose ssrc is not registered, or which are not rtp/rtcp
+	uint64_t unknownDatagrams;
+};
+
+/**
+ * the bundle receiver. one socket receives the rtp and rtcp packets of many
+ * streams, the datagrams are demultiplexed by the ssrc to the receivers of the
+ * streams through an open addressing hash table. the socket is registered to
+ * one reactor, the receivers of the streams are invoked on its thread.
+ * the receivers send their rtcp packets and pinholes to their own peers through
+ * the socket, so a NAT keeps one mapping for all the streams.
+ */
+class RTPBundleReceiver
+{
+public:
+	RTPBundleReceiver();
+	virtual ~RTPBundleReceiver();
+
+	/**
+	 * @brief initialize the bundle socket and register it to the reactor
+	 *
+	 * @param params -- the transmission parameters
+	 * @param reactor -- the reactor which the socket is registered to
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool init(RTPTransParamsV4 *params, RTPReceiveReactor *reactor);
+
+	/**
+	 * @brief register a stream. the datagrams of the ssrc are pushed to the receiver,
+	 * and the callback is invoked once after the datagrams of a batch were pushed.
+	 *
+	 * @param ssrc -- the stream ssrc
+	 * @param receiver -- the stream receiver
+	 * @param func -- the callback function, it reads the pushed packets from the receiver
+	 * @param arg -- the user argument of the callback function
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool add_stream(uint32_t ssrc, RTPSessionReceiver *receiver, OnSocketReadableCallback func, void *arg);
+
+	/**
+	 * @brief unregister a stream. when the function returns, the receiver and the
+	 * callback of the stream are not used any more.
+	 * NOTE: the function must not be called in the stream callbacks
+	 *
+	 * @param ssrc -- the stream ssrc
+	 */
+	void remove_stream(uint32_t ssrc);
+
+	/**
+	 * @brief get the bundle transmitter, the receivers send their rtcp packets by it
+	 */
+	RTPTransmitterV4 *get_transmitter()
+	{
+		return &this->m_transmitter;
+	}
+
+	/**
+	 * @brief get the bound port of the bundle socket
+	 */
+	uint16_t get_port() const
+	{
+		return this->m_port;
+	}
+
+	/**
+	 * @brief get the statistics
+	 *
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_stats(RTPBundleStats &stats);
+
+	/**
+	 * @brief receive and demultiplex the datagrams of the socket
+	 *
+	 * @param maxPackets -- the max datagrams count
+	 *
+	 * @return the received datagrams count
+	 */
+	int receive(int maxPackets);
+
+	/**
+	 * @brief the socket readable callback
+	 * @param arg -- the RTPBundleReceiver pointer
+	 */
+	static void on_readable(void *arg);
+
+private:
+	struct Stream
+	{
+		RTPSessionReceiver *receiver;
+		OnSocketReadableCallback func;
+		void *arg;
+		//whether datagrams were pushed in the current batch
+		bool pending;
+	};
+
+	/**
+	 * @brief get the ssrc which the datagram is demultiplexed by
+	 *
+	 * @param data -- the datagram
+	 * @param len -- the datagram length
+	 * @param ssrc -- the ssrc, output parameter
+	 *
+	 * @return true - successful, false - it is not an rtp or rtcp packet
+	 */
+	static bool get_demux_ssrc(const uint8_t *data, int len, uint32_t &ssrc);
+
+private:
+	bool m_initialize;
+
+	//the bundle transmitter
+	RTPTransmitterV4 m_transmitter;
+	//the bound port
+	uint16_t m_port;
+	//the reactor which the socket is registered to
+	RTPReceiveReactor *m_reactor;
+
+	//the receive batch
+	RTPPacketBatch m_batch;
+
+	//the streams, key: the ssrc, value: the Stream pointer
+	RTPSsrcTable m_streams;
+	//the streams whose datagrams were pushed in the current batch
+	std::vector<Stream *> m_pending_streams;
+
+	//the mutex of the streams, it is held while a batch is demultiplexed
+#ifdef _WIN32
+	std::mutex m_mutex;
+#else
+	pthread_mutex_t m_mutex;
+#endif
+
+	//the received datagrams count
+	uint64_t m_datagrams;
+	//the unknown datagrams count
+	uint64_t m_unknown_datagrams;
+};
+
+#endif
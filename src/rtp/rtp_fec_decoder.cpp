@@ -0,0 +1,245 @@
+#include "rtp_fec_decoder.h"
+
+#include <new>
+#include <string.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+#include "rtp_packet.h"
+#include "common_logger.h"
+
+RTPFecDecoder::RTPFecDecoder()
+{
+	m_initialize = false;
+	m_media_slab = NULL;
+	m_pending_slab = NULL;
+	memset(m_media, 0, sizeof(m_media));
+	memset(m_pending, 0, sizeof(m_pending));
+	m_pending_pos = 0;
+	m_pending_count = 0;
+	m_fec_packets = 0;
+	m_recovered = 0;
+	m_unrecoverable = 0;
+}
+
+RTPFecDecoder::~RTPFecDecoder()
+{
+	if (m_media_slab)
+	{
+		delete[] m_media_slab;
+		m_media_slab = NULL;
+	}
+
+	if (m_pending_slab)
+	{
+		delete[] m_pending_slab;
+		m_pending_slab = NULL;
+	}
+}
+
+bool RTPFecDecoder::init()
+{
+	if (m_initialize)
+	{
+		return true;
+	}
+
+	m_media_slab = new (std::nothrow) uint8_t[(size_t)RTP_FEC_MEDIA_RING_SIZE * RTP_FEC_MAX_PROTECTED_SIZE];
+	m_pending_slab = new (std::nothrow) uint8_t[(size_t)RTP_FEC_PENDING_SIZE * RTP_FEC_MAX_PROTECTED_SIZE];
+	if (!m_media_slab || !m_pending_slab)
+	{
+		LOG_ERROR("RTPFecDecoder::init(), out of memory");
+		goto exitFlag;
+	}
+
+	m_initialize = true;
+	return true;
+
+exitFlag:
+	if (m_media_slab)
+	{
+		delete[] m_media_slab;
+		m_media_slab = NULL;
+	}
+
+	if (m_pending_slab)
+	{
+		delete[] m_pending_slab;
+		m_pending_slab = NULL;
+	}
+
+	return false;
+}
+
+void RTPFecDecoder::add_media(const uint8_t *data, int len)
+{
+	if (!m_initialize || len < (int)sizeof(RTPHeader) || len > RTP_FEC_MAX_PROTECTED_SIZE)
+	{
+		return;
+	}
+
+	store_media(data, len);
+}
+
+void RTPFecDecoder::add_fec(const uint8_t *data, int len, uint64_t nowUs)
+{
+	int parityLen = len - RTP_FEC_RTP_HEADER_SIZE - RTP_FEC_HEADER_SIZE;
+	if (!m_initialize || parityLen < (int)sizeof(RTPHeader) || parityLen > RTP_FEC_MAX_PROTECTED_SIZE)
+	{
+		return;
+	}
+
+	RTPFecHeader header;
+	rtp_fec_read_header(data + RTP_FEC_RTP_HEADER_SIZE, header);
+	if (header.count == 0 || header.stride == 0)
+	{
+		return;
+	}
+
+	m_fec_packets.fetch_add(1, std::memory_order_relaxed);
+
+	//the oldest parity packet is replaced, its group is given up
+	int index = m_pending_pos;
+	if (m_pending[index].length > 0)
+	{
+		for (int i = 0; i < m_pending[index].header.count; i++)
+		{
+			if (!has_media((uint16_t)(m_pending[index].header.baseSequence + i * m_pending[index].header.stride)))
+			{
+				m_unrecoverable.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		drop_pending(index);
+	}
+
+	memcpy(m_pending_slab + (size_t)index * RTP_FEC_MAX_PROTECTED_SIZE,
+		   data + RTP_FEC_RTP_HEADER_SIZE + RTP_FEC_HEADER_SIZE, parityLen);
+	m_pending[index].header = header;
+	m_pending[index].length = parityLen;
+	m_pending[index].arrivalTime = nowUs;
+	m_pending_pos = (m_pending_pos + 1) & (RTP_FEC_PENDING_SIZE - 1);
+	m_pending_count++;
+}
+
+int RTPFecDecoder::recover(uint8_t *buffer, uint64_t nowUs)
+{
+	if (!m_initialize || m_pending_count == 0)
+	{
+		return 0;
+	}
+
+	for (int index = 0; index < RTP_FEC_PENDING_SIZE; index++)
+	{
+		PendingEntry &entry = m_pending[index];
+		if (entry.length == 0)
+		{
+			continue;
+		}
+
+		int missingCount = 0;
+		uint16_t missing = 0;
+		for (int i = 0; i < entry.header.count; i++)
+		{
+			uint16_t sequence = (uint16_t)(entry.header.baseSequence + i * entry.header.stride);
+			if (!has_media(sequence))
+			{
+				missing = sequence;
+				missingCount++;
+			}
+		}
+
+		if (missingCount == 0)
+		{
+			//the whole group was received
+			drop_pending(index);
+		}
+		else if (missingCount == 1)
+		{
+			int len = recover_group(index, missing, buffer);
+			drop_pending(index);
+			if (len > 0)
+			{
+				m_recovered.fetch_add(1, std::memory_order_relaxed);
+				store_media(buffer, len);
+				return len;
+			}
+			m_unrecoverable.fetch_add(1, std::memory_order_relaxed);
+		}
+		else if (nowUs - entry.arrivalTime > (uint64_t)RTP_FEC_MAX_WAIT_MS * 1000)
+		{
+			m_unrecoverable.fetch_add(missingCount, std::memory_order_relaxed);
+			drop_pending(index);
+		}
+	}
+
+	return 0;
+}
+
+void RTPFecDecoder::get_stats(RTPFecStats &stats) const
+{
+	//the counters are independent, a relaxed snapshot is enough for the statistics
+	stats.fecPackets = m_fec_packets.load(std::memory_order_relaxed);
+	stats.recovered = m_recovered.load(std::memory_order_relaxed);
+	stats.unrecoverable = m_unrecoverable.load(std::memory_order_relaxed);
+}
+
+bool RTPFecDecoder::has_media(uint16_t sequence) const
+{
+	const MediaEntry &entry = m_media[sequence & (RTP_FEC_MEDIA_RING_SIZE - 1)];
+	return entry.length > 0 && entry.sequence == sequence;
+}
+
+void RTPFecDecoder::store_media(const uint8_t *data, int len)
+{
+	uint16_t sequence = ntohs(((const RTPHeader *)data)->sequence);
+	int index = sequence & (RTP_FEC_MEDIA_RING_SIZE - 1);
+
+	memcpy(m_media_slab + (size_t)index * RTP_FEC_MAX_PROTECTED_SIZE, data, len);
+	m_media[index].sequence = sequence;
+	m_media[index].length = len;
+}
+
+int RTPFecDecoder::recover_group(int index, uint16_t missing, uint8_t *buffer)
+{
+	PendingEntry &entry = m_pending[index];
+	uint16_t length = entry.header.lengthRecovery;
+
+	memcpy(buffer, m_pending_slab + (size_t)index * RTP_FEC_MAX_PROTECTED_SIZE, entry.length);
+	for (int i = 0; i < entry.header.count; i++)
+	{
+		uint16_t sequence = (uint16_t)(entry.header.baseSequence + i * entry.header.stride);
+		if (sequence == missing)
+		{
+			continue;
+		}
+
+		const MediaEntry &media = m_media[sequence & (RTP_FEC_MEDIA_RING_SIZE - 1)];
+		if (media.length > entry.length)
+		{
+			return 0;
+		}
+		rtp_fec_xor(buffer, m_media_slab + (size_t)(sequence & (RTP_FEC_MEDIA_RING_SIZE - 1)) * RTP_FEC_MAX_PROTECTED_SIZE,
+					media.length);
+		length ^= (uint16_t)media.length;
+	}
+
+	//the parity packet does not match the received packets
+	const RTPHeader *header = (const RTPHeader *)buffer;
+	if (length < sizeof(RTPHeader) || length > entry.length || header->version != 2 ||
+		ntohs(header->sequence) != missing)
+	{
+		LOG_WARNING("the recovered rtp packet %u is malformed", missing);
+		return 0;
+	}
+
+	return length;
+}
+
+void RTPFecDecoder::drop_pending(int index)
+{
+	m_pending[index].length = 0;
+	m_pending_count--;
+}
@@ -0,0 +1,142 @@
+#ifndef _H_RTP_FEC_DECODER_H_
+#define _H_RTP_FEC_DECODER_H_
+
+#include <stdint.h>
+#include <atomic>
+#include "rtp_fec_packet.h"
+
+//the received media packets ring size, it must be a power of 2. it is the
+//max sequence span of the packets which a parity packet protects
+const int RTP_FEC_MEDIA_RING_SIZE = 1024;
+
+//the pending parity packets ring size, it must be a power of 2
+const int RTP_FEC_PENDING_SIZE = 256;
+
+//the parity packet which can not recover its group is dropped after the time in milliseconds
+const int RTP_FEC_MAX_WAIT_MS = 500;
+
+/**
+ * the FEC decoder statistics
+ */
+struct RTPFecStats
+{
+	//the received parity packets
+	uint64_t fecPackets;
+	//the media packets recovered by the parity packets
+	uint64_t recovered;
+	//the lost media packets which the parity packets could not recover
+	uint64_t unrecoverable;
+};
+
+/**
+ * the XOR parity decoder of the video stream. the received media packets are
+ * copied into a ring indexed by the sequence. a parity packet is kept until all
+ * of its group but one packet are received, the missing packet is recovered by
+ * XOR-ing the parity packet and the received packets of the group.
+ * NOTE: the decoder is not thread safe, except get_stats().
+ */
+class RTPFecDecoder
+{
+public:
+	RTPFecDecoder();
+	virtual ~RTPFecDecoder();
+
+	/**
+	 * @brief initialize the decoder
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool init();
+
+	/**
+	 * @brief add a received media rtp packet
+	 *
+	 * @param data -- the rtp packet
+	 * @param len -- the rtp packet length
+	 */
+	void add_media(const uint8_t *data, int len);
+
+	/**
+	 * @brief add a received parity packet
+	 *
+	 * @param data -- the parity packet, the rtp header included
+	 * @param len -- the parity packet length
+	 * @param nowUs -- the arrival time, the monotonic time in microseconds
+	 */
+	void add_fec(const uint8_t *data, int len, uint64_t nowUs);
+
+	/**
+	 * @brief whether any parity packet is pending
+	 */
+	bool has_pending() const { return m_pending_count > 0; }
+
+	/**
+	 * @brief recover a missing media packet by the pending parity packets. the parity
+	 * packets whose groups were received are dropped, so are the parity packets which
+	 * waited too long. call it until it returns 0.
+	 *
+	 * @param buffer -- the buffer, its size must not be less than RTP_FEC_MAX_PROTECTED_SIZE
+	 * @param nowUs -- the monotonic time in microseconds
+	 *
+	 * @return the recovered rtp packet length, 0 if no packet can be recovered
+	 */
+	int recover(uint8_t *buffer, uint64_t nowUs);
+
+	/**
+	 * @brief get the statistics
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_stats(RTPFecStats &stats) const;
+
+private:
+	struct MediaEntry
+	{
+		uint16_t sequence;
+		//the packet length, 0 if the entry is empty
+		int length;
+	};
+
+	struct PendingEntry
+	{
+		RTPFecHeader header;
+		//the parity length, 0 if the entry is empty
+		int length;
+		//the arrival time
+		uint64_t arrivalTime;
+	};
+
+	//whether the media packet was received
+	bool has_media(uint16_t sequence) const;
+
+	//store the media packet into the ring
+	void store_media(const uint8_t *data, int len);
+
+	//recover the missing packet of the group
+	int recover_group(int index, uint16_t missing, uint8_t *buffer);
+
+	//drop the pending parity packet
+	void drop_pending(int index);
+
+private:
+	bool m_initialize;
+
+	//the media packets slab and entries
+	uint8_t *m_media_slab;
+	MediaEntry m_media[RTP_FEC_MEDIA_RING_SIZE];
+
+	//the pending parity slab and entries
+	uint8_t *m_pending_slab;
+	PendingEntry m_pending[RTP_FEC_PENDING_SIZE];
+	//the next entry to write
+	int m_pending_pos;
+	//the pending parity packets count
+	int m_pending_count;
+
+	//the statistics, get_stats() reads them on other threads
+	std::atomic<uint64_t> m_fec_packets;
+	std::atomic<uint64_t> m_recovered;
+	std::atomic<uint64_t> m_unrecoverable;
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "rtp_fec_encoder.h"
+
+#include <new>
+#include <string.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+#include "rtp_packet.h"
+#include "common_logger.h"
+
+RTPFecEncoder::RTPFecEncoder()
+{
+	m_initialize = false;
+	m_slab = NULL;
+	m_sequence = 0;
+	m_ssrc = 0;
+	m_delta_percent = 0;
+	m_key_percent = 0;
+	m_max_protected_size = RTP_FEC_MAX_PROTECTED_SIZE;
+}
+
+RTPFecEncoder::~RTPFecEncoder()
+{
+	if (m_slab)
+	{
+		delete[] m_slab;
+		m_slab = NULL;
+	}
+}
+
+bool RTPFecEncoder::init(uint16_t sequenceStart, uint32_t ssrc)
+{
+	if (m_initialize)
+	{
+		return true;
+	}
+
+	m_slab = new (std::nothrow) uint8_t[(size_t)RTP_FEC_MAX_PACKETS_PER_FRAME * RTP_FEC_MAX_PACKET_SIZE];
+	if (!m_slab)
+	{
+		LOG_ERROR("RTPFecEncoder::init(), out of memory");
+		return false;
+	}
+
+	m_sequence = sequenceStart;
+	m_ssrc = ssrc;
+
+	m_initialize = true;
+	return true;
+}
+
+void RTPFecEncoder::set_protection(int deltaPercent, int keyPercent)
+{
+	m_delta_percent = deltaPercent < 0 ? 0 : (deltaPercent > 100 ? 100 : deltaPercent);
+	m_key_percent = keyPercent < 0 ? 0 : (keyPercent > 100 ? 100 : keyPercent);
+}
+
+void RTPFecEncoder::set_max_protected_size(int size)
+{
+	m_max_protected_size = size > RTP_FEC_MAX_PROTECTED_SIZE ? RTP_FEC_MAX_PROTECTED_SIZE : size;
+}
+
+bool RTPFecEncoder::is_enabled() const
+{
+	return m_initialize && (m_delta_percent > 0 || m_key_percent > 0);
+}
+
+int RTPFecEncoder::encode(std::vector<RTPPacketIov> &packets, bool keyframe)
+{
+	int percent = keyframe ? m_key_percent : m_delta_percent;
+	int mediaCount = (int)packets.size();
+	if (!m_initialize || percent <= 0 || mediaCount == 0)
+	{
+		return 0;
+	}
+
+	int i;
+	for (i = 0; i < mediaCount; i++)
+	{
+		if (packets[i].headerLen < (int)sizeof(RTPHeader) || packets[i].get_length() > m_max_protected_size)
+		{
+			//the parity packet would exceed the MTU
+			return 0;
+		}
+	}
+
+	//the groups count, a group protects at most 255 packets and the stride fits in 8 bits
+	int groups = (mediaCount * percent + 99) / 100;
+	int minGroups = (mediaCount + RTP_FEC_MAX_GROUP_SIZE - 1) / RTP_FEC_MAX_GROUP_SIZE;
+	if (groups < minGroups)
+	{
+		groups = minGroups;
+	}
+	if (groups > mediaCount)
+	{
+		groups = mediaCount;
+	}
+	if (groups > RTP_FEC_MAX_PACKETS_PER_FRAME)
+	{
+		groups = RTP_FEC_MAX_PACKETS_PER_FRAME;
+		if (groups < minGroups)
+		{
+			return 0;
+		}
+	}
+
+	uint16_t baseSequence = ntohs(((const RTPHeader *)packets[0].header)->sequence);
+	for (int g = 0; g < groups; g++)
+	{
+		uint8_t *fec = m_slab + (size_t)g * RTP_FEC_MAX_PACKET_SIZE;
+		uint8_t *parity = fec + RTP_FEC_RTP_HEADER_SIZE + RTP_FEC_HEADER_SIZE;
+
+		int maxLen = 0;
+		uint16_t lengthRecovery = 0;
+		int count = 0;
+		for (i = g; i < mediaCount; i += groups)
+		{
+			const RTPPacketIov &packet = packets[i];
+			int len = packet.get_length();
+			if (count == 0)
+			{
+				memcpy(parity, packet.header, packet.headerLen);
+				if (packet.payloadLen > 0)
+				{
+					memcpy(parity + packet.headerLen, packet.payload, packet.payloadLen);
+				}
+				maxLen = len;
+			}
+			else
+			{
+				if (len > maxLen)
+				{
+					//the shorter packets are padded by zero
+					memset(parity + maxLen, 0, len - maxLen);
+					maxLen = len;
+				}
+				rtp_fec_xor(parity, packet.header, packet.headerLen);
+				if (packet.payloadLen > 0)
+				{
+					rtp_fec_xor(parity + packet.headerLen, packet.payload, packet.payloadLen);
+				}
+			}
+
+			lengthRecovery ^= (uint16_t)len;
+			count++;
+		}
+
+		RTPHeader *rtpHeader = (RTPHeader *)fec;
+		memset(rtpHeader, 0, sizeof(RTPHeader));
+		rtpHeader->version = 2;
+		rtpHeader->payloadType = RTP_FEC_PAYLOAD_TYPE;
+		rtpHeader->sequence = htons(m_sequence++);
+		rtpHeader->timestamp = ((const RTPHeader *)packets[0].header)->timestamp;
+		rtpHeader->ssrc = htonl(m_ssrc);
+
+		RTPFecHeader header;
+		header.baseSequence = (uint16_t)(baseSequence + g);
+		header.stride = (uint8_t)groups;
+		header.count = (uint8_t)count;
+		header.lengthRecovery = lengthRecovery;
+		rtp_fec_write_header(fec + RTP_FEC_RTP_HEADER_SIZE, header);
+
+		RTPPacketIov fecPacket;
+		fecPacket.header = fec;
+		fecPacket.headerLen = RTP_FEC_RTP_HEADER_SIZE + RTP_FEC_HEADER_SIZE + maxLen;
+		fecPacket.payload = NULL;
+		fecPacket.payloadLen = 0;
+		packets.push_back(fecPacket);
+	}
+
+	return groups;
+}
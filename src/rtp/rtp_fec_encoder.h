@@ -0,0 +1,94 @@
+#ifndef _H_RTP_FEC_ENCODER_H_
+#define _H_RTP_FEC_ENCODER_H_
+
+#include <vector>
+#include <stdint.h>
+#include "rtp_packet.h"
+#include "rtp_fec_packet.h"
+
+//the max parity packets of a frame
+const int RTP_FEC_MAX_PACKETS_PER_FRAME = 128;
+
+//the max protected packets of a parity packet
+const int RTP_FEC_MAX_GROUP_SIZE = 255;
+
+/**
+ * the XOR parity encoder of the video frames. the rtp packets of a frame are
+ * interleaved into the parity groups, the packet i is protected by the parity
+ * packet i % n, so a burst loss of n packets is still recoverable. the parity
+ * packets count of a frame is the protection percent of its packets count, the
+ * keyframes have their own protection percent.
+ * NOTE: the encoder is not thread safe.
+ */
+class RTPFecEncoder
+{
+public:
+	RTPFecEncoder();
+	virtual ~RTPFecEncoder();
+
+	/**
+	 * @brief initialize the encoder
+	 *
+	 * @param sequenceStart -- the start sequence of the parity packets
+	 * @param ssrc -- the rtp ssrc
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool init(uint16_t sequenceStart, uint32_t ssrc);
+
+	/**
+	 * @brief set the protection percent, the parity packets count to the media packets count
+	 *
+	 * @param deltaPercent -- the protection percent of the delta frames, 0 disables the protection
+	 * @param keyPercent -- the protection percent of the keyframes, 0 disables the protection
+	 */
+	void set_protection(int deltaPercent, int keyPercent);
+
+	/**
+	 * @brief set the max size of the protected packets, the frames which have a larger
+	 * packet are not protected. the parity packet is RTP_FEC_RTP_HEADER_SIZE +
+	 * RTP_FEC_HEADER_SIZE bytes larger than the largest protected packet, so the
+	 * size must leave room for them under the mtu.
+	 *
+	 * @param size -- the max protected packet size, it is limited by RTP_FEC_MAX_PROTECTED_SIZE
+	 */
+	void set_max_protected_size(int size);
+
+	/**
+	 * @brief whether any frame is protected
+	 */
+	bool is_enabled() const;
+
+	/**
+	 * @brief generate the parity packets of a frame. the parity packets are appended
+	 * to the packets vector, they are valid until the next encode() call.
+	 * NOTE: the rtp headers of the media packets must be final, they are protected too.
+	 *
+	 * @param packets -- the rtp packets of the frame, the parity packets are appended to it
+	 * @param keyframe -- whether the frame is a keyframe
+	 *
+	 * @return the parity packets count
+	 */
+	int encode(std::vector<RTPPacketIov> &packets, bool keyframe);
+
+private:
+	bool m_initialize;
+
+	//the parity packets slab
+	uint8_t *m_slab;
+
+	//the next sequence of the parity packets
+	uint16_t m_sequence;
+	//the rtp ssrc
+	uint32_t m_ssrc;
+
+	//the protection percents
+	int m_delta_percent;
+	int m_key_percent;
+
+	//the max protected packet size
+	int m_max_protected_size;
+};
+
+#endif
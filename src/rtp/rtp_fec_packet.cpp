@@ -0,0 +1,80 @@
+#include "rtp_fec_packet.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RTP_FEC_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+bool rtp_fec_is_fec_packet(const uint8_t *data, size_t len)
+{
+	return len >= (size_t)(RTP_FEC_RTP_HEADER_SIZE + RTP_FEC_HEADER_SIZE) && (data[0] >> 6) == 2 &&
+		   (data[1] & 0x7F) == RTP_FEC_PAYLOAD_TYPE;
+}
+
+void rtp_fec_write_header(uint8_t *buffer, const RTPFecHeader &header)
+{
+	buffer[0] = (uint8_t)(header.baseSequence >> 8);
+	buffer[1] = (uint8_t)header.baseSequence;
+	buffer[2] = header.stride;
+	buffer[3] = header.count;
+	buffer[4] = (uint8_t)(header.lengthRecovery >> 8);
+	buffer[5] = (uint8_t)header.lengthRecovery;
+	buffer[6] = 0;
+	buffer[7] = 0;
+}
+
+void rtp_fec_read_header(const uint8_t *buffer, RTPFecHeader &header)
+{
+	header.baseSequence = (uint16_t)((buffer[0] << 8) | buffer[1]);
+	header.stride = buffer[2];
+	header.count = buffer[3];
+	header.lengthRecovery = (uint16_t)((buffer[4] << 8) | buffer[5]);
+}
+
+void rtp_fec_xor(uint8_t *dst, const uint8_t *src, size_t len)
+{
+	size_t i = 0;
+
+#ifdef RTP_FEC_USE_SSE2
+	//4 vectors in each iteration, so the loads of the iterations overlap
+	for (; i + 64 <= len; i += 64)
+	{
+		__m128i a0 = _mm_loadu_si128((const __m128i *)(dst + i));
+		__m128i a1 = _mm_loadu_si128((const __m128i *)(dst + i + 16));
+		__m128i a2 = _mm_loadu_si128((const __m128i *)(dst + i + 32));
+		__m128i a3 = _mm_loadu_si128((const __m128i *)(dst + i + 48));
+		__m128i b0 = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i b1 = _mm_loadu_si128((const __m128i *)(src + i + 16));
+		__m128i b2 = _mm_loadu_si128((const __m128i *)(src + i + 32));
+		__m128i b3 = _mm_loadu_si128((const __m128i *)(src + i + 48));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(a0, b0));
+		_mm_storeu_si128((__m128i *)(dst + i + 16), _mm_xor_si128(a1, b1));
+		_mm_storeu_si128((__m128i *)(dst + i + 32), _mm_xor_si128(a2, b2));
+		_mm_storeu_si128((__m128i *)(dst + i + 48), _mm_xor_si128(a3, b3));
+	}
+
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(a, b));
+	}
+#endif
+
+	for (; i + 8 <= len; i += 8)
+	{
+		uint64_t a;
+		uint64_t b;
+		memcpy(&a, dst + i, 8);
+		memcpy(&b, src + i, 8);
+		a ^= b;
+		memcpy(dst + i, &a, 8);
+	}
+
+	for (; i < len; i++)
+	{
+		dst[i] ^= src[i];
+	}
+}
@@ -0,0 +1,88 @@
+#ifndef _H_RTP_FEC_PACKET_H_
+#define _H_RTP_FEC_PACKET_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* the XOR parity packet, it follows the 12 bytes rtp header
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ |       base sequence           |    stride     |     count     |
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ |       length recovery         |           reserved            |
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ |          XOR of the protected rtp packets, headers included   |
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+
+ the protected packets are base + i * stride, i in [0, count). the length
+ recovery is the XOR of their lengths. the rtp sequence of the parity packets
+ is a separate sequence space.
+*/
+
+//the rtp payload type of the XOR parity packets
+const uint8_t RTP_FEC_PAYLOAD_TYPE = 127;
+
+//the rtp header size of the parity packet
+const int RTP_FEC_RTP_HEADER_SIZE = 12;
+
+//the parity header size
+const int RTP_FEC_HEADER_SIZE = 8;
+
+//the max protected packet size of the parity buffers, the sessions bound it by their mtu
+const int RTP_FEC_MAX_PROTECTED_SIZE = 1480;
+
+//the max parity packet size
+const int RTP_FEC_MAX_PACKET_SIZE = RTP_FEC_RTP_HEADER_SIZE + RTP_FEC_HEADER_SIZE + RTP_FEC_MAX_PROTECTED_SIZE;
+
+/**
+ * the parity header
+ */
+struct RTPFecHeader
+{
+	//the sequence of the first protected packet
+	uint16_t baseSequence;
+	//the sequence distance of the protected packets
+	uint8_t stride;
+	//the protected packets count
+	uint8_t count;
+	//the XOR of the protected packets lengths
+	uint16_t lengthRecovery;
+};
+
+/**
+ * @brief check if the datagram is a parity packet
+ *
+ * @param data -- the datagram
+ * @param len -- the datagram length
+ * @return true - it is a parity packet
+ */
+bool rtp_fec_is_fec_packet(const uint8_t *data, size_t len);
+
+/**
+ * @brief write the parity header
+ *
+ * @param buffer -- the buffer, it points to the parity header
+ * @param header -- the parity header
+ */
+void rtp_fec_write_header(uint8_t *buffer, const RTPFecHeader &header);
+
+/**
+ * @brief read the parity header
+ *
+ * @param buffer -- the buffer, it points to the parity header
+ * @param header -- the parity header, output parameter
+ */
+void rtp_fec_read_header(const uint8_t *buffer, RTPFecHeader &header);
+
+/**
+ * @brief XOR the source into the destination, dst[i] ^= src[i].
+ * it is vectorized by SSE2 when it is available.
+ *
+ * @param dst -- the destination
+ * @param src -- the source
+ * @param len -- the length
+ */
+void rtp_fec_xor(uint8_t *dst, const uint8_t *src, size_t len);
+
+#endif
@@ -1,5 +1,6 @@
 #include "rtp_h264_frame_assembler.h"
 
+#include <new>
 #include <string.h>
 #include <sys/types.h>
 #ifdef _WIN32
@@ -15,11 +16,35 @@ namespace
 {
 	const uint8_t START_CODE[] = { 0, 0, 0, 1 };
 	const uint8_t SHORT_START_CODE[] = { 0, 0, 1 };
+
+	//the IDR slice and the non-first slices are prefixed by the short start code
+	bool use_short_start_code(uint8_t nal, uint8_t next)
+	{
+		return nal == 0x65 || ((nal == 0x61 || nal == 0x41) && ((next & 0x80) == 0x0));
+	}
 }
 
 RTPH264FrameAssembler::RTPH264FrameAssembler()
 	:m_initialize(false), m_buffer(NULL), m_buffer_used_len(0)
 {
+	m_callback = NULL;
+	m_callback_arg = NULL;
+
+	m_frame_active = false;
+	m_frame_timestamp = 0;
+	m_frame_ssrc = 0;
+	m_frame_packets = 0;
+	m_frame_expected_packets = 0;
+	m_frame_incomplete = false;
+	m_frame_keyframe = false;
+
+	m_fua_active = false;
+	m_fua_nal_start = 0;
+
+	m_last_sequence = 0;
+	m_has_last_sequence = false;
+
+	memset(&m_stats, 0, sizeof(m_stats));
 }
 
 RTPH264FrameAssembler::~RTPH264FrameAssembler()
@@ -37,7 +62,7 @@ bool RTPH264FrameAssembler::initialize()
 		return true;
 	}
 
-	m_buffer = new uint8_t[ASSEMBLER_BUFFER_SIZE];
+	m_buffer = new (std::nothrow) uint8_t[ASSEMBLER_BUFFER_SIZE];
 	if (!m_buffer)
 	{
 		return false;
@@ -47,6 +72,12 @@ bool RTPH264FrameAssembler::initialize()
 	return true;
 }
 
+void RTPH264FrameAssembler::set_frame_callback(OnH264FrameCallback func, void* arg)
+{
+	m_callback = func;
+	m_callback_arg = arg;
+}
+
 bool RTPH264FrameAssembler::push_packet(RTPPacket* packet)
 {
 	if (!m_initialize)
@@ -59,66 +90,200 @@ bool RTPH264FrameAssembler::push_packet(RTPPacket* packet)
 	uint8_t nal;
 	uint8_t type;
 
-	payload = packet->get_payload();
-	payloadLen = packet->get_payload_length();
-	if (payloadLen == 0)
+	uint16_t sequence = (uint16_t)packet->get_sequence();
+	bool gap = false;
+	if (m_has_last_sequence)
 	{
-		return false;
+		int16_t distance = (int16_t)(sequence - m_last_sequence);
+		if (distance <= 0)
+		{
+			//duplicated or out of order
+			return false;
+		}
+
+		gap = (distance != 1);
 	}
+	m_last_sequence = sequence;
+	m_has_last_sequence = true;
 
-	nal = payload[0];
-	type = nal & 0x1F;
+	//the marker packet of the previous frame was lost
+	if (m_frame_active && packet->get_timestamp() != m_frame_timestamp)
+	{
+		deliver_frame(false);
+	}
 
-	if (type >= 1 && type <= 23)
+	if (!m_frame_active)
 	{
-		type = 1;
+		begin_frame(packet);
 	}
 
-	switch (type)
+	//the lost packets belong to the current frame. if the previous frame was
+	//delivered by its marker, they are the leading packets of the current frame
+	if (gap)
 	{
-	case 0:
-	case 1:  //single nalu
-		if (nal == 0x65 || ((nal == 0x61 || nal == 0x41) && ((payload[1] & 0x80) == 0x0)))
+		m_stats.sequenceGaps++;
+		m_frame_incomplete = true;
+		if (m_fua_active)
 		{
-			if (payloadLen + sizeof(SHORT_START_CODE) > ASSEMBLER_BUFFER_SIZE)
-			{
-				m_buffer_used_len = 0;
-				return false;
-			}
+			m_buffer_used_len = m_fua_nal_start;
+			m_fua_active = false;
+		}
+	}
 
-			m_buffer_used_len = payloadLen + sizeof(SHORT_START_CODE);
-			memcpy(m_buffer, SHORT_START_CODE, sizeof(SHORT_START_CODE));
-			memcpy(m_buffer + sizeof(SHORT_START_CODE), payload, payloadLen);
+	m_frame_packets++;
+
+	payload = packet->get_payload();
+	payloadLen = packet->get_payload_length();
+	if (payloadLen == 0)
+	{
+		m_frame_incomplete = true;
+	}
+	else
+	{
+		nal = payload[0];
+		type = nal & 0x1F;
+
+		if (type >= 1 && type <= 23)
+		{
+			type = 1;
 		}
-		else
+
+		switch (type)
 		{
-			if (payloadLen + sizeof(START_CODE) > ASSEMBLER_BUFFER_SIZE)
+		case 0:
+		case 1:  //single nalu
+			if (!append_nal(payload, payloadLen))
+			{
+				m_frame_incomplete = true;
+			}
+			break;
+
+		case 24:  //STAP-A
+			if (!get_stapa_frame(payload + 1, payloadLen - 1))
 			{
-				m_buffer_used_len = 0;
-				return false;
+				m_frame_incomplete = true;
 			}
+			break;
 
-			m_buffer_used_len = payloadLen + sizeof(START_CODE);
-			memcpy(m_buffer, START_CODE, sizeof(START_CODE));
-			memcpy(m_buffer + sizeof(START_CODE), payload, payloadLen);
+		case 28:  //FU-A
+			if (!get_fua_frame(payload, payloadLen))
+			{
+				m_frame_incomplete = true;
+			}
+			break;
+
+		default:
+			LOG_ERROR("Unknown h264 rtp packet format.");
+			m_frame_incomplete = true;
+			break;
 		}
+	}
 
-		return true;
+	if (packet->has_marker())
+	{
+		deliver_frame(true);
+	}
+
+	return true;
+}
+
+void RTPH264FrameAssembler::flush()
+{
+	if (m_frame_active)
+	{
+		deliver_frame(false);
+	}
+}
 
-	case 24:  //STAP-A
-		payload++;
-		payloadLen--;
+void RTPH264FrameAssembler::get_stats(RTPH264AssemblerStats& stats) const
+{
+	stats = m_stats;
+}
 
-		return get_stapa_frame(payload, payloadLen);
+void RTPH264FrameAssembler::begin_frame(RTPPacket* packet)
+{
+	m_frame_active = true;
+	m_frame_timestamp = packet->get_timestamp();
+	m_frame_ssrc = packet->get_ssrc();
+	m_frame_packets = 0;
+	m_frame_expected_packets = packet->has_extension() ? packet->get_reserved() : 0;
+	m_frame_incomplete = false;
+	m_frame_keyframe = false;
+	m_fua_active = false;
+	m_fua_nal_start = 0;
+	m_buffer_used_len = 0;
+}
 
-	case 28:  //FU-A
+void RTPH264FrameAssembler::deliver_frame(bool marker)
+{
+	RTPH264Frame frame;
+	frame.data = m_buffer;
+	frame.length = m_buffer_used_len;
+	frame.ssrc = m_frame_ssrc;
+	frame.timestamp = m_frame_timestamp;
+	frame.keyframe = m_frame_keyframe;
+	frame.complete = marker && !m_frame_incomplete && !m_fua_active &&
+		(m_frame_expected_packets == 0 || m_frame_expected_packets == m_frame_packets);
+
+	if (frame.complete)
+	{
+		m_stats.completeFrames++;
+	}
+	else
+	{
+		m_stats.incompleteFrames++;
+	}
 
-		return get_fua_frame(payload, payloadLen);
+	if (m_callback)
+	{
+		m_callback(frame, m_callback_arg);
+	}
 
-	default:
-		LOG_ERROR("Unknown h264 rtp packet format.");
+	m_frame_active = false;
+	m_fua_active = false;
+	m_buffer_used_len = 0;
+}
+
+bool RTPH264FrameAssembler::append(const uint8_t* data, size_t len)
+{
+	if (m_buffer_used_len + len > (size_t)ASSEMBLER_BUFFER_SIZE)
+	{
+		LOG_ERROR("the h264 frame is larger than the assembler buffer.");
+		return false;
+	}
+
+	memcpy(m_buffer + m_buffer_used_len, data, len);
+	m_buffer_used_len += len;
+
+	return true;
+}
+
+bool RTPH264FrameAssembler::append_nal(const uint8_t* nal, size_t len)
+{
+	size_t start = m_buffer_used_len;
+	bool ret;
+
+	if (use_short_start_code(nal[0], len > 1 ? nal[1] : 0))
+	{
+		ret = append(SHORT_START_CODE, sizeof(SHORT_START_CODE));
+	}
+	else
+	{
+		ret = append(START_CODE, sizeof(START_CODE));
+	}
+
+	if (!ret || !append(nal, len))
+	{
+		m_buffer_used_len = start;
 		return false;
 	}
+
+	if ((nal[0] & 0x1F) == 5)
+	{
+		m_frame_keyframe = true;
+	}
+
+	return true;
 }
 
 bool RTPH264FrameAssembler::get_stapa_frame(uint8_t* data, size_t len)
@@ -126,38 +291,20 @@ bool RTPH264FrameAssembler::get_stapa_frame(uint8_t* data, size_t len)
 	const uint8_t *src = data;
 	int srcLen = (int)len;
 
-	m_buffer_used_len = 0;
-
 	while (srcLen > 2)
 	{
-		uint16_t* nalSizePtr = (uint16_t*)src;
-		uint16_t nalSize = ntohs(*nalSizePtr);
+		uint16_t nalSize = (uint16_t)((src[0] << 8) | src[1]);
 
 		src += 2;
 		srcLen -= 2;
-		if (nalSize <= srcLen)
+		if (nalSize == 0 || nalSize > srcLen)
 		{
-			if (src[0] == 0x65 || ((src[0] == 0x61 || src[0] == 0x41) && ((src[1] & 0x80) == 0x0)))
-			{
-				memcpy(m_buffer + m_buffer_used_len, SHORT_START_CODE, sizeof(SHORT_START_CODE));
-				m_buffer_used_len += sizeof(SHORT_START_CODE);
-
-				memcpy(m_buffer + m_buffer_used_len, src, nalSize);
-				m_buffer_used_len += nalSize;
-			}
-			else
-			{
-				memcpy(m_buffer + m_buffer_used_len, START_CODE, sizeof(START_CODE));
-				m_buffer_used_len += sizeof(START_CODE);
-
-				memcpy(m_buffer + m_buffer_used_len, src, nalSize);
-				m_buffer_used_len += nalSize;
-			}
+			//invalid format
+			return false;
 		}
-		else
+
+		if (!append_nal(src, nalSize))
 		{
-			//invalid format
-			m_buffer_used_len = 0;
 			return false;
 		}
 
@@ -165,12 +312,6 @@ bool RTPH264FrameAssembler::get_stapa_frame(uint8_t* data, size_t len)
 		srcLen -= nalSize;
 	}
 
-	if (m_buffer_used_len > ASSEMBLER_BUFFER_SIZE)
-	{
-		m_buffer_used_len = 0;
-		return false;
-	}
-
 	return true;
 }
 
@@ -183,9 +324,8 @@ bool RTPH264FrameAssembler::get_fua_frame(uint8_t* data, size_t len)
 	uint8_t nalType;
 	uint8_t nal;
 
-	if (len < 3 || len > ASSEMBLER_BUFFER_SIZE)
+	if (len < 3)
 	{
-		m_buffer_used_len = 0;
 		return false;
 	}
 
@@ -201,45 +341,55 @@ bool RTPH264FrameAssembler::get_fua_frame(uint8_t* data, size_t len)
 
 	if (startbit)
 	{
-		if (data[0] == 0x65 || ((data[0] == 0x61 || data[0] == 0x41) && ((data[1] & 0x80) == 0x0)))
+		//the previous FU-A NAL unit was not ended
+		bool ret = !m_fua_active;
+		if (m_fua_active)
 		{
-			m_buffer_used_len = sizeof(SHORT_START_CODE) + 1 + len;
-			memcpy(m_buffer, SHORT_START_CODE, sizeof(SHORT_START_CODE));
-			memcpy(m_buffer + sizeof(SHORT_START_CODE), &nal, 1);
-			memcpy(m_buffer + sizeof(SHORT_START_CODE) + 1, data, len);
+			m_buffer_used_len = m_fua_nal_start;
+		}
+
+		m_fua_nal_start = m_buffer_used_len;
+		if (use_short_start_code(nal, data[0]))
+		{
+			m_fua_active = append(SHORT_START_CODE, sizeof(SHORT_START_CODE));
 		}
 		else
 		{
-			m_buffer_used_len = sizeof(START_CODE) + 1 + len;
-			memcpy(m_buffer, START_CODE, sizeof(START_CODE));
-			memcpy(m_buffer + sizeof(START_CODE), &nal, 1);
-			memcpy(m_buffer + sizeof(START_CODE) + 1, data, len);
+			m_fua_active = append(START_CODE, sizeof(START_CODE));
 		}
+		m_fua_active = m_fua_active && append(&nal, 1) && append(data, len);
 
-		return false;
-	}
-	else if(endbit)
-	{
-		memcpy(m_buffer + m_buffer_used_len, data, len);
-		m_buffer_used_len += len;
+		if (!m_fua_active)
+		{
+			m_buffer_used_len = m_fua_nal_start;
+			return false;
+		}
 
-		return true;
+		if (nalType == 5)
+		{
+			m_frame_keyframe = true;
+		}
+
+		return ret;
 	}
-	else
+
+	if (!m_fua_active)
 	{
-		memcpy(m_buffer + m_buffer_used_len, data, len);
-		m_buffer_used_len += len;
+		//the start fragment was lost
+		return false;
+	}
 
+	if (!append(data, len))
+	{
+		m_buffer_used_len = m_fua_nal_start;
+		m_fua_active = false;
 		return false;
 	}
-}
 
-uint8_t* RTPH264FrameAssembler::get_frame_data()
-{
-	return m_buffer;
-}
+	if (endbit)
+	{
+		m_fua_active = false;
+	}
 
-size_t RTPH264FrameAssembler::get_frame_length()
-{
-	return m_buffer_used_len;
+	return true;
 }
@@ -2,13 +2,59 @@
 #define _H_RTP_H264_FRAME_ASSEMBLER_H_
 
 #include <stdint.h>
+#include <stddef.h>
 #include "rtp_packet.h"
 
-//the assembler buffer size
-const int ASSEMBLER_BUFFER_SIZE = 1024 * 256;
+//the assembler frame buffer size
+const int ASSEMBLER_BUFFER_SIZE = 1024 * 1024;
 
 /**
-* h264 frame assembler from rtp packets
+* the h264 access unit assembled from the rtp packets of one rtp timestamp
+*/
+struct RTPH264Frame
+{
+	//the annex-b frame data, it points to the assembler frame buffer
+	uint8_t* data;
+	//the frame data length
+	size_t length;
+	//the rtp ssrc
+	uint32_t ssrc;
+	//the rtp timestamp
+	uint32_t timestamp;
+	//whether all the rtp packets of the frame were received
+	bool complete;
+	//whether the frame contains an IDR slice
+	bool keyframe;
+};
+
+/**
+* the frame callback function. the frame data is valid until the callback returns.
+* the incomplete frame may be empty if all its NAL units were dropped.
+* @param frame -- the assembled frame
+* @param userArg -- the user argument
+*/
+typedef void (*OnH264FrameCallback)(const RTPH264Frame& frame, void* userArg);
+
+/**
+* the assembler statistics
+*/
+struct RTPH264AssemblerStats
+{
+	//the complete frames count
+	uint64_t completeFrames;
+	//the incomplete frames count
+	uint64_t incompleteFrames;
+	//the sequence gaps count
+	uint64_t sequenceGaps;
+};
+
+/**
+* h264 frame assembler from rtp packets.
+* the payloads of the packets which have the same rtp timestamp are written into
+* one frame buffer, the frame is delivered by the callback when its marker packet
+* arrives or the next frame begins. the sequence gaps are tracked, the frame which
+* lost packets is flagged as incomplete, the NAL unit whose FU-A fragments were lost
+* is dropped from the frame.
 */
 class RTPH264FrameAssembler
 {
@@ -25,30 +71,46 @@ public:
 	bool initialize();
 
 	/**
-	* @brief push a rtp packet to the assembler
+	* @brief set the frame callback function
+	* @param func -- the frame callback function
+	* @param arg -- the user argument
+	*/
+	void set_frame_callback(OnH264FrameCallback func, void* arg);
+
+	/**
+	* @brief push a rtp packet to the assembler. the packets must be pushed in the sequence order.
 	* @param packet - the rtp packet
 	*
-	* @return true - if the packet was pushed, and no error occurs, return true
-	* @return false - failed
+	* @return true - the packet was accepted
+	* @return false - the packet was dropped, it is duplicated or malformed
 	*/
 	bool push_packet(RTPPacket* packet);
 
 	/**
-	* @brief get the h264 frame data pointer
-	*
-	* @return the frame data pointer
+	* @brief deliver the pending frame, it is flagged as incomplete because its marker packet was not received
 	*/
-	uint8_t* get_frame_data();
+	void flush();
 
 	/**
-	* @brief get the h264 frame data length
-	*
-	* @return the frame data length
+	* @brief get the statistics
+	* @param stats -- the statistics, output parameter
 	*/
-	size_t get_frame_length();
+	void get_stats(RTPH264AssemblerStats& stats) const;
 
 private:
 
+	//begin a new frame
+	void begin_frame(RTPPacket* packet);
+
+	//deliver the current frame by the callback
+	void deliver_frame(bool marker);
+
+	//append the data to the frame buffer
+	bool append(const uint8_t* data, size_t len);
+
+	//append a NAL unit with the start code to the frame buffer
+	bool append_nal(const uint8_t* nal, size_t len);
+
 	//get the STAP-A data
 	bool get_stapa_frame(uint8_t* data, size_t len);
 
@@ -57,8 +119,41 @@ private:
 
 private:
 	bool m_initialize;
+
+	//the frame buffer
 	uint8_t* m_buffer;
 	size_t m_buffer_used_len;
+
+	//the frame callback
+	OnH264FrameCallback m_callback;
+	void* m_callback_arg;
+
+	//whether a frame is being assembled
+	bool m_frame_active;
+	//the current frame rtp timestamp
+	uint32_t m_frame_timestamp;
+	//the current frame rtp ssrc
+	uint32_t m_frame_ssrc;
+	//the received packets count of the current frame
+	int m_frame_packets;
+	//the packets count of the current frame which the sender announced, 0 if unknown
+	int m_frame_expected_packets;
+	//whether the current frame lost data
+	bool m_frame_incomplete;
+	//whether the current frame contains an IDR slice
+	bool m_frame_keyframe;
+
+	//whether a FU-A NAL unit is being assembled
+	bool m_fua_active;
+	//the FU-A NAL unit start offset in the frame buffer
+	size_t m_fua_nal_start;
+
+	//the last received sequence
+	uint16_t m_last_sequence;
+	bool m_has_last_sequence;
+
+	//the statistics
+	RTPH264AssemblerStats m_stats;
 };
 
-#endif
\ No newline at end of file
+#endif
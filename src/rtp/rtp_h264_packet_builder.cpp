@@ -4,14 +4,13 @@
 #include <string.h>
 #include <sys/types.h>
 
-#ifdef _WIN32
-#include <winsock2.h>
-#else
-#include <arpa/inet.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <arpa/inet.h>
 #endif
 
 #include "common_logger.h"
-#include "codec_utils.h"
 
 RTPH264PacketBuilder::RTPH264PacketBuilder()
 {
@@ -22,9 +21,11 @@ RTPH264PacketBuilder::RTPH264PacketBuilder()
 	m_ntp_timestamp = 0;
 	m_marker = false;
 
+	m_header_pos = NULL;
+	m_max_packet_size = RTP_PACKET_SIZE;
+
 	m_rtp_buffer = NULL;
 	m_rtp_buffer_end = NULL;
-	m_current_pos = NULL;
 
 	m_initialize = false;
 }
@@ -75,107 +76,72 @@ void RTPH264PacketBuilder::increment_timestamp_by(uint32_t inc)
 	this->m_timestamp += inc;
 }
 
-bool RTPH264PacketBuilder::build_fua_packet(const uint8_t* data, int len,
-	std::vector<std::pair<const uint8_t*, int> >& rtpvec)
+void RTPH264PacketBuilder::set_max_packet_size(int packetSize)
 {
-	const uint8_t fnri = data[0] & 0xE0;
-	const uint8_t type = data[0] & 0x1F;
-	bool isStart = true;
-	data++;
-	len--;
+	if (packetSize < RTP_H264_MIN_PACKET_SIZE)
+	{
+		packetSize = RTP_H264_MIN_PACKET_SIZE;
+	}
+	else if (packetSize > RTP_H264_MAX_PACKET_SIZE)
+	{
+		packetSize = RTP_H264_MAX_PACKET_SIZE;
+	}
 
-	int leftLen = len;
+	this->m_max_packet_size = packetSize;
+}
 
-	while (true)
-	{
-		if (m_current_pos + sizeof(RTPHeader) + sizeof(RTPExtensionHeader) >= m_rtp_buffer_end)
-		{
-			return false;
-		}
+int RTPH264PacketBuilder::get_max_packet_size() const
+{
+	return this->m_max_packet_size;
+}
 
-		const uint8_t* const start = m_current_pos;
-
-		RTPHeader* rtpHeader = (RTPHeader*)m_current_pos;
-		rtpHeader->version = 2;
-		rtpHeader->padding = 0;
-		rtpHeader->extension = 1;
-		rtpHeader->csrcCount = 0;
-		rtpHeader->payloadType = 96;
-		rtpHeader->marker = 0;
-		rtpHeader->sequence = htons((uint16_t)(m_sequence & 0x0000FFFF));
-		rtpHeader->timestamp = htonl(this->m_timestamp);
-		rtpHeader->ssrc = htonl(this->m_ssrc);
-
-		RTPExtensionHeader* extHeader = (RTPExtensionHeader*)(m_current_pos + sizeof(RTPHeader));
-		extHeader->id = 0;
-		extHeader->length = htons(3);
-		extHeader->reserved = 0;
-		extHeader->seqHigh16 = htons((uint16_t)((m_sequence >> 16) & 0x0000FFFF));
-		extHeader->msw = 0;
-		extHeader->lsw = 0;
-
-		m_current_pos += sizeof(RTPHeader) + sizeof(RTPExtensionHeader);
-
-		if (m_current_pos + 2 >= m_rtp_buffer_end)
-		{
-			return false;
-		}
+//the header parts are aligned, the rtp header is accessed by the struct
+static inline size_t align_header_size(size_t size)
+{
+	return (size + 7) & ~(size_t)7;
+}
 
-		int copyLen = ((RTP_PAYLOAD_SIZE - 2) < leftLen ? (RTP_PAYLOAD_SIZE - 2) : leftLen);
-		//FU indicator
-		*(m_current_pos++) = fnri | 0x1c;
-		if (isStart)
+void RTPH264PacketBuilder::reserve_header_arena(int maxPayload)
+{
+	//a FU-A header for each fragment, a STAP-A packet at most for each small nalu
+	size_t size = 0;
+	for (int i = 0; i < m_au_index.get_count(); i++)
+	{
+		int naluLen = (int)m_au_index.get_nalu(i).size;
+		if (naluLen <= 0)
 		{
-			//FU header -- start
-			*(m_current_pos++) = 0x80 | type;
-			isStart = false;
-		}
-		else
-		{
-			if (copyLen == leftLen)
-			{
-				//FU header  -- end
-				*(m_current_pos++) = 0x40 | type;
-			}
-			else
-			{
-				//FU header -- middle
-				*(m_current_pos++) = 0x00 | type;
-			}
+			continue;
 		}
 
-		if (m_current_pos + copyLen >= m_rtp_buffer_end)
+		if (naluLen > maxPayload)
 		{
-			return false;
+			int fragmentSize = maxPayload - 2;
+			size_t fragments = (naluLen - 1 + fragmentSize - 1) / fragmentSize;
+			size += fragments * align_header_size(RTP_H264_HEADER_SIZE + 2);
 		}
 		else
 		{
-			memcpy(m_current_pos, data + (len - leftLen), copyLen);
-			m_current_pos += copyLen;
-			rtpvec.push_back(std::make_pair(start, m_current_pos - start));
-			m_sequence++;
-			leftLen -= copyLen;
-			if (leftLen <= 0)
-			{
-				break;
-			}
+			size += align_header_size(RTP_H264_HEADER_SIZE + 1 + 2 + naluLen);
 		}
 	}
 
-	return true;
-}
-
-bool RTPH264PacketBuilder::build_packet(std::vector<std::pair<const uint8_t*, int> >& datavec,
-	std::vector<std::pair<const uint8_t*, int> >& rtpvec)
-{
-	if (m_current_pos + sizeof(RTPHeader) + sizeof(RTPExtensionHeader) >= m_rtp_buffer_end)
+	if (m_header_arena.size() < size)
 	{
-		return false;
+		m_header_arena.resize(size);
 	}
+	m_header_pos = m_header_arena.empty() ? NULL : &m_header_arena[0];
+}
 
-	const uint8_t* const start = m_current_pos;
+uint8_t* RTPH264PacketBuilder::alloc_header(int len)
+{
+	uint8_t* header = m_header_pos;
+	m_header_pos += align_header_size(len);
+	return header;
+}
 
-	RTPHeader* rtpHeader = (RTPHeader*)m_current_pos;
+void RTPH264PacketBuilder::write_rtp_header(uint8_t* buffer)
+{
+	RTPHeader* rtpHeader = (RTPHeader*)buffer;
 	rtpHeader->version = 2;
 	rtpHeader->padding = 0;
 	rtpHeader->extension = 1;
@@ -186,163 +152,222 @@ bool RTPH264PacketBuilder::build_packet(std::vector<std::pair<const uint8_t*, in
 	rtpHeader->timestamp = htonl(this->m_timestamp);
 	rtpHeader->ssrc = htonl(this->m_ssrc);
 
-	RTPExtensionHeader* extHeader = (RTPExtensionHeader*)(m_current_pos + sizeof(RTPHeader));
+	RTPExtensionHeader* extHeader = (RTPExtensionHeader*)(buffer + sizeof(RTPHeader));
 	extHeader->id = 0;
 	extHeader->length = htons(3);
 	extHeader->reserved = 0;
 	extHeader->seqHigh16 = htons((uint16_t)((m_sequence >> 16) & 0x0000FFFF));
 	extHeader->msw = 0;
 	extHeader->lsw = 0;
+}
 
-	m_current_pos += sizeof(RTPHeader) + sizeof(RTPExtensionHeader);
+bool RTPH264PacketBuilder::build_fua_packet(const uint8_t* data, int len, int fragmentSize,
+	std::vector<RTPPacketIov>& rtpvec)
+{
+	const uint8_t fnri = data[0] & 0xE0;
+	const uint8_t type = data[0] & 0x1F;
+	bool isStart = true;
+	data++;
+	len--;
 
-	//single nal unit packet
-	if (datavec.size() == 1)
+	int offset = 0;
+	while (offset < len)
 	{
-		const uint8_t* data = datavec[0].first;
-		int dataLen = datavec[0].second;
-		if (m_current_pos + dataLen < m_rtp_buffer_end)
-		{
-			memcpy(m_current_pos, data, dataLen);
-			m_current_pos += dataLen;
-			rtpvec.push_back(std::make_pair(start, m_current_pos - start));
-			m_sequence++;
+		int payloadLen = (fragmentSize < len - offset ? fragmentSize : len - offset);
 
-			return true;
+		uint8_t* header = alloc_header(RTP_H264_HEADER_SIZE + 2);
+		write_rtp_header(header);
+
+		//FU indicator
+		header[RTP_H264_HEADER_SIZE] = fnri | 0x1c;
+		if (isStart)
+		{
+			//FU header -- start
+			header[RTP_H264_HEADER_SIZE + 1] = 0x80 | type;
+			isStart = false;
+		}
+		else if (offset + payloadLen == len)
+		{
+			//FU header  -- end
+			header[RTP_H264_HEADER_SIZE + 1] = 0x40 | type;
 		}
 		else
 		{
-			return false;
+			//FU header -- middle
+			header[RTP_H264_HEADER_SIZE + 1] = 0x00 | type;
 		}
+
+		//the fragment is not copied, the payload part points to the nalu
+		RTPPacketIov packet;
+		packet.header = header;
+		packet.headerLen = RTP_H264_HEADER_SIZE + 2;
+		packet.payload = data + offset;
+		packet.payloadLen = payloadLen;
+		rtpvec.push_back(packet);
+
+		m_sequence++;
+		offset += payloadLen;
+	}
+
+	return true;
+}
+
+bool RTPH264PacketBuilder::build_packet(std::vector<std::pair<const uint8_t*, int> >& datavec,
+	std::vector<RTPPacketIov>& rtpvec)
+{
+	RTPPacketIov packet;
+
+	//single nal unit packet
+	if (datavec.size() == 1)
+	{
+		uint8_t* header = alloc_header(RTP_H264_HEADER_SIZE);
+		write_rtp_header(header);
+
+		packet.header = header;
+		packet.headerLen = RTP_H264_HEADER_SIZE;
+		packet.payload = datavec[0].first;
+		packet.payloadLen = datavec[0].second;
 	}
 	else  //STAP-A
 	{
+		//the F bit is the OR of the aggregated nalus, the NRI is their max NRI, RFC 6184 5.7
+		int headerLen = RTP_H264_HEADER_SIZE + 1;
+		uint8_t forbidden = 0;
+		uint8_t nri = 0;
 		std::vector<std::pair<const uint8_t*, int> >::iterator it;
 		for (it = datavec.begin(); it != datavec.end(); it++)
+		{
+			headerLen += 2 + it->second;
+			forbidden |= it->first[0] & 0x80;
+			nri = std::max(nri, (uint8_t)(it->first[0] & 0x60));
+		}
+
+		//the aggregated nalus are small, they are copied to the header part
+		uint8_t* header = alloc_header(headerLen);
+		write_rtp_header(header);
+
+		uint8_t* pos = header + RTP_H264_HEADER_SIZE;
+		*(pos++) = forbidden | nri | 0x18;
+		for (it = datavec.begin(); it != datavec.end(); it++)
 		{
 			const uint8_t* data = it->first;
 			int dataLen = it->second;
-			if (m_current_pos + dataLen < m_rtp_buffer_end)
-			{
-				if (it == datavec.begin())
-				{
-					//STAP-A
-					*m_current_pos = 0x18;
-					m_current_pos++;
-				}
-				//size
-				*(m_current_pos++) = (dataLen >> 8) & 0xFF;
-				*(m_current_pos++) = dataLen & 0xFF;
-
-				memcpy(m_current_pos, data, dataLen);
-				m_current_pos += dataLen;
-			}
-			else
-			{
-				return false;
-			}
-		}
 
-		rtpvec.push_back(std::make_pair(start, m_current_pos - start));
-		m_sequence++;
+			//size
+			*(pos++) = (dataLen >> 8) & 0xFF;
+			*(pos++) = dataLen & 0xFF;
 
-		return true;
+			memcpy(pos, data, dataLen);
+			pos += dataLen;
+		}
+
+		packet.header = header;
+		packet.headerLen = headerLen;
+		packet.payload = NULL;
+		packet.payloadLen = 0;
 	}
+
+	rtpvec.push_back(packet);
+	m_sequence++;
+
+	return true;
 }
 
 bool RTPH264PacketBuilder::send_data(const uint8_t *data, size_t len)
 {
-	this->m_nalu_vec.clear();
+	//the frame is scanned once, the session reads the nalu types from the index
+	m_au_index.parse(data, len);
+
+	return true;
+}
 
-	const uint8_t* end = data + len;
-	const uint8_t* startCode;
+bool RTPH264PacketBuilder::receive_rtp_packets(std::vector<std::pair<const uint8_t*, int> >& packets)
+{
+	m_iov_packets.clear();
+	if (!receive_rtp_packets(m_iov_packets))
+	{
+		return false;
+	}
 
-	startCode = avc_find_start_code(data, end);
-	while (startCode < end)
+	uint8_t* pos = m_rtp_buffer;
+	std::vector<RTPPacketIov>::const_iterator it;
+	for (it = m_iov_packets.begin(); it != m_iov_packets.end(); it++)
 	{
-		while (!*(startCode++));
-		const uint8_t* nextStart = avc_find_start_code(startCode, end);
-		int naluLen = (int)(nextStart - startCode);
-		if (naluLen > 0)
+		if (pos + it->get_length() > m_rtp_buffer_end)
 		{
-			//if (startCode[0] == 0x41 || startCode[0] == 0x61 || startCode[0] == 0x67 || startCode[0] == 0x68 || startCode[0] == 0x65)
-			{
-				this->m_nalu_vec.push_back(std::make_pair(startCode, naluLen));
-			}
+			return false;
 		}
 
-		startCode = nextStart;
+		memcpy(pos, it->header, it->headerLen);
+		if (it->payloadLen > 0)
+		{
+			memcpy(pos + it->headerLen, it->payload, it->payloadLen);
+		}
+		packets.push_back(std::make_pair((const uint8_t*)pos, it->get_length()));
+		pos += it->get_length();
 	}
 
 	return true;
 }
 
-bool RTPH264PacketBuilder::receive_rtp_packets(std::vector<std::pair<const uint8_t*, int> >& packets)
+bool RTPH264PacketBuilder::receive_rtp_packets(std::vector<RTPPacketIov>& packets)
 {
-	m_current_pos = m_rtp_buffer;
+	//the packet size is read once, a new size takes effect from the next frame
+	const int maxPayload = m_max_packet_size - RTP_H264_HEADER_SIZE;
+	reserve_header_arena(maxPayload);
 
-	int totalLen = 0;
-	std::vector<std::pair<const uint8_t*, int> > tmp;
+	//the pending nalus are sent by one packet. the STAP-A payload is the STAP-A
+	//header and a 2 bytes size field before each nalu, a single nalu is sent as it is
+	int stapLen = 0;
+	m_aggregate.clear();
 
-	std::vector<std::pair<const uint8_t*, int> >::iterator it;
-	for (it = m_nalu_vec.begin(); it != m_nalu_vec.end(); it++)
+	for (int i = 0; i < m_au_index.get_count(); i++)
 	{
-		const uint8_t* naluData = it->first;
-		int naluLen = it->second;
+		const uint8_t* naluData = m_au_index.get_nalu(i).data;
+		int naluLen = (int)m_au_index.get_nalu(i).size;
+		if (naluLen <= 0)
+		{
+			continue;
+		}
 
-		if (naluLen > RTP_PAYLOAD_SIZE)
+		//the nalus keep their order, so the pending packet is sent when a nalu does
+		//not fit in it. filling each packet up is the fewest packets for the order
+		if (m_aggregate.size() > 0 && (naluLen > maxPayload || stapLen + 2 + naluLen > maxPayload))
 		{
-			//single nalu or STAP-A
-			if (tmp.size() > 0)
+			if (!build_packet(m_aggregate, packets))
 			{
-				if (!build_packet(tmp, packets))
-				{
-					return false;
-				}
-				tmp.clear();
-				totalLen = 0;
+				return false;
 			}
+			m_aggregate.clear();
+		}
 
+		if (naluLen > maxPayload)
+		{
 			//FU-A
-			if (!build_fua_packet(naluData, naluLen, packets))
+			if (!build_fua_packet(naluData, naluLen, maxPayload - 2, packets))
 			{
 				return false;
 			}
+			continue;
 		}
-		else
+
+		if (m_aggregate.empty())
 		{
-			if (totalLen < RTP_PAYLOAD_SIZE && RTP_PAYLOAD_SIZE < totalLen + naluLen)
-			{
-				//single nalu or STAP-A
-				if (tmp.size() > 0)
-				{
-					if (!build_packet(tmp, packets))
-					{
-						return false;
-					}
-					tmp.clear();
-				}
-
-				totalLen = naluLen;
-				tmp.push_back(std::make_pair(naluData, naluLen));
-			}
-			else
-			{
-				totalLen += naluLen;
-				tmp.push_back(std::make_pair(naluData, naluLen));
-			}
+			stapLen = 1;
 		}
+		stapLen += 2 + naluLen;
+		m_aggregate.push_back(std::make_pair(naluData, naluLen));
 	}
 
 	//single nalu or STAP-A
-	if (tmp.size() > 0)
+	if (m_aggregate.size() > 0)
 	{
-		if (!build_packet(tmp, packets))
+		if (!build_packet(m_aggregate, packets))
 		{
 			return false;
 		}
-		tmp.clear();
+		m_aggregate.clear();
 	}
 
 	return true;
-}
\ No newline at end of file
+}
@@ -4,10 +4,17 @@
 #include <vector>
 #include <stdint.h>
 #include "rtp_packet.h"
+#include "codec_utils.h"
 
-//the rtp packet size, it's less than mtu
+//the default rtp packet size, it's less than mtu
 const int RTP_PACKET_SIZE = 1400;
 
+//the max rtp packet size, the ethernet mtu without the ip header and the udp header
+const int RTP_H264_MAX_PACKET_SIZE = 1500 - 20 - 8;
+
+//the min rtp packet size
+const int RTP_H264_MIN_PACKET_SIZE = 256;
+
 //the rtp packet payload size
 const int RTP_PAYLOAD_SIZE = RTP_PACKET_SIZE - sizeof(RTPHeader) - sizeof(RTPExtensionHeader);
 
@@ -17,6 +24,9 @@ const int RTP_PACKETS_BUFFER_SIZE = 1024 * 256;
 //the nalu buffer size
 const int NALU_BUFFER_SIZE = 1024 * 256;
 
+//the rtp header and the extension header length of the packets
+const int RTP_H264_HEADER_SIZE = sizeof(RTPHeader) + sizeof(RTPExtensionHeader);
+
 /**
 * the rtp packet builder for H264 frame data
 */
@@ -47,13 +57,49 @@ public:
 	bool send_data(const uint8_t *data, size_t len);
 
 	/**
-	 * @brief Receive the rtp packet
+	 * @brief Receive the rtp packet. the packets are copied to the builder buffer,
+	 * they are valid until the next call.
 	 * 
 	 * @param packets -- the rtp packet data vectors
 	 *
 	 */
 	bool receive_rtp_packets(std::vector<std::pair<const uint8_t*, int> >& packets);
 
+	/**
+	 * @brief Receive the rtp packets without copying the payload. the header part of
+	 * each packet is in the header arena of the builder, the payload part points to
+	 * the data which is sent, so the frame size is not limited by the builder buffer.
+	 * the headers may be modified by the caller before the packets are sent.
+	 * NOTE: the packets are valid until the next call, and the data which is sent
+	 * must exist until the packets are sent.
+	 *
+	 * @param packets -- the rtp packets, output parameter
+	 */
+	bool receive_rtp_packets(std::vector<RTPPacketIov>& packets);
+
+	/**
+	 * @brief get the nalus index of the data which is sent
+	 */
+	const AccessUnitIndex &get_access_unit_index() const
+	{
+		return this->m_au_index;
+	}
+
+	/**
+	 * @brief set the max rtp packet size, the udp payload size of the packets.
+	 * the nalus are fragmented and aggregated by the exact packet sizes, no packet
+	 * exceeds the size. the size may be changed at any time, it takes effect from
+	 * the next frame. it is clamped to RTP_H264_MIN_PACKET_SIZE and RTP_H264_MAX_PACKET_SIZE.
+	 *
+	 * @param packetSize -- the max rtp packet size, RTP_PACKET_SIZE by default
+	 */
+	void set_max_packet_size(int packetSize);
+
+	/**
+	 * @brief get the max rtp packet size
+	 */
+	int get_max_packet_size() const;
+
 	/**
 	 * @brief set the ssrc
 	 */
@@ -73,23 +119,46 @@ public:
 
 private:
 
+	/**
+	 * @brief grow the header arena for the headers of the nalus which are sent
+	 *
+	 * @param maxPayload -- the max rtp payload size
+	 */
+	void reserve_header_arena(int maxPayload);
+
+	/**
+	 * @brief allocate a header part from the header arena
+	 *
+	 * @param len -- the header part length
+	 * @return the header part
+	 */
+	uint8_t* alloc_header(int len);
+
+	/**
+	 * @brief write the rtp header and the extension header
+	 *
+	 * @param buffer -- the header part
+	 */
+	void write_rtp_header(uint8_t* buffer);
+
 	/**
 	 * @brief build the rtp FU-A packets
 	 *
 	 * @param data -- the data
 	 *        len -- the data length
-	 *        rtpvec-- the rtp data vector, output parameter
+	 *        fragmentSize -- the max fragment size of the nalu
+	 *        rtpvec-- the rtp packets, output parameter
 	 */
-	bool build_fua_packet(const uint8_t* data, int len, std::vector<std::pair<const uint8_t*, int> >& rtpvec);
+	bool build_fua_packet(const uint8_t* data, int len, int fragmentSize, std::vector<RTPPacketIov>& rtpvec);
 
 	/**
 	* @brief build the rtp packets
 	*
 	* @param vec -- the <data,length> vectors
-	*        rtpvec -- the rtp data vector, output parameter
+	*        rtpvec -- the rtp packets, output parameter
 	*/
 	bool build_packet(std::vector<std::pair<const uint8_t*, int> >& datavec,
-		std::vector<std::pair<const uint8_t*, int> >& rtpvec);
+		std::vector<RTPPacketIov>& rtpvec);
 
 private:
 	bool m_initialize;
@@ -100,16 +169,27 @@ private:
 	uint64_t m_ntp_timestamp;
 	bool m_marker;
 
-	//the NALUs vector. the NALU does not include the start code 00 00 00 01
-	//the pair consists of the nalu pointer and the nalu length
-	std::vector<std::pair<const uint8_t*, int> > m_nalu_vec;
+	//the NALUs index of the sent data. the NALU does not include the start code 00 00 00 01
+	AccessUnitIndex m_au_index;
+
+	//the header parts of the packets, the nalus aggregated by the STAP-A packets are copied to it
+	std::vector<uint8_t> m_header_arena;
+	//the header arena current position pointer
+	uint8_t* m_header_pos;
+
+	//the max rtp packet size
+	int m_max_packet_size;
+
+	//the nalus which are aggregated to the pending packet
+	std::vector<std::pair<const uint8_t*, int> > m_aggregate;
+
+	//the packets of receive_rtp_packets() which copies the packets
+	std::vector<RTPPacketIov> m_iov_packets;
 
 	//the rtp packets buffer
 	uint8_t* m_rtp_buffer;
 	//the rtp packets buffer end
 	const uint8_t* m_rtp_buffer_end;
-	//the rtp packets buffer current position pointer
-	uint8_t* m_current_pos;
 };
 
 #endif
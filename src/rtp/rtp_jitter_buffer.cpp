@@ -0,0 +1,278 @@
+#include "rtp_jitter_buffer.h"
+
+#include "common_logger.h"
+
+RTPJitterBuffer::RTPJitterBuffer()
+{
+	m_initialize = false;
+	m_pool = NULL;
+	m_clock_rate = RTP_JITTER_DEFAULT_CLOCK_RATE;
+	m_count = 0;
+	m_started = false;
+	m_next_sequence = 0;
+	m_highest_sequence = 0;
+	m_base_timestamp = 0;
+	m_last_transit = 0;
+	m_jitter = 0;
+	m_window_min_transit = 0;
+	m_prev_window_min_transit = 0;
+	m_window_start = 0;
+	m_min_delay = RTP_JITTER_MIN_DELAY_MS;
+	m_max_delay = RTP_JITTER_MAX_DELAY_MS;
+	m_delay = RTP_JITTER_MIN_DELAY_MS;
+	m_received = 0;
+	m_late_drops = 0;
+	m_duplicates = 0;
+	m_reorders = 0;
+	m_lost = 0;
+}
+
+RTPJitterBuffer::~RTPJitterBuffer()
+{
+	flush();
+}
+
+bool RTPJitterBuffer::init(RTPPacketPool *pool, uint32_t clockRate)
+{
+	if (m_initialize)
+	{
+		return true;
+	}
+
+	if (!pool || clockRate == 0)
+	{
+		return false;
+	}
+
+	m_pool = pool;
+	m_clock_rate = clockRate;
+	m_ring.assign(RTP_JITTER_RING_SIZE, (RTPPacketSlot *)NULL);
+	m_count = 0;
+	m_started = false;
+
+	m_initialize = true;
+	return true;
+}
+
+void RTPJitterBuffer::set_delay_range(int minDelayMs, int maxDelayMs)
+{
+	if (minDelayMs < 0 || maxDelayMs < minDelayMs)
+	{
+		return;
+	}
+
+	m_min_delay = minDelayMs;
+	m_max_delay = maxDelayMs;
+	if (m_delay < m_min_delay)
+	{
+		m_delay = m_min_delay;
+	}
+	else if (m_delay > m_max_delay)
+	{
+		m_delay = m_max_delay;
+	}
+}
+
+bool RTPJitterBuffer::push(RTPPacketSlot *slot, uint64_t arrivalUs, bool retransmitted)
+{
+	if (!m_initialize || !slot)
+	{
+		return false;
+	}
+
+	uint32_t sequence = slot->packet.get_sequence();
+	uint32_t timestamp = slot->packet.get_timestamp();
+	if (!m_started)
+	{
+		reset(sequence, timestamp);
+	}
+
+	//extend the 16 bits sequence around the next sequence, so the packets
+	//are ordered correctly when the sequence wraps around
+	uint32_t extended = m_next_sequence + (uint32_t)(int16_t)((uint16_t)sequence - (uint16_t)m_next_sequence);
+	int32_t distance = (int32_t)(extended - m_next_sequence);
+
+	if (distance >= RTP_JITTER_RING_SIZE || distance < -RTP_JITTER_RING_SIZE)
+	{
+		//the sequence jumps, the stream was restarted
+		LOG_WARNING("rtp sequence jumps from %u to %u, flush the jitter buffer", m_next_sequence, sequence);
+		flush();
+		reset(sequence, timestamp);
+		extended = m_next_sequence;
+	}
+	else if (distance < 0)
+	{
+		//the following packets were already released
+		m_late_drops++;
+		return false;
+	}
+
+	RTPPacketSlot *&entry = m_ring[extended & (RTP_JITTER_RING_SIZE - 1)];
+	if (entry)
+	{
+		m_duplicates++;
+		return false;
+	}
+
+	if ((int32_t)(extended - m_highest_sequence) < 0)
+	{
+		m_reorders++;
+	}
+	else
+	{
+		m_highest_sequence = extended;
+	}
+
+	entry = slot;
+	m_count++;
+	m_received++;
+
+	if (!retransmitted)
+	{
+		update_timing(timestamp, arrivalUs);
+	}
+	return true;
+}
+
+RTPPacketSlot *RTPJitterBuffer::pop(uint64_t nowUs)
+{
+	if (m_count == 0)
+	{
+		return NULL;
+	}
+
+	//the head packet, the missing sequences before it are lost if it is due
+	uint32_t sequence = m_next_sequence;
+	RTPPacketSlot **entry = &m_ring[sequence & (RTP_JITTER_RING_SIZE - 1)];
+	while (!*entry)
+	{
+		sequence++;
+		entry = &m_ring[sequence & (RTP_JITTER_RING_SIZE - 1)];
+	}
+
+	//the rtp timestamp is mapped to the local clock by the min transit time
+	int64_t transit = m_window_min_transit < m_prev_window_min_transit ? m_window_min_transit : m_prev_window_min_transit;
+	int64_t playout = transit + get_media_time((*entry)->packet.get_timestamp()) + (int64_t)m_delay * 1000;
+	if ((int64_t)nowUs < playout)
+	{
+		return NULL;
+	}
+
+	RTPPacketSlot *slot = *entry;
+	*entry = NULL;
+	m_count--;
+	m_lost += sequence - m_next_sequence;
+	m_next_sequence = sequence + 1;
+
+	return slot;
+}
+
+void RTPJitterBuffer::flush()
+{
+	if (m_count == 0)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < m_ring.size(); i++)
+	{
+		if (m_ring[i])
+		{
+			m_pool->release(m_ring[i]);
+			m_ring[i] = NULL;
+		}
+	}
+
+	m_count = 0;
+}
+
+void RTPJitterBuffer::get_stats(RTPJitterBufferStats &stats) const
+{
+	stats.depthPackets = m_count;
+	stats.depthMs = 0;
+	if (m_count > 0)
+	{
+		uint32_t sequence = m_next_sequence;
+		while (!m_ring[sequence & (RTP_JITTER_RING_SIZE - 1)])
+		{
+			sequence++;
+		}
+
+		uint32_t head = m_ring[sequence & (RTP_JITTER_RING_SIZE - 1)]->packet.get_timestamp();
+		RTPPacketSlot *tail = m_ring[m_highest_sequence & (RTP_JITTER_RING_SIZE - 1)];
+		if (tail)
+		{
+			stats.depthMs = (int)((get_media_time(tail->packet.get_timestamp()) - get_media_time(head)) / 1000);
+		}
+	}
+
+	stats.delayMs = m_delay;
+	stats.jitterMs = m_jitter / 1000;
+	stats.jitter = (uint32_t)(m_jitter * m_clock_rate / 1000000);
+	stats.received = m_received;
+	stats.lateDrops = m_late_drops;
+	stats.duplicates = m_duplicates;
+	stats.reorders = m_reorders;
+	stats.lost = m_lost;
+}
+
+int64_t RTPJitterBuffer::get_media_time(uint32_t timestamp) const
+{
+	return (int64_t)(int32_t)(timestamp - m_base_timestamp) * 1000000 / m_clock_rate;
+}
+
+void RTPJitterBuffer::update_timing(uint32_t timestamp, uint64_t arrivalUs)
+{
+	int64_t transit = (int64_t)arrivalUs - get_media_time(timestamp);
+
+	if (m_window_start == 0)
+	{
+		m_last_transit = transit;
+		m_window_min_transit = transit;
+		m_prev_window_min_transit = transit;
+		m_window_start = arrivalUs;
+		return;
+	}
+
+	//RFC 3550 A.8, J(i) = J(i-1) + (|D(i-1,i)| - J(i-1))/16
+	int64_t d = transit - m_last_transit;
+	if (d < 0)
+	{
+		d = -d;
+	}
+	m_jitter += ((double)d - m_jitter) / 16;
+	m_last_transit = transit;
+
+	//the min transit time of the last two windows, it follows the clock drift
+	if (transit < m_window_min_transit)
+	{
+		m_window_min_transit = transit;
+	}
+
+	if (arrivalUs - m_window_start >= (uint64_t)RTP_JITTER_TRANSIT_WINDOW_US)
+	{
+		m_prev_window_min_transit = m_window_min_transit;
+		m_window_min_transit = transit;
+		m_window_start = arrivalUs;
+	}
+
+	int delay = (int)(m_jitter * RTP_JITTER_DELAY_FACTOR / 1000);
+	if (delay < m_min_delay)
+	{
+		delay = m_min_delay;
+	}
+	else if (delay > m_max_delay)
+	{
+		delay = m_max_delay;
+	}
+	m_delay = delay;
+}
+
+void RTPJitterBuffer::reset(uint32_t sequence, uint32_t timestamp)
+{
+	m_started = true;
+	m_next_sequence = sequence;
+	m_highest_sequence = sequence;
+	m_base_timestamp = timestamp;
+	m_window_start = 0;
+}
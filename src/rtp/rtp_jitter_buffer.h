@@ -0,0 +1,198 @@
+#ifndef _H_RTP_JITTER_BUFFER_H_
+#define _H_RTP_JITTER_BUFFER_H_
+
+#include <vector>
+#include <stdint.h>
+
+#include "rtp_packet_pool.h"
+
+//the jitter buffer ring size, it must be a power of 2. it is the max sequence
+//distance between the packets held by the jitter buffer
+const int RTP_JITTER_RING_SIZE = 512;
+
+//the default rtp timestamp clock rate, the senders stamp the packets in milliseconds
+const uint32_t RTP_JITTER_DEFAULT_CLOCK_RATE = 1000;
+
+//the default min playout delay in milliseconds
+const int RTP_JITTER_MIN_DELAY_MS = 20;
+
+//the default max playout delay in milliseconds
+const int RTP_JITTER_MAX_DELAY_MS = 500;
+
+//the playout delay is the jitter multiplied by the factor
+const int RTP_JITTER_DELAY_FACTOR = 4;
+
+//the window in microseconds of the min transit time, which maps the rtp timestamp to the local clock
+const int64_t RTP_JITTER_TRANSIT_WINDOW_US = 10 * 1000 * 1000;
+
+//the jitter buffer statistics
+struct RTPJitterBufferStats
+{
+	//the packets count in the buffer
+	int depthPackets;
+	//the media duration in the buffer in milliseconds
+	int depthMs;
+	//the current playout delay in milliseconds
+	int delayMs;
+	//the interarrival jitter in milliseconds
+	double jitterMs;
+	//the interarrival jitter in timestamp units, RFC 3550 6.4.1
+	uint32_t jitter;
+	//the received packets count
+	uint64_t received;
+	//the packets dropped because they arrived after their playout time
+	uint64_t lateDrops;
+	//the duplicated packets count
+	uint64_t duplicates;
+	//the packets arrived out of order
+	uint64_t reorders;
+	//the lost packets skipped by the playout
+	uint64_t lost;
+
+	RTPJitterBufferStats()
+	{
+		depthPackets = 0;
+		depthMs = 0;
+		delayMs = 0;
+		jitterMs = 0;
+		jitter = 0;
+		received = 0;
+		lateDrops = 0;
+		duplicates = 0;
+		reorders = 0;
+		lost = 0;
+	}
+};
+
+/**
+ * the rtp jitter buffer. the packets are held in a sequence indexed ring and
+ * are released in the sequence order at their playout time. the playout time is
+ * the rtp timestamp mapped to the local clock plus the playout delay, the delay
+ * adapts to the interarrival jitter estimated as RFC 3550.
+ * the buffer holds the slots of the packet pool, the released and dropped slots
+ * are returned to the pool.
+ * NOTE: the jitter buffer is not thread safe.
+ */
+class RTPJitterBuffer
+{
+public:
+	RTPJitterBuffer();
+	virtual ~RTPJitterBuffer();
+
+	/**
+	 * @brief initialize the jitter buffer
+	 *
+	 * @param pool -- the packet pool which the slots belong to
+	 * @param clockRate -- the rtp timestamp clock rate
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool init(RTPPacketPool *pool, uint32_t clockRate);
+
+	/**
+	 * @brief set the playout delay range
+	 *
+	 * @param minDelayMs -- the min playout delay in milliseconds
+	 * @param maxDelayMs -- the max playout delay in milliseconds
+	 */
+	void set_delay_range(int minDelayMs, int maxDelayMs);
+
+	/**
+	 * @brief push the packet to the jitter buffer
+	 *
+	 * @param slot -- the slot which holds a parsed rtp packet
+	 * @param arrivalUs -- the arrival time of the packet, the monotonic time in microseconds
+	 * @param retransmitted -- whether the packet is a retransmission, its arrival time
+	 *        is not used for the jitter and the transit time
+	 *
+	 * @return true - the slot is owned by the jitter buffer
+	 * @return false - the packet was dropped, the slot is still owned by the caller
+	 */
+	bool push(RTPPacketSlot *slot, uint64_t arrivalUs, bool retransmitted);
+
+	/**
+	 * @brief pop the next packet whose playout time is reached.
+	 * the lost packets are skipped when the following packet is due.
+	 *
+	 * @param nowUs -- the monotonic time in microseconds
+	 *
+	 * @return the slot, the caller must release it to the pool. NULL if no packet is due
+	 */
+	RTPPacketSlot *pop(uint64_t nowUs);
+
+	/**
+	 * @brief release all the packets in the buffer to the pool
+	 */
+	void flush();
+
+	/**
+	 * @brief get the statistics
+	 *
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_stats(RTPJitterBufferStats &stats) const;
+
+private:
+	/**
+	 * @brief get the timestamp distance to the base timestamp in microseconds
+	 */
+	int64_t get_media_time(uint32_t timestamp) const;
+
+	/**
+	 * @brief update the jitter, the transit time and the playout delay by the arrival packet
+	 */
+	void update_timing(uint32_t timestamp, uint64_t arrivalUs);
+
+	/**
+	 * @brief reset the sequence and timing state, the stream was restarted
+	 */
+	void reset(uint32_t sequence, uint32_t timestamp);
+
+private:
+	bool m_initialize;
+
+	//the packet pool
+	RTPPacketPool *m_pool;
+	//the rtp timestamp clock rate
+	uint32_t m_clock_rate;
+
+	//the ring, indexed by the extended sequence
+	std::vector<RTPPacketSlot *> m_ring;
+	//the packets count in the ring
+	int m_count;
+	//whether the first packet was pushed
+	bool m_started;
+	//the extended sequence of the next packet to release
+	uint32_t m_next_sequence;
+	//the highest extended sequence received
+	uint32_t m_highest_sequence;
+
+	//the timestamp which the media time is relative to
+	uint32_t m_base_timestamp;
+	//the transit time of the previous packet in microseconds
+	int64_t m_last_transit;
+	//the interarrival jitter in microseconds
+	double m_jitter;
+	//the min transit time in the current window
+	int64_t m_window_min_transit;
+	//the min transit time in the previous window
+	int64_t m_prev_window_min_transit;
+	//the start time of the current window
+	uint64_t m_window_start;
+
+	//the playout delay range in milliseconds
+	int m_min_delay;
+	int m_max_delay;
+	//the current playout delay in milliseconds
+	int m_delay;
+
+	//the statistics counters
+	uint64_t m_received;
+	uint64_t m_late_drops;
+	uint64_t m_duplicates;
+	uint64_t m_reorders;
+	uint64_t m_lost;
+};
+
+#endif
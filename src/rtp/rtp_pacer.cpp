@@ -0,0 +1,498 @@
+#include "rtp_pacer.h"
+
+#include <new>
+#include <string.h>
+#ifdef _WIN32
+#include <functional>
+#include <chrono>
+#else
+#include <time.h>
+#endif
+
+#include "common_logger.h"
+#include "common_utils.h"
+
+static void *pacer_thread_func(void *ptr)
+{
+	RTPPacer *pacer = (RTPPacer *)ptr;
+	pacer->run();
+
+	return 0;
+}
+
+RTPPacer::RTPPacer()
+{
+	m_running = false;
+	m_started = false;
+
+	m_video_slab = NULL;
+	memset(m_video_queue, 0, sizeof(m_video_queue));
+	m_video_head = 0;
+	m_video_tail = 0;
+	m_video_bytes = 0;
+
+	m_audio_slab = NULL;
+	memset(m_audio_queue, 0, sizeof(m_audio_queue));
+	m_audio_head = 0;
+	m_audio_tail = 0;
+
+	m_target_bitrate = RTP_PACER_DEFAULT_BITRATE;
+	m_max_queue_delay_us = (uint64_t)RTP_PACER_DEFAULT_MAX_QUEUE_DELAY_MS * 1000;
+	m_budget = 0;
+	m_refill_time = 0;
+	m_sending = false;
+
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_queue_delay_total = 0;
+
+#ifdef _WIN32
+#else
+	pthread_mutex_init(&m_mutex, NULL);
+
+	//the timed waits use the monotonic clock
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&m_condi, &attr);
+	pthread_cond_init(&m_sent_condi, &attr);
+	pthread_condattr_destroy(&attr);
+#endif
+}
+
+RTPPacer::~RTPPacer()
+{
+	stop();
+
+	if (m_video_slab)
+	{
+		delete[] m_video_slab;
+		m_video_slab = NULL;
+	}
+
+	if (m_audio_slab)
+	{
+		delete[] m_audio_slab;
+		m_audio_slab = NULL;
+	}
+
+#ifdef _WIN32
+#else
+	pthread_mutex_destroy(&m_mutex);
+	pthread_cond_destroy(&m_condi);
+	pthread_cond_destroy(&m_sent_condi);
+#endif
+}
+
+bool RTPPacer::start(uint32_t targetBitrate)
+{
+	if (m_started)
+	{
+		return true;
+	}
+
+	if (!m_video_slab)
+	{
+		m_video_slab = new (std::nothrow) uint8_t[(size_t)RTP_PACER_VIDEO_QUEUE_SIZE * RTP_PACER_SLOT_SIZE];
+	}
+	if (!m_audio_slab)
+	{
+		m_audio_slab = new (std::nothrow) uint8_t[(size_t)RTP_PACER_AUDIO_QUEUE_SIZE * RTP_PACER_SLOT_SIZE];
+	}
+	if (!m_video_slab || !m_audio_slab)
+	{
+		LOG_ERROR("RTPPacer::start(), out of memory");
+		return false;
+	}
+
+	m_batch.reserve(RTP_PACER_MAX_BATCH + RTP_PACER_AUDIO_QUEUE_SIZE);
+	m_batch_transmitters.reserve(RTP_PACER_MAX_BATCH + RTP_PACER_AUDIO_QUEUE_SIZE);
+	m_send_packets.reserve(RTP_PACER_MAX_BATCH + RTP_PACER_AUDIO_QUEUE_SIZE);
+
+	set_target_bitrate(targetBitrate);
+	m_refill_time = get_monotonic_time_us();
+	m_budget = 0;
+
+	m_running = true;
+#ifdef _WIN32
+	m_thread = std::thread(std::bind(&RTPPacer::run, this));
+#else
+	int ret = pthread_create(&m_thread, NULL, pacer_thread_func, this);
+	if (ret != 0)
+	{
+		LOG_ERROR("Start pacer thread error.");
+		m_running = false;
+		return false;
+	}
+#endif
+
+	m_started = true;
+	return true;
+}
+
+void RTPPacer::stop()
+{
+	if (!m_started)
+	{
+		return;
+	}
+
+	lock();
+	m_running = false;
+#ifdef _WIN32
+	m_condi.notify_all();
+#else
+	pthread_cond_broadcast(&m_condi);
+#endif
+	unlock();
+
+#ifdef _WIN32
+	m_thread.join();
+#else
+	pthread_join(m_thread, NULL);
+#endif
+
+	m_video_head = m_video_tail = 0;
+	m_audio_head = m_audio_tail = 0;
+	m_video_bytes = 0;
+	m_started = false;
+}
+
+void RTPPacer::set_target_bitrate(uint32_t targetBitrate)
+{
+	lock();
+	m_target_bitrate = targetBitrate > 0 ? targetBitrate : RTP_PACER_DEFAULT_BITRATE;
+	unlock();
+}
+
+void RTPPacer::set_max_queue_delay_ms(int delayMs)
+{
+	lock();
+	m_max_queue_delay_us = (uint64_t)(delayMs > 1 ? delayMs : 1) * 1000;
+	unlock();
+}
+
+bool RTPPacer::enqueue_video(RTPTransmitterV4 *transmitter, const std::vector<RTPPacketIov> &packets)
+{
+	if (!m_running || packets.empty())
+	{
+		return false;
+	}
+
+	bool ret = false;
+	uint64_t now = get_monotonic_time_us();
+
+	lock();
+	if (m_video_tail - m_video_head + packets.size() > (uint32_t)RTP_PACER_VIDEO_QUEUE_SIZE)
+	{
+		m_stats.overflows += packets.size();
+		goto exitFlag;
+	}
+
+	size_t i;
+	for (i = 0; i < packets.size(); i++)
+	{
+		if (packets[i].get_length() > RTP_PACER_SLOT_SIZE)
+		{
+			goto exitFlag;
+		}
+	}
+
+	for (i = 0; i < packets.size(); i++)
+	{
+		uint32_t index = (m_video_tail + (uint32_t)i) & (RTP_PACER_VIDEO_QUEUE_SIZE - 1);
+		uint8_t *slot = m_video_slab + (size_t)index * RTP_PACER_SLOT_SIZE;
+		memcpy(slot, packets[i].header, packets[i].headerLen);
+		if (packets[i].payloadLen > 0)
+		{
+			memcpy(slot + packets[i].headerLen, packets[i].payload, packets[i].payloadLen);
+		}
+		m_video_queue[index].transmitter = transmitter;
+		m_video_queue[index].length = packets[i].get_length();
+		m_video_queue[index].enqueueTime = now;
+		m_video_bytes += packets[i].get_length();
+	}
+	m_video_tail += (uint32_t)packets.size();
+	ret = true;
+
+#ifdef _WIN32
+	m_condi.notify_one();
+#else
+	pthread_cond_signal(&m_condi);
+#endif
+
+exitFlag:
+	unlock();
+	return ret;
+}
+
+bool RTPPacer::enqueue_audio(RTPTransmitterV4 *transmitter, const uint8_t *data, int len)
+{
+	if (!m_running || len > RTP_PACER_SLOT_SIZE)
+	{
+		return false;
+	}
+
+	bool ret = false;
+
+	lock();
+	if (m_audio_tail - m_audio_head < (uint32_t)RTP_PACER_AUDIO_QUEUE_SIZE)
+	{
+		uint32_t index = m_audio_tail & (RTP_PACER_AUDIO_QUEUE_SIZE - 1);
+		memcpy(m_audio_slab + (size_t)index * RTP_PACER_SLOT_SIZE, data, len);
+		m_audio_queue[index].transmitter = transmitter;
+		m_audio_queue[index].length = len;
+		m_audio_queue[index].enqueueTime = get_monotonic_time_us();
+		m_audio_tail++;
+		ret = true;
+
+#ifdef _WIN32
+		m_condi.notify_one();
+#else
+		pthread_cond_signal(&m_condi);
+#endif
+	}
+	else
+	{
+		m_stats.overflows++;
+	}
+	unlock();
+
+	return ret;
+}
+
+void RTPPacer::remove_transmitter(RTPTransmitterV4 *transmitter)
+{
+	uint32_t i;
+
+	lock();
+	for (i = m_video_head; i != m_video_tail; i++)
+	{
+		QueueEntry &entry = m_video_queue[i & (RTP_PACER_VIDEO_QUEUE_SIZE - 1)];
+		if (entry.transmitter == transmitter)
+		{
+			entry.transmitter = NULL;
+		}
+	}
+
+	for (i = m_audio_head; i != m_audio_tail; i++)
+	{
+		QueueEntry &entry = m_audio_queue[i & (RTP_PACER_AUDIO_QUEUE_SIZE - 1)];
+		if (entry.transmitter == transmitter)
+		{
+			entry.transmitter = NULL;
+		}
+	}
+
+	//the batch being sent may use the transmitter
+	while (m_sending)
+	{
+#ifdef _WIN32
+		std::unique_lock<std::mutex> lk(m_mutex, std::adopt_lock);
+		m_sent_condi.wait(lk);
+		lk.release();
+#else
+		pthread_cond_wait(&m_sent_condi, &m_mutex);
+#endif
+	}
+	unlock();
+}
+
+void RTPPacer::get_stats(RTPPacerStats &stats)
+{
+	lock();
+	stats = m_stats;
+	stats.avgQueueDelayUs = m_stats.videoPackets > 0 ? (double)m_queue_delay_total / m_stats.videoPackets : 0;
+	stats.queuedPackets = (int)(m_video_tail - m_video_head);
+	unlock();
+}
+
+void RTPPacer::refill(uint64_t nowUs)
+{
+	//the pacing rate drains the queue before its oldest packet exceeds the max queue delay
+	double rate = (double)m_target_bitrate * RTP_PACER_FACTOR_PERCENT / 100 / 8 / 1000000;
+	if (m_video_head != m_video_tail)
+	{
+		uint64_t age = nowUs - m_video_queue[m_video_head & (RTP_PACER_VIDEO_QUEUE_SIZE - 1)].enqueueTime;
+		uint64_t remaining = age + 1000 < m_max_queue_delay_us ? m_max_queue_delay_us - age : 1000;
+		double drainRate = (double)m_video_bytes / remaining;
+		if (drainRate > rate)
+		{
+			rate = drainRate;
+		}
+	}
+
+	m_budget += rate * (double)(nowUs - m_refill_time);
+	m_refill_time = nowUs;
+
+	double burst = rate * RTP_PACER_BURST_US;
+	if (burst < RTP_PACER_SLOT_SIZE)
+	{
+		burst = RTP_PACER_SLOT_SIZE;
+	}
+	if (m_budget > burst)
+	{
+		m_budget = burst;
+	}
+}
+
+uint64_t RTPPacer::next_send_wait(uint64_t nowUs)
+{
+	double rate = (double)m_target_bitrate * RTP_PACER_FACTOR_PERCENT / 100 / 8 / 1000000;
+	uint64_t wait = (uint64_t)(-m_budget / rate) + 1;
+
+	//the drain rate may be higher, the bucket is refilled again after the wait
+	uint64_t age = nowUs - m_video_queue[m_video_head & (RTP_PACER_VIDEO_QUEUE_SIZE - 1)].enqueueTime;
+	uint64_t remaining = age + 1000 < m_max_queue_delay_us ? m_max_queue_delay_us - age : 1000;
+	uint64_t drainWait = (uint64_t)(-m_budget * remaining / m_video_bytes) + 1;
+
+	return wait < drainWait ? wait : drainWait;
+}
+
+void RTPPacer::run()
+{
+	lock();
+	while (m_running)
+	{
+		uint64_t now = get_monotonic_time_us();
+		refill(now);
+
+		m_batch.clear();
+		m_batch_transmitters.clear();
+
+		//the audio packets are never held by the budget
+		uint32_t audioEnd = m_audio_tail;
+		for (uint32_t i = m_audio_head; i != audioEnd; i++)
+		{
+			uint32_t index = i & (RTP_PACER_AUDIO_QUEUE_SIZE - 1);
+			QueueEntry &entry = m_audio_queue[index];
+			if (entry.transmitter)
+			{
+				m_batch.push_back(std::make_pair((const uint8_t *)m_audio_slab + (size_t)index * RTP_PACER_SLOT_SIZE, entry.length));
+				m_batch_transmitters.push_back(entry.transmitter);
+				m_budget -= entry.length;
+				m_stats.audioPackets++;
+				m_stats.bytes += entry.length;
+			}
+		}
+
+		uint32_t videoEnd = m_video_head;
+		int videoCount = 0;
+		while (videoEnd != m_video_tail && m_budget >= 0 && videoCount < RTP_PACER_MAX_BATCH)
+		{
+			uint32_t index = videoEnd & (RTP_PACER_VIDEO_QUEUE_SIZE - 1);
+			QueueEntry &entry = m_video_queue[index];
+			if (entry.transmitter)
+			{
+				m_batch.push_back(std::make_pair((const uint8_t *)m_video_slab + (size_t)index * RTP_PACER_SLOT_SIZE, entry.length));
+				m_batch_transmitters.push_back(entry.transmitter);
+				m_budget -= entry.length;
+				videoCount++;
+
+				uint64_t delay = now - entry.enqueueTime;
+				m_queue_delay_total += delay;
+				if (delay > m_stats.maxQueueDelayUs)
+				{
+					m_stats.maxQueueDelayUs = delay;
+				}
+				m_stats.videoPackets++;
+				m_stats.bytes += entry.length;
+			}
+			videoEnd++;
+		}
+
+		if (!m_batch.empty())
+		{
+			//the queue slots of the batch are not reused until they are popped
+			m_sending = true;
+			unlock();
+			send_batch(m_batch_transmitters);
+			lock();
+			m_sending = false;
+#ifdef _WIN32
+			m_sent_condi.notify_all();
+#else
+			pthread_cond_broadcast(&m_sent_condi);
+#endif
+		}
+
+		for (uint32_t i = m_video_head; i != videoEnd; i++)
+		{
+			m_video_bytes -= m_video_queue[i & (RTP_PACER_VIDEO_QUEUE_SIZE - 1)].length;
+		}
+		m_video_head = videoEnd;
+		m_audio_head = audioEnd;
+
+		if (m_audio_head != m_audio_tail || !m_running)
+		{
+			continue;
+		}
+
+		if (m_video_head == m_video_tail)
+		{
+			//the budget accumulated while the queue is empty is capped by the bucket depth
+#ifdef _WIN32
+			std::unique_lock<std::mutex> lk(m_mutex, std::adopt_lock);
+			m_condi.wait(lk);
+			lk.release();
+#else
+			pthread_cond_wait(&m_condi, &m_mutex);
+#endif
+		}
+		else if (m_budget < 0)
+		{
+			uint64_t wait = next_send_wait(get_monotonic_time_us());
+#ifdef _WIN32
+			std::unique_lock<std::mutex> lk(m_mutex, std::adopt_lock);
+			m_condi.wait_for(lk, std::chrono::microseconds(wait));
+			lk.release();
+#else
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			uint64_t ns = (uint64_t)ts.tv_nsec + wait * 1000;
+			ts.tv_sec += (time_t)(ns / 1000000000);
+			ts.tv_nsec = (long)(ns % 1000000000);
+			pthread_cond_timedwait(&m_condi, &m_mutex, &ts);
+#endif
+		}
+	}
+	unlock();
+}
+
+void RTPPacer::send_batch(const std::vector<RTPTransmitterV4 *> &transmitters)
+{
+	size_t begin = 0;
+	while (begin < m_batch.size())
+	{
+		size_t end = begin + 1;
+		while (end < m_batch.size() && transmitters[end] == transmitters[begin])
+		{
+			end++;
+		}
+
+		m_send_packets.assign(m_batch.begin() + begin, m_batch.begin() + end);
+		if (!transmitters[begin]->send_packets(m_send_packets))
+		{
+			LOG_WARNING("the paced rtp packets send failed");
+		}
+
+		begin = end;
+	}
+}
+
+void RTPPacer::lock()
+{
+#ifdef _WIN32
+	m_mutex.lock();
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+}
+
+void RTPPacer::unlock()
+{
+#ifdef _WIN32
+	m_mutex.unlock();
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+}
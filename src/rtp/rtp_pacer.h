@@ -0,0 +1,234 @@
+#ifndef _H_RTP_PACER_H_
+#define _H_RTP_PACER_H_
+
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#else
+#include <pthread.h>
+#endif
+
+#include "rtp_transmitter_v4.h"
+
+//the video queue size, it must be a power of 2
+const int RTP_PACER_VIDEO_QUEUE_SIZE = 1024;
+
+//the audio queue size, it must be a power of 2
+const int RTP_PACER_AUDIO_QUEUE_SIZE = 64;
+
+//the max packet size in the queues
+const int RTP_PACER_SLOT_SIZE = 1500;
+
+//the default target bitrate in bits per second
+const uint32_t RTP_PACER_DEFAULT_BITRATE = 2000000;
+
+//the pacing rate to the target bitrate in percent, the frames larger than the average are drained faster
+const int RTP_PACER_FACTOR_PERCENT = 250;
+
+//the default max queue delay in milliseconds, it is the frame interval of 30 fps.
+//the pacing rate is raised so the queued packets are sent within the delay
+const int RTP_PACER_DEFAULT_MAX_QUEUE_DELAY_MS = 33;
+
+//the token bucket depth in microseconds of the pacing rate
+const int RTP_PACER_BURST_US = 2000;
+
+//the max packets sent by one send call
+const int RTP_PACER_MAX_BATCH = 16;
+
+/**
+ * the pacer statistics
+ */
+struct RTPPacerStats
+{
+	//the sent video packets
+	uint64_t videoPackets;
+	//the sent audio packets
+	uint64_t audioPackets;
+	//the sent bytes
+	uint64_t bytes;
+	//the packets which were sent directly because the queue was full
+	uint64_t overflows;
+	//the average and the max queue delay of the video packets in microseconds
+	double avgQueueDelayUs;
+	uint64_t maxQueueDelayUs;
+	//the video packets in the queue
+	int queuedPackets;
+};
+
+/**
+ * the send pacer. the video packets are queued and released by a token bucket
+ * on the pacer thread, so a keyframe is spread over the frame interval instead
+ * of a line rate burst. the audio packets have a priority lane, they are sent
+ * before any queued video packet as soon as they are enqueued.
+ * the packets are copied into the preallocated queue slabs.
+ */
+class RTPPacer
+{
+public:
+	RTPPacer();
+	virtual ~RTPPacer();
+
+	/**
+	 * @brief start the pacer thread
+	 *
+	 * @param targetBitrate -- the target bitrate in bits per second
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool start(uint32_t targetBitrate);
+
+	/**
+	 * @brief stop the pacer thread, the queued packets are dropped
+	 */
+	void stop();
+
+	/**
+	 * @brief whether the pacer thread is running
+	 */
+	bool is_running() const { return m_running; }
+
+	/**
+	 * @brief set the target bitrate
+	 *
+	 * @param targetBitrate -- the target bitrate in bits per second
+	 */
+	void set_target_bitrate(uint32_t targetBitrate);
+
+	/**
+	 * @brief set the max queue delay
+	 *
+	 * @param delayMs -- the max queue delay in milliseconds
+	 */
+	void set_max_queue_delay_ms(int delayMs);
+
+	/**
+	 * @brief queue the rtp packets of a video frame
+	 *
+	 * @param transmitter -- the transmitter which sends the packets
+	 * @param packets -- the rtp packets, they are copied
+	 *
+	 * @return true - the packets were queued
+	 * @return false - the pacer is not running or the queue is full, the caller sends the packets
+	 */
+	bool enqueue_video(RTPTransmitterV4 *transmitter, const std::vector<RTPPacketIov> &packets);
+
+	/**
+	 * @brief queue an audio rtp packet to the priority lane
+	 *
+	 * @param transmitter -- the transmitter which sends the packet
+	 * @param data -- the rtp packet, it is copied
+	 * @param len -- the rtp packet length
+	 *
+	 * @return true - the packet was queued
+	 * @return false - the pacer is not running or the queue is full, the caller sends the packet
+	 */
+	bool enqueue_audio(RTPTransmitterV4 *transmitter, const uint8_t *data, int len);
+
+	/**
+	 * @brief drop the queued packets of the transmitter. when it returns, the pacer
+	 * thread does not use the transmitter any more, so it can be deleted.
+	 *
+	 * @param transmitter -- the transmitter
+	 */
+	void remove_transmitter(RTPTransmitterV4 *transmitter);
+
+	/**
+	 * @brief get the statistics
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_stats(RTPPacerStats &stats);
+
+	/**
+	 * @brief the pacer thread loop
+	 */
+	void run();
+
+private:
+	struct QueueEntry
+	{
+		//the transmitter, NULL if the packet was dropped
+		RTPTransmitterV4 *transmitter;
+		//the packet length
+		int length;
+		//the enqueue time, the monotonic time in microseconds
+		uint64_t enqueueTime;
+	};
+
+	//refill the token bucket, it must be called with the lock held
+	void refill(uint64_t nowUs);
+
+	//the time in microseconds until the next video packet can be sent, it must be called with the lock held
+	uint64_t next_send_wait(uint64_t nowUs);
+
+	//send the packets of the batch, grouped by the transmitter
+	void send_batch(const std::vector<RTPTransmitterV4 *> &transmitters);
+
+	void lock();
+	void unlock();
+
+private:
+	//whether the pacer thread is running
+	std::atomic<bool> m_running;
+	//whether the pacer thread was started
+	bool m_started;
+
+	//the video queue
+	uint8_t *m_video_slab;
+	QueueEntry m_video_queue[RTP_PACER_VIDEO_QUEUE_SIZE];
+	uint32_t m_video_head;
+	uint32_t m_video_tail;
+	//the queued video bytes
+	uint64_t m_video_bytes;
+
+	//the audio queue
+	uint8_t *m_audio_slab;
+	QueueEntry m_audio_queue[RTP_PACER_AUDIO_QUEUE_SIZE];
+	uint32_t m_audio_head;
+	uint32_t m_audio_tail;
+
+	//the target bitrate in bits per second
+	uint32_t m_target_bitrate;
+	//the max queue delay in microseconds
+	uint64_t m_max_queue_delay_us;
+
+	//the token bucket in bytes, it may be negative after a packet larger than the remaining tokens
+	double m_budget;
+	//the last refill time
+	uint64_t m_refill_time;
+
+	//whether the pacer thread is sending a batch without the lock
+	bool m_sending;
+
+	//the batch being sent, it points to the queue slabs
+	std::vector<std::pair<const uint8_t *, int>> m_batch;
+	std::vector<RTPTransmitterV4 *> m_batch_transmitters;
+	//the packets which are sent together by one transmitter
+	std::vector<std::pair<const uint8_t *, int>> m_send_packets;
+
+	//the statistics
+	RTPPacerStats m_stats;
+	uint64_t m_queue_delay_total;
+
+#ifdef _WIN32
+	std::thread m_thread;
+	std::mutex m_mutex;
+	//signaled when the packets are queued
+	std::condition_variable m_condi;
+	//signaled when a batch was sent
+	std::condition_variable m_sent_condi;
+#else
+	pthread_t m_thread;
+	pthread_mutex_t m_mutex;
+	//signaled when the packets are queued
+	pthread_cond_t m_condi;
+	//signaled when a batch was sent
+	pthread_cond_t m_sent_condi;
+#endif
+};
+
+#endif
@@ -11,210 +11,227 @@
 #include <sys/socket.h>
 #endif
 
-#include "common_logger.h"
+#include <atomic>
 
-RTPPacket::RTPPacket()
-{
-    reset();
-}
+//the parse errors of all the sessions
+static std::atomic<uint64_t> s_parse_errors[RTP_PARSE_ERROR_COUNT];
 
-RTPPacket::~RTPPacket()
+RTPPacketView::RTPPacketView()
 {
+	reset();
 }
 
-bool RTPPacket::parse(uint8_t *buffer, size_t bufferLen)
+bool RTPPacketView::parse(uint8_t *buffer, size_t bufferLen)
 {
-    if (bufferLen <= sizeof(RTPHeader))
-    {
-        LOG_ERROR("buffer size is less than RTPHeader length");
-        return false;
-    }
-
-    this->m_packet = buffer;
-	this->m_packet_len = bufferLen;
-
-    RTPHeader *rtpHeader = (RTPHeader *)buffer;
-    if (rtpHeader->version != 2)
-    {
-        LOG_ERROR("RTP Header version error");
-        return false;
-    }
-
-    this->m_padding = (rtpHeader->padding != 0);
-    this->m_extension = (rtpHeader->extension != 0);
-    this->m_csrc_count = rtpHeader->csrcCount;
-    this->m_marker = (rtpHeader->marker != 0);
-    this->m_payload_type = rtpHeader->payloadType;
-    this->m_sequence = ntohs(rtpHeader->sequence);
-    this->m_timestamp = ntohl(rtpHeader->timestamp);
-    this->m_ssrc = ntohl(rtpHeader->ssrc);
-
-    uint32_t paddingBytes = 0;
-    if (rtpHeader->padding)
-    {
+	if (bufferLen < sizeof(RTPHeader))
+	{
+		count_parse_error(RTP_PARSE_TOO_SHORT);
+		return false;
+	}
+
+	uint8_t first = buffer[0];
+	if ((first & 0xC0) != 0x80)
+	{
+		count_parse_error(RTP_PARSE_BAD_VERSION);
+		return false;
+	}
+
+	size_t offset = sizeof(RTPHeader) + (first & 0x0F) * 4;
+	if (offset > bufferLen)
+	{
+		count_parse_error(RTP_PARSE_BAD_CSRC);
+		return false;
+	}
+
+	//the extension header follows the csrc list, its length is in 32-bit words
+	uint32_t extensionOffset = 0;
+	if (first & 0x10)
+	{
+		if (offset + 4 > bufferLen)
+		{
+			count_parse_error(RTP_PARSE_BAD_EXTENSION);
+			return false;
+		}
+
+		extensionOffset = (uint32_t)offset;
+		offset += 4 + read_uint16(buffer + offset + 2) * 4;
+		if (offset > bufferLen)
+		{
+			count_parse_error(RTP_PARSE_BAD_EXTENSION);
+			return false;
+		}
+	}
+
+	size_t paddingBytes = 0;
+	if (first & 0x20)
+	{
 		paddingBytes = buffer[bufferLen - 1];
-        if (paddingBytes == 0)
-        {
-            LOG_ERROR("padding length error");
-            return false;
-        }
-    }
-
-    RTPExtensionHeader *rtpExtHeader = NULL;
-    if (this->m_extension)
-    {
-        rtpExtHeader = (RTPExtensionHeader *)(buffer + sizeof(RTPHeader) + (this->m_csrc_count * 4));
-        this->m_extension_id = ntohs(rtpExtHeader->id);
-        this->m_extension_len = ntohs(rtpExtHeader->length);
-
-		if (this->m_extension_len != 3)
+		if (paddingBytes == 0 || offset + paddingBytes > bufferLen)
 		{
-			LOG_ERROR("extension length error");
+			count_parse_error(RTP_PARSE_BAD_PADDING);
 			return false;
 		}
+	}
 
-        uint32_t high32 = ntohs(rtpExtHeader->seqHigh16);
-		this->m_sequence = (high32 << 16) | this->m_sequence;
-		this->m_reserved = ntohs(rtpExtHeader->reserved);
-		this->m_msw = ntohl(rtpExtHeader->msw);
-		this->m_lsw = ntohl(rtpExtHeader->lsw);
-    }
-    else
-    {
-		LOG_ERROR("no extension error");
-		return false;
-    }
+	m_packet = buffer;
+	m_packet_len = bufferLen;
+	m_extension_offset = extensionOffset;
+	m_payload_offset = (uint32_t)offset;
+	m_payload_len = bufferLen - offset - paddingBytes;
 
-    this->m_payload_len = bufferLen - paddingBytes - sizeof(RTPHeader) - (this->m_csrc_count * 4) - sizeof(RTPExtensionHeader);
-    if (this->m_payload_len < 0)
-    {
-        LOG_ERROR("payload length error");
-        return false;
-    }
+	return true;
+}
 
-    this->m_payload = buffer + sizeof(RTPHeader) + (this->m_csrc_count * 4) + sizeof(RTPExtensionHeader);
+void RTPPacketView::reset()
+{
+	m_packet = NULL;
+	m_packet_len = 0;
+	m_extension_offset = 0;
+	m_payload_offset = 0;
+	m_payload_len = 0;
+}
 
-    return true;
+void RTPPacketView::count_parse_error(int error)
+{
+	s_parse_errors[error].fetch_add(1, std::memory_order_relaxed);
+}
+
+void RTPPacketView::get_parse_errors(uint64_t errors[RTP_PARSE_ERROR_COUNT])
+{
+	for (int i = 0; i < RTP_PARSE_ERROR_COUNT; i++)
+	{
+		errors[i] = s_parse_errors[i].load(std::memory_order_relaxed);
+	}
+}
+
+/*****************************************************************/
+/*****************************************************************/
+
+RTPPacket::RTPPacket()
+{
+	reset();
+}
+
+RTPPacket::~RTPPacket()
+{
+}
+
+bool RTPPacket::parse(uint8_t *buffer, size_t bufferLen)
+{
+	if (!m_view.parse(buffer, bufferLen))
+	{
+		return false;
+	}
+
+	//the sequence high 16 bits and the ntp timestamp are in the extension
+	if (m_view.get_extension_length() != 3)
+	{
+		RTPPacketView::count_parse_error(m_view.has_extension() ? RTP_PARSE_BAD_EXTENSION : RTP_PARSE_NO_EXTENSION);
+		m_view.reset();
+		return false;
+	}
+
+	return true;
 }
 
 bool RTPPacket::has_padding() const
 {
-    return this->m_padding;
+	return m_view.has_padding();
 }
 
 bool RTPPacket::has_extension() const
 {
-    return this->m_extension;
+	return m_view.has_extension();
 }
 
 uint8_t RTPPacket::get_csrc_count() const
 {
-    return this->m_csrc_count;
+	return m_view.get_csrc_count();
 }
 
 bool RTPPacket::has_marker() const
 {
-    return this->m_marker;
+	return m_view.has_marker();
 }
 
 uint8_t RTPPacket::get_payload_type() const
 {
-    return this->m_payload_type;
+	return m_view.get_payload_type();
 }
 
 uint32_t RTPPacket::get_sequence() const
 {
-    return this->m_sequence;
+	uint32_t high16 = RTPPacketView::read_uint16(m_view.get_extension_data() + 2);
+	return (high16 << 16) | m_view.get_sequence();
 }
 
 uint32_t RTPPacket::get_timestamp() const
 {
-    return this->m_timestamp;
+	return m_view.get_timestamp();
 }
 
 uint32_t RTPPacket::get_ssrc() const
 {
-    return this->m_ssrc;
+	return m_view.get_ssrc();
 }
 
 void RTPPacket::set_ssrc(uint32_t newSsrc)
 {
-    RTPHeader *rtpHeader = (RTPHeader *)this->m_packet;
-    rtpHeader->ssrc = htonl(newSsrc);
+	RTPHeader *rtpHeader = (RTPHeader *)m_view.get_packet();
+	rtpHeader->ssrc = htonl(newSsrc);
 }
 
 uint32_t RTPPacket::get_csrc(int index) const
 {
-    if (index >= this->m_csrc_count)
-    {
-        return 0;
-    }
-
-    uint32_t *csrcval = (uint32_t *)(this->m_packet + sizeof(RTPHeader) + index * 4);
-    return ntohl(*csrcval);
+	return m_view.get_csrc(index);
 }
 
 uint8_t *RTPPacket::get_payload() const
 {
-    return this->m_payload;
+	return m_view.get_payload();
 }
 
 size_t RTPPacket::get_payload_length() const
 {
-    return this->m_payload_len;
+	return m_view.get_payload_length();
 }
 
 uint8_t * RTPPacket::get_packet() const
 {
-	return this->m_packet;
+	return m_view.get_packet();
 }
+
 size_t RTPPacket::get_packet_length() const
 {
-	return this->m_packet_len;
+	return m_view.get_packet_length();
 }
 
 uint16_t RTPPacket::get_extension_id() const
 {
-    return this->m_extension_id;
+	return m_view.get_extension_id();
 }
 
 uint16_t RTPPacket::get_extension_length() const
 {
-    return this->m_extension_len;
+	return m_view.get_extension_length();
 }
 
 uint16_t RTPPacket::get_reserved() const
 {
-	return this->m_reserved;
+	return RTPPacketView::read_uint16(m_view.get_extension_data());
 }
 
 uint32_t RTPPacket::get_msw() const
 {
-	return this->m_msw;
+	return RTPPacketView::read_uint32(m_view.get_extension_data() + 4);
 }
 
 uint32_t RTPPacket::get_lsw() const
 {
-	return this->m_lsw;
+	return RTPPacketView::read_uint32(m_view.get_extension_data() + 8);
 }
 
 void RTPPacket::reset()
 {
-    m_padding = false;
-    m_csrc_count = 0;
-    m_marker = false;
-    m_extension = false;
-    m_payload_type = 0;
-    m_sequence = 0;
-    m_timestamp = 0;
-    m_ssrc = 0;
-    m_payload_len = 0;
-    m_payload = NULL;
-    m_packet = NULL;
-	m_packet_len = 0;
-    m_extension_id = 0;
-    m_extension_len = 0;
-	m_reserved = 0;
-	m_msw = 0;
-	m_lsw = 0;
-}
\ No newline at end of file
+	m_view.reset();
+}
@@ -75,7 +75,124 @@ struct RTPExtensionHeader
 };
 
 /**
- * @brief the RTP packet
+ * the rtp packet in two parts for the scatter/gather io, the header part holds the
+ * rtp header and the payload header, the payload part points to the media data.
+ * the parts are sent by one datagram without copying them together.
+ */
+struct RTPPacketIov
+{
+	//the header part
+	const uint8_t *header;
+	//the header part length
+	int headerLen;
+	//the payload part, NULL if the whole packet is in the header part
+	const uint8_t *payload;
+	//the payload part length
+	int payloadLen;
+
+	int get_length() const
+	{
+		return headerLen + payloadLen;
+	}
+};
+
+//the rtp parse errors
+enum RTPParseError
+{
+	//the packet is shorter than the rtp header
+	RTP_PARSE_TOO_SHORT = 0,
+	//the version is not 2
+	RTP_PARSE_BAD_VERSION,
+	//the csrc list exceeds the packet
+	RTP_PARSE_BAD_CSRC,
+	//the header extension exceeds the packet
+	RTP_PARSE_BAD_EXTENSION,
+	//the padding length is 0 or exceeds the payload
+	RTP_PARSE_BAD_PADDING,
+	//the packet has no RTPExtensionHeader
+	RTP_PARSE_NO_EXTENSION,
+	RTP_PARSE_ERROR_COUNT
+};
+
+/**
+ * @brief the zero-copy view of an RTP packet. parse() only validates the offsets,
+ * the header fields are decoded from the buffer when they are read.
+ * the parse errors are counted, they are not logged.
+ * NOTE: the getters are valid after parse() succeeded, the buffer must outlive the view
+ */
+class RTPPacketView
+{
+public:
+	RTPPacketView();
+
+	/**
+	 * @brief validate the packet, the csrc list, the header extension and the padding
+	 * @param buffer -- the packet
+	 * @param bufferLen -- the packet length
+	 * @return true - successful, false - the packet is malformed, the error is counted
+	 */
+	bool parse(uint8_t *buffer, size_t bufferLen);
+
+	bool has_padding() const { return (m_packet[0] & 0x20) != 0; }
+	bool has_extension() const { return (m_packet[0] & 0x10) != 0; }
+	uint8_t get_csrc_count() const { return m_packet[0] & 0x0F; }
+	bool has_marker() const { return (m_packet[1] & 0x80) != 0; }
+	uint8_t get_payload_type() const { return m_packet[1] & 0x7F; }
+	uint16_t get_sequence() const { return read_uint16(m_packet + 2); }
+	uint32_t get_timestamp() const { return read_uint32(m_packet + 4); }
+	uint32_t get_ssrc() const { return read_uint32(m_packet + 8); }
+
+	uint32_t get_csrc(int index) const
+	{
+		return (index >= 0 && index < get_csrc_count()) ? read_uint32(m_packet + 12 + index * 4) : 0;
+	}
+
+	//the extension id, the extension length in 32-bit words and the extension data
+	uint16_t get_extension_id() const { return m_extension_offset ? read_uint16(m_packet + m_extension_offset) : 0; }
+	uint16_t get_extension_length() const { return m_extension_offset ? read_uint16(m_packet + m_extension_offset + 2) : 0; }
+	uint8_t *get_extension_data() const { return m_extension_offset ? m_packet + m_extension_offset + 4 : NULL; }
+
+	uint8_t *get_payload() const { return m_packet + m_payload_offset; }
+	size_t get_payload_length() const { return m_payload_len; }
+
+	uint8_t *get_packet() const { return m_packet; }
+	size_t get_packet_length() const { return m_packet_len; }
+
+	void reset();
+
+	/**
+	 * @brief count a parse error
+	 * @param error -- the RTPParseError
+	 */
+	static void count_parse_error(int error);
+
+	/**
+	 * @brief get the parse error counters of all the packets
+	 * @param errors -- the counters indexed by RTPParseError, output parameter
+	 */
+	static void get_parse_errors(uint64_t errors[RTP_PARSE_ERROR_COUNT]);
+
+	static uint16_t read_uint16(const uint8_t *p)
+	{
+		return (uint16_t)((p[0] << 8) | p[1]);
+	}
+
+	static uint32_t read_uint32(const uint8_t *p)
+	{
+		return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+	}
+
+private:
+	uint8_t *m_packet;
+	size_t m_packet_len;
+	//the extension header offset, 0 if the packet has no extension
+	uint32_t m_extension_offset;
+	uint32_t m_payload_offset;
+	size_t m_payload_len;
+};
+
+/**
+ * @brief the RTP packet which carries the RTPExtensionHeader
  * 
  */
 class RTPPacket
@@ -112,25 +229,8 @@ public:
 	void reset();
 
 private:
-	bool m_padding;
-	bool m_extension;
-	uint8_t m_csrc_count;
-	bool m_marker;
-	uint8_t m_payload_type;
-	uint32_t m_sequence;
-	uint32_t m_timestamp;
-	uint32_t m_ssrc;
-	uint16_t m_extension_id;
-	uint16_t m_extension_len;
-	uint16_t m_reserved;
-	uint32_t m_msw;
-	uint32_t m_lsw;
-
-	uint8_t * m_payload;
-	size_t m_payload_len;
-
-	uint8_t * m_packet;
-	size_t m_packet_len;
+	//the fields are decoded from the packet buffer
+	RTPPacketView m_view;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "rtp_packet_batch.h"
+
+#include <new>
+#include <string.h>
+
+#include "common_logger.h"
+
+RTPPacketBatch::RTPPacketBatch()
+{
+	m_initialize = false;
+	m_capacity = 0;
+	m_slot_size = 0;
+	m_count = 0;
+	m_slab = NULL;
+#ifdef _WIN32
+#else
+	m_control_size = 0;
+#endif
+}
+
+RTPPacketBatch::~RTPPacketBatch()
+{
+	if (m_slab)
+	{
+		delete[] m_slab;
+		m_slab = NULL;
+	}
+}
+
+bool RTPPacketBatch::init(int capacity, int slotSize)
+{
+	if (m_initialize)
+	{
+		return true;
+	}
+
+	if (capacity <= 0 || slotSize <= 0)
+	{
+		return false;
+	}
+
+	m_slab = new (std::nothrow) uint8_t[(size_t)capacity * slotSize];
+	if (!m_slab)
+	{
+		LOG_ERROR("RTPPacketBatch::init(), out of memory");
+		return false;
+	}
+
+	m_capacity = capacity;
+	m_slot_size = slotSize;
+	m_count = 0;
+
+	m_buffers.resize(capacity);
+	m_lengths.resize(capacity, 0);
+	for (int i = 0; i < capacity; i++)
+	{
+		m_buffers[i] = m_slab + (size_t)i * slotSize;
+	}
+
+#ifdef _WIN32
+#else
+	m_msgs.resize(capacity);
+	m_iovecs.resize(capacity);
+	m_control_size = CMSG_SPACE(sizeof(uint32_t));
+	m_controls.assign(m_control_size * capacity, 0);
+	memset(&m_msgs[0], 0, sizeof(struct mmsghdr) * capacity);
+	for (int i = 0; i < capacity; i++)
+	{
+		m_iovecs[i].iov_base = m_buffers[i];
+		m_iovecs[i].iov_len = slotSize;
+
+		m_msgs[i].msg_hdr.msg_iov = &m_iovecs[i];
+		m_msgs[i].msg_hdr.msg_iovlen = 1;
+		m_msgs[i].msg_hdr.msg_control = &m_controls[m_control_size * i];
+	}
+	reset_controls();
+#endif
+
+	m_initialize = true;
+	return true;
+}
+
+void RTPPacketBatch::set_slot_buffer(int index, uint8_t *buffer)
+{
+	m_buffers[index] = buffer;
+#ifdef _WIN32
+#else
+	m_iovecs[index].iov_base = buffer;
+#endif
+}
+
+void RTPPacketBatch::reset_controls()
+{
+#ifdef _WIN32
+#else
+	for (int i = 0; i < m_capacity; i++)
+	{
+		m_msgs[i].msg_hdr.msg_controllen = m_control_size;
+	}
+#endif
+}
+
+void RTPPacketBatch::reset_slot_buffer(int index)
+{
+	set_slot_buffer(index, m_slab + (size_t)index * m_slot_size);
+}
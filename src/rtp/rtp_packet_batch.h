@@ -0,0 +1,148 @@
+#ifndef _H_RTP_PACKET_BATCH_H_
+#define _H_RTP_PACKET_BATCH_H_
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _WIN32
+#else
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+//the default datagrams count of a receive batch
+const int RTP_BATCH_DEFAULT_CAPACITY = 32;
+
+/**
+ * the datagrams batch. it is filled by RTPTransmitterV4::receive_batch() with one
+ * recvmmsg() call. the datagrams are received into a preallocated slab, one slot
+ * for each datagram, so no memory is allocated on the receive path.
+ */
+class RTPPacketBatch
+{
+public:
+	RTPPacketBatch();
+	virtual ~RTPPacketBatch();
+
+	/**
+	 * @brief initialize the batch
+	 *
+	 * @param capacity -- the max datagrams count of the batch
+	 * @param slotSize -- the max size of a datagram
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool init(int capacity, int slotSize);
+
+	/**
+	 * @brief get the max datagrams count of the batch
+	 */
+	int get_capacity() const
+	{
+		return this->m_capacity;
+	}
+
+	/**
+	 * @brief get the slot size
+	 */
+	int get_slot_size() const
+	{
+		return this->m_slot_size;
+	}
+
+	/**
+	 * @brief get the received datagrams count
+	 */
+	int get_count() const
+	{
+		return this->m_count;
+	}
+
+	/**
+	 * @brief get the datagram data
+	 *
+	 * @param index -- the datagram index, [0, get_count())
+	 * @return the datagram data pointer
+	 */
+	uint8_t *get_data(int index) const
+	{
+		return this->m_buffers[index];
+	}
+
+	/**
+	 * @brief get the datagram length
+	 *
+	 * @param index -- the datagram index, [0, get_count())
+	 * @return the datagram length
+	 */
+	int get_length(int index) const
+	{
+		return this->m_lengths[index];
+	}
+
+	/**
+	 * @brief bind an external buffer to the slot, the next datagram of the slot
+	 * is received into the buffer directly.
+	 *
+	 * @param index -- the slot index, [0, get_capacity())
+	 * @param buffer -- the buffer, its size must not be less than the slot size
+	 */
+	void set_slot_buffer(int index, uint8_t *buffer);
+
+	/**
+	 * @brief bind the slot to its own buffer in the slab again
+	 *
+	 * @param index -- the slot index, [0, get_capacity())
+	 */
+	void reset_slot_buffer(int index);
+
+	/**
+	 * @brief clear the received datagrams
+	 */
+	void clear()
+	{
+		this->m_count = 0;
+	}
+
+private:
+	friend class RTPTransmitterV4;
+
+	/**
+	 * @brief restore the control buffers length of the messages, recvmmsg() shrinks it
+	 * to the received control messages
+	 */
+	void reset_controls();
+
+	bool m_initialize;
+
+	//the max datagrams count
+	int m_capacity;
+	//the slot size
+	int m_slot_size;
+	//the received datagrams count
+	int m_count;
+
+	//the slab which the datagrams are received into
+	uint8_t *m_slab;
+
+	//the slot buffers
+	std::vector<uint8_t *> m_buffers;
+	//the received datagrams length
+	std::vector<int> m_lengths;
+
+#ifdef _WIN32
+#else
+	//the recvmmsg() message headers
+	std::vector<struct mmsghdr> m_msgs;
+	//the recvmmsg() io vectors
+	std::vector<struct iovec> m_iovecs;
+	//the recvmmsg() control buffers, one SO_RXQ_OVFL control message for each datagram
+	std::vector<uint8_t> m_controls;
+	//the control buffer size of each datagram
+	size_t m_control_size;
+#endif
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "rtp_packet_history.h"
+
+#include <new>
+#include <string.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+#include "rtp_packet.h"
+#include "common_logger.h"
+
+RTPPacketHistory::RTPPacketHistory()
+{
+	m_initialize = false;
+	m_slab = NULL;
+	memset(m_entries, 0, sizeof(m_entries));
+#ifdef _WIN32
+#else
+	pthread_mutex_init(&m_mutex, NULL);
+#endif
+}
+
+RTPPacketHistory::~RTPPacketHistory()
+{
+	if (m_slab)
+	{
+		delete[] m_slab;
+		m_slab = NULL;
+	}
+#ifdef _WIN32
+#else
+	pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+bool RTPPacketHistory::init()
+{
+	if (m_initialize)
+	{
+		return true;
+	}
+
+	m_slab = new (std::nothrow) uint8_t[(size_t)RTP_HISTORY_SIZE * RTP_HISTORY_SLOT_SIZE];
+	if (!m_slab)
+	{
+		LOG_ERROR("RTPPacketHistory::init(), out of memory");
+		return false;
+	}
+
+	m_initialize = true;
+	return true;
+}
+
+bool RTPPacketHistory::put(const uint8_t *data, int len)
+{
+	RTPPacketIov packet;
+	packet.header = data;
+	packet.headerLen = len;
+	packet.payload = NULL;
+	packet.payloadLen = 0;
+
+	return put(packet);
+}
+
+bool RTPPacketHistory::put(const RTPPacketIov &packet)
+{
+	int len = packet.get_length();
+	if (!m_initialize || packet.headerLen < (int)sizeof(RTPHeader) || len > RTP_HISTORY_SLOT_SIZE)
+	{
+		return false;
+	}
+
+	uint16_t sequence = ntohs(((const RTPHeader *)packet.header)->sequence);
+	int index = sequence & (RTP_HISTORY_SIZE - 1);
+
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+	uint8_t *slot = m_slab + (size_t)index * RTP_HISTORY_SLOT_SIZE;
+	memcpy(slot, packet.header, packet.headerLen);
+	if (packet.payloadLen > 0)
+	{
+		memcpy(slot + packet.headerLen, packet.payload, packet.payloadLen);
+	}
+	m_entries[index].sequence = sequence;
+	m_entries[index].length = len;
+	m_entries[index].retransmitTime = 0;
+#ifdef _WIN32
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+
+	return true;
+}
+
+int RTPPacketHistory::get_for_retransmit(uint16_t sequence, uint64_t nowUs, uint64_t minIntervalUs, uint8_t *buffer)
+{
+	if (!m_initialize)
+	{
+		return 0;
+	}
+
+	int len = 0;
+	int index = sequence & (RTP_HISTORY_SIZE - 1);
+
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+	HistoryEntry &entry = m_entries[index];
+	//the packet was overwritten, or the receiver asks again before the retransmission could arrive
+	if (entry.length > 0 && entry.sequence == sequence &&
+		(entry.retransmitTime == 0 || nowUs - entry.retransmitTime >= minIntervalUs))
+	{
+		len = entry.length;
+		memcpy(buffer, m_slab + (size_t)index * RTP_HISTORY_SLOT_SIZE, len);
+		entry.retransmitTime = nowUs;
+	}
+#ifdef _WIN32
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+
+	return len;
+}
@@ -0,0 +1,101 @@
+#ifndef _H_RTP_PACKET_HISTORY_H_
+#define _H_RTP_PACKET_HISTORY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _WIN32
+#include <mutex>
+#else
+#include <pthread.h>
+#endif
+
+#include "rtp_packet.h"
+
+//the history ring size, it must be a power of 2. it is the max sequence
+//distance of the packets which can be retransmitted
+const int RTP_HISTORY_SIZE = 1024;
+
+//the max packet size in the history
+const int RTP_HISTORY_SLOT_SIZE = 1500;
+
+/**
+ * the sent rtp packets history. the packets are copied into a preallocated slab,
+ * one slot for each sequence modulo the ring size, so they can be retransmitted
+ * after the packet builder buffer is rewritten. the functions are thread safe.
+ */
+class RTPPacketHistory
+{
+public:
+	RTPPacketHistory();
+	virtual ~RTPPacketHistory();
+
+	/**
+	 * @brief initialize the history
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool init();
+
+	/**
+	 * @brief store the sent rtp packet, it replaces the packet which has the same slot
+	 *
+	 * @param data -- the rtp packet
+	 * @param len -- the rtp packet length
+	 *
+	 * @return true - successful
+	 * @return false - the packet is malformed or too large
+	 */
+	bool put(const uint8_t *data, int len);
+
+	/**
+	 * @brief store the sent rtp packet which is in two parts
+	 *
+	 * @param packet -- the rtp packet, the rtp header is in the header part
+	 *
+	 * @return true - successful
+	 * @return false - the packet is malformed or too large
+	 */
+	bool put(const RTPPacketIov &packet);
+
+	/**
+	 * @brief copy the stored packet for retransmission. the packet is not returned
+	 * if it was retransmitted within the min interval, the duplicated requests
+	 * within a round trip time are suppressed.
+	 *
+	 * @param sequence -- the rtp sequence
+	 * @param nowUs -- the monotonic time in microseconds
+	 * @param minIntervalUs -- the min interval between two retransmissions of the packet in microseconds
+	 * @param buffer -- the buffer, its size must not be less than RTP_HISTORY_SLOT_SIZE
+	 *
+	 * @return the packet length, 0 if the packet is not in the history or it was retransmitted recently
+	 */
+	int get_for_retransmit(uint16_t sequence, uint64_t nowUs, uint64_t minIntervalUs, uint8_t *buffer);
+
+private:
+	struct HistoryEntry
+	{
+		//the rtp sequence
+		uint16_t sequence;
+		//the packet length, 0 if the entry is empty
+		int length;
+		//the last retransmission time, 0 if it was not retransmitted
+		uint64_t retransmitTime;
+	};
+
+	bool m_initialize;
+
+	//the packets slab
+	uint8_t *m_slab;
+	//the entries, indexed by the sequence
+	HistoryEntry m_entries[RTP_HISTORY_SIZE];
+
+#ifdef _WIN32
+	std::mutex m_mutex;
+#else
+	pthread_mutex_t m_mutex;
+#endif
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "rtp_packet_pool.h"
+
+#include <new>
+
+#include "common_logger.h"
+
+RTPPacketPool::RTPPacketPool()
+{
+	m_initialize = false;
+	m_capacity = 0;
+	m_slot_size = 0;
+	m_slots = NULL;
+	m_slab = NULL;
+	m_free_head = NULL;
+	m_free_count = 0;
+}
+
+RTPPacketPool::~RTPPacketPool()
+{
+	if (m_slots)
+	{
+		delete[] m_slots;
+		m_slots = NULL;
+	}
+
+	if (m_slab)
+	{
+		delete[] m_slab;
+		m_slab = NULL;
+	}
+}
+
+bool RTPPacketPool::init(int capacity, int slotSize)
+{
+	if (m_initialize)
+	{
+		return true;
+	}
+
+	if (capacity <= 0 || slotSize <= 0)
+	{
+		return false;
+	}
+
+	m_slots = new (std::nothrow) RTPPacketSlot[capacity];
+	m_slab = new (std::nothrow) uint8_t[(size_t)capacity * slotSize];
+	if (!m_slots || !m_slab)
+	{
+		LOG_ERROR("RTPPacketPool::init(), out of memory");
+		goto exitFlag;
+	}
+
+	m_capacity = capacity;
+	m_slot_size = slotSize;
+
+	//chain all the slots to the free list
+	m_free_head = NULL;
+	for (int i = capacity - 1; i >= 0; i--)
+	{
+		m_slots[i].buffer = m_slab + (size_t)i * slotSize;
+		m_slots[i].length = 0;
+		m_slots[i].next = m_free_head;
+		m_free_head = &m_slots[i];
+	}
+	m_free_count = capacity;
+
+	m_initialize = true;
+	return true;
+
+exitFlag:
+	if (m_slots)
+	{
+		delete[] m_slots;
+		m_slots = NULL;
+	}
+
+	if (m_slab)
+	{
+		delete[] m_slab;
+		m_slab = NULL;
+	}
+
+	return false;
+}
+
+RTPPacketSlot *RTPPacketPool::acquire()
+{
+	RTPPacketSlot *slot = m_free_head;
+	if (slot)
+	{
+		m_free_head = slot->next;
+		slot->next = NULL;
+		m_free_count--;
+	}
+
+	return slot;
+}
+
+void RTPPacketPool::release(RTPPacketSlot *slot)
+{
+	if (!slot)
+	{
+		return;
+	}
+
+	slot->length = 0;
+	slot->next = m_free_head;
+	m_free_head = slot;
+	m_free_count++;
+}
+
+RTPPacketSlot *RTPPacketPool::find_slot(const RTPPacket *packet) const
+{
+	if (!m_initialize || !packet)
+	{
+		return NULL;
+	}
+
+	//the packet is the first member of the slot
+	const RTPPacketSlot *slot = reinterpret_cast<const RTPPacketSlot *>(packet);
+	if (slot < m_slots || slot >= m_slots + m_capacity)
+	{
+		return NULL;
+	}
+
+	return const_cast<RTPPacketSlot *>(slot);
+}
@@ -0,0 +1,109 @@
+#ifndef _H_RTP_PACKET_POOL_H_
+#define _H_RTP_PACKET_POOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "rtp_packet.h"
+
+/**
+ * the packet pool slot. the datagram is received into the slot buffer,
+ * and the rtp packet is parsed in place.
+ */
+struct RTPPacketSlot
+{
+	//the rtp packet, a view of the slot buffer
+	RTPPacket packet;
+
+	//the slot buffer
+	uint8_t *buffer;
+
+	//the datagram length in the slot buffer
+	int length;
+
+	//the next free slot
+	RTPPacketSlot *next;
+};
+
+/**
+ * the fixed capacity rtp packet pool. all the slots are allocated when the pool
+ * is initialized, the released slots are recycled by the free list, so acquire()
+ * and release() are O(1) and never allocate memory.
+ * NOTE: the pool is not thread safe.
+ */
+class RTPPacketPool
+{
+public:
+	RTPPacketPool();
+	virtual ~RTPPacketPool();
+
+	/**
+	 * @brief initialize the pool
+	 *
+	 * @param capacity -- the slots count
+	 * @param slotSize -- the slot buffer size
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool init(int capacity, int slotSize);
+
+	/**
+	 * @brief acquire a free slot
+	 *
+	 * @return the slot, NULL if the pool is exhausted
+	 */
+	RTPPacketSlot *acquire();
+
+	/**
+	 * @brief release the slot to the pool
+	 *
+	 * @param slot -- the slot which acquire() returns
+	 */
+	void release(RTPPacketSlot *slot);
+
+	/**
+	 * @brief find the slot which the rtp packet belongs to
+	 *
+	 * @param packet -- the rtp packet
+	 *
+	 * @return the slot, NULL if the packet does not belong to the pool
+	 */
+	RTPPacketSlot *find_slot(const RTPPacket *packet) const;
+
+	/**
+	 * @brief get the slots count
+	 */
+	int get_capacity() const
+	{
+		return this->m_capacity;
+	}
+
+	/**
+	 * @brief get the free slots count
+	 */
+	int get_free_count() const
+	{
+		return this->m_free_count;
+	}
+
+private:
+	bool m_initialize;
+
+	//the slots count
+	int m_capacity;
+	//the slot buffer size
+	int m_slot_size;
+
+	//the slots array
+	RTPPacketSlot *m_slots;
+	//the slab which the slot buffers are in
+	uint8_t *m_slab;
+
+	//the free list head
+	RTPPacketSlot *m_free_head;
+	//the free slots count
+	int m_free_count;
+};
+
+#endif
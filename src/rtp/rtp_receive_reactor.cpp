@@ -0,0 +1,541 @@
+#include "rtp_receive_reactor.h"
+
+#include <new>
+#include <errno.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <thread>
+#include <chrono>
+#else
+#include <unistd.h>
+#include <sched.h>
+#endif
+
+#include "common_logger.h"
+#include "common_utils.h"
+
+//the reactor whose table the current thread is in, the callbacks which
+//modify their own reactor must not wait for themselves
+static thread_local const RTPReceiveReactor *t_current_reactor = NULL;
+
+RTPReceiveReactor::RTPReceiveReactor()
+{
+	m_initialize = false;
+	m_next_timer_id = 1;
+	m_table.store(new HandlerTable());
+	m_epoch.store(0);
+#ifdef _WIN32
+#else
+	m_epoll_fd = -1;
+	pthread_mutex_init(&m_mutex, NULL);
+#endif
+}
+
+RTPReceiveReactor::~RTPReceiveReactor()
+{
+#ifdef _WIN32
+#else
+	if (m_epoll_fd != -1)
+	{
+		close(m_epoll_fd);
+	}
+
+	pthread_mutex_destroy(&m_mutex);
+#endif
+
+	HandlerTable *table = m_table.load();
+	for (size_t i = 0; i < table->timers.size(); i++)
+	{
+		delete table->timers[i];
+	}
+	delete table;
+
+	for (size_t i = 0; i < m_retired_tables.size(); i++)
+	{
+		delete m_retired_tables[i];
+	}
+	for (size_t i = 0; i < m_retired_timers.size(); i++)
+	{
+		delete m_retired_timers[i];
+	}
+}
+
+bool RTPReceiveReactor::init()
+{
+	if (m_initialize)
+	{
+		return true;
+	}
+
+#ifdef _WIN32
+#else
+	m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (m_epoll_fd == -1)
+	{
+		LOG_ERROR("epoll_create1 failed, %d", errno);
+		return false;
+	}
+#endif
+
+	m_initialize = true;
+	return true;
+}
+
+RTPReceiveReactor::HandlerTable *RTPReceiveReactor::enter_table()
+{
+	//the epoch is odd before the table is loaded, so a writer which replaced
+	//the table either sees the odd epoch or is seen by the load
+	m_epoch.fetch_add(1);
+	t_current_reactor = this;
+	return m_table.load();
+}
+
+void RTPReceiveReactor::leave_table()
+{
+	//the tables replaced by the callbacks were only used by this thread
+	for (size_t i = 0; i < m_retired_tables.size(); i++)
+	{
+		delete m_retired_tables[i];
+	}
+	m_retired_tables.clear();
+
+	for (size_t i = 0; i < m_retired_timers.size(); i++)
+	{
+		delete m_retired_timers[i];
+	}
+	m_retired_timers.clear();
+
+	t_current_reactor = NULL;
+	m_epoch.fetch_add(1);
+}
+
+bool RTPReceiveReactor::is_in_table() const
+{
+	return t_current_reactor == this;
+}
+
+void RTPReceiveReactor::retire_table(HandlerTable *old, TimerHandler *timer)
+{
+	if (is_in_table())
+	{
+		//the callback is iterating the old table, it is freed when the callback returns
+		m_retired_tables.push_back(old);
+		if (timer)
+		{
+			m_retired_timers.push_back(timer);
+		}
+		return;
+	}
+
+	//wait for the reactor thread to leave the table it is in, the next table it enters is the new one
+	uint64_t epoch = m_epoch.load();
+	if (epoch & 1)
+	{
+		while (m_epoch.load() == epoch)
+		{
+#ifdef _WIN32
+			std::this_thread::yield();
+#else
+			sched_yield();
+#endif
+		}
+	}
+
+	delete old;
+	if (timer)
+	{
+		delete timer;
+	}
+}
+
+const RTPReceiveReactor::SocketHandler *RTPReceiveReactor::find_socket(const HandlerTable *table, RTPSocket sock)
+{
+	//the table is small and sorted, the binary search touches a few cache lines
+	size_t low = 0;
+	size_t high = table->sockets.size();
+	while (low < high)
+	{
+		size_t mid = (low + high) / 2;
+		if (table->sockets[mid].sock < sock)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	if (low < table->sockets.size() && table->sockets[low].sock == sock)
+	{
+		return &table->sockets[low];
+	}
+	return NULL;
+}
+
+bool RTPReceiveReactor::add_socket(RTPSocket sock, OnSocketReadableCallback func, void *arg)
+{
+	if (!m_initialize || !func)
+	{
+		return false;
+	}
+
+	SocketHandler handler;
+	handler.sock = sock;
+	handler.func = func;
+	handler.arg = arg;
+
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+
+	HandlerTable *table = new (std::nothrow) HandlerTable(*m_table.load());
+	if (!table)
+	{
+#ifdef _WIN32
+#else
+		pthread_mutex_unlock(&m_mutex);
+#endif
+		LOG_ERROR("RTPReceiveReactor::add_socket(), out of memory");
+		return false;
+	}
+
+	bool exists = false;
+	std::vector<SocketHandler>::iterator it = table->sockets.begin();
+	for (; it != table->sockets.end() && it->sock <= sock; it++)
+	{
+		if (it->sock == sock)
+		{
+			*it = handler;
+			exists = true;
+			break;
+		}
+	}
+	if (!exists)
+	{
+		table->sockets.insert(it, handler);
+	}
+
+#ifdef _WIN32
+#else
+	//the events which arrive before the table is published are reported again, the reactor is level-triggered
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = sock;
+
+	if (epoll_ctl(m_epoll_fd, exists ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, sock, &ev) != 0)
+	{
+		pthread_mutex_unlock(&m_mutex);
+		delete table;
+
+		LOG_ERROR("epoll_ctl add socket %d failed, %d", sock, errno);
+		return false;
+	}
+#endif
+
+	HandlerTable *old = m_table.exchange(table);
+
+#ifdef _WIN32
+	lock.unlock();
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+
+	retire_table(old, NULL);
+	return true;
+}
+
+bool RTPReceiveReactor::remove_socket(RTPSocket sock)
+{
+	if (!m_initialize)
+	{
+		return false;
+	}
+
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+
+	HandlerTable *old = NULL;
+	const HandlerTable *current = m_table.load();
+	if (find_socket(current, sock))
+	{
+		HandlerTable *table = new (std::nothrow) HandlerTable(*current);
+		if (!table)
+		{
+#ifdef _WIN32
+#else
+			pthread_mutex_unlock(&m_mutex);
+#endif
+			LOG_ERROR("RTPReceiveReactor::remove_socket(), out of memory");
+			return false;
+		}
+
+		for (std::vector<SocketHandler>::iterator it = table->sockets.begin(); it != table->sockets.end(); it++)
+		{
+			if (it->sock == sock)
+			{
+				table->sockets.erase(it);
+				break;
+			}
+		}
+
+#ifdef _WIN32
+#else
+		epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, sock, NULL);
+#endif
+		old = m_table.exchange(table);
+	}
+
+#ifdef _WIN32
+	lock.unlock();
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+
+	//the writers do not wait for the reactor under the lock, so the callbacks may modify the reactor
+	if (old)
+	{
+		retire_table(old, NULL);
+	}
+
+	return true;
+}
+
+int RTPReceiveReactor::add_timer(int interval_ms, OnTimerCallback func, void *arg)
+{
+	if (!m_initialize || !func || interval_ms <= 0)
+	{
+		return -1;
+	}
+
+	TimerHandler *handler = new (std::nothrow) TimerHandler();
+	if (!handler)
+	{
+		LOG_ERROR("RTPReceiveReactor::add_timer(), out of memory");
+		return -1;
+	}
+	handler->func = func;
+	handler->arg = arg;
+	handler->interval = interval_ms;
+	handler->expiration = get_monotonic_time_ms() + interval_ms;
+
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+
+	HandlerTable *table = new (std::nothrow) HandlerTable(*m_table.load());
+	if (!table)
+	{
+#ifdef _WIN32
+#else
+		pthread_mutex_unlock(&m_mutex);
+#endif
+		delete handler;
+		LOG_ERROR("RTPReceiveReactor::add_timer(), out of memory");
+		return -1;
+	}
+
+	int timerId = m_next_timer_id++;
+	handler->id = timerId;
+	table->timers.push_back(handler);
+	HandlerTable *old = m_table.exchange(table);
+
+#ifdef _WIN32
+	lock.unlock();
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+
+	retire_table(old, NULL);
+	return timerId;
+}
+
+bool RTPReceiveReactor::remove_timer(int timerId)
+{
+	if (!m_initialize)
+	{
+		return false;
+	}
+
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+
+	HandlerTable *old = NULL;
+	TimerHandler *timer = NULL;
+	const HandlerTable *current = m_table.load();
+	for (size_t i = 0; i < current->timers.size(); i++)
+	{
+		if (current->timers[i]->id != timerId)
+		{
+			continue;
+		}
+
+		HandlerTable *table = new (std::nothrow) HandlerTable(*current);
+		if (!table)
+		{
+#ifdef _WIN32
+#else
+			pthread_mutex_unlock(&m_mutex);
+#endif
+			LOG_ERROR("RTPReceiveReactor::remove_timer(), out of memory");
+			return false;
+		}
+
+		timer = table->timers[i];
+		table->timers.erase(table->timers.begin() + i);
+		old = m_table.exchange(table);
+		break;
+	}
+
+#ifdef _WIN32
+	lock.unlock();
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+
+	if (old)
+	{
+		retire_table(old, timer);
+	}
+
+	return true;
+}
+
+int RTPReceiveReactor::get_wait_time(const HandlerTable *table, int timeout_ms)
+{
+	uint64_t now = get_monotonic_time_ms();
+
+	for (size_t i = 0; i < table->timers.size(); i++)
+	{
+		uint64_t expiration = table->timers[i]->expiration;
+		int wait = (expiration > now) ? (int)(expiration - now) : 0;
+		if (timeout_ms < 0 || wait < timeout_ms)
+		{
+			timeout_ms = wait;
+		}
+	}
+
+	return timeout_ms;
+}
+
+void RTPReceiveReactor::run_timers(const HandlerTable *table)
+{
+	if (table->timers.empty())
+	{
+		return;
+	}
+
+	uint64_t now = get_monotonic_time_ms();
+	for (size_t i = 0; i < table->timers.size(); i++)
+	{
+		TimerHandler *handler = table->timers[i];
+		if (handler->expiration <= now)
+		{
+			//the missed expirations are skipped, the timer does not fire in a burst
+			handler->expiration += handler->interval;
+			if (handler->expiration <= now)
+			{
+				handler->expiration = now + handler->interval;
+			}
+
+			handler->func(handler->arg);
+		}
+	}
+}
+
+int RTPReceiveReactor::run_once(int timeout_ms)
+{
+	if (!m_initialize)
+	{
+		return -1;
+	}
+
+	HandlerTable *table = enter_table();
+	timeout_ms = get_wait_time(table, timeout_ms);
+
+#ifdef _WIN32
+	fd_set fdset;
+	FD_ZERO(&fdset);
+
+	for (size_t i = 0; i < table->sockets.size() && fdset.fd_count < FD_SETSIZE; i++)
+	{
+		FD_SET(table->sockets[i].sock, &fdset);
+	}
+	leave_table();
+
+	int count = 0;
+	if (fdset.fd_count == 0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+	}
+	else
+	{
+		struct timeval tv;
+		tv.tv_sec = timeout_ms / 1000;
+		tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+		count = select(0, &fdset, NULL, NULL, &tv);
+		if (count < 0)
+		{
+			return -1;
+		}
+	}
+
+	//the socket may be removed after select() returns, the handler is looked up in the current table
+	table = enter_table();
+	for (int i = 0; i < count; i++)
+	{
+		const SocketHandler *handler = find_socket(table, fdset.fd_array[i]);
+		if (handler)
+		{
+			handler->func(handler->arg);
+		}
+	}
+
+	run_timers(table);
+	leave_table();
+
+	return count;
+#else
+	//the writers do not wait for the reactor while it is blocked in epoll_wait()
+	leave_table();
+
+	int count = epoll_wait(m_epoll_fd, m_events, RTP_REACTOR_MAX_EVENTS, timeout_ms);
+	if (count < 0)
+	{
+		if (errno != EINTR)
+		{
+			return -1;
+		}
+		count = 0;
+	}
+
+	//the socket may be removed after epoll_wait() returns, the handler is looked up in the current table
+	table = enter_table();
+	for (int i = 0; i < count; i++)
+	{
+		const SocketHandler *handler = find_socket(table, m_events[i].data.fd);
+		if (handler)
+		{
+			handler->func(handler->arg);
+		}
+	}
+
+	run_timers(table);
+	leave_table();
+
+	return count;
+#endif
+}
@@ -0,0 +1,219 @@
+#ifndef _H_RTP_RECEIVE_REACTOR_H_
+#define _H_RTP_RECEIVE_REACTOR_H_
+
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <mutex>
+#else
+#include <pthread.h>
+#include <sys/epoll.h>
+#endif
+
+#include "rtp_transmitter_v4.h"
+
+//the max events count which the reactor handles in one wakeup
+const int RTP_REACTOR_MAX_EVENTS = 64;
+
+//the socket readable callback function. it is invoked on the reactor thread.
+//the callback should drain the socket, the reactor is level-triggered, so
+//the data left in the socket will wake up the reactor again.
+//@param userArg -- the user argument
+typedef void (*OnSocketReadableCallback)(void *userArg);
+
+//the timer callback function. it is invoked on the reactor thread.
+//@param userArg -- the user argument
+typedef void (*OnTimerCallback)(void *userArg);
+
+/**
+ * the event-driven receive reactor. the sockets registered to the reactor are
+ * watched by epoll (select on windows), the readable callback is invoked as soon
+ * as the socket becomes readable.
+ * the sockets and the timers are kept in an immutable handler table. the writers
+ * publish a new table and wait for the reactor thread to leave the old one, so the
+ * reactor thread dispatches the callbacks without any lock, and adding or removing
+ * a socket never waits for the callbacks of the other sockets.
+ */
+class RTPReceiveReactor
+{
+public:
+	RTPReceiveReactor();
+	virtual ~RTPReceiveReactor();
+
+	/**
+	 * @brief initialize the reactor
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool init();
+
+	/**
+	 * @brief register the socket to the reactor.
+	 *
+	 * @param sock -- the socket
+	 * @param func -- the readable callback function
+	 * @param arg -- the user argument of the callback function
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool add_socket(RTPSocket sock, OnSocketReadableCallback func, void *arg);
+
+	/**
+	 * @brief unregister the socket from the reactor.
+	 * when the function returns, the readable callback of the socket is
+	 * not running and will never be invoked again, unless the function is
+	 * invoked by the callback itself.
+	 *
+	 * @param sock -- the socket
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool remove_socket(RTPSocket sock);
+
+	/**
+	 * @brief add a periodic timer to the reactor
+	 *
+	 * @param interval_ms -- the timer interval in milliseconds
+	 * @param func -- the timer callback function
+	 * @param arg -- the user argument of the callback function
+	 *
+	 * @return the timer id, -1 on error
+	 */
+	int add_timer(int interval_ms, OnTimerCallback func, void *arg);
+
+	/**
+	 * @brief remove the timer from the reactor.
+	 * when the function returns, the timer callback is not running and
+	 * will never be invoked again, unless the function is invoked by a
+	 * callback of the reactor.
+	 *
+	 * @param timerId -- the timer id which add_timer() returns
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool remove_timer(int timerId);
+
+	/**
+	 * @brief wait for the readable sockets and invoke their callbacks,
+	 * then invoke the callbacks of the expired timers.
+	 * the wait time is shortened to the next timer expiration.
+	 *
+	 * @param timeout_ms -- the max wait time in milliseconds
+	 *
+	 * @return the readable sockets count, -1 on error
+	 */
+	int run_once(int timeout_ms);
+
+private:
+	struct SocketHandler
+	{
+		RTPSocket sock;
+		OnSocketReadableCallback func;
+		void *arg;
+	};
+
+	struct TimerHandler
+	{
+		int id;
+		OnTimerCallback func;
+		void *arg;
+		//the interval in milliseconds
+		int interval;
+		//the next expiration time in milliseconds, it is only updated by the reactor thread
+		uint64_t expiration;
+	};
+
+	struct HandlerTable
+	{
+		//the registered sockets, sorted by the socket
+		std::vector<SocketHandler> sockets;
+		//the timers, they are shared by the tables until they are removed
+		std::vector<TimerHandler *> timers;
+	};
+
+	/**
+	 * @brief enter the handler table, the table is valid until leave_table()
+	 *
+	 * @return the current table
+	 */
+	HandlerTable *enter_table();
+
+	/**
+	 * @brief leave the handler table, the retired tables are freed
+	 */
+	void leave_table();
+
+	/**
+	 * @brief free the replaced table when the reactor thread left it.
+	 * the writer lock must not be held, the callbacks may take it
+	 *
+	 * @param old -- the replaced table
+	 * @param timer -- the removed timer, it is freed with the table, it may be NULL
+	 */
+	void retire_table(HandlerTable *old, TimerHandler *timer);
+
+	/**
+	 * @brief whether the current thread is in a table of the reactor, i.e. in a callback
+	 */
+	bool is_in_table() const;
+
+	/**
+	 * @brief find the socket handler in the table
+	 *
+	 * @param table -- the handler table
+	 * @param sock -- the socket
+	 *
+	 * @return the handler, NULL if the socket is not registered
+	 */
+	static const SocketHandler *find_socket(const HandlerTable *table, RTPSocket sock);
+
+	/**
+	 * @brief get the wait time until the next timer expiration
+	 *
+	 * @param table -- the handler table
+	 * @param timeout_ms -- the max wait time in milliseconds
+	 * @return the wait time in milliseconds
+	 */
+	static int get_wait_time(const HandlerTable *table, int timeout_ms);
+
+	/**
+	 * @brief invoke the callbacks of the expired timers
+	 *
+	 * @param table -- the handler table
+	 */
+	static void run_timers(const HandlerTable *table);
+
+private:
+	bool m_initialize;
+
+	//the writer lock, the reactor thread never takes it
+#ifdef _WIN32
+	std::mutex m_mutex;
+#else
+	pthread_mutex_t m_mutex;
+
+	//the epoll file descriptor
+	int m_epoll_fd;
+	//the epoll events buffer
+	struct epoll_event m_events[RTP_REACTOR_MAX_EVENTS];
+#endif
+
+	//the current handler table
+	std::atomic<HandlerTable *> m_table;
+	//the reactor epoch, it is odd while the reactor thread is in a table
+	std::atomic<uint64_t> m_epoch;
+	//the tables which were replaced by the callbacks, they are freed when the reactor thread leaves the table
+	std::vector<HandlerTable *> m_retired_tables;
+	std::vector<TimerHandler *> m_retired_timers;
+
+	//the next timer id
+	int m_next_timer_id;
+};
+
+#endif
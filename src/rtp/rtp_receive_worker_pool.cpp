@@ -0,0 +1,218 @@
+#include "rtp_receive_worker_pool.h"
+
+#include <new>
+#include <string.h>
+#ifdef _WIN32
+#include <functional>
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+#include "common_logger.h"
+
+RTPReceiveWorkerPool::RTPReceiveWorkerPool()
+{
+	m_running = false;
+	m_realtime_priority = 0;
+}
+
+RTPReceiveWorkerPool::~RTPReceiveWorkerPool()
+{
+	stop();
+	destroy();
+}
+
+bool RTPReceiveWorkerPool::init(int count)
+{
+	if (!m_workers.empty())
+	{
+		return true;
+	}
+
+	if (count < 1 || count > RTP_RECEIVE_MAX_WORKERS)
+	{
+		LOG_ERROR("invalid receive workers count %d", count);
+		return false;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		Worker *worker = new (std::nothrow) Worker();
+		if (!worker)
+		{
+			LOG_ERROR("RTPReceiveWorkerPool::init(), out of memory");
+			destroy();
+			return false;
+		}
+		worker->pool = this;
+		worker->index = i;
+		worker->started = false;
+		m_workers.push_back(worker);
+
+		if (!worker->reactor.init())
+		{
+			LOG_ERROR("create the reactor of receive worker %d error.", i);
+			destroy();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void RTPReceiveWorkerPool::destroy()
+{
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		delete m_workers[i];
+	}
+	m_workers.clear();
+}
+
+bool RTPReceiveWorkerPool::start()
+{
+	if (m_running)
+	{
+		return true;
+	}
+
+	if (m_workers.empty())
+	{
+		return false;
+	}
+
+	m_running = true;
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		Worker *worker = m_workers[i];
+#ifdef _WIN32
+		worker->thread = std::thread(std::bind(&RTPReceiveWorkerPool::run_worker, this, (int)i));
+#else
+		int ret = pthread_create(&worker->thread, NULL, thread_func, worker);
+		if (ret != 0)
+		{
+			LOG_ERROR("Start receive worker %d error.", (int)i);
+			stop();
+			return false;
+		}
+#endif
+		worker->started = true;
+
+		if (m_realtime_priority > 0)
+		{
+			apply_realtime_priority(worker);
+		}
+	}
+
+	return true;
+}
+
+void RTPReceiveWorkerPool::set_realtime_priority(int priority)
+{
+	m_realtime_priority = priority;
+}
+
+void RTPReceiveWorkerPool::apply_realtime_priority(Worker *worker)
+{
+#ifdef _WIN32
+	if (!SetThreadPriority((HANDLE)worker->thread.native_handle(), THREAD_PRIORITY_TIME_CRITICAL))
+	{
+		LOG_WARNING("fail to raise the priority of receive worker %d, %d", worker->index, (int)GetLastError());
+	}
+#else
+	int minPriority = sched_get_priority_min(SCHED_FIFO);
+	int maxPriority = sched_get_priority_max(SCHED_FIFO);
+
+	struct sched_param param;
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = m_realtime_priority;
+	if (param.sched_priority < minPriority)
+	{
+		param.sched_priority = minPriority;
+	}
+	else if (param.sched_priority > maxPriority)
+	{
+		param.sched_priority = maxPriority;
+	}
+
+	//EPERM without CAP_SYS_NICE or an RLIMIT_RTPRIO, the worker keeps running at the normal priority
+	int ret = pthread_setschedparam(worker->thread, SCHED_FIFO, &param);
+	if (ret != 0)
+	{
+		LOG_WARNING("fail to set SCHED_FIFO %d of receive worker %d, %d", param.sched_priority, worker->index, ret);
+	}
+#endif
+}
+
+void RTPReceiveWorkerPool::stop()
+{
+	m_running = false;
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		Worker *worker = m_workers[i];
+		if (!worker->started)
+		{
+			continue;
+		}
+
+#ifdef _WIN32
+		worker->thread.join();
+#else
+		pthread_join(worker->thread, NULL);
+#endif
+		worker->started = false;
+	}
+}
+
+RTPReceiveReactor *RTPReceiveWorkerPool::get_reactor(int index) const
+{
+	if (index < 0 || index >= (int)m_workers.size())
+	{
+		return NULL;
+	}
+
+	return &m_workers[index]->reactor;
+}
+
+RTPReceiveReactor *RTPReceiveWorkerPool::select_reactor(const std::string &key) const
+{
+	return get_reactor(select_worker(key));
+}
+
+int RTPReceiveWorkerPool::select_worker(const std::string &key) const
+{
+	if (m_workers.empty())
+	{
+		return -1;
+	}
+
+	//FNV-1a, the uuids are spread evenly and the same key always maps to the same worker
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < key.size(); i++)
+	{
+		hash ^= (uint8_t)key[i];
+		hash *= 16777619u;
+	}
+
+	return (int)(hash % m_workers.size());
+}
+
+void *RTPReceiveWorkerPool::thread_func(void *ptr)
+{
+	Worker *worker = (Worker *)ptr;
+	worker->pool->run_worker(worker->index);
+
+	return 0;
+}
+
+void RTPReceiveWorkerPool::run_worker(int index)
+{
+	RTPReceiveReactor &reactor = m_workers[index]->reactor;
+	while (m_running)
+	{
+		//the readable receivers drain their sockets in the reactor callbacks
+		reactor.run_once(RTP_RECEIVE_WORKER_TIMEOUT_MS);
+	}
+}
@@ -0,0 +1,148 @@
+#ifndef _H_RTP_RECEIVE_WORKER_POOL_H_
+#define _H_RTP_RECEIVE_WORKER_POOL_H_
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <thread>
+#else
+#include <pthread.h>
+#endif
+
+#include "rtp_receive_reactor.h"
+
+//the max receive workers count
+const int RTP_RECEIVE_MAX_WORKERS = 16;
+//the default receive workers count, the callbacks of all the users run on one thread
+const int RTP_RECEIVE_DEFAULT_WORKERS = 1;
+//the max wait time of the worker reactors in milliseconds
+const int RTP_RECEIVE_WORKER_TIMEOUT_MS = 20;
+
+/**
+ * the receive worker pool. every worker has its own reactor and thread, the
+ * sockets and the timers of a receiver are registered to one worker, so a slow
+ * callback only delays the receivers on the same worker. the reactor of a key
+ * is picked by hash, the receivers of the same key always share a worker.
+ * the reactors live from init() to the destructor, the threads from start() to stop().
+ */
+class RTPReceiveWorkerPool
+{
+public:
+	RTPReceiveWorkerPool();
+	virtual ~RTPReceiveWorkerPool();
+
+	/**
+	 * @brief create the worker reactors
+	 *
+	 * @param count -- the workers count, 1 to RTP_RECEIVE_MAX_WORKERS
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool init(int count);
+
+	/**
+	 * @brief start the worker threads
+	 *
+	 * @return true - successful
+	 * @return false - fail, the started workers are stopped
+	 */
+	bool start();
+
+	/**
+	 * @brief set the realtime priority of the worker threads, it takes effect when
+	 * the threads are started. the threads are scheduled by SCHED_FIFO on linux and
+	 * THREAD_PRIORITY_TIME_CRITICAL on windows. the threads keep the normal priority
+	 * if the process has no permission.
+	 *
+	 * @param priority -- the SCHED_FIFO priority, 1 to 99, 0 is the normal priority
+	 */
+	void set_realtime_priority(int priority);
+
+	/**
+	 * @brief stop the worker threads, the registered sockets and timers are kept
+	 */
+	void stop();
+
+	/**
+	 * @brief whether the worker threads are running
+	 */
+	bool is_running() const { return m_running; }
+
+	/**
+	 * @brief get the workers count
+	 */
+	int get_worker_count() const { return (int)m_workers.size(); }
+
+	/**
+	 * @brief get the reactor of the worker
+	 *
+	 * @param index -- the worker index
+	 *
+	 * @return the reactor, NULL if the index is invalid
+	 */
+	RTPReceiveReactor *get_reactor(int index) const;
+
+	/**
+	 * @brief get the reactor which the key is pinned to
+	 *
+	 * @param key -- the key, e.g. the user uuid
+	 *
+	 * @return the reactor, NULL if the pool is not initialized
+	 */
+	RTPReceiveReactor *select_reactor(const std::string &key) const;
+
+	/**
+	 * @brief get the index of the worker which the key is pinned to
+	 *
+	 * @param key -- the key, e.g. the user uuid
+	 *
+	 * @return the worker index, -1 if the pool is not initialized
+	 */
+	int select_worker(const std::string &key) const;
+
+	/**
+	 * @brief the worker thread loop
+	 *
+	 * @param index -- the worker index
+	 */
+	void run_worker(int index);
+
+private:
+	struct Worker
+	{
+		RTPReceiveWorkerPool *pool;
+		int index;
+		RTPReceiveReactor reactor;
+#ifdef _WIN32
+		std::thread thread;
+#else
+		pthread_t thread;
+#endif
+		//whether the worker thread was started
+		bool started;
+	};
+
+	//destroy the worker reactors, the threads must be stopped
+	void destroy();
+
+	//the pthread entry of the workers
+	static void *thread_func(void *ptr);
+
+	//raise the worker thread to the realtime priority
+	void apply_realtime_priority(Worker *worker);
+
+private:
+	std::vector<Worker *> m_workers;
+
+	//whether the worker threads are running
+	std::atomic<bool> m_running;
+
+	//the realtime priority of the worker threads, 0 is the normal priority
+	int m_realtime_priority;
+};
+
+#endif
@@ -1,18 +1,34 @@
 #include "rtp_session_audio.h"
 
 #include <string.h>
-#include <time.h>
 #include "common_logger.h"
+#include "common_utils.h"
 
 RTPSessionAudio::RTPSessionAudio()
 {
 	m_initialize = false;
 	m_aac_rtp_builder = NULL;
 	m_transmitter = NULL;
+	m_ssrc = 0;
+	m_pacer = NULL;
+	m_mtu = RTP_DEFAULT_MTU;
+	m_pmtu_discovery = false;
+	m_pmtu_probe_time = 0;
+	m_max_packet_size = RTP_DEFAULT_MTU - RTP_IP_UDP_HEADER_SIZE;
+	m_oversize_packets = 0;
 }
 
 RTPSessionAudio::~RTPSessionAudio()
 {
+	//the reactor callbacks use the transmitter
+	m_rtcp.stop();
+
+	//the pacer thread uses the transmitter
+	if (m_pacer)
+	{
+		m_pacer->remove_transmitter(m_transmitter);
+	}
+
 	if (m_aac_rtp_builder)
 	{
 		delete m_aac_rtp_builder;
@@ -45,6 +61,7 @@ bool RTPSessionAudio::init(uint16_t sequenceStart, uint32_t timestampStart, uint
 		goto exitFlag;
 	}
 	m_aac_rtp_builder->set_ssrc(ssrc);
+	m_ssrc = ssrc;
 
 	m_transmitter = new RTPTransmitterV4();
 	if (!m_transmitter)
@@ -112,8 +129,8 @@ bool RTPSessionAudio::send_aac_data(const uint8_t *data, size_t length)
 		return false;
 	}
 
-	clock_t now = clock();
-	uint32_t now_ms = (uint32_t)(now * 1000 / CLOCKS_PER_SEC);
+	//the rtp timestamp is the monotonic sending time in milliseconds
+	uint32_t now_ms = (uint32_t)get_monotonic_time_ms();
 
 	if (m_aac_rtp_builder->send_data(data, length))
 	{
@@ -121,9 +138,102 @@ bool RTPSessionAudio::send_aac_data(const uint8_t *data, size_t length)
 		RTPHeader *rtpHeader = (RTPHeader *)rtp.first;
 		rtpHeader->timestamp = htonl(now_ms);
 
-		bool ret = m_transmitter->send_data(rtp.first, rtp.second);
+		//the AAC frame can't be fragmented, it is sent and counted
+		m_max_packet_size = get_max_packet_size();
+		if (rtp.second > m_max_packet_size)
+		{
+			m_oversize_packets++;
+		}
+
+		//the audio packets are not held behind the queued video packets
+		bool ret = (m_pacer && m_pacer->enqueue_audio(m_transmitter, rtp.first, rtp.second)) ||
+				   m_transmitter->send_data(rtp.first, rtp.second);
+		if (ret)
+		{
+			m_rtcp.on_rtp_sent(1, (uint32_t)(rtp.second - sizeof(RTPHeader) - sizeof(RTPExtensionHeader)),
+							   (uint32_t)(RTP_IP_UDP_HEADER_SIZE + sizeof(RTPHeader) + sizeof(RTPExtensionHeader)));
+		}
 		return ret;
 	}
 
 	return false;
+}
+
+void RTPSessionAudio::set_mtu(int mtu)
+{
+	m_mtu = mtu;
+}
+
+bool RTPSessionAudio::set_pmtu_discovery(bool enabled)
+{
+	if (!m_initialize || !m_transmitter->set_pmtu_discovery(enabled))
+	{
+		return false;
+	}
+
+	m_pmtu_discovery = enabled;
+	m_pmtu_probe_time = get_monotonic_time_ms();
+	return true;
+}
+
+void RTPSessionAudio::get_mtu_stats(RTPMtuStats &stats)
+{
+	memset(&stats, 0, sizeof(stats));
+	stats.mtu = m_mtu;
+	stats.maxPacketSize = m_max_packet_size;
+	stats.oversizePackets = m_oversize_packets;
+	if (!m_initialize)
+	{
+		return;
+	}
+
+	stats.pathMtu = m_transmitter->get_path_mtu();
+	stats.mtuExceeded = m_transmitter->get_mtu_exceeded();
+}
+
+int RTPSessionAudio::get_max_packet_size()
+{
+	int mtu = m_mtu;
+	if (m_pmtu_discovery)
+	{
+		//the learned path mtu expires, so the routes are queried again periodically
+		int pathMtu;
+		uint64_t now = get_monotonic_time_ms();
+		if (now - m_pmtu_probe_time >= (uint64_t)RTP_PMTU_PROBE_INTERVAL_MS)
+		{
+			pathMtu = m_transmitter->probe_path_mtu();
+			m_pmtu_probe_time = now;
+		}
+		else
+		{
+			pathMtu = m_transmitter->get_path_mtu();
+		}
+
+		if (pathMtu > 0 && pathMtu < mtu)
+		{
+			mtu = pathMtu;
+		}
+	}
+
+	return mtu - RTP_IP_UDP_HEADER_SIZE;
+}
+
+void RTPSessionAudio::set_pacer(RTPPacer *pacer)
+{
+	m_pacer = pacer;
+}
+
+bool RTPSessionAudio::start_rtcp(RTPReceiveReactor *reactor)
+{
+	if (!m_initialize)
+	{
+		return false;
+	}
+
+	return m_rtcp.start(reactor, m_transmitter, m_ssrc, RTCP_DEFAULT_CLOCK_RATE);
+}
+
+void RTPSessionAudio::get_rtcp_stats(RTCPSendStats &stats)
+{
+	m_rtcp.get_stats(stats);
 }
\ No newline at end of file
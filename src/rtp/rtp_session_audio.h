@@ -5,6 +5,9 @@
 #include <stdint.h>
 #include "rtp_aac_packet_builder.h"
 #include "rtp_transmitter_v4.h"
+#include "rtp_receive_reactor.h"
+#include "rtcp_session_sender.h"
+#include "rtp_pacer.h"
 
 class RTPSessionAudio
 {
@@ -70,6 +73,68 @@ public:
 	 */
 	bool send_aac_data(const uint8_t *data, size_t length);
 
+	/**
+	 * @brief set the mtu of the session. the AAC frames are not fragmented, the
+	 * packets which exceed the mtu or the path mtu are counted.
+	 *
+	 * @param mtu -- the mtu, RTP_DEFAULT_MTU by default
+	 */
+	void set_mtu(int mtu);
+
+	/**
+	 * @brief enable the path mtu discovery. the datagrams are not fragmented, the
+	 * path mtu is queried when a datagram exceeds it and every RTP_PMTU_PROBE_INTERVAL_MS.
+	 * NOTE: the function must be called after init()
+	 *
+	 * @param enabled -- whether the discovery is enabled, it is disabled by default
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool set_pmtu_discovery(bool enabled);
+
+	/**
+	 * @brief get the mtu statistics, the packets per frame and the header overhead
+	 * are in the rtcp statistics
+	 *
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_mtu_stats(RTPMtuStats &stats);
+
+	/**
+	 * @brief set the send pacer, the rtp packets are queued to the audio priority lane of the pacer.
+	 * the packets are sent directly if the pacer is NULL, not running or full.
+	 * NOTE: the pacer must outlive the session
+	 *
+	 * @param pacer -- the pacer
+	 */
+	void set_pacer(RTPPacer *pacer);
+
+	/**
+	 * @brief start the rtcp reports of the session. the rtp socket and the report
+	 * timer are registered to the reactor, they are unregistered when the session is deleted.
+	 * NOTE: the function must be called after init()
+	 *
+	 * @param reactor -- the reactor
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool start_rtcp(RTPReceiveReactor *reactor);
+
+	/**
+	 * @brief get the rtcp statistics of the sent stream
+	 *
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_rtcp_stats(RTCPSendStats &stats);
+
+private:
+	/**
+	 * @brief probe the path mtu if it is due
+	 *
+	 * @return the max rtp packet size
+	 */
+	int get_max_packet_size();
+
 private:
 	//whether the session was initialized
 	bool m_initialize;
@@ -77,8 +142,28 @@ private:
 	//the socket transmitter
 	RTPTransmitterV4 *m_transmitter;
 
+	//the rtp ssrc
+	uint32_t m_ssrc;
+
+	//the rtcp reports
+	RTCPSessionSender m_rtcp;
+
+	//the send pacer, NULL if the packets are sent directly
+	RTPPacer *m_pacer;
+
 	//the AAC rtp packet builder
 	RTPAACPacketBuilder *m_aac_rtp_builder;
+
+	//the configured mtu
+	int m_mtu;
+	//whether the path mtu discovery is enabled
+	bool m_pmtu_discovery;
+	//the monotonic time of the last path mtu query in milliseconds
+	uint64_t m_pmtu_probe_time;
+	//the max rtp packet size of the last packet
+	int m_max_packet_size;
+	//the packets which exceed the max rtp packet size
+	uint64_t m_oversize_packets;
 };
 
 #endif
\ No newline at end of file
@@ -1,46 +1,51 @@
 #include "rtp_session_receiver.h"
 
+#include <new>
 #include <string.h>
 #include <time.h>
 #include "common_logger.h"
+#include "common_utils.h"
+#include "rtp_bundle_receiver.h"
 
 RTPSessionReceiver::RTPSessionReceiver()
 {
 	m_initialize = false;
 	m_transmitter = NULL;
-	m_reorder = false;
-	m_rtp_packet = NULL;
-	m_recv_buffer = NULL;
+	m_bundle = NULL;
+	m_bundle_ssrc = 0;
+	m_bundle_destination = NULL;
+	m_bundle_pushed = 0;
+	m_use_jitter_buffer = false;
+	m_recv_batch_pos = 0;
+	m_recv_batch_time = 0;
+	m_rtcp_ssrc = 0;
+	m_nack_enabled = false;
+	m_nack_rtt_ms = 0;
+	m_media_ssrc = 0;
+	m_fec_enabled = false;
+	m_fec_active = false;
 }
 
 RTPSessionReceiver::~RTPSessionReceiver()
 {
-	if (m_transmitter)
-	{
-		delete m_transmitter;
-	}
-
-	if (m_rtp_packet)
+	//the bundle does not push datagrams any more when remove_stream() returns
+	if (m_bundle && m_initialize)
 	{
-		delete m_rtp_packet;
+		m_bundle->remove_stream(m_bundle_ssrc);
 	}
 
-	if (m_recv_buffer)
+	if (m_bundle_destination)
 	{
-		delete[] m_recv_buffer;
+		delete m_bundle_destination;
 	}
 
-	std::list<RTPPacket *>::iterator it;
-	for (it = m_reorder_list.begin(); it != m_reorder_list.end(); it++)
+	if (m_transmitter)
 	{
-		uint8_t *ptr = (*it)->get_packet();
-		delete[] ptr;
-
-		delete (*it);
+		delete m_transmitter;
 	}
 }
 
-bool RTPSessionReceiver::init(bool reorder, RTPTransParamsV4 *recvParams, const char* pinholeIP, const uint16_t& pinholePort)
+bool RTPSessionReceiver::init(bool jitterBuffer, RTPTransParamsV4 *recvParams, const char* pinholeIP, const uint16_t& pinholePort)
 {
 	if (m_initialize)
 	{
@@ -49,7 +54,7 @@ bool RTPSessionReceiver::init(bool reorder, RTPTransParamsV4 *recvParams, const
 
 	bool ret;
 
-	m_reorder = reorder;
+	m_use_jitter_buffer = jitterBuffer;
 	m_transmitter = new RTPTransmitterV4();
 	if (!m_transmitter)
 	{
@@ -69,18 +74,25 @@ bool RTPSessionReceiver::init(bool reorder, RTPTransParamsV4 *recvParams, const
 		goto exitFlag;
 	}
 
-	m_rtp_packet = new RTPPacket();
-	if (!m_rtp_packet)
+	if (!m_recv_batch.init(RTP_BATCH_DEFAULT_CAPACITY, RTP_RECV_BUFFER_SIZE))
 	{
 		goto exitFlag;
 	}
+	m_batch_packets.resize(RTP_BATCH_DEFAULT_CAPACITY);
+	m_recv_batch_pos = 0;
 
-	m_recv_buffer = new uint8_t[RTP_RECV_BUFFER_SIZE];
-	if (!m_recv_buffer)
+	//the pool holds the jitter buffer, the datagrams being received and the packets outstanding
+	if (!init_playout(RTP_JITTER_RING_SIZE + RTP_BATCH_DEFAULT_CAPACITY + RTP_PLAYOUT_MAX_OUTSTANDING))
 	{
 		goto exitFlag;
 	}
 
+	if (m_use_jitter_buffer)
+	{
+		m_batch_slots.assign(RTP_BATCH_DEFAULT_CAPACITY, (RTPPacketSlot *)NULL);
+		bind_batch_slots();
+	}
+
 	m_initialize = true;
 	return true;
 
@@ -92,159 +104,485 @@ exitFlag:
 		m_transmitter = NULL;
 	}
 
-	if (m_rtp_packet)
+	m_initialize = false;
+	return false;
+}
+
+bool RTPSessionReceiver::init_bundle(RTPBundleReceiver *bundle, const char *pinholeIP, const uint16_t &pinholePort, uint32_t ssrc,
+									 OnSocketReadableCallback func, void *arg)
+{
+	if (m_initialize)
 	{
-		delete m_rtp_packet;
-		m_rtp_packet = NULL;
+		return true;
 	}
 
-	if (m_recv_buffer)
+	if (!bundle)
 	{
-		delete[] m_recv_buffer;
-		m_recv_buffer = NULL;
+		return false;
 	}
 
-	m_initialize = false;
-	return false;
+	m_use_jitter_buffer = true;
+	m_bundle_destination = new (std::nothrow) IPAddrV4(pinholeIP, pinholePort);
+	if (!m_bundle_destination)
+	{
+		LOG_ERROR("Create IPAddrV4 failed.");
+		return false;
+	}
+
+	//the pushed datagrams go to the jitter buffer at once, the pool holds no batch
+	if (!init_playout(RTP_JITTER_RING_SIZE + RTP_PLAYOUT_MAX_OUTSTANDING + 1))
+	{
+		return false;
+	}
+
+	//the session is initialized before it is registered, the bundle may push at once
+	m_bundle = bundle;
+	m_bundle_ssrc = ssrc;
+	m_initialize = true;
+	if (!m_bundle->add_stream(ssrc, this, func, arg))
+	{
+		m_bundle = NULL;
+		m_initialize = false;
+		return false;
+	}
+
+	return true;
+}
+
+bool RTPSessionReceiver::init_playout(int poolSize)
+{
+	m_rtcp_statistics.init(RTCP_DEFAULT_CLOCK_RATE);
+	m_rtcp_ssrc = rtcp_random_ssrc();
+
+	if (m_use_jitter_buffer)
+	{
+		if (!m_packet_pool.init(poolSize, RTP_RECV_BUFFER_SIZE))
+		{
+			return false;
+		}
+
+		if (!m_jitter_buffer.init(&m_packet_pool, RTP_JITTER_DEFAULT_CLOCK_RATE))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void RTPSessionReceiver::set_nack_enabled(bool enabled)
+{
+	m_nack_enabled = enabled;
+}
+
+void RTPSessionReceiver::set_fec_enabled(bool enabled)
+{
+	m_fec_enabled = enabled;
 }
 
 void RTPSessionReceiver::nat_pinhole(const std::string& message)
 {
-	m_transmitter->send_data((const uint8_t*)message.c_str(), message.size());
+	send_to_peer((const uint8_t*)message.c_str(), message.size());
+}
+
+bool RTPSessionReceiver::send_to_peer(const uint8_t *data, size_t len)
+{
+	//the streams of a bundle share the socket, every stream sends to its own peer
+	if (m_bundle)
+	{
+		return m_bundle->get_transmitter()->send_data_to(data, len, *m_bundle_destination);
+	}
+
+	return m_transmitter->send_data(data, len);
+}
+
+int RTPSessionReceiver::next_datagram(int64_t timeout_us)
+{
+	if (m_recv_batch_pos >= m_recv_batch.get_count())
+	{
+		m_recv_batch_pos = 0;
+		if (m_use_jitter_buffer)
+		{
+			bind_batch_slots();
+		}
+
+		if (m_transmitter->receive_batch(m_recv_batch, timeout_us) <= 0)
+		{
+			return -1;
+		}
+		m_recv_batch_time = get_monotonic_time_us();
+	}
+
+	return m_recv_batch_pos++;
 }
 
 RTPPacket *RTPSessionReceiver::receive_rtp_packet(int64_t timeout_us)
 {
-	if (!m_initialize)
+	if (!m_initialize || m_bundle)
 	{
 		return NULL;
 	}
 
-	int receivedLen = m_transmitter->receive_data(m_recv_buffer, RTP_RECV_BUFFER_SIZE, timeout_us);
-	if (receivedLen == 0)
+	int index;
+	while ((index = next_datagram(timeout_us)) >= 0)
 	{
-		return NULL;
+		uint8_t *data = m_recv_batch.get_data(index);
+		int len = m_recv_batch.get_length(index);
+		if (rtcp_is_rtcp_packet(data, len))
+		{
+			handle_rtcp_packet(data, len);
+			timeout_us = 0;
+			continue;
+		}
+
+		//the recovered packets need the jitter buffer
+		if (rtp_fec_is_fec_packet(data, len))
+		{
+			timeout_us = 0;
+			continue;
+		}
+
+		//the malformed packets are counted by the parser, the next datagram is read
+		RTPPacket *packet = &m_batch_packets[index];
+		if (!packet->parse(data, len))
+		{
+			timeout_us = 0;
+			continue;
+		}
+
+		m_rtcp_statistics.on_rtp_packet(packet->get_ssrc(), (uint16_t)packet->get_sequence(),
+										packet->get_timestamp(), m_recv_batch_time);
+		m_media_ssrc = packet->get_ssrc();
+		if (m_nack_enabled)
+		{
+			m_nack_generator.on_packet((uint16_t)packet->get_sequence(), m_recv_batch_time);
+		}
+		return packet;
 	}
 
-	bool ret = m_rtp_packet->parse(m_recv_buffer, receivedLen);
-	if (!ret)
+	return NULL;
+}
+
+void RTPSessionReceiver::bind_batch_slots()
+{
+	for (int i = 0; i < (int)m_batch_slots.size(); i++)
 	{
-		return NULL;
+		if (m_batch_slots[i])
+		{
+			continue;
+		}
+
+		RTPPacketSlot *slot = m_packet_pool.acquire();
+		if (slot)
+		{
+			m_batch_slots[i] = slot;
+			m_recv_batch.set_slot_buffer(i, slot->buffer);
+		}
+		else
+		{
+			//the pool is exhausted, the datagram of the batch slot will be dropped
+			m_recv_batch.reset_slot_buffer(i);
+		}
+	}
+}
+
+int RTPSessionReceiver::receive_rtp_packets(int maxPackets)
+{
+	if (!m_initialize || !m_use_jitter_buffer)
+	{
+		return 0;
+	}
+
+	int count = 0;
+	if (m_bundle)
+	{
+		//the bundle pushed the datagrams already, only the recovery and the NACK are left
+		count = m_bundle_pushed;
+		m_bundle_pushed = 0;
+	}
+
+	while (!m_bundle && count < maxPackets)
+	{
+		int index = next_datagram(0);
+		if (index < 0)
+		{
+			break;
+		}
+		count++;
+
+		RTPPacketSlot *slot = m_batch_slots[index];
+		if (!slot)
+		{
+			LOG_WARNING("the rtp packet pool is exhausted, drop the packet");
+			continue;
+		}
+
+		//the slot is moved to the jitter buffer, the batch slot is bound to a new slot on the next refill
+		slot->length = m_recv_batch.get_length(index);
+		if (handle_datagram(slot))
+		{
+			m_batch_slots[index] = NULL;
+		}
+	}
+
+	if (m_fec_active && m_fec_decoder.has_pending())
+	{
+		recover_fec_packets();
+	}
+
+	//the gaps are requested as soon as they are detected
+	if (m_nack_enabled && count > 0)
+	{
+		send_nack();
 	}
 
-	return m_rtp_packet;
+	return count;
 }
 
-RTPPacket *RTPSessionReceiver::receive_rtp_packet(int reorderLen, int64_t timeout_us)
+void RTPSessionReceiver::push_datagram(const uint8_t *data, int len, uint64_t time)
 {
-	if (reorderLen <= 0 || !m_reorder)
+	if (!m_initialize || !m_bundle || len <= 0 || len > RTP_RECV_BUFFER_SIZE)
+	{
+		return;
+	}
+
+	m_bundle_pushed++;
+	m_recv_batch_time = time;
+
+	RTPPacketSlot *slot = m_packet_pool.acquire();
+	if (!slot)
 	{
-		return receive_rtp_packet(timeout_us);
+		LOG_WARNING("the rtp packet pool is exhausted, drop the packet");
+		return;
 	}
 
-	int receivedLen = m_transmitter->receive_data(m_recv_buffer, RTP_RECV_BUFFER_SIZE, timeout_us);
-	if (m_reorder_list.size() == 0)
+	memcpy(slot->buffer, data, len);
+	slot->length = len;
+	if (!handle_datagram(slot))
 	{
-		uint8_t *ptr = new uint8_t[receivedLen];
-		if (ptr)
+		m_packet_pool.release(slot);
+	}
+}
+
+bool RTPSessionReceiver::handle_datagram(RTPPacketSlot *slot)
+{
+	if (rtcp_is_rtcp_packet(slot->buffer, slot->length))
+	{
+		handle_rtcp_packet(slot->buffer, slot->length);
+		return false;
+	}
+
+	if (rtp_fec_is_fec_packet(slot->buffer, slot->length))
+	{
+		//the parity packets have their own sequence space, they are not counted in the statistics
+		if (m_fec_enabled && !m_fec_active)
 		{
-			RTPPacket *tmpPacket = new RTPPacket();
-			if (tmpPacket)
-			{
-				m_reorder_list.push_back(tmpPacket);
-			}
-			else
+			//the decoder is allocated when the sender turns out to send parity packets
+			m_fec_active = m_fec_decoder.init();
+			if (!m_fec_active)
 			{
-				delete[] ptr;
+				//the parity packets are ignored, the stream is received without them
+				m_fec_enabled = false;
 			}
 		}
-	}else if (receivedLen > 0)
+
+		if (m_fec_active)
+		{
+			m_fec_decoder.add_fec(slot->buffer, slot->length, m_recv_batch_time);
+		}
+		return false;
+	}
+
+	if (!slot->packet.parse(slot->buffer, slot->length))
+	{
+		return false;
+	}
+
+	if (m_fec_active)
+	{
+		m_fec_decoder.add_media(slot->buffer, slot->length);
+	}
+
+	m_rtcp_statistics.on_rtp_packet(slot->packet.get_ssrc(), (uint16_t)slot->packet.get_sequence(),
+									slot->packet.get_timestamp(), m_recv_batch_time);
+	m_media_ssrc = slot->packet.get_ssrc();
+
+	bool retransmitted = false;
+	if (m_nack_enabled)
+	{
+		retransmitted = m_nack_generator.on_packet((uint16_t)slot->packet.get_sequence(), m_recv_batch_time);
+	}
+
+	return m_jitter_buffer.push(slot, m_recv_batch_time, retransmitted);
+}
+
+void RTPSessionReceiver::recover_fec_packets()
+{
+	while (true)
 	{
-		uint8_t *ptr = new uint8_t[receivedLen];
-		if (ptr)
+		RTPPacketSlot *slot = m_packet_pool.acquire();
+		if (!slot)
 		{
-			RTPPacket *tmpPacket = new RTPPacket();
-			if (tmpPacket)
-			{
-				memcpy(ptr, m_recv_buffer, receivedLen);
-				bool ret = tmpPacket->parse(ptr, receivedLen);
-				if (!ret)
-				{
-					delete[] ptr;
-					delete tmpPacket;
-				}
-				else
-				{
-					//insert to list
-					uint32_t seq = tmpPacket->get_sequence();
-					std::list<RTPPacket *>::iterator it;
-					std::list<RTPPacket *>::iterator start;
-					bool done = false;
-
-					it = m_reorder_list.end();
-					--it;
-					start = m_reorder_list.begin();
-
-					while (!done)
-					{
-						RTPPacket *p;
-						uint32_t seqnr;
-
-						p = *it;
-						seqnr = p->get_sequence();
-						if (seqnr > seq)
-						{
-							if (it != start)
-							{
-								--it;
-							}
-							else
-							{
-								done = true;
-								m_reorder_list.push_front(tmpPacket);
-							}
-						}
-						else if (seqnr < seq)
-						{
-							++it;
-							m_reorder_list.insert(it, tmpPacket);
-							done = true;
-						}
-						else
-						{
-							done = true;
-							//the sequences are equal, drop the packet
-							delete[] ptr;
-							delete tmpPacket;
-						}
-					}
-				}
-			}
-			else
+			LOG_WARNING("the rtp packet pool is exhausted, drop the recovered packet");
+			return;
+		}
+
+		int len = m_fec_decoder.recover(slot->buffer, m_recv_batch_time);
+		if (len <= 0 || !slot->packet.parse(slot->buffer, len))
+		{
+			m_packet_pool.release(slot);
+			if (len <= 0)
 			{
-				delete[] ptr;
+				return;
 			}
+			continue;
+		}
+		slot->length = len;
+
+		//the recovered packet cancels its NACK, it is not a sample of the network jitter
+		if (m_nack_enabled)
+		{
+			m_nack_generator.on_recovered((uint16_t)slot->packet.get_sequence(), m_recv_batch_time);
+		}
+
+		if (!m_jitter_buffer.push(slot, m_recv_batch_time, true))
+		{
+			m_packet_pool.release(slot);
 		}
 	}
+}
 
-	if ((int)m_reorder_list.size() > reorderLen)
+RTPPacket *RTPSessionReceiver::playout_rtp_packet()
+{
+	if (!m_initialize || !m_use_jitter_buffer)
 	{
-		RTPPacket *packet = m_reorder_list.front();
-		m_reorder_list.pop_front();
-
-		return packet;
+		return NULL;
 	}
 
-	return NULL;
+	RTPPacketSlot *slot = m_jitter_buffer.pop(get_monotonic_time_us());
+	return slot ? &slot->packet : NULL;
+}
+
+RTPJitterBuffer *RTPSessionReceiver::get_jitter_buffer()
+{
+	return m_use_jitter_buffer ? &m_jitter_buffer : NULL;
 }
 
 void RTPSessionReceiver::end_receive_rtp_packet(RTPPacket *packet)
 {
-	if (packet && packet != m_rtp_packet)
+	//the packets in the receive batch are views, they are not allocated
+	RTPPacketSlot *slot = m_packet_pool.find_slot(packet);
+	if (slot)
 	{
-		uint8_t *ptr = packet->get_packet();
-		delete[] ptr;
+		m_packet_pool.release(slot);
+	}
+}
 
-		delete packet;
+void RTPSessionReceiver::handle_rtcp_packet(const uint8_t *data, int len)
+{
+	RTCPReport report;
+	RTCPCompoundReader reader(data, len);
+	while (reader.next())
+	{
+		if (reader.get_type() == RTCP_PT_SR && reader.parse_report(report))
+		{
+			m_rtcp_statistics.on_sender_report(report, m_recv_batch_time);
+		}
 	}
+}
+
+bool RTPSessionReceiver::send_receiver_report()
+{
+	if (!m_initialize)
+	{
+		return false;
+	}
+
+	RTCPReportBlock block;
+	if (!m_rtcp_statistics.build_report_block(block, get_monotonic_time_us()))
+	{
+		return false;
+	}
+
+	int len = rtcp_build_receiver_report(m_rtcp_buffer, sizeof(m_rtcp_buffer), m_rtcp_ssrc, &block, 1);
+	if (len <= 0)
+	{
+		return false;
+	}
+
+	return send_to_peer(m_rtcp_buffer, len);
+}
+
+void RTPSessionReceiver::get_rtcp_stats(RTCPReceiveStats &stats)
+{
+	m_rtcp_statistics.get_stats(stats);
+}
+
+bool RTPSessionReceiver::send_nack()
+{
+	if (!m_initialize || !m_nack_enabled)
+	{
+		return false;
+	}
+
+	//the retransmissions need a round trip time more to arrive before their playout time
+	int rtt = m_nack_generator.get_rtt_ms();
+	if (m_use_jitter_buffer && rtt != m_nack_rtt_ms)
+	{
+		int minDelay = RTP_JITTER_MIN_DELAY_MS + rtt;
+		m_jitter_buffer.set_delay_range(minDelay < RTP_JITTER_MAX_DELAY_MS ? minDelay : RTP_JITTER_MAX_DELAY_MS,
+										RTP_JITTER_MAX_DELAY_MS);
+		m_nack_rtt_ms = rtt;
+	}
+
+	int count = m_nack_generator.get_nack_list(get_monotonic_time_us(), m_nack_sequences, RTCP_NACK_MAX_SEQUENCES);
+	if (count <= 0)
+	{
+		return false;
+	}
+
+	int len = rtcp_build_generic_nack(m_rtcp_buffer, sizeof(m_rtcp_buffer), m_rtcp_ssrc, m_media_ssrc,
+									  m_nack_sequences, count);
+	if (len <= 0)
+	{
+		return false;
+	}
+
+	return send_to_peer(m_rtcp_buffer, len);
+}
+
+void RTPSessionReceiver::get_nack_stats(RTCPNackStats &stats)
+{
+	m_nack_generator.get_stats(stats);
+}
+
+void RTPSessionReceiver::get_fec_stats(RTPFecStats &stats)
+{
+	m_fec_decoder.get_stats(stats);
+}
+
+bool RTPSessionReceiver::get_socket_stats(RTPSocketStats &stats)
+{
+	if (!m_initialize)
+	{
+		memset(&stats, 0, sizeof(stats));
+		return false;
+	}
+
+	if (m_bundle)
+	{
+		return m_bundle->get_transmitter()->get_socket_stats(stats);
+	}
+
+	return m_transmitter->get_socket_stats(stats);
+}
+
+RTPSocket RTPSessionReceiver::get_socket() const
+{
+	if (m_bundle)
+	{
+		return m_bundle->get_transmitter()->get_socket();
+	}
+
+	return m_transmitter->get_socket();
 }
\ No newline at end of file
@@ -1,14 +1,28 @@
 #ifndef _H_RTP_SESSION_RECEIVER_H_
 #define _H_RTP_SESSION_RECEIVER_H_
 
-#include <list>
+#include <vector>
 #include <stdint.h>
 #include "rtp_transmitter_v4.h"
+#include "rtp_packet_batch.h"
+#include "rtp_packet_pool.h"
+#include "rtp_jitter_buffer.h"
 #include "rtp_packet.h"
+#include "rtcp_packet.h"
+#include "rtcp_statistics.h"
+#include "rtcp_nack_generator.h"
+#include "rtp_fec_decoder.h"
+#include "rtp_receive_reactor.h"
+
+class RTPBundleReceiver;
 
 //the rtp receive buffer size. it was used to receive data from remote peer
 const int RTP_RECV_BUFFER_SIZE = 1024 * 2;
 
+//the max packets count which are returned by playout_rtp_packet() and
+//not yet ended by end_receive_rtp_packet()
+const int RTP_PLAYOUT_MAX_OUTSTANDING = 4;
+
 class RTPSessionReceiver
 {
 public:
@@ -23,14 +37,61 @@ public:
 	/**
 	 * @brief initialize the rtp session
 	 *
-	 * @param reorder -- whether the rtp receive session re-order the rtp packets
+	 * @param jitterBuffer -- whether the rtp packets are played out through the jitter buffer
 	 * @param recvParams -- the recv transmission parameters
 	 * @param pinholeIP -- the NAT pinhole ip address
 	 * @param pinholePort -- the NAt pinhole port
 	 *
 	 * @return if initialize successfully, return true otherwise return false
 	 */
-	bool init(bool reorder, RTPTransParamsV4 *recvParams, const char *pinholeIP, const uint16_t &pinholePort);
+	bool init(bool jitterBuffer, RTPTransParamsV4 *recvParams, const char *pinholeIP, const uint16_t &pinholePort);
+
+	/**
+	 * @brief initialize the rtp session on the socket of a bundle. the bundle pushes
+	 * the datagrams of the ssrc by push_datagram(), the rtp packets are played out
+	 * through the jitter buffer. the rtcp packets and the pinholes are sent through
+	 * the bundle socket to the NAT pinhole destination.
+	 *
+	 * @param bundle -- the bundle receiver, it must outlive the session
+	 * @param pinholeIP -- the NAT pinhole ip address
+	 * @param pinholePort -- the NAT pinhole port
+	 * @param ssrc -- the ssrc of the received stream
+	 * @param func -- the callback which is invoked after the datagrams of a batch were pushed
+	 * @param arg -- the user argument of the callback function
+	 *
+	 * @return if initialize successfully, return true otherwise return false
+	 */
+	bool init_bundle(RTPBundleReceiver *bundle, const char *pinholeIP, const uint16_t &pinholePort, uint32_t ssrc,
+					 OnSocketReadableCallback func, void *arg);
+
+	/**
+	 * @brief push a datagram which the bundle demultiplexed to the jitter buffer.
+	 * the datagram is copied into a packet pool slot.
+	 *
+	 * @param data -- the datagram
+	 * @param len -- the datagram length
+	 * @param time -- the receive time, the monotonic time in microseconds
+	 */
+	void push_datagram(const uint8_t *data, int len, uint64_t time);
+
+	/**
+	 * @brief enable the generic NACK of the lost packets. the playout delay of the
+	 * jitter buffer is raised by the measured round trip time, so the retransmissions
+	 * arrive before their playout time.
+	 *
+	 * @param enabled -- whether the NACK is enabled
+	 */
+	void set_nack_enabled(bool enabled);
+
+	/**
+	 * @brief enable the recovery of the lost packets by the XOR parity packets.
+	 * the recovered packets are pushed to the jitter buffer. the decoder is allocated,
+	 * and the media packets are copied to it, only after the first parity packet arrives.
+	 * NOTE: the function must be called before init()
+	 *
+	 * @param enabled -- whether the FEC is enabled
+	 */
+	void set_fec_enabled(bool enabled);
 
 	/**
 	 * @brief the receive NAT pinhole
@@ -40,46 +101,223 @@ public:
 
 	/**
 	 * @brief receive rtp packet.
+	 * the packet is a view of the datagram in the receive batch, it is not copied.
+	 * the packet is valid until the next receive_rtp_packet() call.
 	 * @param timeout_us -- the timeout in microseconds
 	 * @return the rtp packet pointer. if receive failed, returns NULL pointer.
 	 */
 	RTPPacket *receive_rtp_packet(int64_t timeout_us);
 
 	/**
-	* @brief receive rtp packet from the re-order packets buffer.
-	*
-	* @param reorderLen -- the re-order buffer len. if the packets number in the 
-	* packets buffer is less than reorderLen, then the function returns NULL.
-	* @param timeout_us -- the timeout in microseconds
-	*
-	* @return the rtp packet pointer. if receive failed, returns NULL pointer.
-	*/
-	RTPPacket *receive_rtp_packet(int reorderLen, int64_t timeout_us);
+	 * @brief receive the rtp packets to the jitter buffer.
+	 * the datagrams are received into the packet pool slots directly, no memory is allocated.
+	 * on a bundle, the datagrams pushed since the last call are counted instead.
+	 *
+	 * @param maxPackets -- the max datagrams count to receive
+	 *
+	 * @return the received datagrams count
+	 */
+	int receive_rtp_packets(int maxPackets);
+
+	/**
+	 * @brief play out the next rtp packet whose playout time is reached
+	 * from the jitter buffer. the packets are played out in the sequence order.
+	 *
+	 * @return the rtp packet pointer. if no packet is due, returns NULL pointer.
+	 */
+	RTPPacket *playout_rtp_packet();
+
+	/**
+	 * @brief get the jitter buffer, it is NULL if the session does not use the jitter buffer
+	 *
+	 * @return the jitter buffer
+	 */
+	RTPJitterBuffer *get_jitter_buffer();
 
 	/**
 	* @brief end of receiving rtp packet.
 	* Note: This function MUST be called when you call receive_rtp_packet();
 	*
-	* @param packet -- the rtp packete which the function ReceiveRTPPacket() returns.
+	* @param packet -- the rtp packete which receive_rtp_packet() or playout_rtp_packet() returns.
 	*/
 	void end_receive_rtp_packet(RTPPacket *packet);
 
+	/**
+	 * @brief send the receiver report of the received stream to the NAT pinhole destination
+	 *
+	 * @return true - successful
+	 * @return false - fail, or no rtp packet was received
+	 */
+	bool send_receiver_report();
+
+	/**
+	 * @brief get the rtcp statistics of the received stream
+	 *
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_rtcp_stats(RTCPReceiveStats &stats);
+
+	/**
+	 * @brief send the generic NACK of the missing packets which are due to be requested
+	 * to the NAT pinhole destination
+	 *
+	 * @return true - the NACK was sent
+	 * @return false - fail, or no packet should be requested
+	 */
+	bool send_nack();
+
+	/**
+	 * @brief get the NACK statistics
+	 *
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_nack_stats(RTCPNackStats &stats);
+
+	/**
+	 * @brief get the FEC statistics, it can be called on any thread
+	 *
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_fec_stats(RTPFecStats &stats);
+
+	/**
+	 * @brief get the statistics of the receive socket, the kernel drops and the
+	 * receive queue occupancy. the streams of a bundle share the socket, they get
+	 * the statistics of the bundle socket.
+	 *
+	 * @param stats -- the statistics, output parameter
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool get_socket_stats(RTPSocketStats &stats);
+
+	/**
+	 * @brief get the receive socket, it can be registered to the receive reactor
+	 *
+	 * @return the receive socket
+	 */
+	RTPSocket get_socket() const;
+
+private:
+	/**
+	 * @brief get the next datagram from the receive batch. if all the datagrams
+	 * in the batch were consumed, the batch is refilled by one recvmmsg() call.
+	 *
+	 * @param timeout_us -- the timeout in microseconds
+	 * @return the datagram index in the receive batch, -1 if no datagram available
+	 */
+	int next_datagram(int64_t timeout_us);
+
+	/**
+	 * @brief bind the free pool slots to the batch slots whose datagrams were
+	 * moved to the jitter buffer, so the datagrams are received into the pool directly.
+	 */
+	void bind_batch_slots();
+
+	/**
+	 * @brief handle the rtcp packet which is multiplexed on the rtp socket
+	 *
+	 * @param data -- the rtcp packet
+	 * @param len -- the rtcp packet length
+	 */
+	void handle_rtcp_packet(const uint8_t *data, int len);
+
+	/**
+	 * @brief push the packets which the parity packets recover to the jitter buffer
+	 */
+	void recover_fec_packets();
+
+	/**
+	 * @brief initialize the packet pool, the jitter buffer and the rtcp statistics
+	 *
+	 * @param poolSize -- the packet pool slots count
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool init_playout(int poolSize);
+
+	/**
+	 * @brief handle the datagram in the pool slot
+	 *
+	 * @param slot -- the pool slot, its length is set
+	 *
+	 * @return true - the slot was moved to the jitter buffer
+	 * @return false - the slot is still owned by the caller
+	 */
+	bool handle_datagram(RTPPacketSlot *slot);
+
+	/**
+	 * @brief send the data to the NAT pinhole destination
+	 *
+	 * @param data -- the data pointer
+	 * @param len -- the data length
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool send_to_peer(const uint8_t *data, size_t len);
+
 private:
 	//whether the session was initialized
 	bool m_initialize;
 
-	//the socket transmitter
+	//the socket transmitter, it is NULL on a bundle
 	RTPTransmitterV4 *m_transmitter;
 
-	//whether reorder the rtp packets by their sequences.
-	bool m_reorder;
-	//the reorder packets list
-	std::list<RTPPacket *> m_reorder_list;
+	//the bundle which pushes the datagrams, NULL if the session has its own socket
+	RTPBundleReceiver *m_bundle;
+	//the ssrc which the session is registered to the bundle by
+	uint32_t m_bundle_ssrc;
+	//the NAT pinhole destination on the bundle socket
+	IPAddrV4 *m_bundle_destination;
+	//the datagrams pushed by the bundle since the last receive_rtp_packets() call
+	int m_bundle_pushed;
+
+	//whether the rtp packets are played out through the jitter buffer
+	bool m_use_jitter_buffer;
+
+	//the packet pool, the jitter buffer holds the slots of the pool
+	RTPPacketPool m_packet_pool;
+	//the pool slots bound to the receive batch slots, NULL if the batch slot uses its own buffer
+	std::vector<RTPPacketSlot *> m_batch_slots;
+	//the jitter buffer
+	RTPJitterBuffer m_jitter_buffer;
+
+	//the receive batch, it was used to receive data from remote peer
+	RTPPacketBatch m_recv_batch;
+	//the next unconsumed datagram index in the receive batch
+	int m_recv_batch_pos;
+	//the time when the receive batch was filled, the monotonic time in microseconds
+	uint64_t m_recv_batch_time;
+	//the rtp packet views of the datagrams in the receive batch
+	std::vector<RTPPacket> m_batch_packets;
+
+	//the rtcp statistics of the received stream
+	RTCPReceiverStatistics m_rtcp_statistics;
+	//the ssrc of the receiver reports
+	uint32_t m_rtcp_ssrc;
+	//the receiver report buffer
+	uint8_t m_rtcp_buffer[RTCP_PACKET_BUFFER_SIZE];
+
+	//whether the NACK is enabled
+	bool m_nack_enabled;
+	//the NACK generator
+	RTCPNackGenerator m_nack_generator;
+	//the NACK sequences buffer
+	uint16_t m_nack_sequences[RTCP_NACK_MAX_SEQUENCES];
+	//the round trip time which the playout delay was raised by
+	int m_nack_rtt_ms;
+	//the ssrc of the received stream
+	uint32_t m_media_ssrc;
 
-	//the rtp packet, it was used to receive data from remote peer
-	RTPPacket *m_rtp_packet;
-	//the rtp receive buffer, it was used to receive data from remote peer
-	uint8_t *m_recv_buffer;
+	//whether the FEC is enabled
+	bool m_fec_enabled;
+	//whether a parity packet was received, the decoder is initialized then
+	bool m_fec_active;
+	//the XOR parity decoder
+	RTPFecDecoder m_fec_decoder;
 };
 
 #endif
\ No newline at end of file
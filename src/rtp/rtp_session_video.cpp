@@ -1,18 +1,32 @@
 #include "rtp_session_video.h"
 
 #include <string.h>
-#include <time.h>
 #include "common_logger.h"
+#include "common_utils.h"
 
 RTPSessionVideo::RTPSessionVideo()
 {
 	m_initialize = false;
 	m_h264_rtp_builder = NULL;
 	m_transmitter = NULL;
+	m_ssrc = 0;
+	m_pacer = NULL;
+	m_mtu = RTP_DEFAULT_MTU;
+	m_pmtu_discovery = false;
+	m_pmtu_probe_time = 0;
 }
 
 RTPSessionVideo::~RTPSessionVideo()
 {
+	//the reactor callbacks use the transmitter
+	m_rtcp.stop();
+
+	//the pacer thread uses the transmitter
+	if (m_pacer)
+	{
+		m_pacer->remove_transmitter(m_transmitter);
+	}
+
 	if (m_h264_rtp_builder)
 	{
 		delete m_h264_rtp_builder;
@@ -45,6 +59,7 @@ bool RTPSessionVideo::init(uint16_t sequenceStart, uint32_t timestampStart, uint
 		goto exitFlag;
 	}
 	m_h264_rtp_builder->set_ssrc(ssrc);
+	m_ssrc = ssrc;
 
 	m_transmitter = new RTPTransmitterV4();
 	if (!m_transmitter)
@@ -59,6 +74,19 @@ bool RTPSessionVideo::init(uint16_t sequenceStart, uint32_t timestampStart, uint
 		goto exitFlag;
 	}
 
+	ret = m_history.init();
+	if (!ret)
+	{
+		goto exitFlag;
+	}
+
+	//the parity packets have their own sequence space
+	ret = m_fec_encoder.init(sequenceStart, ssrc);
+	if (!ret)
+	{
+		goto exitFlag;
+	}
+
 	m_initialize = true;
 	return true;
 
@@ -111,8 +139,10 @@ bool RTPSessionVideo::send_h264_data(const uint8_t *data, size_t length)
 		return false;
 	}
 
-	clock_t now = clock();
-	uint32_t now_ms = (uint32_t)(now * 1000 / CLOCKS_PER_SEC);
+	//the rtp timestamp is the monotonic sending time in milliseconds
+	uint32_t now_ms = (uint32_t)get_monotonic_time_ms();
+
+	update_packet_size();
 
 	bool ret = m_h264_rtp_builder->send_data(data, length);
 	if (!ret)
@@ -128,14 +158,18 @@ bool RTPSessionVideo::send_h264_data(const uint8_t *data, size_t length)
 		return false;
 	}
 
-	uint8_t num = (uint8_t)m_rtp_send_packets.size();
-	std::vector<std::pair<const uint8_t *, int>>::iterator it;
+	uint16_t num = (uint16_t)m_rtp_send_packets.size();
+	uint32_t octets = 0;
+	bool keyframe = m_h264_rtp_builder->get_access_unit_index().has_idr();
+	std::vector<RTPPacketIov>::iterator it;
 	for (it = m_rtp_send_packets.begin(); it != m_rtp_send_packets.end(); it++)
 	{
-		RTPExtensionHeader *header = (RTPExtensionHeader *)(it->first + sizeof(RTPHeader));
+		octets += (uint32_t)(it->get_length() - sizeof(RTPHeader) - sizeof(RTPExtensionHeader));
+
+		RTPExtensionHeader *header = (RTPExtensionHeader *)(it->header + sizeof(RTPHeader));
 		header->reserved = htons(num);
 		header->seqHigh16 = 0;
-		RTPHeader *rtpHeader = (RTPHeader *)it->first;
+		RTPHeader *rtpHeader = (RTPHeader *)it->header;
 		if (it == m_rtp_send_packets.end() - 1)
 		{
 			rtpHeader->marker = 1;
@@ -143,12 +177,127 @@ bool RTPSessionVideo::send_h264_data(const uint8_t *data, size_t length)
 
 		rtpHeader->timestamp = htonl(now_ms);
 
-		ret = m_transmitter->send_data(it->first, it->second);
-		if (!ret)
+		m_history.put(*it);
+	}
+
+	//the parity packets are sent after the rtp packets, they are not retransmitted
+	m_fec_encoder.encode(m_rtp_send_packets, keyframe);
+
+	//the frame is spread over the frame interval by the pacer, otherwise all the
+	//packets of the frame are sent to all the destinations at once
+	ret = (m_pacer && m_pacer->enqueue_video(m_transmitter, m_rtp_send_packets)) ||
+		  m_transmitter->send_packets(m_rtp_send_packets);
+	if (ret)
+	{
+		m_rtcp.on_rtp_sent(num, octets, num * (uint32_t)(RTP_IP_UDP_HEADER_SIZE + RTP_H264_HEADER_SIZE));
+	}
+
+	return ret;
+}
+
+void RTPSessionVideo::set_mtu(int mtu)
+{
+	m_mtu = mtu;
+}
+
+bool RTPSessionVideo::set_pmtu_discovery(bool enabled)
+{
+	if (!m_initialize || !m_transmitter->set_pmtu_discovery(enabled))
+	{
+		return false;
+	}
+
+	m_pmtu_discovery = enabled;
+	m_pmtu_probe_time = get_monotonic_time_ms();
+	return true;
+}
+
+void RTPSessionVideo::get_mtu_stats(RTPMtuStats &stats)
+{
+	memset(&stats, 0, sizeof(stats));
+	stats.mtu = m_mtu;
+	if (!m_initialize)
+	{
+		return;
+	}
+
+	stats.pathMtu = m_transmitter->get_path_mtu();
+	stats.maxPacketSize = m_h264_rtp_builder->get_max_packet_size();
+	stats.mtuExceeded = m_transmitter->get_mtu_exceeded();
+}
+
+void RTPSessionVideo::update_packet_size()
+{
+	int mtu = m_mtu;
+	if (m_pmtu_discovery)
+	{
+		//the learned path mtu expires, so the routes are queried again periodically
+		int pathMtu;
+		uint64_t now = get_monotonic_time_ms();
+		if (now - m_pmtu_probe_time >= (uint64_t)RTP_PMTU_PROBE_INTERVAL_MS)
+		{
+			pathMtu = m_transmitter->probe_path_mtu();
+			m_pmtu_probe_time = now;
+		}
+		else
+		{
+			pathMtu = m_transmitter->get_path_mtu();
+		}
+
+		if (pathMtu > 0 && pathMtu < mtu)
 		{
-			return false;
+			mtu = pathMtu;
 		}
 	}
 
-	return true;
+	//the parity packet is larger than the largest packet it protects, the media packets leave room for it
+	int maxPacketSize = mtu - RTP_IP_UDP_HEADER_SIZE;
+	if (m_fec_encoder.is_enabled())
+	{
+		maxPacketSize -= RTP_FEC_RTP_HEADER_SIZE + RTP_FEC_HEADER_SIZE;
+	}
+
+	m_h264_rtp_builder->set_max_packet_size(maxPacketSize);
+
+	//the builder raises a tiny size to its minimum, those packets are not protected
+	int protectedSize = m_h264_rtp_builder->get_max_packet_size();
+	m_fec_encoder.set_max_protected_size(protectedSize < maxPacketSize ? protectedSize : maxPacketSize);
+}
+
+void RTPSessionVideo::set_fec_protection(int deltaPercent, int keyPercent)
+{
+	m_fec_encoder.set_protection(deltaPercent, keyPercent);
+}
+
+void RTPSessionVideo::get_send_stats(uint64_t &syscalls, uint64_t &datagrams)
+{
+	syscalls = 0;
+	datagrams = 0;
+	if (!m_initialize)
+	{
+		return;
+	}
+
+	m_transmitter->get_send_stats(syscalls, datagrams);
+}
+
+void RTPSessionVideo::set_pacer(RTPPacer *pacer)
+{
+	m_pacer = pacer;
+}
+
+bool RTPSessionVideo::start_rtcp(RTPReceiveReactor *reactor)
+{
+	if (!m_initialize)
+	{
+		return false;
+	}
+
+	m_rtcp.set_packet_history(&m_history);
+	return m_rtcp.start(reactor, m_transmitter, m_ssrc, RTCP_DEFAULT_CLOCK_RATE);
+}
+
+void RTPSessionVideo::get_rtcp_stats(RTCPSendStats &stats)
+{
+	m_rtcp.get_stats(stats);
 }
\ No newline at end of file
@@ -5,6 +5,11 @@
 #include <stdint.h>
 #include "rtp_h264_packet_builder.h"
 #include "rtp_transmitter_v4.h"
+#include "rtp_receive_reactor.h"
+#include "rtcp_session_sender.h"
+#include "rtp_pacer.h"
+#include "rtp_packet_history.h"
+#include "rtp_fec_encoder.h"
 
 class RTPSessionVideo
 {
@@ -71,6 +76,84 @@ public:
 	 */
 	bool send_h264_data(const uint8_t *data, size_t length);
 
+	/**
+	 * @brief set the XOR parity protection of the frames, the parity packets are sent
+	 * after the rtp packets of each frame. the protection is disabled by default.
+	 *
+	 * @param deltaPercent -- the parity packets percent of the delta frames, 0 disables the protection
+	 * @param keyPercent -- the parity packets percent of the keyframes, 0 disables the protection
+	 */
+	void set_fec_protection(int deltaPercent, int keyPercent);
+
+	/**
+	 * @brief set the mtu of the session. the rtp packets are built to fit in the mtu
+	 * or the path mtu if it is smaller, it takes effect from the next frame.
+	 *
+	 * @param mtu -- the mtu, RTP_DEFAULT_MTU by default
+	 */
+	void set_mtu(int mtu);
+
+	/**
+	 * @brief enable the path mtu discovery. the datagrams are not fragmented, the
+	 * path mtu is queried when a datagram exceeds it and every RTP_PMTU_PROBE_INTERVAL_MS.
+	 * NOTE: the function must be called after init()
+	 *
+	 * @param enabled -- whether the discovery is enabled, it is disabled by default
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool set_pmtu_discovery(bool enabled);
+
+	/**
+	 * @brief get the mtu statistics, the packets per frame and the header overhead
+	 * are in the rtcp statistics
+	 *
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_mtu_stats(RTPMtuStats &stats);
+
+	/**
+	 * @brief get the send statistics
+	 *
+	 * @param syscalls -- the send system calls count, output parameter
+	 * @param datagrams -- the sent datagrams count, output parameter
+	 */
+	void get_send_stats(uint64_t &syscalls, uint64_t &datagrams);
+
+	/**
+	 * @brief set the send pacer, the rtp packets of the frames are queued to the pacer.
+	 * the packets are sent directly if the pacer is NULL, not running or full.
+	 * NOTE: the pacer must outlive the session
+	 *
+	 * @param pacer -- the pacer
+	 */
+	void set_pacer(RTPPacer *pacer);
+
+	/**
+	 * @brief start the rtcp reports of the session. the rtp socket and the report
+	 * timer are registered to the reactor, they are unregistered when the session is deleted.
+	 * the packets requested by the received NACKs are retransmitted.
+	 * NOTE: the function must be called after init()
+	 *
+	 * @param reactor -- the reactor
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool start_rtcp(RTPReceiveReactor *reactor);
+
+	/**
+	 * @brief get the rtcp statistics of the sent stream
+	 *
+	 * @param stats -- the statistics, output parameter
+	 */
+	void get_rtcp_stats(RTCPSendStats &stats);
+
+private:
+	/**
+	 * @brief probe the path mtu if it is due, and set the max packet size of the builder
+	 */
+	void update_packet_size();
+
 private:
 	//whether the session was initialized
 	bool m_initialize;
@@ -78,12 +161,34 @@ private:
 	//the socket transmitter
 	RTPTransmitterV4 *m_transmitter;
 
+	//the rtp ssrc
+	uint32_t m_ssrc;
+
+	//the rtcp reports
+	RTCPSessionSender m_rtcp;
+
+	//the send pacer, NULL if the packets are sent directly
+	RTPPacer *m_pacer;
+
+	//the sent packets history, the packets requested by the NACKs are retransmitted from it
+	RTPPacketHistory m_history;
+
+	//the XOR parity encoder of the frames
+	RTPFecEncoder m_fec_encoder;
+
 	//the h264 rtp packet builder
 	RTPH264PacketBuilder *m_h264_rtp_builder;
 
-	//the rtp packets vector, it was used to build the rtp packet for sending to remote peer
-	// pair: first -- rtp packet data; second -- rtp packet data length
-	std::vector<std::pair<const uint8_t *, int>> m_rtp_send_packets;
+	//the configured mtu
+	int m_mtu;
+	//whether the path mtu discovery is enabled
+	bool m_pmtu_discovery;
+	//the monotonic time of the last path mtu query in milliseconds
+	uint64_t m_pmtu_probe_time;
+
+	//the rtp packets vector, it was used to build the rtp packet for sending to remote peer.
+	//the header parts are in the builder, the payload parts point to the h264 data
+	std::vector<RTPPacketIov> m_rtp_send_packets;
 };
 
 #endif
\ No newline at end of file
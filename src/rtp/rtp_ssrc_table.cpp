@@ -0,0 +1,155 @@
+#include "rtp_ssrc_table.h"
+
+#include <new>
+#include <string.h>
+
+#include "common_logger.h"
+
+RTPSsrcTable::RTPSsrcTable()
+{
+	m_slots = NULL;
+	m_mask = 0;
+	m_shift = 32;
+	m_count = 0;
+}
+
+RTPSsrcTable::~RTPSsrcTable()
+{
+	if (m_slots)
+	{
+		delete[] m_slots;
+		m_slots = NULL;
+	}
+}
+
+bool RTPSsrcTable::init(int capacity)
+{
+	uint32_t slots = RTP_SSRC_TABLE_MIN_CAPACITY;
+	while ((int64_t)slots < (int64_t)capacity * 2)
+	{
+		slots <<= 1;
+	}
+
+	return rehash(slots);
+}
+
+bool RTPSsrcTable::rehash(uint32_t capacity)
+{
+	Slot *slots = new (std::nothrow) Slot[capacity];
+	if (!slots)
+	{
+		LOG_ERROR("RTPSsrcTable::rehash(), out of memory");
+		return false;
+	}
+	memset(slots, 0, sizeof(Slot) * capacity);
+
+	Slot *oldSlots = m_slots;
+	uint32_t oldCapacity = m_slots ? m_mask + 1 : 0;
+
+	m_slots = slots;
+	m_mask = capacity - 1;
+	m_shift = 32;
+	for (uint32_t n = capacity; n > 1; n >>= 1)
+	{
+		m_shift--;
+	}
+
+	for (uint32_t i = 0; i < oldCapacity; i++)
+	{
+		if (!oldSlots[i].value)
+		{
+			continue;
+		}
+
+		uint32_t index = hash(oldSlots[i].ssrc);
+		while (m_slots[index].value)
+		{
+			index = (index + 1) & m_mask;
+		}
+		m_slots[index] = oldSlots[i];
+	}
+
+	if (oldSlots)
+	{
+		delete[] oldSlots;
+	}
+	return true;
+}
+
+bool RTPSsrcTable::insert(uint32_t ssrc, void *value)
+{
+	if (!value)
+	{
+		return false;
+	}
+
+	if (!m_slots && !init(0))
+	{
+		return false;
+	}
+
+	uint32_t index = hash(ssrc);
+	while (m_slots[index].value)
+	{
+		if (m_slots[index].ssrc == ssrc)
+		{
+			m_slots[index].value = value;
+			return true;
+		}
+		index = (index + 1) & m_mask;
+	}
+
+	//the load factor is kept under 1/2, the probe sequences stay short
+	if ((uint32_t)(m_count + 1) * 2 > m_mask + 1)
+	{
+		if (!rehash((m_mask + 1) * 2))
+		{
+			return false;
+		}
+		return insert(ssrc, value);
+	}
+
+	m_slots[index].ssrc = ssrc;
+	m_slots[index].value = value;
+	m_count++;
+	return true;
+}
+
+bool RTPSsrcTable::remove(uint32_t ssrc)
+{
+	if (!m_slots)
+	{
+		return false;
+	}
+
+	uint32_t index = hash(ssrc);
+	while (m_slots[index].value && m_slots[index].ssrc != ssrc)
+	{
+		index = (index + 1) & m_mask;
+	}
+
+	if (!m_slots[index].value)
+	{
+		return false;
+	}
+
+	//shift the following entries of the cluster back, so no probe sequence is broken
+	uint32_t hole = index;
+	uint32_t next = (hole + 1) & m_mask;
+	while (m_slots[next].value)
+	{
+		uint32_t home = hash(m_slots[next].ssrc);
+		//the entry can fill the hole if its home slot is not in (hole, next]
+		if (((next - home) & m_mask) >= ((next - hole) & m_mask))
+		{
+			m_slots[hole] = m_slots[next];
+			hole = next;
+		}
+		next = (next + 1) & m_mask;
+	}
+
+	m_slots[hole].ssrc = 0;
+	m_slots[hole].value = NULL;
+	m_count--;
+	return true;
+}
@@ -0,0 +1,124 @@
+#ifndef _H_RTP_SSRC_TABLE_H_
+#define _H_RTP_SSRC_TABLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+//the min slots count of the ssrc table
+const int RTP_SSRC_TABLE_MIN_CAPACITY = 16;
+
+/**
+ * the ssrc hash table. the 32-bit ssrc is mapped to a value by open addressing
+ * with the linear probing, the slots are in one flat array, so a lookup usually
+ * touches one cache line. the table is grown to keep the load factor under 1/2,
+ * and the removed slots are closed by the backward shift, there is no tombstone.
+ * NOTE: the table is not thread safe.
+ */
+class RTPSsrcTable
+{
+public:
+	RTPSsrcTable();
+	virtual ~RTPSsrcTable();
+
+	/**
+	 * @brief initialize the table
+	 *
+	 * @param capacity -- the expected entries count
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool init(int capacity);
+
+	/**
+	 * @brief insert the ssrc, the value of an existing ssrc is replaced
+	 *
+	 * @param ssrc -- the ssrc
+	 * @param value -- the value, it must not be NULL
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool insert(uint32_t ssrc, void *value);
+
+	/**
+	 * @brief remove the ssrc
+	 *
+	 * @param ssrc -- the ssrc
+	 *
+	 * @return true - the ssrc was removed
+	 * @return false - the ssrc is not found
+	 */
+	bool remove(uint32_t ssrc);
+
+	/**
+	 * @brief find the value of the ssrc
+	 *
+	 * @param ssrc -- the ssrc
+	 *
+	 * @return the value, NULL if the ssrc is not found
+	 */
+	void *find(uint32_t ssrc) const
+	{
+		if (!this->m_slots)
+		{
+			return NULL;
+		}
+
+		uint32_t index = hash(ssrc);
+		while (this->m_slots[index].value)
+		{
+			if (this->m_slots[index].ssrc == ssrc)
+			{
+				return this->m_slots[index].value;
+			}
+			index = (index + 1) & this->m_mask;
+		}
+
+		return NULL;
+	}
+
+	/**
+	 * @brief get the entries count
+	 */
+	int get_count() const
+	{
+		return this->m_count;
+	}
+
+private:
+	struct Slot
+	{
+		uint32_t ssrc;
+		//the value, NULL if the slot is empty
+		void *value;
+	};
+
+	//the fibonacci hash, the ssrcs are random but the multiplication spreads the sequential ones too
+	uint32_t hash(uint32_t ssrc) const
+	{
+		return (uint32_t)(ssrc * 2654435769u) >> this->m_shift;
+	}
+
+	/**
+	 * @brief rebuild the table with the slots count
+	 *
+	 * @param capacity -- the slots count, a power of 2
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool rehash(uint32_t capacity);
+
+private:
+	//the slots array
+	Slot *m_slots;
+	//the slots count - 1
+	uint32_t m_mask;
+	//32 - log2(the slots count)
+	int m_shift;
+	//the entries count
+	int m_count;
+};
+
+#endif
@@ -4,9 +4,12 @@
 #include <string.h>
 
 #ifdef _WIN32
+#include <ws2tcpip.h>
 #else
 #include <unistd.h>
+#include <poll.h>
 #include <sys/ioctl.h>
+#include <linux/sock_diag.h>
 #endif
 
 #include "common_logger.h"
@@ -25,10 +28,17 @@ RTPTransmitterV4::RTPTransmitterV4()
 	m_initialize = false;
 	m_bind_ip = 0;
 	m_bind_port = 0;
+	m_send_syscalls = 0;
+	m_send_datagrams = 0;
+	m_pmtu_discovery = false;
+	m_path_mtu = 0;
+	m_mtu_exceeded = 0;
+	m_recv_drops = 0;
 #ifdef _WIN32
 	m_bind_socket = INVALID_SOCKET;
 #else
 	m_bind_socket = -1;
+	m_gso_enabled = false;
 	pthread_mutex_init(&m_mutex, NULL);
 #endif
 }
@@ -66,20 +76,18 @@ bool RTPTransmitterV4::init(RTPTransParamsV4 *params)
 		return true;
 	}
 
-	uint8_t ttl;
-	if (params)
+	RTPTransParamsV4 defaultParams;
+	if (!params)
 	{
-		this->m_bind_ip = params->bindIP;
-		this->m_bind_port = params->bindPort;
-		ttl = params->ttl;
-	}
-	else
-	{
-		this->m_bind_ip = 0;
-		this->m_bind_port = get_available_port();
-		ttl = 128;
+		defaultParams.bindPort = get_available_port();
+		params = &defaultParams;
 	}
 
+	this->m_bind_ip = params->bindIP;
+	this->m_bind_port = params->bindPort;
+	int ttl = params->ttl;
+	int priority = params->priority;
+
 	m_bind_socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
 #ifdef _WIN32
 	if (m_bind_socket == INVALID_SOCKET)
@@ -93,34 +101,24 @@ bool RTPTransmitterV4::init(RTPTransParamsV4 *params)
 	}
 #endif
 
-	/*
-	int one = 1;
-
-#ifdef _WIN32
-	if (setsockopt(m_bind_socket, SOL_SOCKET, SO_REUSEADDR, (const char *)&one, sizeof(one)) != 0)
+	if (params->reuseAddress)
 	{
-		LOG_ERROR("fail to reuse address");
+		int one = 1;
+		if (setsockopt(m_bind_socket, SOL_SOCKET, SO_REUSEADDR, (const char *)&one, sizeof(one)) != 0)
+		{
+			LOG_ERROR("fail to reuse address");
 
-		closesocket(m_bind_socket);
-		m_bind_socket = INVALID_SOCKET;
-		return false;
-	}
+#ifdef _WIN32
+			closesocket(m_bind_socket);
+			m_bind_socket = INVALID_SOCKET;
 #else
-	if (setsockopt(m_bind_socket, SOL_SOCKET, SO_REUSEADDR, (const void *)&one, sizeof(one)) != 0)
-	{
-		LOG_ERROR("fail to reuse address");
-
-		close(m_bind_socket);
-		m_bind_socket = -1;
-		return false;
+			close(m_bind_socket);
+			m_bind_socket = -1;
+#endif
+			return false;
+		}
 	}
 
-	if (setsockopt(m_bind_socket, IPPROTO_IP, IP_TTL, (const void *)&ttl, sizeof(ttl)) != 0)
-	{
-		LOG_WARNING("fail to set IP_TTL: %d; error was (%d)", ttl, errno);
-	}
-#endif
-	*/
 	sockaddr_in addr;
 	memset(&addr, 0, sizeof(sockaddr_in));
 	addr.sin_family = AF_INET;
@@ -141,6 +139,47 @@ bool RTPTransmitterV4::init(RTPTransParamsV4 *params)
 		return false;
 	}
 
+	//the buffers absorb the bursts of the keyframes, the errors are not fatal
+	if (params->recvBufferSize > 0)
+	{
+		set_buffer_size(true, params->recvBufferSize);
+	}
+
+	if (params->sendBufferSize > 0)
+	{
+		set_buffer_size(false, params->sendBufferSize);
+	}
+
+	if (setsockopt(m_bind_socket, IPPROTO_IP, IP_TTL, (const char *)&ttl, sizeof(ttl)) != 0)
+	{
+		LOG_WARNING("fail to set IP_TTL: %d; error was (%d)", ttl, errno);
+	}
+
+#ifdef _WIN32
+	if (priority >= 0)
+	{
+		LOG_WARNING("the socket priority is not supported");
+	}
+#else
+	//the datagrams carry the drops counter of the socket, the kernel drops are not silent
+	int one = 1;
+	if (setsockopt(m_bind_socket, SOL_SOCKET, SO_RXQ_OVFL, (const void *)&one, sizeof(one)) != 0)
+	{
+		LOG_WARNING("fail to set SO_RXQ_OVFL; error was (%d)", errno);
+	}
+
+	//the priority maps the packets to the qdisc band, the errors are not fatal
+	if (priority >= 0 && setsockopt(m_bind_socket, SOL_SOCKET, SO_PRIORITY, (const void *)&priority, sizeof(priority)) != 0)
+	{
+		LOG_WARNING("fail to set SO_PRIORITY: %d; error was (%d)", priority, errno);
+	}
+
+	//UDP GSO is supported since linux 4.18
+	int segment = 0;
+	socklen_t segmentLen = sizeof(segment);
+	m_gso_enabled = (getsockopt(m_bind_socket, SOL_UDP, UDP_SEGMENT, (void *)&segment, &segmentLen) == 0);
+#endif
+
 	m_initialize = true;
 	return true;
 }
@@ -155,6 +194,10 @@ bool RTPTransmitterV4::add_destination(const char *ip, const uint16_t &port)
 
 	IPAddrV4 *addr = new IPAddrV4(ip, port);
 	m_destinations.push_back(addr);
+	if (m_pmtu_discovery)
+	{
+		m_path_mtu = query_path_mtu_locked();
+	}
 
 #ifdef _WIN32
 #else
@@ -184,6 +227,10 @@ bool RTPTransmitterV4::delete_destination(const char *ip, const uint16_t &port)
 			it++;
 		}
 	}
+	if (m_pmtu_discovery)
+	{
+		m_path_mtu = query_path_mtu_locked();
+	}
 
 #ifdef _WIN32
 #else
@@ -205,6 +252,7 @@ bool RTPTransmitterV4::clear_destination()
 		delete *it;
 	}
 	m_destinations.clear();
+	m_path_mtu = 0;
 #ifdef _WIN32
 #else
 	pthread_mutex_unlock(&m_mutex);
@@ -225,8 +273,17 @@ bool RTPTransmitterV4::send_data(const uint8_t *data, size_t len)
 	{
 		int ret = ::sendto(m_bind_socket, (const char *)data, (int)len, 0,
 						   (const struct sockaddr *)(*it)->get_sock_addr(), (int)sizeof(sockaddr_in));
+		m_send_syscalls++;
 		if (ret == -1)
 		{
+#ifdef _WIN32
+			if (WSAGetLastError() == WSAEMSGSIZE)
+#else
+			if (errno == EMSGSIZE)
+#endif
+			{
+				on_mtu_exceeded_locked();
+			}
 #ifdef _WIN32
 #else
 			pthread_mutex_unlock(&m_mutex);
@@ -241,15 +298,510 @@ bool RTPTransmitterV4::send_data(const uint8_t *data, size_t len)
 #endif
 			return false;
 		}
+		m_send_datagrams++;
+	}
+
+#ifdef _WIN32
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+	return true;
+}
+
+bool RTPTransmitterV4::send_data_to(const uint8_t *data, size_t len, const IPAddrV4 &addr)
+{
+	if (!m_initialize)
+	{
+		return false;
+	}
+
+	//sendto() is thread safe, the send statistics are not counted so no lock is taken
+	int ret = ::sendto(m_bind_socket, (const char *)data, (int)len, 0,
+					   (const struct sockaddr *)addr.get_sock_addr(), (int)sizeof(sockaddr_in));
+	if (ret < (int)len)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool RTPTransmitterV4::send_packets(const std::vector<std::pair<const uint8_t *, int> > &packets)
+{
+	if (!m_initialize)
+	{
+		return false;
+	}
+
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+
+	//the contiguous packets are sent as the packets which have no payload part
+	m_send_packets.resize(packets.size());
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		m_send_packets[i].header = packets[i].first;
+		m_send_packets[i].headerLen = packets[i].second;
+		m_send_packets[i].payload = NULL;
+		m_send_packets[i].payloadLen = 0;
+	}
+
+	bool ret = send_packets_locked(m_send_packets);
+
+#ifdef _WIN32
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+	return ret;
+}
+
+bool RTPTransmitterV4::send_packets(const std::vector<RTPPacketIov> &packets)
+{
+	if (!m_initialize)
+	{
+		return false;
+	}
+
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+
+	bool ret = send_packets_locked(packets);
+
+#ifdef _WIN32
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+	return ret;
+}
+
+bool RTPTransmitterV4::send_packets_locked(const std::vector<RTPPacketIov> &packets)
+{
+#ifdef _WIN32
+	std::vector<IPAddrV4 *>::const_iterator it = m_destinations.begin();
+	for (; it != m_destinations.end(); it++)
+	{
+		for (size_t i = 0; i < packets.size(); i++)
+		{
+			WSABUF buffers[2];
+			buffers[0].buf = (char *)packets[i].header;
+			buffers[0].len = (ULONG)packets[i].headerLen;
+			buffers[1].buf = (char *)packets[i].payload;
+			buffers[1].len = (ULONG)packets[i].payloadLen;
+
+			DWORD sentLen = 0;
+			int ret = ::WSASendTo(m_bind_socket, buffers, packets[i].payloadLen > 0 ? 2 : 1, &sentLen, 0,
+								  (const struct sockaddr *)(*it)->get_sock_addr(), (int)sizeof(sockaddr_in), NULL, NULL);
+			m_send_syscalls++;
+			if (ret != 0 || (int)sentLen < packets[i].get_length())
+			{
+				if (ret != 0 && WSAGetLastError() == WSAEMSGSIZE)
+				{
+					on_mtu_exceeded_locked();
+				}
+				return false;
+			}
+			m_send_datagrams++;
+		}
+	}
+
+	return true;
+#else
+	if (packets.empty() || m_destinations.empty())
+	{
+		return true;
+	}
+
+	bool gso = m_gso_enabled;
+	int count = build_send_messages(packets, gso);
+	int sent = send_messages(0, count);
+	int error = errno;
+
+	int datagrams = 0;
+	for (int i = 0; i < sent; i++)
+	{
+		datagrams += m_send_segments[i];
+	}
+	m_send_datagrams += datagrams;
+
+	if (sent < count && gso && (error == EIO || error == EINVAL || error == ENOPROTOOPT || error == EOPNOTSUPP))
+	{
+		//the device or the route does not support GSO, disable it and send the
+		//remaining datagrams one by one. the messages without GSO are built in
+		//the same order, so the sent datagrams count is the index of the first
+		//message to send.
+		LOG_WARNING("UDP GSO send failed, %d, fall back to sendmmsg without GSO", error);
+		m_gso_enabled = false;
+
+		count = build_send_messages(packets, false);
+		sent = datagrams + send_messages(datagrams, count - datagrams);
+		error = errno;
+		m_send_datagrams += sent - datagrams;
+	}
+
+	if (sent < count)
+	{
+		//the datagrams after the failed one are not sent, the caller sends smaller packets next time
+		if (error == EMSGSIZE)
+		{
+			on_mtu_exceeded_locked();
+		}
+		LOG_ERROR("sendmmsg failed, %d of %d messages sent, %d", sent, count, error);
+		return false;
+	}
+
+	return true;
+#endif
+}
+
+void RTPTransmitterV4::get_send_stats(uint64_t &syscalls, uint64_t &datagrams)
+{
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+	syscalls = m_send_syscalls;
+	datagrams = m_send_datagrams;
+#else
+	pthread_mutex_lock(&m_mutex);
+	syscalls = m_send_syscalls;
+	datagrams = m_send_datagrams;
+	pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+void RTPTransmitterV4::set_buffer_size(bool recv, uint32_t size)
+{
+	int value = (int)size;
+	const char *name = recv ? "SO_RCVBUF" : "SO_SNDBUF";
+
+#ifdef _WIN32
+	if (setsockopt(m_bind_socket, SOL_SOCKET, recv ? SO_RCVBUF : SO_SNDBUF, (const char *)&value, sizeof(value)) != 0)
+	{
+		LOG_WARNING("fail to set %s: %u", name, size);
+	}
+#else
+	if (setsockopt(m_bind_socket, SOL_SOCKET, recv ? SO_RCVBUFFORCE : SO_SNDBUFFORCE, (const void *)&value, sizeof(value)) == 0)
+	{
+		return;
+	}
+
+	if (setsockopt(m_bind_socket, SOL_SOCKET, recv ? SO_RCVBUF : SO_SNDBUF, (const void *)&value, sizeof(value)) != 0)
+	{
+		LOG_WARNING("fail to set %s: %u; error was (%d)", name, size, errno);
+		return;
+	}
+
+	//the kernel doubles the size for its bookkeeping, and limits it by net.core.rmem_max/wmem_max
+	int actual = 0;
+	socklen_t len = sizeof(actual);
+	if (getsockopt(m_bind_socket, SOL_SOCKET, recv ? SO_RCVBUF : SO_SNDBUF, (void *)&actual, &len) == 0 && actual / 2 < value)
+	{
+		LOG_WARNING("%s is limited to %d by the sysctl, %u was requested", name, actual / 2, size);
+	}
+#endif
+}
+
+bool RTPTransmitterV4::get_socket_stats(RTPSocketStats &stats)
+{
+	memset(&stats, 0, sizeof(stats));
+	if (!m_initialize)
+	{
+		return false;
+	}
+
+	int recvBuffer = 0;
+	int sendBuffer = 0;
+#ifdef _WIN32
+	int len = sizeof(int);
+	getsockopt(m_bind_socket, SOL_SOCKET, SO_RCVBUF, (char *)&recvBuffer, &len);
+	len = sizeof(int);
+	getsockopt(m_bind_socket, SOL_SOCKET, SO_SNDBUF, (char *)&sendBuffer, &len);
+
+	//the pending bytes of all the datagrams
+	unsigned long queued = 0;
+	ioctlsocket(m_bind_socket, FIONREAD, &queued);
+	stats.recvQueued = (uint32_t)queued;
+#else
+	//the memory info counts the queued datagrams with their overhead, as the buffer size is counted
+	uint32_t meminfo[SK_MEMINFO_VARS];
+	socklen_t len = sizeof(meminfo);
+	memset(meminfo, 0, sizeof(meminfo));
+	if (getsockopt(m_bind_socket, SOL_SOCKET, SO_MEMINFO, (void *)meminfo, &len) == 0)
+	{
+		recvBuffer = (int)meminfo[SK_MEMINFO_RCVBUF];
+		sendBuffer = (int)meminfo[SK_MEMINFO_SNDBUF];
+		stats.recvQueued = meminfo[SK_MEMINFO_RMEM_ALLOC];
+		if (len > SK_MEMINFO_DROPS * sizeof(uint32_t))
+		{
+			stats.recvDrops = meminfo[SK_MEMINFO_DROPS];
+		}
+	}
+	else
+	{
+		len = sizeof(int);
+		getsockopt(m_bind_socket, SOL_SOCKET, SO_RCVBUF, (void *)&recvBuffer, &len);
+		len = sizeof(int);
+		getsockopt(m_bind_socket, SOL_SOCKET, SO_SNDBUF, (void *)&sendBuffer, &len);
+	}
+#endif
+
+	stats.recvBufferSize = (uint32_t)recvBuffer;
+	stats.sendBufferSize = (uint32_t)sendBuffer;
+	if (stats.recvDrops < m_recv_drops.load(std::memory_order_relaxed))
+	{
+		stats.recvDrops = m_recv_drops.load(std::memory_order_relaxed);
+	}
+	return true;
+}
+
+bool RTPTransmitterV4::set_pmtu_discovery(bool enabled)
+{
+	if (!m_initialize)
+	{
+		return false;
 	}
 
+#ifdef _WIN32
+	DWORD value = enabled ? 1 : 0;
+	if (setsockopt(m_bind_socket, IPPROTO_IP, IP_DONTFRAGMENT, (const char *)&value, sizeof(value)) != 0)
+	{
+		LOG_WARNING("fail to set IP_DONTFRAGMENT, %d", WSAGetLastError());
+		return false;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+#else
+	//the kernel fragments the datagrams locally if the discovery is disabled
+	int value = enabled ? IP_PMTUDISC_DO : IP_PMTUDISC_WANT;
+	if (setsockopt(m_bind_socket, IPPROTO_IP, IP_MTU_DISCOVER, (const void *)&value, sizeof(value)) != 0)
+	{
+		LOG_WARNING("fail to set IP_MTU_DISCOVER, %d", errno);
+		return false;
+	}
+
+	pthread_mutex_lock(&m_mutex);
+#endif
+	m_pmtu_discovery = enabled;
+	m_path_mtu = enabled ? query_path_mtu_locked() : 0;
 #ifdef _WIN32
 #else
 	pthread_mutex_unlock(&m_mutex);
 #endif
+
 	return true;
 }
 
+int RTPTransmitterV4::probe_path_mtu()
+{
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+#else
+	pthread_mutex_lock(&m_mutex);
+#endif
+	if (m_pmtu_discovery)
+	{
+		m_path_mtu = query_path_mtu_locked();
+	}
+	int mtu = m_path_mtu;
+#ifdef _WIN32
+#else
+	pthread_mutex_unlock(&m_mutex);
+#endif
+
+	return mtu;
+}
+
+int RTPTransmitterV4::get_path_mtu()
+{
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_path_mtu;
+#else
+	pthread_mutex_lock(&m_mutex);
+	int mtu = m_path_mtu;
+	pthread_mutex_unlock(&m_mutex);
+	return mtu;
+#endif
+}
+
+uint64_t RTPTransmitterV4::get_mtu_exceeded()
+{
+#ifdef _WIN32
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_mtu_exceeded;
+#else
+	pthread_mutex_lock(&m_mutex);
+	uint64_t exceeded = m_mtu_exceeded;
+	pthread_mutex_unlock(&m_mutex);
+	return exceeded;
+#endif
+}
+
+int RTPTransmitterV4::query_path_mtu_locked()
+{
+#ifdef _WIN32
+	//the route mtu is not available by the socket options
+	return 0;
+#else
+	//the bind socket is not connected, the route mtu of each destination is read
+	//by a connected socket. no datagram is sent by connect()
+	int minMtu = 0;
+	std::vector<IPAddrV4 *>::const_iterator it = m_destinations.begin();
+	for (; it != m_destinations.end(); it++)
+	{
+		int probe = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if (probe == -1)
+		{
+			continue;
+		}
+
+		if (::connect(probe, (const struct sockaddr *)(*it)->get_sock_addr(), sizeof(sockaddr_in)) == 0)
+		{
+			int mtu = 0;
+			socklen_t mtuLen = sizeof(mtu);
+			if (getsockopt(probe, IPPROTO_IP, IP_MTU, (void *)&mtu, &mtuLen) == 0 && mtu > 0 &&
+				(minMtu == 0 || mtu < minMtu))
+			{
+				minMtu = mtu;
+			}
+		}
+		close(probe);
+	}
+
+	return minMtu;
+#endif
+}
+
+void RTPTransmitterV4::on_mtu_exceeded_locked()
+{
+	m_mtu_exceeded++;
+	if (m_pmtu_discovery)
+	{
+		m_path_mtu = query_path_mtu_locked();
+	}
+	LOG_WARNING("the datagram exceeds the path mtu, the path mtu is %d", m_path_mtu);
+}
+
+#ifdef _WIN32
+#else
+int RTPTransmitterV4::build_send_messages(const std::vector<RTPPacketIov> &packets, bool gso)
+{
+	size_t total = packets.size() * m_destinations.size();
+	size_t controlSpace = CMSG_SPACE(sizeof(uint16_t));
+
+	//one message and two io vectors for each datagram at most
+	if (m_send_msgs.size() < total)
+	{
+		m_send_msgs.resize(total);
+		m_send_iovecs.resize(total * 2);
+		m_send_segments.resize(total);
+		m_send_controls.resize(total * controlSpace);
+	}
+
+	int msgIndex = 0;
+	int iovIndex = 0;
+	int packetsCount = (int)packets.size();
+
+	std::vector<IPAddrV4 *>::const_iterator it = m_destinations.begin();
+	for (; it != m_destinations.end(); it++)
+	{
+		int i = 0;
+		while (i < packetsCount)
+		{
+			struct mmsghdr &msg = m_send_msgs[msgIndex];
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_hdr.msg_name = (void *)(*it)->get_sock_addr();
+			msg.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			msg.msg_hdr.msg_iov = &m_send_iovecs[iovIndex];
+
+			//the GSO segment size is the size of the first datagram, all the
+			//segments but the last one must have the same size
+			int segmentSize = packets[i].get_length();
+			int maxSegments = 1;
+			if (gso)
+			{
+				maxSegments = RTP_GSO_MAX_BYTES / segmentSize;
+				if (maxSegments > RTP_GSO_MAX_SEGMENTS)
+				{
+					maxSegments = RTP_GSO_MAX_SEGMENTS;
+				}
+			}
+
+			//the kernel segments the super datagram by the size, not by the io vectors
+			int segments = 0;
+			int iovCount = 0;
+			do
+			{
+				m_send_iovecs[iovIndex + iovCount].iov_base = (void *)packets[i].header;
+				m_send_iovecs[iovIndex + iovCount].iov_len = packets[i].headerLen;
+				iovCount++;
+				if (packets[i].payloadLen > 0)
+				{
+					m_send_iovecs[iovIndex + iovCount].iov_base = (void *)packets[i].payload;
+					m_send_iovecs[iovIndex + iovCount].iov_len = packets[i].payloadLen;
+					iovCount++;
+				}
+				segments++;
+				i++;
+
+				//a short segment ends the super datagram
+				if (packets[i - 1].get_length() < segmentSize)
+				{
+					break;
+				}
+			} while (i < packetsCount && segments < maxSegments && packets[i].get_length() <= segmentSize);
+
+			msg.msg_hdr.msg_iovlen = iovCount;
+			iovIndex += iovCount;
+			m_send_segments[msgIndex] = segments;
+
+			if (segments > 1)
+			{
+				msg.msg_hdr.msg_control = &m_send_controls[msgIndex * controlSpace];
+				msg.msg_hdr.msg_controllen = controlSpace;
+
+				struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg.msg_hdr);
+				cmsg->cmsg_level = SOL_UDP;
+				cmsg->cmsg_type = UDP_SEGMENT;
+				cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+				uint16_t size = (uint16_t)segmentSize;
+				memcpy(CMSG_DATA(cmsg), &size, sizeof(size));
+			}
+
+			msgIndex++;
+		}
+	}
+
+	return msgIndex;
+}
+
+int RTPTransmitterV4::send_messages(int start, int count)
+{
+	int sent = 0;
+	while (sent < count)
+	{
+		int ret = ::sendmmsg(m_bind_socket, &m_send_msgs[start + sent], count - sent, 0);
+		m_send_syscalls++;
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+
+		sent += ret;
+	}
+
+	return sent;
+}
+#endif
+
 int RTPTransmitterV4::receive_data(uint8_t *buffer, int bufferlen, int64_t microseconds)
 {
 	if (!m_initialize)
@@ -329,4 +881,73 @@ int RTPTransmitterV4::receive_data(uint8_t *buffer, int bufferlen, int64_t micro
 	}
 
 	return 0;
+}
+
+int RTPTransmitterV4::receive_batch(RTPPacketBatch &batch, int64_t microseconds)
+{
+	batch.m_count = 0;
+	if (!m_initialize || !batch.m_initialize)
+	{
+		return 0;
+	}
+
+#ifdef _WIN32
+	int count = 0;
+	while (count < batch.m_capacity)
+	{
+		int len = receive_data(batch.m_buffers[count], batch.m_slot_size, count == 0 ? microseconds : 0);
+		if (len <= 0)
+		{
+			break;
+		}
+
+		batch.m_lengths[count++] = len;
+	}
+#else
+	batch.reset_controls();
+	int count = ::recvmmsg(m_bind_socket, &batch.m_msgs[0], batch.m_capacity, MSG_DONTWAIT, NULL);
+	if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && microseconds > 0)
+	{
+		struct pollfd pfd;
+		pfd.fd = m_bind_socket;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		if (::poll(&pfd, 1, (int)((microseconds + 999) / 1000)) > 0)
+		{
+			count = ::recvmmsg(m_bind_socket, &batch.m_msgs[0], batch.m_capacity, MSG_DONTWAIT, NULL);
+		}
+	}
+
+	if (count <= 0)
+	{
+		return 0;
+	}
+
+	uint32_t drops = 0;
+	bool hasDrops = false;
+	for (int i = 0; i < count; i++)
+	{
+		batch.m_lengths[i] = (int)batch.m_msgs[i].msg_len;
+
+		//the counter is attached once the socket has dropped a datagram, it only grows
+		struct msghdr *msg = &batch.m_msgs[i].msg_hdr;
+		for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg))
+		{
+			if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+			{
+				memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+				hasDrops = true;
+			}
+		}
+	}
+
+	if (hasDrops && drops != m_recv_drops.load(std::memory_order_relaxed))
+	{
+		m_recv_drops.store(drops, std::memory_order_relaxed);
+	}
+#endif
+
+	batch.m_count = count;
+	return count;
 }
\ No newline at end of file
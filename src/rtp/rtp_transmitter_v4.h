@@ -2,6 +2,7 @@
 #define _H_RTP_UDPV4_SOCKET_H_
 
 #include <vector>
+#include <atomic>
 
 #include <stdint.h>
 #include <sys/types.h>
@@ -13,10 +14,91 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netinet/ip.h>
+#include <netinet/udp.h>
 #include <pthread.h>
 #endif
 
 #include "common_address_ipv4.h"
+#include "rtp_packet.h"
+#include "rtp_packet_batch.h"
+
+//the socket handle type
+#ifdef _WIN32
+typedef SOCKET RTPSocket;
+#else
+typedef int RTPSocket;
+#endif
+
+#ifdef _WIN32
+#else
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#ifndef SO_RCVBUFFORCE
+#define SO_RCVBUFFORCE 33
+#endif
+
+#ifndef SO_SNDBUFFORCE
+#define SO_SNDBUFFORCE 32
+#endif
+
+#ifndef SO_RXQ_OVFL
+#define SO_RXQ_OVFL 40
+#endif
+
+#ifndef SO_MEMINFO
+#define SO_MEMINFO 55
+#endif
+#endif
+
+//the max segments count of one UDP GSO send, it is limited by the kernel
+const int RTP_GSO_MAX_SEGMENTS = 64;
+
+//the max bytes of one UDP GSO send, the whole super datagram must fit in
+//one ip packet
+const int RTP_GSO_MAX_BYTES = 65000;
+
+//the ip header and the udp header size of the datagrams
+const int RTP_IP_UDP_HEADER_SIZE = 20 + 8;
+
+//the default mtu of the send sessions, the rtp packets are 1400 bytes at most
+const int RTP_DEFAULT_MTU = 1400 + RTP_IP_UDP_HEADER_SIZE;
+
+//the interval to query the path mtu of the routes again, the learned path mtu expires
+const int RTP_PMTU_PROBE_INTERVAL_MS = 60 * 1000;
+
+//the mtu statistics of a send session
+struct RTPMtuStats
+{
+	//the configured mtu
+	int mtu;
+	//the path mtu of the destinations, 0 if it is unknown or the discovery is disabled
+	int pathMtu;
+	//the max rtp packet size, the smaller mtu without the ip header and the udp header
+	int maxPacketSize;
+	//the sends which failed because the datagram exceeded the path mtu
+	uint64_t mtuExceeded;
+	//the packets which exceed the max rtp packet size, they can't be fragmented
+	uint64_t oversizePackets;
+};
+
+//the socket statistics of a transmitter
+struct RTPSocketStats
+{
+	//the receive buffer size which the kernel uses
+	uint32_t recvBufferSize;
+	//the send buffer size which the kernel uses
+	uint32_t sendBufferSize;
+	//the bytes in the receive queue, they are counted with the kernel overhead as the buffer is
+	uint32_t recvQueued;
+	//the datagrams which the kernel dropped because the receive buffer was full
+	uint64_t recvDrops;
+};
 
 //the udp over ipv4 socket parameters
 struct RTPTransParamsV4
@@ -27,22 +109,31 @@ struct RTPTransParamsV4
 	//the port to bind
 	uint16_t bindPort;
 
-	//the socket send buffer size
+	//the socket send buffer size, 0 keeps the kernel default
 	uint32_t sendBufferSize;
 
-	//the socket receive buffer size
+	//the socket receive buffer size, 0 keeps the kernel default.
+	//the size is limited by net.core.rmem_max unless the process has CAP_NET_ADMIN
 	uint32_t recvBufferSize;
 
 	//time to live
 	uint8_t ttl;
 
+	//whether the bound address can be reused (SO_REUSEADDR)
+	bool reuseAddress;
+
+	//the socket priority (SO_PRIORITY) of the sent packets, 0 to 6, -1 keeps the default
+	int priority;
+
 	RTPTransParamsV4()
 	{
 		bindIP = 0;
 		bindPort = 0;
-		sendBufferSize = 1024 * 32;
-		recvBufferSize = 1024 * 32;
+		sendBufferSize = 0;
+		recvBufferSize = 0;
 		ttl = 128;
+		reuseAddress = false;
+		priority = -1;
 	}
 };
 
@@ -103,6 +194,97 @@ public:
 	 */
 	bool send_data(const uint8_t* data, size_t len);
 
+	/**
+	 * @brief send data to one address, it need not be a destination.
+	 * the streams which share the socket send their rtcp packets to their own peers by it.
+	 *
+	 * @param data -- the data pointer
+	 * @param len -- the data length
+	 * @param addr -- the address
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool send_data_to(const uint8_t* data, size_t len, const IPAddrV4& addr);
+
+	/**
+	 * @brief send the rtp packets to all the destinations.
+	 * all the packets are submitted to all the destinations by one sendmmsg() call.
+	 * if the kernel supports UDP GSO, the consecutive packets which have the same
+	 * size are sent as one super datagram, the kernel segments it.
+	 *
+	 * @param packets -- the rtp packets. pair: first -- the packet data; second -- the packet length
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool send_packets(const std::vector<std::pair<const uint8_t*, int> >& packets);
+
+	/**
+	 * @brief send the rtp packets to all the destinations by the scatter/gather io.
+	 * the header part and the payload part of a packet are sent as one datagram
+	 * without copying them, the packets are sent as send_packets() does.
+	 *
+	 * @param packets -- the rtp packets
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool send_packets(const std::vector<RTPPacketIov>& packets);
+
+	/**
+	 * @brief get the send statistics
+	 *
+	 * @param syscalls -- the send system calls count, output parameter
+	 * @param datagrams -- the sent datagrams count, output parameter
+	 */
+	void get_send_stats(uint64_t& syscalls, uint64_t& datagrams);
+
+	/**
+	 * @brief get the socket statistics. the kernel drops are read from the socket
+	 * memory info, the older kernels which have no SO_MEMINFO count them from the
+	 * SO_RXQ_OVFL counter of the received datagrams, so the drops are seen when
+	 * the next datagram is received after them. the drops are 0 on windows.
+	 *
+	 * @param stats -- the statistics, output parameter
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool get_socket_stats(RTPSocketStats& stats);
+
+	/**
+	 * @brief enable the path mtu discovery. the DF bit is set, so the datagrams which
+	 * exceed the path mtu fail with EMSGSIZE instead of being fragmented, and the path
+	 * mtu is queried from the kernel routes of the destinations again.
+	 *
+	 * @param enabled -- whether the discovery is enabled, it is disabled by default
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool set_pmtu_discovery(bool enabled);
+
+	/**
+	 * @brief query the path mtu of the destinations from the kernel routes, the path
+	 * mtu which was learned by the ICMP messages is included
+	 *
+	 * @return the min path mtu of the destinations, 0 if it is unknown or the discovery is disabled
+	 */
+	int probe_path_mtu();
+
+	/**
+	 * @brief get the path mtu of the last query
+	 *
+	 * @return the path mtu, 0 if it is unknown or the discovery is disabled
+	 */
+	int get_path_mtu();
+
+	/**
+	 * @brief get the sends which failed because the datagram exceeded the path mtu
+	 */
+	uint64_t get_mtu_exceeded();
+
 	/**
 	 * @brief receive udp data by function select()
 	 *
@@ -113,6 +295,83 @@ public:
 	 */
 	int receive_data(uint8_t* buffer, int bufferlen, int64_t microseconds);
 
+	/**
+	 * @brief receive a batch of udp datagrams by one recvmmsg() call.
+	 * the datagrams are received into the slots of the batch, the previous
+	 * datagrams in the batch are overwritten.
+	 *
+	 * @param batch -- the batch which receives the datagrams
+	 * @param microseconds -- the timeout time in microseconds, if it is 0,
+	 *  the function returns immediately when no datagram is available
+	 * @return the received datagrams count
+	 */
+	int receive_batch(RTPPacketBatch& batch, int64_t microseconds);
+
+	/**
+	 * @brief get the bind socket, it can be registered to the event loop.
+	 *
+	 * @return the bind socket
+	 */
+	RTPSocket get_socket() const
+	{
+		return this->m_bind_socket;
+	}
+
+private:
+	/**
+	 * @brief send the rtp packets to all the destinations, the mutex is locked
+	 *
+	 * @param packets -- the rtp packets
+	 *
+	 * @return true - successful
+	 * @return false - fail
+	 */
+	bool send_packets_locked(const std::vector<RTPPacketIov>& packets);
+
+	/**
+	 * @brief query the min path mtu of the destinations, the mutex is locked
+	 *
+	 * @return the path mtu, 0 if it is unknown
+	 */
+	int query_path_mtu_locked();
+
+	/**
+	 * @brief count the send which failed by EMSGSIZE and query the path mtu, the mutex is locked
+	 */
+	void on_mtu_exceeded_locked();
+
+	/**
+	 * @brief set the socket buffer size. on linux the size is forced first, it is not
+	 * limited by the sysctl if the process has CAP_NET_ADMIN.
+	 *
+	 * @param recv -- true: the receive buffer, false: the send buffer
+	 * @param size -- the buffer size
+	 */
+	void set_buffer_size(bool recv, uint32_t size);
+
+#ifdef _WIN32
+#else
+	/**
+	 * @brief build the sendmmsg() messages of the packets for all the destinations
+	 *
+	 * @param packets -- the rtp packets
+	 * @param gso -- whether send the packets by UDP GSO
+	 *
+	 * @return the messages count
+	 */
+	int build_send_messages(const std::vector<RTPPacketIov>& packets, bool gso);
+
+	/**
+	 * @brief send the built messages by sendmmsg()
+	 *
+	 * @param start -- the index of the first message to send
+	 * @param count -- the messages count
+	 *
+	 * @return the sent messages count
+	 */
+	int send_messages(int start, int count);
+#endif
+
 private:
 	bool m_initialize;
 
@@ -135,6 +394,39 @@ private:
 #endif
 	//the destination addresses
 	std::vector<IPAddrV4*> m_destinations;
+
+	//the send system calls count
+	uint64_t m_send_syscalls;
+	//the sent datagrams count
+	uint64_t m_send_datagrams;
+
+	//whether the path mtu discovery is enabled
+	bool m_pmtu_discovery;
+	//the path mtu of the destinations, 0 if it is unknown
+	int m_path_mtu;
+	//the sends which failed by EMSGSIZE
+	uint64_t m_mtu_exceeded;
+
+	//the SO_RXQ_OVFL counter of the last received datagram, it is updated on the receive thread
+	std::atomic<uint32_t> m_recv_drops;
+
+#ifdef _WIN32
+#else
+	//whether the kernel supports UDP GSO
+	bool m_gso_enabled;
+
+	//the sendmmsg() message headers
+	std::vector<struct mmsghdr> m_send_msgs;
+	//the sendmmsg() io vectors, two io vectors for each datagram at most
+	std::vector<struct iovec> m_send_iovecs;
+	//the datagrams count of each sendmmsg() message
+	std::vector<int> m_send_segments;
+	//the sendmmsg() control messages buffer, one UDP_SEGMENT control message for each message
+	std::vector<uint8_t> m_send_controls;
+#endif
+
+	//the packets of send_packets() which sends the contiguous packets
+	std::vector<RTPPacketIov> m_send_packets;
 };
 
 #endif
\ No newline at end of file
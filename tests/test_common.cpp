@@ -0,0 +1,22 @@
+#include "test_common.h"
+
+#include "common_logger.h"
+
+//the tests do not start the logger, the logs are discarded
+AppLogger *g_pLogger = NULL;
+int g_log_level = LOG_LEVEL_ERROR;
+uint32_t g_log_module_mask = LOG_MODULE_ALL;
+
+int g_test_failures = 0;
+
+int test_result(const char *name)
+{
+	if (g_test_failures > 0)
+	{
+		printf("%s: %d checks failed\n", name, g_test_failures);
+		return 1;
+	}
+
+	printf("%s: passed\n", name);
+	return 0;
+}
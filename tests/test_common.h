@@ -0,0 +1,42 @@
+#ifndef _H_TEST_COMMON_H_
+#define _H_TEST_COMMON_H_
+
+#include <stdio.h>
+
+//the failed checks count of the test program
+extern int g_test_failures;
+
+//check the condition, a failure is printed and counted, the test goes on
+#define TEST_CHECK(cond) \
+	do \
+	{ \
+		if (!(cond)) \
+		{ \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			g_test_failures++; \
+		} \
+	} while (0)
+
+//check the two integers are equal, the values are printed on a failure
+#define TEST_CHECK_EQ(a, b) \
+	do \
+	{ \
+		long long _a = (long long)(a); \
+		long long _b = (long long)(b); \
+		if (_a != _b) \
+		{ \
+			fprintf(stderr, "%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+			g_test_failures++; \
+		} \
+	} while (0)
+
+/**
+ * @brief print the result of the test program
+ *
+ * @param name -- the test program name
+ *
+ * @return the exit code of the test program, 0 if all the checks passed
+ */
+int test_result(const char *name);
+
+#endif
@@ -0,0 +1,188 @@
+#include "test_common.h"
+
+#include <string.h>
+#include <vector>
+
+#include "rtp_fec_decoder.h"
+#include "rtp_fec_encoder.h"
+#include "rtp_fec_packet.h"
+#include "rtp_packet.h"
+
+//the media packets of a frame, the lengths differ to exercise the length recovery
+static const int MEDIA_COUNT = 8;
+static uint8_t g_media[MEDIA_COUNT][1200];
+static int g_media_len[MEDIA_COUNT];
+
+static void make_media(uint16_t sequenceStart)
+{
+	for (int i = 0; i < MEDIA_COUNT; i++)
+	{
+		uint16_t sequence = (uint16_t)(sequenceStart + i);
+		int len = 100 + i * 97;
+		uint8_t *p = g_media[i];
+		memset(p, 0, sizeof(g_media[i]));
+		p[0] = 0x80;
+		p[1] = (uint8_t)((i == MEDIA_COUNT - 1 ? 0x80 : 0) | 96);
+		p[2] = (uint8_t)(sequence >> 8);
+		p[3] = (uint8_t)sequence;
+		p[7] = 0x64;
+		p[11] = 0x01;
+		for (int j = 12; j < len; j++)
+		{
+			p[j] = (uint8_t)(j * 7 + i * 13);
+		}
+		g_media_len[i] = len;
+	}
+}
+
+//protect the media packets, the parity packets are appended to the list
+static int encode_media(uint16_t sequenceStart, std::vector<RTPPacketIov> &packets)
+{
+	make_media(sequenceStart);
+
+	RTPFecEncoder encoder;
+	TEST_CHECK(encoder.init(1000, 1));
+	encoder.set_protection(25, 25);
+	TEST_CHECK(encoder.is_enabled());
+
+	packets.clear();
+	for (int i = 0; i < MEDIA_COUNT; i++)
+	{
+		RTPPacketIov packet;
+		packet.header = g_media[i];
+		packet.headerLen = 12;
+		packet.payload = g_media[i] + 12;
+		packet.payloadLen = g_media_len[i] - 12;
+		packets.push_back(packet);
+	}
+
+	//the encoder buffers are copied before it goes out of scope
+	int groups = encoder.encode(packets, false);
+	static std::vector<std::vector<uint8_t> > copies;
+	copies.clear();
+	copies.reserve(packets.size());
+	for (size_t i = MEDIA_COUNT; i < packets.size(); i++)
+	{
+		copies.push_back(std::vector<uint8_t>(packets[i].header, packets[i].header + packets[i].get_length()));
+		packets[i].header = &copies.back()[0];
+	}
+	return groups;
+}
+
+static void test_single_loss(uint16_t sequenceStart)
+{
+	std::vector<RTPPacketIov> packets;
+	//25% of 8 packets, the packets 0,2,4,6 and 1,3,5,7 are protected by the two parity packets
+	TEST_CHECK_EQ(encode_media(sequenceStart, packets), 2);
+	TEST_CHECK_EQ(packets.size(), MEDIA_COUNT + 2);
+	TEST_CHECK(rtp_fec_is_fec_packet(packets[MEDIA_COUNT].header, packets[MEDIA_COUNT].get_length()));
+
+	RTPFecHeader header;
+	rtp_fec_read_header(packets[MEDIA_COUNT + 1].header + RTP_FEC_RTP_HEADER_SIZE, header);
+	TEST_CHECK_EQ(header.baseSequence, (uint16_t)(sequenceStart + 1));
+	TEST_CHECK_EQ(header.stride, 2);
+	TEST_CHECK_EQ(header.count, 4);
+
+	RTPFecDecoder decoder;
+	TEST_CHECK(decoder.init());
+
+	//the packet 5 is lost, the other group is complete
+	const int lost = 5;
+	uint64_t now = 1000000;
+	for (int i = 0; i < MEDIA_COUNT; i++)
+	{
+		if (i != lost)
+		{
+			decoder.add_media(g_media[i], g_media_len[i]);
+		}
+	}
+	decoder.add_fec(packets[MEDIA_COUNT].header, packets[MEDIA_COUNT].get_length(), now);
+	decoder.add_fec(packets[MEDIA_COUNT + 1].header, packets[MEDIA_COUNT + 1].get_length(), now);
+	TEST_CHECK(decoder.has_pending());
+
+	uint8_t buffer[RTP_FEC_MAX_PROTECTED_SIZE];
+	int len = decoder.recover(buffer, now);
+	TEST_CHECK_EQ(len, g_media_len[lost]);
+	if (len == g_media_len[lost])
+	{
+		TEST_CHECK(memcmp(buffer, g_media[lost], len) == 0);
+	}
+	TEST_CHECK_EQ(decoder.recover(buffer, now), 0);
+	TEST_CHECK(!decoder.has_pending());
+
+	RTPFecStats stats;
+	decoder.get_stats(stats);
+	TEST_CHECK_EQ(stats.fecPackets, 2);
+	TEST_CHECK_EQ(stats.recovered, 1);
+	TEST_CHECK_EQ(stats.unrecoverable, 0);
+}
+
+static void test_double_loss()
+{
+	std::vector<RTPPacketIov> packets;
+	TEST_CHECK_EQ(encode_media(200, packets), 2);
+
+	RTPFecDecoder decoder;
+	TEST_CHECK(decoder.init());
+
+	//the packets 1 and 3 are in the same group, the parity can not recover them
+	uint64_t now = 1000000;
+	for (int i = 0; i < MEDIA_COUNT; i++)
+	{
+		if (i != 1 && i != 3)
+		{
+			decoder.add_media(g_media[i], g_media_len[i]);
+		}
+	}
+	for (size_t i = MEDIA_COUNT; i < packets.size(); i++)
+	{
+		decoder.add_fec(packets[i].header, packets[i].get_length(), now);
+	}
+
+	uint8_t buffer[RTP_FEC_MAX_PROTECTED_SIZE];
+	TEST_CHECK_EQ(decoder.recover(buffer, now), 0);
+	//the group waits for a retransmission
+	TEST_CHECK(decoder.has_pending());
+
+	//the retransmitted packet 3 makes the group recoverable
+	decoder.add_media(g_media[3], g_media_len[3]);
+	int len = decoder.recover(buffer, now + 1000);
+	TEST_CHECK_EQ(len, g_media_len[1]);
+	if (len == g_media_len[1])
+	{
+		TEST_CHECK(memcmp(buffer, g_media[1], len) == 0);
+	}
+
+	//a group which misses two packets is given up after the waiting time
+	RTPFecDecoder timeout;
+	TEST_CHECK(timeout.init());
+	for (int i = 0; i < MEDIA_COUNT; i++)
+	{
+		if (i != 1 && i != 3)
+		{
+			timeout.add_media(g_media[i], g_media_len[i]);
+		}
+	}
+	for (size_t i = MEDIA_COUNT; i < packets.size(); i++)
+	{
+		timeout.add_fec(packets[i].header, packets[i].get_length(), now);
+	}
+	TEST_CHECK_EQ(timeout.recover(buffer, now + RTP_FEC_MAX_WAIT_MS * 1000 / 2), 0);
+	TEST_CHECK(timeout.has_pending());
+	TEST_CHECK_EQ(timeout.recover(buffer, now + (RTP_FEC_MAX_WAIT_MS + 1) * 1000), 0);
+	TEST_CHECK(!timeout.has_pending());
+
+	RTPFecStats stats;
+	timeout.get_stats(stats);
+	TEST_CHECK_EQ(stats.recovered, 0);
+	TEST_CHECK_EQ(stats.unrecoverable, 2);
+}
+
+int main()
+{
+	test_single_loss(100);
+	//the group crosses the sequence wrap around
+	test_single_loss(65533);
+	test_double_loss();
+	return test_result("test_fec");
+}
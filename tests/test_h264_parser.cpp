@@ -0,0 +1,286 @@
+#include "test_common.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "codec_h264_parser.h"
+#include "codec_utils.h"
+
+//x264, High 4.0 1920x1080, frame cropping and the VUI timing, the emulation prevention bytes
+static const uint8_t SPS_HIGH_1080P[] = {
+	0x67, 0x64, 0x00, 0x28, 0xAC, 0xD9, 0x40, 0x78, 0x02, 0x27, 0xE5, 0xC0, 0x44, 0x00, 0x00, 0x03,
+	0x00, 0x04, 0x00, 0x00, 0x03, 0x00, 0xF0, 0x3C, 0x60, 0xC6, 0x58
+};
+
+//Constrained Baseline 3.0 1280x720, pic_order_cnt_type 2
+static const uint8_t SPS_BASELINE_720P[] = {
+	0x67, 0x42, 0xC0, 0x1E, 0xD9, 0x00, 0x50, 0x05, 0xBB, 0x01, 0x10, 0x00, 0x00, 0x03, 0x00, 0x10,
+	0x00, 0x00, 0x03, 0x03, 0x20, 0xF1, 0x62, 0xE4, 0x80
+};
+
+//High 4.0 1920x1080 interlaced, the height is counted in field macroblock pairs, 30000/1001 fps
+static const uint8_t SPS_HIGH_1080I[] = {
+	0x67, 0x64, 0x00, 0x28, 0xAC, 0x56, 0xC0, 0x78, 0x04, 0x4F, 0xDF, 0xFE, 0x00, 0x08, 0x00, 0x06,
+	0xD4, 0x04, 0x04, 0x07, 0xC0, 0x00, 0x00, 0xFA, 0x40, 0x00, 0x3A, 0x98, 0x21
+};
+
+//High 4:2:2 3.1 10 bits 1280x720, sps id 3, the vertical crop unit is 1 line
+static const uint8_t SPS_HIGH422_720P[] = {
+	0x67, 0x7A, 0x00, 0x1F, 0x23, 0x6C, 0x2E, 0x80, 0x50, 0x05, 0xDF, 0x84, 0x50
+};
+
+//High 4:4:4 3.2 638x366, the 12 scaling lists, one of them ends early with a zero scale
+static const uint8_t SPS_HIGH444_SCALING[] = {
+	0x67, 0xF4, 0x00, 0x20, 0x91, 0xB4, 0x92, 0x49, 0x24, 0x92, 0x49, 0x20, 0x42, 0x24, 0x84, 0x21,
+	0x08, 0x42, 0x10, 0x84, 0x21, 0x08, 0x42, 0x10, 0x84, 0x21, 0x08, 0x42, 0x10, 0x84, 0x21, 0x08,
+	0x42, 0x10, 0x84, 0x21, 0x08, 0x42, 0x10, 0x84, 0x21, 0x08, 0x42, 0x10, 0x84, 0x21, 0x08, 0x42,
+	0x10, 0x84, 0x21, 0x08, 0x42, 0x10, 0x1A, 0xD0, 0x14, 0x05, 0xFA, 0x49, 0x20
+};
+
+//Main 2.1 352x288, sps id 31, pic_order_cnt_type 1 and gaps_in_frame_num_allowed
+static const uint8_t SPS_MAIN_POC1[] = {
+	0x67, 0x4D, 0x40, 0x15, 0x04, 0x14, 0x29, 0x88, 0x46, 0x20, 0x90, 0xB0, 0x4B, 0x20
+};
+
+struct SPSSample
+{
+	const char *name;
+	const uint8_t *data;
+	size_t size;
+
+	int profileIdc;
+	int levelIdc;
+	int spsId;
+	int chromaFormatIdc;
+	int bitDepth;
+	int log2MaxFrameNum;
+	int picOrderCntType;
+	bool frameMbsOnly;
+	int width;
+	int height;
+	int fps;
+};
+
+static const SPSSample SPS_SAMPLES[] = {
+	{ "high 1080p", SPS_HIGH_1080P, sizeof(SPS_HIGH_1080P), 100, 40, 0, 1, 8, 4, 0, true, 1920, 1080, 30 },
+	{ "baseline 720p", SPS_BASELINE_720P, sizeof(SPS_BASELINE_720P), 66, 30, 0, 1, 8, 4, 2, true, 1280, 720, 25 },
+	{ "high 1080i", SPS_HIGH_1080I, sizeof(SPS_HIGH_1080I), 100, 40, 0, 1, 8, 5, 0, false, 1920, 1080, 29 },
+	{ "high 4:2:2 720p", SPS_HIGH422_720P, sizeof(SPS_HIGH422_720P), 122, 31, 3, 2, 10, 8, 0, true, 1280, 720, 0 },
+	{ "high 4:4:4 scaling", SPS_HIGH444_SCALING, sizeof(SPS_HIGH444_SCALING), 244, 32, 0, 3, 8, 16, 2, true, 638, 366, 0 },
+	{ "main poc 1", SPS_MAIN_POC1, sizeof(SPS_MAIN_POC1), 77, 21, 31, 1, 8, 4, 1, true, 352, 288, 0 },
+};
+
+static void test_sps_samples()
+{
+	for (size_t i = 0; i < sizeof(SPS_SAMPLES) / sizeof(SPS_SAMPLES[0]); i++)
+	{
+		const SPSSample &sample = SPS_SAMPLES[i];
+		H264SPS sps;
+		TEST_CHECK(h264_parse_sps(sample.data, sample.size, sps));
+		if (!sps.valid)
+		{
+			printf("%s: the sps is not parsed\n", sample.name);
+			continue;
+		}
+
+		TEST_CHECK_EQ(sps.profileIdc, sample.profileIdc);
+		TEST_CHECK_EQ(sps.levelIdc, sample.levelIdc);
+		TEST_CHECK_EQ(sps.spsId, sample.spsId);
+		TEST_CHECK_EQ(sps.chromaFormatIdc, sample.chromaFormatIdc);
+		TEST_CHECK_EQ(sps.bitDepthLuma, sample.bitDepth);
+		TEST_CHECK_EQ(sps.bitDepthChroma, sample.bitDepth);
+		TEST_CHECK_EQ(sps.log2MaxFrameNum, sample.log2MaxFrameNum);
+		TEST_CHECK_EQ(sps.picOrderCntType, sample.picOrderCntType);
+		TEST_CHECK_EQ(sps.frameMbsOnly, sample.frameMbsOnly);
+		TEST_CHECK_EQ(sps.width, sample.width);
+		TEST_CHECK_EQ(sps.height, sample.height);
+		TEST_CHECK_EQ(sps.fps, sample.fps);
+	}
+
+	//the details of the samples which are not in the table
+	H264SPS sps;
+	TEST_CHECK(h264_parse_sps(SPS_BASELINE_720P, sizeof(SPS_BASELINE_720P), sps));
+	//constraint_set0_flag and constraint_set1_flag
+	TEST_CHECK_EQ(sps.constraintFlags, 0x30);
+	TEST_CHECK(h264_parse_sps(SPS_HIGH_1080I, sizeof(SPS_HIGH_1080I), sps));
+	TEST_CHECK_EQ(sps.log2MaxPocLsb, 6);
+	TEST_CHECK_EQ(sps.numUnitsInTick, 1001);
+	TEST_CHECK_EQ(sps.timeScale, 60000);
+	TEST_CHECK(sps.fixedFrameRate);
+	TEST_CHECK(h264_parse_sps(SPS_MAIN_POC1, sizeof(SPS_MAIN_POC1), sps));
+	TEST_CHECK_EQ(sps.numRefFrames, 3);
+	TEST_CHECK(sps.gapsInFrameNumAllowed);
+}
+
+static void test_sps_invalid()
+{
+	H264SPS sps;
+	//the truncated sps
+	TEST_CHECK(!h264_parse_sps(SPS_HIGH_1080P, 8, sps));
+	TEST_CHECK(!sps.valid);
+	//not a sps
+	TEST_CHECK(!h264_parse_sps(SPS_HIGH_1080P + 1, sizeof(SPS_HIGH_1080P) - 1, sps));
+
+	//chroma_format_idc 4 is reserved
+	uint8_t data[sizeof(SPS_HIGH_1080P)];
+	memcpy(data, SPS_HIGH_1080P, sizeof(data));
+	//seq_parameter_set_id 010 and chroma_format_idc 00101
+	data[4] = 0x45;
+	TEST_CHECK(!h264_parse_sps(data, sizeof(data), sps));
+}
+
+//write the bits of the pps and the slice headers
+class BitWriter
+{
+public:
+	BitWriter() : m_bits(0) {}
+
+	void write_bits(uint32_t value, int count)
+	{
+		for (int i = count - 1; i >= 0; i--)
+		{
+			if ((m_bits & 7) == 0)
+			{
+				m_data.push_back(0);
+			}
+			m_data.back() |= (uint8_t)(((value >> i) & 1) << (7 - (m_bits & 7)));
+			m_bits++;
+		}
+	}
+
+	void write_ue(uint32_t value)
+	{
+		int count = 0;
+		while ((value + 1) >> (count + 1))
+		{
+			count++;
+		}
+		write_bits(0, count);
+		write_bits(value + 1, count + 1);
+	}
+
+	//the rbsp stop bit, no emulation prevention is needed for the written values
+	const std::vector<uint8_t> &finish()
+	{
+		write_bits(1, 1);
+		return m_data;
+	}
+
+private:
+	std::vector<uint8_t> m_data;
+	int m_bits;
+};
+
+static void append_nalu(std::vector<uint8_t> &stream, const uint8_t *nal, size_t size)
+{
+	static const uint8_t START_CODE[] = { 0x00, 0x00, 0x00, 0x01 };
+	stream.insert(stream.end(), START_CODE, START_CODE + sizeof(START_CODE));
+	stream.insert(stream.end(), nal, nal + size);
+}
+
+//the access unit of the baseline sample, a P slice or an IDR slice with the frame_num
+static void make_access_unit(std::vector<uint8_t> &stream, bool idr, int nalRefIdc, uint32_t frameNum)
+{
+	stream.clear();
+
+	BitWriter slice;
+	slice.write_bits(0, 1);
+	slice.write_bits((uint32_t)nalRefIdc, 2);
+	slice.write_bits(idr ? 5 : 1, 5);
+	//first_mb_in_slice, slice_type 7 I or 5 P, pic_parameter_set_id
+	slice.write_ue(0);
+	slice.write_ue(idr ? 7 : 5);
+	slice.write_ue(0);
+	slice.write_bits(frameNum, 4);
+	if (idr)
+	{
+		//idr_pic_id
+		slice.write_ue(0);
+	}
+	const std::vector<uint8_t> &data = slice.finish();
+
+	if (idr)
+	{
+		BitWriter pps;
+		pps.write_bits(0x68, 8);
+		//pic_parameter_set_id, seq_parameter_set_id, entropy_coding_mode_flag,
+		//bottom_field_pic_order_in_frame_present_flag, num_slice_groups_minus1
+		pps.write_ue(0);
+		pps.write_ue(0);
+		pps.write_bits(0, 1);
+		pps.write_bits(0, 1);
+		pps.write_ue(0);
+		const std::vector<uint8_t> &ppsData = pps.finish();
+
+		append_nalu(stream, SPS_BASELINE_720P, sizeof(SPS_BASELINE_720P));
+		append_nalu(stream, &ppsData[0], ppsData.size());
+	}
+	append_nalu(stream, &data[0], data.size());
+}
+
+static bool parse_frame(H264StreamParser &parser, bool idr, int nalRefIdc, uint32_t frameNum, H264AccessUnitInfo &info)
+{
+	std::vector<uint8_t> stream;
+	make_access_unit(stream, idr, nalRefIdc, frameNum);
+
+	AccessUnitIndex index;
+	index.parse(&stream[0], stream.size());
+	return parser.parse_access_unit(index, info);
+}
+
+static void test_frame_num_gap()
+{
+	H264StreamParser parser;
+	H264AccessUnitInfo info;
+
+	TEST_CHECK(parse_frame(parser, true, 3, 0, info));
+	TEST_CHECK(info.keyframe);
+	TEST_CHECK_EQ(info.slice.sliceType, 2);
+	TEST_CHECK(!info.frameNumGap);
+	TEST_CHECK(parser.get_sps(0) != NULL);
+	TEST_CHECK(parser.get_sps(1) == NULL);
+
+	TEST_CHECK(parse_frame(parser, false, 2, 1, info));
+	TEST_CHECK(!info.keyframe);
+	TEST_CHECK_EQ(info.slice.sliceType, 0);
+	TEST_CHECK_EQ(info.slice.frameNum, 1);
+	TEST_CHECK(!info.frameNumGap);
+
+	//the non reference pictures follow the previous reference picture
+	TEST_CHECK(parse_frame(parser, false, 0, 2, info));
+	TEST_CHECK(!info.frameNumGap);
+	TEST_CHECK(parse_frame(parser, false, 0, 2, info));
+	TEST_CHECK(!info.frameNumGap);
+
+	//the reference picture 2 is lost
+	TEST_CHECK(parse_frame(parser, false, 2, 3, info));
+	TEST_CHECK(info.frameNumGap);
+
+	//the frame_num wraps around at 2^log2_max_frame_num
+	uint32_t frameNum;
+	for (frameNum = 4; frameNum < 16; frameNum++)
+	{
+		TEST_CHECK(parse_frame(parser, false, 2, frameNum, info));
+		TEST_CHECK(!info.frameNumGap);
+	}
+	TEST_CHECK(parse_frame(parser, false, 2, 0, info));
+	TEST_CHECK(!info.frameNumGap);
+	TEST_CHECK(parse_frame(parser, false, 2, 2, info));
+	TEST_CHECK(info.frameNumGap);
+
+	//an IDR picture never has a gap, and the reset forgets the previous reference picture
+	TEST_CHECK(parse_frame(parser, true, 3, 0, info));
+	TEST_CHECK(!info.frameNumGap);
+	parser.reset_frame_num();
+	TEST_CHECK(parse_frame(parser, false, 2, 9, info));
+	TEST_CHECK(!info.frameNumGap);
+}
+
+int main()
+{
+	test_sps_samples();
+	test_sps_invalid();
+	test_frame_num_gap();
+	return test_result("test_h264_parser");
+}
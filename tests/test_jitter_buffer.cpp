@@ -0,0 +1,174 @@
+#include "test_common.h"
+
+#include <string.h>
+
+#include "rtp_jitter_buffer.h"
+
+//the packet header size, the rtp header and the 3 words header extension
+static const int TEST_HEADER_SIZE = 12 + 4 + 12;
+
+//acquire a slot and write a parsed rtp packet of the sequence and the timestamp to it
+static RTPPacketSlot *make_packet(RTPPacketPool &pool, uint16_t sequence, uint32_t timestamp)
+{
+	RTPPacketSlot *slot = pool.acquire();
+	if (!slot)
+	{
+		return NULL;
+	}
+
+	uint8_t *p = slot->buffer;
+	memset(p, 0, TEST_HEADER_SIZE + 4);
+	p[0] = 0x90;
+	p[1] = 96;
+	p[2] = (uint8_t)(sequence >> 8);
+	p[3] = (uint8_t)sequence;
+	p[4] = (uint8_t)(timestamp >> 24);
+	p[5] = (uint8_t)(timestamp >> 16);
+	p[6] = (uint8_t)(timestamp >> 8);
+	p[7] = (uint8_t)timestamp;
+	p[11] = 1;
+	p[12] = 0xBE;
+	p[13] = 0xDE;
+	p[15] = 3;
+	slot->length = TEST_HEADER_SIZE + 4;
+
+	if (!slot->packet.parse(slot->buffer, slot->length))
+	{
+		pool.release(slot);
+		return NULL;
+	}
+	return slot;
+}
+
+//push the packet, the slot is released if the jitter buffer drops it
+static bool push_packet(RTPJitterBuffer &jitter, RTPPacketPool &pool, uint16_t sequence, uint64_t arrivalUs)
+{
+	//the packets are 10 ms apart, the clock rate is 1000
+	RTPPacketSlot *slot = make_packet(pool, sequence, (uint32_t)(uint16_t)(sequence + 10) * 10);
+	if (!slot)
+	{
+		return false;
+	}
+
+	if (!jitter.push(slot, arrivalUs, false))
+	{
+		pool.release(slot);
+		return false;
+	}
+	return true;
+}
+
+//pop a packet and return its sequence, -1 if no packet is due
+static int pop_sequence(RTPJitterBuffer &jitter, RTPPacketPool &pool, uint64_t nowUs)
+{
+	RTPPacketSlot *slot = jitter.pop(nowUs);
+	if (!slot)
+	{
+		return -1;
+	}
+
+	int sequence = (uint16_t)slot->packet.get_sequence();
+	pool.release(slot);
+	return sequence;
+}
+
+static void test_reorder_wrap()
+{
+	RTPPacketPool pool;
+	RTPJitterBuffer jitter;
+	TEST_CHECK(pool.init(64, 256));
+	TEST_CHECK(jitter.init(&pool, RTP_JITTER_DEFAULT_CLOCK_RATE));
+
+	//the sequence wraps around while the packets arrive out of order
+	uint16_t arrival[] = {65533, 65535, 65534, 0, 2, 1};
+	uint64_t now = 1000000;
+	for (size_t i = 0; i < sizeof(arrival) / sizeof(arrival[0]); i++)
+	{
+		TEST_CHECK(push_packet(jitter, pool, arrival[i], now));
+	}
+
+	RTPJitterBufferStats stats;
+	jitter.get_stats(stats);
+	TEST_CHECK_EQ(stats.depthPackets, 6);
+	TEST_CHECK_EQ(stats.reorders, 2);
+	TEST_CHECK_EQ(stats.depthMs, 50);
+
+	//the packets are released in the sequence order
+	now += 10 * 1000 * 1000;
+	int expected[] = {65533, 65534, 65535, 0, 1, 2};
+	for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++)
+	{
+		TEST_CHECK_EQ(pop_sequence(jitter, pool, now), expected[i]);
+	}
+	TEST_CHECK_EQ(pop_sequence(jitter, pool, now), -1);
+
+	//a duplicated packet and a packet after its playout are dropped
+	TEST_CHECK(push_packet(jitter, pool, 3, now));
+	TEST_CHECK(!push_packet(jitter, pool, 3, now));
+	TEST_CHECK(!push_packet(jitter, pool, 65535, now));
+
+	jitter.get_stats(stats);
+	TEST_CHECK_EQ(stats.received, 7);
+	TEST_CHECK_EQ(stats.duplicates, 1);
+	TEST_CHECK_EQ(stats.lateDrops, 1);
+	TEST_CHECK_EQ(stats.lost, 0);
+
+	jitter.flush();
+	TEST_CHECK_EQ(pool.get_free_count(), pool.get_capacity());
+}
+
+static void test_lost_and_playout_time()
+{
+	RTPPacketPool pool;
+	RTPJitterBuffer jitter;
+	TEST_CHECK(pool.init(64, 256));
+	TEST_CHECK(jitter.init(&pool, RTP_JITTER_DEFAULT_CLOCK_RATE));
+	jitter.set_delay_range(RTP_JITTER_MIN_DELAY_MS, RTP_JITTER_MAX_DELAY_MS);
+
+	//the packets arrive on time, 11 is lost
+	uint64_t start = 1000000;
+	TEST_CHECK(push_packet(jitter, pool, 10, start));
+	TEST_CHECK(push_packet(jitter, pool, 12, start + 20 * 1000));
+
+	//the packet is held for the playout delay
+	TEST_CHECK_EQ(pop_sequence(jitter, pool, start), -1);
+	TEST_CHECK_EQ(pop_sequence(jitter, pool, start + RTP_JITTER_MIN_DELAY_MS * 1000), 10);
+
+	//the lost packet is skipped when the following packet is due
+	TEST_CHECK_EQ(pop_sequence(jitter, pool, start + RTP_JITTER_MIN_DELAY_MS * 1000), -1);
+	TEST_CHECK_EQ(pop_sequence(jitter, pool, start + (20 + RTP_JITTER_MIN_DELAY_MS) * 1000), 12);
+
+	RTPJitterBufferStats stats;
+	jitter.get_stats(stats);
+	TEST_CHECK_EQ(stats.lost, 1);
+	TEST_CHECK_EQ(stats.delayMs, RTP_JITTER_MIN_DELAY_MS);
+	TEST_CHECK_EQ(pool.get_free_count(), pool.get_capacity());
+}
+
+static void test_sequence_jump()
+{
+	RTPPacketPool pool;
+	RTPJitterBuffer jitter;
+	TEST_CHECK(pool.init(64, 256));
+	TEST_CHECK(jitter.init(&pool, RTP_JITTER_DEFAULT_CLOCK_RATE));
+
+	//a jump beyond the ring restarts the stream, the held packets are flushed
+	uint64_t now = 1000000;
+	TEST_CHECK(push_packet(jitter, pool, 100, now));
+	TEST_CHECK(push_packet(jitter, pool, 101, now));
+	TEST_CHECK(push_packet(jitter, pool, 100 + RTP_JITTER_RING_SIZE * 4, now));
+
+	RTPJitterBufferStats stats;
+	jitter.get_stats(stats);
+	TEST_CHECK_EQ(stats.depthPackets, 1);
+	TEST_CHECK_EQ(pop_sequence(jitter, pool, now + 10 * 1000 * 1000), 100 + RTP_JITTER_RING_SIZE * 4);
+	TEST_CHECK_EQ(pool.get_free_count(), pool.get_capacity());
+}
+
+int main()
+{
+	test_reorder_wrap();
+	test_lost_and_playout_time();
+	test_sequence_jump();
+	return test_result("test_jitter_buffer");
+}
@@ -0,0 +1,199 @@
+#include "test_common.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "common_utils.h"
+#include "rtp_receive_reactor.h"
+
+//the media sockets which are loaded during the whole test
+static const int MEDIA_SOCKETS = 8;
+//the join and leave period
+static const int CHURN_TIME_MS = 1000;
+
+//the max gap between two media callbacks, a writer must never block the reactor thread for long
+static const uint64_t MAX_STALL_US = 200000;
+
+struct MediaContext
+{
+	int sock;
+	uint64_t datagrams;
+	uint64_t lastTime;
+	uint64_t maxStall;
+};
+
+//the socket and the timer of a joining user
+struct ChurnContext
+{
+	int sock;
+	std::atomic<bool> removed;
+	std::atomic<int> callbacks;
+};
+
+static std::atomic<int> g_late_callbacks(0);
+
+static void on_media_readable(void *arg)
+{
+	MediaContext *ctx = (MediaContext *)arg;
+	uint8_t buffer[1500];
+	while (recv(ctx->sock, buffer, sizeof(buffer), MSG_DONTWAIT) > 0)
+	{
+		ctx->datagrams++;
+	}
+
+	uint64_t now = get_monotonic_time_us();
+	if (ctx->lastTime != 0 && now - ctx->lastTime > ctx->maxStall)
+	{
+		ctx->maxStall = now - ctx->lastTime;
+	}
+	ctx->lastTime = now;
+}
+
+//the callbacks of a removed socket or timer must never run
+static void on_churn_readable(void *arg)
+{
+	ChurnContext *ctx = (ChurnContext *)arg;
+	if (ctx->removed.load())
+	{
+		g_late_callbacks++;
+	}
+	ctx->callbacks++;
+
+	uint8_t buffer[64];
+	while (recv(ctx->sock, buffer, sizeof(buffer), MSG_DONTWAIT) > 0)
+	{
+	}
+}
+
+static void on_churn_timer(void *arg)
+{
+	ChurnContext *ctx = (ChurnContext *)arg;
+	if (ctx->removed.load())
+	{
+		g_late_callbacks++;
+	}
+}
+
+static int create_socket(sockaddr_in &addr)
+{
+	int sock = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+
+	socklen_t len = sizeof(addr);
+	if (sock < 0 || bind(sock, (sockaddr *)&addr, sizeof(addr)) != 0 || getsockname(sock, (sockaddr *)&addr, &len) != 0)
+	{
+		return -1;
+	}
+	return sock;
+}
+
+static void test_join_leave_under_load()
+{
+	RTPReceiveReactor reactor;
+	TEST_CHECK(reactor.init());
+
+	MediaContext media[MEDIA_SOCKETS];
+	sockaddr_in mediaAddr[MEDIA_SOCKETS];
+	int i;
+	for (i = 0; i < MEDIA_SOCKETS; i++)
+	{
+		memset(&media[i], 0, sizeof(media[i]));
+		media[i].sock = create_socket(mediaAddr[i]);
+		TEST_CHECK(media[i].sock >= 0);
+		TEST_CHECK(reactor.add_socket(media[i].sock, on_media_readable, &media[i]));
+	}
+
+	std::atomic<bool> running(true);
+	std::thread reactorThread([&]() {
+		while (running.load())
+		{
+			reactor.run_once(10);
+		}
+	});
+
+	//every media socket gets a datagram each millisecond
+	std::thread sender([&]() {
+		int sock = socket(AF_INET, SOCK_DGRAM, 0);
+		uint8_t payload[1200];
+		memset(payload, 0x55, sizeof(payload));
+		while (running.load())
+		{
+			for (int n = 0; n < MEDIA_SOCKETS; n++)
+			{
+				sendto(sock, payload, sizeof(payload), 0, (sockaddr *)&mediaAddr[n], sizeof(mediaAddr[n]));
+			}
+			usleep(1000);
+		}
+		close(sock);
+	});
+
+	//the users join and leave constantly, the contexts are freed after the reactor stops
+	std::vector<ChurnContext *> contexts;
+	int churnSender = socket(AF_INET, SOCK_DGRAM, 0);
+	uint64_t start = get_monotonic_time_us();
+	while (get_monotonic_time_us() - start < (uint64_t)CHURN_TIME_MS * 1000)
+	{
+		ChurnContext *ctx = new ChurnContext();
+		ctx->removed = false;
+		ctx->callbacks = 0;
+		contexts.push_back(ctx);
+
+		sockaddr_in addr;
+		ctx->sock = create_socket(addr);
+		TEST_CHECK(reactor.add_socket(ctx->sock, on_churn_readable, ctx));
+		int timerId = reactor.add_timer(1, on_churn_timer, ctx);
+		TEST_CHECK(timerId != -1);
+		sendto(churnSender, "rtp", 3, 0, (sockaddr *)&addr, sizeof(addr));
+
+		TEST_CHECK(reactor.remove_socket(ctx->sock));
+		TEST_CHECK(reactor.remove_timer(timerId));
+		ctx->removed = true;
+		close(ctx->sock);
+	}
+	close(churnSender);
+
+	running = false;
+	sender.join();
+	reactorThread.join();
+
+	uint64_t maxStall = 0;
+	uint64_t datagrams = 0;
+	for (i = 0; i < MEDIA_SOCKETS; i++)
+	{
+		TEST_CHECK(media[i].datagrams > 0);
+		datagrams += media[i].datagrams;
+		if (media[i].maxStall > maxStall)
+		{
+			maxStall = media[i].maxStall;
+		}
+		reactor.remove_socket(media[i].sock);
+		close(media[i].sock);
+	}
+
+	int churnCallbacks = 0;
+	for (size_t n = 0; n < contexts.size(); n++)
+	{
+		churnCallbacks += contexts[n]->callbacks;
+		delete contexts[n];
+	}
+
+	printf("join/leave %d in %d ms, %d churn callbacks, %llu media datagrams, max receive stall %.1f ms\n",
+		(int)contexts.size(), CHURN_TIME_MS, churnCallbacks, (unsigned long long)datagrams, maxStall / 1000.0);
+
+	TEST_CHECK_EQ(g_late_callbacks.load(), 0);
+	TEST_CHECK(maxStall < MAX_STALL_US);
+}
+
+int main()
+{
+	test_join_leave_under_load();
+	return test_result("test_reactor_churn");
+}
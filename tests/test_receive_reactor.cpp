@@ -0,0 +1,120 @@
+#include "test_common.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "rtp_receive_reactor.h"
+
+struct ReadableContext
+{
+	int sock;
+	int callbacks;
+	int datagrams;
+};
+
+static void on_readable(void *arg)
+{
+	ReadableContext *ctx = (ReadableContext *)arg;
+	ctx->callbacks++;
+
+	//the callback drains the socket, the reactor is level-triggered
+	uint8_t buffer[64];
+	while (recv(ctx->sock, buffer, sizeof(buffer), MSG_DONTWAIT) > 0)
+	{
+		ctx->datagrams++;
+	}
+}
+
+static void on_timer(void *arg)
+{
+	(*(int *)arg)++;
+}
+
+//create a udp socket bound to an ephemeral loopback port
+static int create_socket(sockaddr_in &addr)
+{
+	int sock = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+
+	socklen_t len = sizeof(addr);
+	if (sock < 0 || bind(sock, (sockaddr *)&addr, sizeof(addr)) != 0 || getsockname(sock, (sockaddr *)&addr, &len) != 0)
+	{
+		return -1;
+	}
+	return sock;
+}
+
+static void test_socket_callback()
+{
+	RTPReceiveReactor reactor;
+	TEST_CHECK(reactor.init());
+
+	sockaddr_in addr;
+	ReadableContext ctx;
+	ctx.sock = create_socket(addr);
+	ctx.callbacks = 0;
+	ctx.datagrams = 0;
+	TEST_CHECK(ctx.sock >= 0);
+	TEST_CHECK(reactor.add_socket(ctx.sock, on_readable, &ctx));
+	//registering the socket again replaces its callback
+	TEST_CHECK(reactor.add_socket(ctx.sock, on_readable, &ctx));
+
+	//nothing is readable, the wait times out
+	TEST_CHECK_EQ(reactor.run_once(10), 0);
+	TEST_CHECK_EQ(ctx.callbacks, 0);
+
+	int sender = socket(AF_INET, SOCK_DGRAM, 0);
+	for (int i = 0; i < 3; i++)
+	{
+		sendto(sender, "rtp", 3, 0, (sockaddr *)&addr, sizeof(addr));
+	}
+
+	TEST_CHECK_EQ(reactor.run_once(1000), 1);
+	TEST_CHECK_EQ(ctx.callbacks, 1);
+	TEST_CHECK_EQ(ctx.datagrams, 3);
+
+	//the removed socket is not watched any more
+	TEST_CHECK(reactor.remove_socket(ctx.sock));
+	sendto(sender, "rtp", 3, 0, (sockaddr *)&addr, sizeof(addr));
+	TEST_CHECK_EQ(reactor.run_once(10), 0);
+	TEST_CHECK_EQ(ctx.callbacks, 1);
+
+	close(sender);
+	close(ctx.sock);
+}
+
+static void test_timer()
+{
+	RTPReceiveReactor reactor;
+	TEST_CHECK(reactor.init());
+
+	int fired = 0;
+	int timerId = reactor.add_timer(5, on_timer, &fired);
+	TEST_CHECK(timerId != -1);
+
+	//the wait is shortened to the timer expiration
+	for (int i = 0; i < 5; i++)
+	{
+		reactor.run_once(1000);
+	}
+	TEST_CHECK(fired >= 4);
+
+	TEST_CHECK(reactor.remove_timer(timerId));
+	//removing a removed timer is not an error
+	TEST_CHECK(reactor.remove_timer(timerId));
+	int count = fired;
+	reactor.run_once(20);
+	TEST_CHECK_EQ(fired, count);
+}
+
+int main()
+{
+	test_socket_callback();
+	test_timer();
+	return test_result("test_receive_reactor");
+}
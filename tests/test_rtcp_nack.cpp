@@ -0,0 +1,141 @@
+#include "test_common.h"
+
+#include <string.h>
+
+#include "rtcp_nack_generator.h"
+#include "rtcp_packet.h"
+#include "rtp_packet_history.h"
+
+static void test_nack_list()
+{
+	RTCPNackGenerator generator;
+	uint16_t sequences[RTCP_NACK_MAX_SEQUENCES];
+
+	//the sequence wraps around, 0 and 1 are missing
+	uint64_t now = 1000000;
+	TEST_CHECK(!generator.on_packet(65534, now));
+	TEST_CHECK(!generator.on_packet(65535, now));
+	TEST_CHECK(!generator.on_packet(2, now));
+
+	TEST_CHECK_EQ(generator.get_nack_list(now, sequences, RTCP_NACK_MAX_SEQUENCES), 2);
+	TEST_CHECK_EQ(sequences[0], 0);
+	TEST_CHECK_EQ(sequences[1], 1);
+
+	//the requested packets are not requested again before the retransmission could arrive
+	TEST_CHECK_EQ(generator.get_nack_list(now + 1000, sequences, RTCP_NACK_MAX_SEQUENCES), 0);
+
+	//the retransmission is recognized and samples the round trip time
+	TEST_CHECK(generator.on_packet(1, now + 30000));
+	TEST_CHECK_EQ(generator.get_rtt_ms(), 30);
+	//a duplicate is not a retransmission
+	TEST_CHECK(!generator.on_packet(1, now + 31000));
+
+	//the missing packet is requested again after the round trip time
+	TEST_CHECK_EQ(generator.get_nack_list(now + 31000, sequences, RTCP_NACK_MAX_SEQUENCES), 0);
+	TEST_CHECK_EQ(generator.get_nack_list(now + 40000, sequences, RTCP_NACK_MAX_SEQUENCES), 1);
+	TEST_CHECK_EQ(sequences[0], 0);
+
+	//a reordered packet which was not requested yet only closes its gap
+	TEST_CHECK(!generator.on_packet(5, now + 41000));
+	TEST_CHECK(!generator.on_packet(4, now + 41000));
+	//the packet recovered by FEC is not requested
+	generator.on_recovered(3, now + 41000);
+	TEST_CHECK_EQ(generator.get_nack_list(now + 100000, sequences, RTCP_NACK_MAX_SEQUENCES), 1);
+	TEST_CHECK_EQ(sequences[0], 0);
+
+	//the packet which is too old to play out is given up
+	TEST_CHECK_EQ(generator.get_nack_list(now + RTCP_NACK_MAX_AGE_MS * 1000, sequences, RTCP_NACK_MAX_SEQUENCES), 0);
+
+	RTCPNackStats stats;
+	generator.get_stats(stats);
+	TEST_CHECK_EQ(stats.missing, 4);
+	TEST_CHECK_EQ(stats.requests, 4);
+	TEST_CHECK_EQ(stats.recovered, 1);
+	TEST_CHECK_EQ(stats.abandoned, 1);
+}
+
+static void test_large_gap()
+{
+	RTCPNackGenerator generator;
+	uint16_t sequences[RTCP_NACK_MAX_SEQUENCES];
+
+	//a gap larger than the list is left to the keyframe recovery
+	TEST_CHECK(!generator.on_packet(100, 0));
+	TEST_CHECK(!generator.on_packet(100 + RTCP_NACK_LIST_SIZE + 2, 0));
+	TEST_CHECK_EQ(generator.get_nack_list(0, sequences, RTCP_NACK_MAX_SEQUENCES), 0);
+}
+
+static void test_generic_nack_round_trip()
+{
+	//the sequences are packed into PID and BLP pairs, 17 sequences per pair at most
+	uint16_t lost[] = {100, 101, 116, 117, 300, 301, 302, 1000};
+	int count = sizeof(lost) / sizeof(lost[0]);
+
+	uint8_t buffer[RTCP_PACKET_BUFFER_SIZE];
+	int len = rtcp_build_generic_nack(buffer, sizeof(buffer), 0x11111111, 0x22222222, lost, count);
+	//4 pairs: 100-116, 117, 300-302, 1000
+	TEST_CHECK_EQ(len, RTCP_HEADER_SIZE + 8 + 4 * 4);
+	TEST_CHECK(rtcp_is_rtcp_packet(buffer, len));
+
+	RTCPCompoundReader reader(buffer, len);
+	TEST_CHECK(reader.next());
+	TEST_CHECK_EQ(reader.get_type(), RTCP_PT_RTPFB);
+	TEST_CHECK_EQ(reader.get_count(), RTCP_FMT_GENERIC_NACK);
+
+	uint32_t mediaSsrc = 0;
+	uint16_t parsed[RTCP_NACK_MAX_SEQUENCES];
+	TEST_CHECK_EQ(reader.parse_generic_nack(mediaSsrc, parsed, RTCP_NACK_MAX_SEQUENCES), count);
+	TEST_CHECK_EQ(mediaSsrc, 0x22222222);
+	for (int i = 0; i < count; i++)
+	{
+		TEST_CHECK_EQ(parsed[i], lost[i]);
+	}
+}
+
+//write an rtp packet with the 3 words header extension
+static int make_packet(uint8_t *buffer, uint16_t sequence, uint8_t fill)
+{
+	memset(buffer, fill, 200);
+	buffer[0] = 0x90;
+	buffer[1] = 96;
+	buffer[2] = (uint8_t)(sequence >> 8);
+	buffer[3] = (uint8_t)sequence;
+	buffer[12] = 0xBE;
+	buffer[13] = 0xDE;
+	buffer[14] = 0;
+	buffer[15] = 3;
+	return 200;
+}
+
+static void test_packet_history()
+{
+	RTPPacketHistory history;
+	TEST_CHECK(history.init());
+
+	uint8_t packet[RTP_HISTORY_SLOT_SIZE];
+	uint8_t buffer[RTP_HISTORY_SLOT_SIZE];
+	int len = make_packet(packet, 7, 0x5A);
+	TEST_CHECK(history.put(packet, len));
+
+	//the stored packet is retransmitted once per interval
+	TEST_CHECK_EQ(history.get_for_retransmit(7, 1000000, 20000, buffer), len);
+	TEST_CHECK(memcmp(buffer, packet, len) == 0);
+	TEST_CHECK_EQ(history.get_for_retransmit(7, 1010000, 20000, buffer), 0);
+	TEST_CHECK_EQ(history.get_for_retransmit(7, 1020000, 20000, buffer), len);
+
+	//the packet is overwritten by the packet of the same slot
+	len = make_packet(packet, 7 + RTP_HISTORY_SIZE, 0x3C);
+	TEST_CHECK(history.put(packet, len));
+	TEST_CHECK_EQ(history.get_for_retransmit(7, 2000000, 20000, buffer), 0);
+	TEST_CHECK_EQ(history.get_for_retransmit(7 + RTP_HISTORY_SIZE, 2000000, 20000, buffer), len);
+	TEST_CHECK_EQ(buffer[len - 1], 0x3C);
+}
+
+int main()
+{
+	test_nack_list();
+	test_large_gap();
+	test_generic_nack_round_trip();
+	test_packet_history();
+	return test_result("test_rtcp_nack");
+}
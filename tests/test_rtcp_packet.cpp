@@ -0,0 +1,114 @@
+#include "test_common.h"
+
+#include <string.h>
+
+#include "rtcp_packet.h"
+
+static RTCPReportBlock make_block(uint32_t ssrc, int32_t cumulativeLost)
+{
+	RTCPReportBlock block;
+	block.ssrc = ssrc;
+	block.fractionLost = 25;
+	block.cumulativeLost = cumulativeLost;
+	block.extendedHighestSequence = 0x00012345;
+	block.jitter = 321;
+	block.lastSR = 0xAABBCCDD;
+	block.delaySinceLastSR = 65536 * 3;
+	return block;
+}
+
+static void check_block(const RTCPReportBlock &a, const RTCPReportBlock &b)
+{
+	TEST_CHECK_EQ(a.ssrc, b.ssrc);
+	TEST_CHECK_EQ(a.fractionLost, b.fractionLost);
+	TEST_CHECK_EQ(a.cumulativeLost, b.cumulativeLost);
+	TEST_CHECK_EQ(a.extendedHighestSequence, b.extendedHighestSequence);
+	TEST_CHECK_EQ(a.jitter, b.jitter);
+	TEST_CHECK_EQ(a.lastSR, b.lastSR);
+	TEST_CHECK_EQ(a.delaySinceLastSR, b.delaySinceLastSR);
+}
+
+static void test_compound_round_trip()
+{
+	RTCPSenderInfo info;
+	info.ntpMsw = 0x83AA7E80;
+	info.ntpLsw = 0x12345678;
+	info.rtpTimestamp = 90000;
+	info.packetCount = 1000;
+	info.octetCount = 1200000;
+
+	//the cumulative lost is 24 bits signed, the duplicates make it negative
+	RTCPReportBlock blocks[2];
+	blocks[0] = make_block(0x11111111, 42);
+	blocks[1] = make_block(0x22222222, -5);
+
+	uint8_t buffer[RTCP_PACKET_BUFFER_SIZE];
+	int srLen = rtcp_build_sender_report(buffer, sizeof(buffer), 0xCAFEBABE, info, blocks, 2);
+	TEST_CHECK_EQ(srLen, RTCP_HEADER_SIZE + 4 + RTCP_SENDER_INFO_SIZE + 2 * RTCP_REPORT_BLOCK_SIZE);
+	int rrLen = rtcp_build_receiver_report(buffer + srLen, sizeof(buffer) - srLen, 0x33333333, blocks + 1, 1);
+	TEST_CHECK_EQ(rrLen, RTCP_HEADER_SIZE + 4 + RTCP_REPORT_BLOCK_SIZE);
+	TEST_CHECK(rtcp_is_rtcp_packet(buffer, srLen + rrLen));
+
+	RTCPCompoundReader reader(buffer, srLen + rrLen);
+	RTCPReport report;
+
+	TEST_CHECK(reader.next());
+	TEST_CHECK_EQ(reader.get_type(), RTCP_PT_SR);
+	TEST_CHECK_EQ(reader.get_count(), 2);
+	TEST_CHECK_EQ(reader.get_length(), srLen);
+	TEST_CHECK(reader.parse_report(report));
+	TEST_CHECK_EQ(report.type, RTCP_PT_SR);
+	TEST_CHECK_EQ(report.ssrc, 0xCAFEBABE);
+	TEST_CHECK_EQ(report.senderInfo.ntpMsw, info.ntpMsw);
+	TEST_CHECK_EQ(report.senderInfo.ntpLsw, info.ntpLsw);
+	TEST_CHECK_EQ(report.senderInfo.rtpTimestamp, info.rtpTimestamp);
+	TEST_CHECK_EQ(report.senderInfo.packetCount, info.packetCount);
+	TEST_CHECK_EQ(report.senderInfo.octetCount, info.octetCount);
+	TEST_CHECK_EQ(report.blockCount, 2);
+	check_block(report.blocks[0], blocks[0]);
+	check_block(report.blocks[1], blocks[1]);
+
+	TEST_CHECK(reader.next());
+	TEST_CHECK_EQ(reader.get_type(), RTCP_PT_RR);
+	TEST_CHECK(reader.parse_report(report));
+	TEST_CHECK_EQ(report.type, RTCP_PT_RR);
+	TEST_CHECK_EQ(report.ssrc, 0x33333333);
+	TEST_CHECK_EQ(report.blockCount, 1);
+	check_block(report.blocks[0], blocks[1]);
+
+	TEST_CHECK(!reader.next());
+}
+
+static void test_malformed()
+{
+	RTCPReportBlock block = make_block(0x11111111, 1);
+	uint8_t buffer[RTCP_PACKET_BUFFER_SIZE];
+
+	//the buffer is too small for the report
+	TEST_CHECK_EQ(rtcp_build_receiver_report(buffer, RTCP_HEADER_SIZE + 4, 0x33333333, &block, 1), 0);
+
+	//the length field exceeds the datagram
+	int len = rtcp_build_receiver_report(buffer, sizeof(buffer), 0x33333333, &block, 1);
+	RTCPCompoundReader truncated(buffer, len - 4);
+	TEST_CHECK(!truncated.next());
+
+	//the report count exceeds the packet length
+	buffer[0] = (uint8_t)((buffer[0] & 0xE0) | 2);
+	RTCPCompoundReader reader(buffer, len);
+	RTCPReport report;
+	TEST_CHECK(!reader.next() || !reader.parse_report(report));
+
+	//an rtp packet is not an rtcp packet
+	uint8_t rtp[12];
+	memset(rtp, 0, sizeof(rtp));
+	rtp[0] = 0x80;
+	rtp[1] = 96;
+	TEST_CHECK(!rtcp_is_rtcp_packet(rtp, sizeof(rtp)));
+}
+
+int main()
+{
+	test_compound_round_trip();
+	test_malformed();
+	return test_result("test_rtcp_packet");
+}
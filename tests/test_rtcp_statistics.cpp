@@ -0,0 +1,67 @@
+#include "test_common.h"
+
+#include "rtcp_statistics.h"
+
+static void test_receiver_report()
+{
+	RTCPReceiverStatistics statistics;
+	statistics.init(RTCP_DEFAULT_CLOCK_RATE);
+
+	//the sequence wraps around, 2, 5 and 7 are lost. the packets are 10 ms apart
+	//and arrive without jitter
+	const uint32_t ssrc = 0x12345678;
+	int received = 0;
+	for (uint16_t sequence = 65530; sequence != 11; sequence++)
+	{
+		if (sequence == 2 || sequence == 5 || sequence == 7)
+		{
+			continue;
+		}
+
+		uint32_t timestamp = (uint32_t)(uint16_t)(sequence + 6) * 10;
+		statistics.on_rtp_packet(ssrc, sequence, timestamp, (uint64_t)timestamp * 1000);
+		received++;
+	}
+
+	RTCPSenderInfo info;
+	info.ntpMsw = 0x83AA7E80;
+	info.ntpLsw = 0x12345678;
+	info.rtpTimestamp = 0;
+	info.packetCount = 0;
+	info.octetCount = 0;
+	RTCPReport report;
+	report.type = RTCP_PT_SR;
+	report.ssrc = ssrc;
+	report.senderInfo = info;
+	report.blockCount = 0;
+	statistics.on_sender_report(report, 5000000);
+
+	//the probation takes the first packet, the sequence base is the second one
+	RTCPReportBlock block;
+	TEST_CHECK(statistics.build_report_block(block, 5000000 + 1500000));
+	TEST_CHECK_EQ(block.ssrc, ssrc);
+	TEST_CHECK_EQ(block.extendedHighestSequence, 65536 + 10);
+	TEST_CHECK_EQ(block.cumulativeLost, 3);
+	TEST_CHECK_EQ(block.fractionLost, (3 << 8) / 16);
+	TEST_CHECK_EQ(block.jitter, 0);
+	TEST_CHECK_EQ(block.lastSR, 0x7E801234);
+	TEST_CHECK_EQ(block.delaySinceLastSR, 65536 * 3 / 2);
+
+	//nothing was lost in the next interval
+	TEST_CHECK(statistics.build_report_block(block, 5000000 + 2500000));
+	TEST_CHECK_EQ(block.cumulativeLost, 3);
+	TEST_CHECK_EQ(block.fractionLost, 0);
+
+	RTCPReceiveStats stats;
+	statistics.get_stats(stats);
+	TEST_CHECK_EQ(stats.packetsReceived, received);
+	TEST_CHECK_EQ(stats.cumulativeLost, 3);
+	TEST_CHECK_EQ(stats.senderReports, 1);
+	TEST_CHECK_EQ(stats.receiverReports, 2);
+}
+
+int main()
+{
+	test_receiver_report();
+	return test_result("test_rtcp_statistics");
+}
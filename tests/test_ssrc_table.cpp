@@ -0,0 +1,117 @@
+#include "test_common.h"
+
+#include <stdlib.h>
+#include <map>
+
+#include "rtp_ssrc_table.h"
+
+static void *make_value(uint32_t n)
+{
+	//the table only stores the pointer, it is never dereferenced
+	return (void *)(uintptr_t)(n + 1);
+}
+
+static void test_insert_remove()
+{
+	RTPSsrcTable table;
+	//the lookups before the first insert are safe
+	TEST_CHECK(table.find(1) == NULL);
+	TEST_CHECK(!table.remove(1));
+	TEST_CHECK(!table.insert(1, NULL));
+
+	TEST_CHECK(table.insert(1, make_value(1)));
+	TEST_CHECK(table.insert(0, make_value(0)));
+	TEST_CHECK(table.insert(0xFFFFFFFF, make_value(2)));
+	TEST_CHECK_EQ(table.get_count(), 3);
+	TEST_CHECK(table.find(0) == make_value(0));
+	TEST_CHECK(table.find(1) == make_value(1));
+	TEST_CHECK(table.find(0xFFFFFFFF) == make_value(2));
+	TEST_CHECK(table.find(2) == NULL);
+
+	//the value of an existing ssrc is replaced
+	TEST_CHECK(table.insert(1, make_value(10)));
+	TEST_CHECK_EQ(table.get_count(), 3);
+	TEST_CHECK(table.find(1) == make_value(10));
+
+	TEST_CHECK(table.remove(1));
+	TEST_CHECK(!table.remove(1));
+	TEST_CHECK(table.find(1) == NULL);
+	TEST_CHECK(table.find(0) == make_value(0));
+	TEST_CHECK_EQ(table.get_count(), 2);
+}
+
+static void test_growth()
+{
+	RTPSsrcTable table;
+	TEST_CHECK(table.init(4));
+
+	//the table grows past its initial capacity and keeps all entries
+	const uint32_t count = 5000;
+	uint32_t i;
+	for (i = 0; i < count; i++)
+	{
+		TEST_CHECK(table.insert(i * 0x10000, make_value(i)));
+	}
+	TEST_CHECK_EQ(table.get_count(), count);
+
+	int missing = 0;
+	for (i = 0; i < count; i++)
+	{
+		if (table.find(i * 0x10000) != make_value(i))
+		{
+			missing++;
+		}
+	}
+	TEST_CHECK_EQ(missing, 0);
+}
+
+static void test_against_map()
+{
+	//the keys come from a small range, so the clusters are long and the removal shifts often
+	RTPSsrcTable table;
+	TEST_CHECK(table.init(16));
+	std::map<uint32_t, void *> reference;
+
+	srand(24);
+	int mismatches = 0;
+	for (int step = 0; step < 200000; step++)
+	{
+		uint32_t ssrc = (uint32_t)(rand() % 512) * 0x01000193u;
+		if (rand() % 3 == 0)
+		{
+			bool removed = table.remove(ssrc);
+			if (removed != (reference.erase(ssrc) > 0))
+			{
+				mismatches++;
+			}
+		}
+		else
+		{
+			void *value = make_value((uint32_t)step);
+			table.insert(ssrc, value);
+			reference[ssrc] = value;
+		}
+
+		uint32_t probe = (uint32_t)(rand() % 512) * 0x01000193u;
+		std::map<uint32_t, void *>::const_iterator it = reference.find(probe);
+		if (table.find(probe) != (it == reference.end() ? NULL : it->second))
+		{
+			mismatches++;
+		}
+	}
+
+	TEST_CHECK_EQ(mismatches, 0);
+	TEST_CHECK_EQ(table.get_count(), reference.size());
+	for (std::map<uint32_t, void *>::const_iterator it = reference.begin(); it != reference.end(); ++it)
+	{
+		TEST_CHECK(table.find(it->first) == it->second);
+	}
+}
+
+int main()
+{
+	test_insert_remove();
+	test_growth();
+	test_against_map();
+	return test_result("test_ssrc_table");
+}
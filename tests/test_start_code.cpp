@@ -0,0 +1,95 @@
+#include "test_common.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//the scanners are static, the source is compiled into the test to reach them
+#include "codec_utils.cpp"
+
+typedef const uint8_t *(*FindStartCodeFunc)(const uint8_t *start, const uint8_t *end);
+
+//compare a scanner with the scalar one, returns the mismatches count
+static int compare_scanner(FindStartCodeFunc scanner, const uint8_t *buffer, int size)
+{
+	int mismatches = 0;
+	//every start offset covers the unaligned heads and every length covers the tails
+	for (int offset = 0; offset < 40 && offset < size; offset++)
+	{
+		for (int length = 0; offset + length <= size; length += (length < 80 ? 1 : 37))
+		{
+			const uint8_t *start = buffer + offset;
+			const uint8_t *end = start + length;
+			if (scanner(start, end) != AVCFindStartCodeInternal(start, end))
+			{
+				mismatches++;
+			}
+		}
+	}
+	return mismatches;
+}
+
+static void fill_random(uint8_t *buffer, int size, int zeroPercent)
+{
+	for (int i = 0; i < size; i++)
+	{
+		int r = rand() % 100;
+		buffer[i] = r < zeroPercent ? 0 : (r < zeroPercent + 10 ? 1 : (uint8_t)(2 + rand() % 254));
+	}
+}
+
+static void test_scanners(FindStartCodeFunc scanner)
+{
+	uint8_t buffer[1024];
+
+	//no start code at all
+	memset(buffer, 0xFF, sizeof(buffer));
+	TEST_CHECK_EQ(compare_scanner(scanner, buffer, sizeof(buffer)), 0);
+	//only zeros, the zero runs must not be reported
+	memset(buffer, 0, sizeof(buffer));
+	TEST_CHECK_EQ(compare_scanner(scanner, buffer, sizeof(buffer)), 0);
+
+	//a single start code at every position, including across the 16 and 32 byte blocks
+	for (int pos = 0; pos < 100; pos++)
+	{
+		memset(buffer, 0xFF, 160);
+		buffer[pos] = 0;
+		buffer[pos + 1] = 0;
+		buffer[pos + 2] = 1;
+		TEST_CHECK_EQ(compare_scanner(scanner, buffer, 160), 0);
+	}
+
+	//the dense random data has many candidates and false positives of the zero byte test
+	srand(15);
+	for (int round = 0; round < 20; round++)
+	{
+		fill_random(buffer, sizeof(buffer), round % 2 ? 60 : 20);
+		TEST_CHECK_EQ(compare_scanner(scanner, buffer, sizeof(buffer)), 0);
+	}
+}
+
+static void test_avc_find_start_code()
+{
+	//the 4 bytes start code is reported from its first zero
+	const uint8_t data[] = { 0xFF, 0x00, 0x00, 0x00, 0x01, 0x65, 0x00, 0x00, 0x01, 0x41 };
+	const uint8_t *end = data + sizeof(data);
+	TEST_CHECK(avc_find_start_code(data, end) == data + 1);
+	TEST_CHECK(avc_find_start_code(data + 5, end) == data + 6);
+	TEST_CHECK(avc_find_start_code(data + 7, end) == end);
+	TEST_CHECK(avc_find_start_code(data, data) == data);
+}
+
+int main()
+{
+#ifdef CODEC_HAVE_SSE2
+	test_scanners(AVCFindStartCodeSSE2);
+#endif
+#ifdef CODEC_HAVE_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		test_scanners(AVCFindStartCodeAVX2);
+	}
+#endif
+	test_avc_find_start_code();
+	return test_result("test_start_code");
+}